@@ -7,12 +7,22 @@ and may not be redistributed without written permission.*/
 #include <SDL2/SDL.h>
 #include <stdio.h>
 #include <iostream> // addition
+#include "../common/startup_profiler.h"
+#include "../common/fill_engine.h"
+#include "../common/job_system.h"
+#include <string>
 
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
+//Fill the window through common/fill_engine.h instead of SDL_FillRect (--fill solid|vertical|horizontal|checker)
+FillMode gFillMode = FILL_MODE_TOTAL;
+
+//Workers the fill is split across, only started for --fill
+JobSystem gJobs;
+
 /*
 ------------------------------------------------------------------------------------------------------------------------------------------------------------------
 At the top of our source file we include SDL since we're going to need the SDL functions and datatypes to make any SDL code. 
@@ -25,6 +35,26 @@ After including our headers, we declare the width and height of the window we're
 
 int main( int argc, char* args[] )
 {
+  //Time startup phases from here
+  startupBegin();
+
+  //Read the command line
+  for( int i = 1; i < argc; ++i )
+  {
+    if( std::string( args[ i ] ) == "--fill" && i + 1 < argc )
+    {
+      gFillMode = fillModeFromName( args[ ++i ] );
+      if( gFillMode == FILL_MODE_TOTAL )
+      {
+        std::cout << "Unknown fill mode " << args[ i ] << ", use solid, vertical, horizontal or checker" << std::endl;
+      }
+    }
+  }
+  if( gFillMode != FILL_MODE_TOTAL )
+  {
+    startJobSystem( gJobs );
+  }
+
   //The window we'll be rendering to
   SDL_Window* window = NULL;
 
@@ -64,6 +94,8 @@ SDL_GetError will let you know if any errors happened inside of any SDL function
 */
   else
   {
+    startupMark( "SDL_Init" );
+
     //Create window
     window = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
     if( window == NULL )
@@ -86,14 +118,34 @@ If there is an error, SDL_CreateWindow returns NULL. If there's no window, we wa
 */
     else
     {
+      startupMark( "SDL_CreateWindow" );
+
       //Get window surface
       screenSurface = SDL_GetWindowSurface( window );
+      startupMark( "SDL_GetWindowSurface" );
 
       //Fill the surface white
-      SDL_FillRect( screenSurface, NULL, SDL_MapRGB( screenSurface->format, 0x77, 0xFF, 0xFF ) );
+      Uint32 color = SDL_MapRGB( screenSurface->format, 0x77, 0xFF, 0xFF );
+      if( gFillMode == FILL_MODE_TOTAL )
+      {
+        SDL_FillRect( screenSurface, NULL, color );
+      }
+      else
+      {
+        //The same color fading to, or checkered with, a darker one
+        Uint32 dark = SDL_MapRGB( screenSurface->format, 0x10, 0x40, 0x60 );
+        FillSpec spec = gFillMode == FILL_SOLID ? solidFill( color ) : gFillMode == FILL_CHECKER ? checkerFill( color, dark, 32 ) : gradientFill( gFillMode == FILL_VERTICAL_GRADIENT, color, dark );
+        Uint64 fillStart = SDL_GetPerformanceCounter();
+        if( fillSurface( screenSurface, NULL, spec, FILL_PATH_AUTO, &gJobs ) < 0 )
+        {
+          std::cout << "Unable to fill the window surface! SDL_Error: " << SDL_GetError() << std::endl;
+        }
+        std::cout << fillModeName( gFillMode ) << " fill (" << fillPathName( bestFillPath() ) << "): " << ( SDL_GetPerformanceCounter() - fillStart ) * 1000.0 / SDL_GetPerformanceFrequency() << " ms" << std::endl;
+      }
 
       //Update the surface
       SDL_UpdateWindowSurface( window );
+      startupFirstFrame( "01" );
 
       //Hack to get window to stay up
       SDL_Event e; bool quit = false; while( quit == false ){ while( SDL_PollEvent( &e ) ){ if( e.type == SDL_QUIT ) quit = true; } }
@@ -107,6 +159,11 @@ If the window was created successfully, we want to get the window's surface so w
 To keep this tutorial simple, all we're going to do here is fill the window's surface white using SDL_FillRect. 
 Don't worry too much about this function here. This tutorial is only concerned about getting a window to pop up.
 
+Run with --fill solid, vertical, horizontal or checker and the window is filled by fillSurface from common/fill_engine.h instead, 
+which splits the rows into jobs on a job system (common/job_system.h, a worker per core) and writes them with SIMD (and, on big surfaces, non-temporal) stores, and can do gradients 
+and a checker pattern at the cost of a plain fill. It prints how long the fill took; tools/fill_bench compares it to SDL_FillRect 
+at sizes up to 8K, where the difference actually shows.
+
 An important thing to know about rendering is that just because you've drawn something to the screen surface doesn't mean you'll see it. 
 After you've done all your drawing you need to update the window so it shows everything you drew. A call to **SDL_UpdateWindowSurface** will do this.
 
@@ -123,6 +180,12 @@ find out that hacky code is the basically the only way games get shipped on any
   //Destroy window
   SDL_DestroyWindow( window );
 
+  //Stop the fill's workers
+  if( jobWorkerCount( gJobs ) > 0 )
+  {
+    stopJobSystem( gJobs );
+  }
+
   //Quit SDL subsystems
   SDL_Quit();
 
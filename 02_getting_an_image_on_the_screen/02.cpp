@@ -6,6 +6,7 @@ and may not be redistributed without written permission.*/
 //Using SDL and standard IO
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include "../common/startup_profiler.h"
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -75,6 +76,8 @@ bool init()
 	}
 	else
 	{
+		startupMark( "SDL_Init" );
+
 		//Create window
 		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
 		if( gWindow == NULL )
@@ -84,8 +87,11 @@ bool init()
 		}
 		else
 		{
+			startupMark( "SDL_CreateWindow" );
+
 			//Get window surface
 			gScreenSurface = SDL_GetWindowSurface( gWindow );
+			startupMark( "SDL_GetWindowSurface" );
 		}
 	}
 
@@ -168,6 +174,9 @@ Get into the habit of taking undefined behavior seriously now because you do not
 
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -182,6 +191,8 @@ int main( int argc, char* args[] )
 		}
 		else
 		{
+			startupMark( "loadMedia" );
+
 			//Apply the image
 			SDL_BlitSurface( gHelloWorld, NULL, gScreenSurface, NULL );
 
@@ -199,6 +210,7 @@ Now if this was the only code for drawing we had, we still wouldn't see the imag
 			
 			//Update the surface
 			SDL_UpdateWindowSurface( gWindow );
+			startupFirstFrame( "02" );
 /*
 -------------------------------------------------------------------------------------------------------------------------------------------------------------------
 After drawing everything on the screen that we want to show for this frame we have to update the screen using SDL_UpdateWindowSurface. 
@@ -3,9 +3,13 @@ and may not be redistributed without written permission.*/
 
 // --------------------------------------------------|| 03 Event driven programming ||------------------------------------------------------
 
-//Using SDL and standard IO
+//Using SDL, standard IO, and strings
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <string>
+#include "../common/startup_profiler.h"
+#include "../common/flat_image.h"
+#include "../common/perf_counters.h"
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -29,9 +33,57 @@ SDL_Surface* gScreenSurface = NULL;
 //The image we will load and show on the screen
 SDL_Surface* gXOut = NULL;
 
+//Hold the image in a compact encoding instead (--encoding auto|surface|sdl-rle|indexed|runs)
+bool gEncode = false;
+FlatEncoding gEncoding = FLAT_ENCODING_AUTO;
+
+//The image as our own runs, when that is the encoding
+FlatRuns gXOutRuns;
+bool gUseRuns = false;
+
+//Time spent blitting the image, for the exit report
+Uint64 gBlitTicks = 0;
+int gBlits = 0;
+
+//Hardware counters per frame, per blit and around loadMedia, written as JSON to gPerfPath on exit (--perf out.json)
+const char* gPerfPath = NULL;
+PerfCounters gPerfCounters;
+PerfRegion gPerfFrame;
+PerfRegion gPerfBlit;
+PerfRegion gPerfLoad;
+
 
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
+	//Check for an in-memory encoding
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--encoding" && i + 1 < argc )
+		{
+			gEncode = flatEncodingFromName( args[ ++i ], gEncoding );
+			if( !gEncode )
+			{
+				printf( "Unknown encoding %s, using the plain surface\n", args[ i ] );
+			}
+		}
+		else if( std::string( args[ i ] ) == "--perf" && i + 1 < argc )
+		{
+			gPerfPath = args[ ++i ];
+		}
+	}
+
+	//Open the counters before anything we want counted
+	initPerfRegion( gPerfFrame, "frame" );
+	initPerfRegion( gPerfBlit, "blit" );
+	initPerfRegion( gPerfLoad, "loadMedia" );
+	if( gPerfPath != NULL )
+	{
+		openPerfCounters( gPerfCounters );
+	}
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -40,12 +92,17 @@ int main( int argc, char* args[] )
 	else
 	{
 		//Load media
-		if( !loadMedia() )
+		beginPerfRegion( gPerfCounters, gPerfLoad );
+		bool loaded = loadMedia();
+		endPerfRegion( gPerfCounters, gPerfLoad );
+		if( !loaded )
 		{
 			printf( "Failed to load media!\n" );
 		}
 		else
 		{			
+			startupMark( "loadMedia" );
+
 			//Main loop flag
 			bool quit = false;
 
@@ -65,6 +122,8 @@ In this application we're going to look for quit events to end the application.
 			//While application is running
 			while( !quit )
 			{
+				beginPerfRegion( gPerfCounters, gPerfFrame );
+
 
 /*
 -------------------------------------------------------------------------------------------------------------------------------------------------
@@ -104,16 +163,44 @@ we set the quit flag to true so we can exit the application.
 -------------------------------------------------------------------------------------------------------------------------------------------------
 */
 				//Apply the image
-				SDL_BlitSurface( gXOut, NULL, gScreenSurface, NULL );
+				Uint64 blitStart = SDL_GetPerformanceCounter();
+				beginPerfRegion( gPerfCounters, gPerfBlit );
+				if( gUseRuns )
+				{
+					blitFlatRuns( gXOutRuns, gScreenSurface, NULL );
+				}
+				else if( gEncode )
+				{
+					blitFlatSurface( gXOut, gScreenSurface, NULL );
+				}
+				else
+				{
+					SDL_BlitSurface( gXOut, NULL, gScreenSurface, NULL );
+				}
+				endPerfRegion( gPerfCounters, gPerfBlit );
+				gBlitTicks += SDL_GetPerformanceCounter() - blitStart;
+				++gBlits;
 			
 				//Update the surface
 				SDL_UpdateWindowSurface( gWindow );
+				startupFirstFrame( "03" );
+				endPerfRegion( gPerfCounters, gPerfFrame );
 			}
 /*
 -------------------------------------------------------------------------------------------------------------------------------------------------
 After we're done processing the events for our frame, we draw to the screen and update it (as discussed in the previous tutorial). 
 If the quit flag was set to true, the application will exit at the end of the loop. 
 If it is still false it will keep going until the user Xs out the window.
+
+x.bmp is a black X on white, 17 colors in all, yet as a surface it takes a full 4 bytes a pixel. Run with --encoding auto to hold it 
+as whichever of common/flat_image.h's encodings is smallest for it (our own color runs, about 50 KB instead of 1.2 MB) or name one: 
+surface, sdl-rle, indexed or runs. Loading prints the memory it takes and exiting prints the average blit time.
+
+The time doesn't say why a blit takes what it takes. Run with --perf out.json (- for the console) to read the CPU's own counters 
+through common/perf_counters.h around loadMedia, every frame and every blit: cycles, instructions, cache, branch and TLB misses. 
+Exiting prints instructions per cycle and misses per thousand instructions, and writes the totals and each frame's counts as JSON. 
+Few instructions per cycle and many misses means the blit waits on memory, which is what the encodings above cut down. 
+Most containers don't allow the counters; the lesson then says so once and runs as usual.
 -------------------------------------------------------------------------------------------------------------------------------------------------
 */
 		}
@@ -140,6 +227,8 @@ bool init()
 	}
 	else
 	{
+		startupMark( "SDL_Init" );
+
 		//Create window
 		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
 		if( gWindow == NULL )
@@ -149,8 +238,11 @@ bool init()
 		}
 		else
 		{
+			startupMark( "SDL_CreateWindow" );
+
 			//Get window surface
 			gScreenSurface = SDL_GetWindowSurface( gWindow );
+			startupMark( "SDL_GetWindowSurface" );
 		}
 	}
 
@@ -170,12 +262,77 @@ bool loadMedia()
 		printf( "Unable to load image %s! SDL Error: %s\n", "03_event_driven_programming/x.bmp", SDL_GetError() );
 		success = false;
 	}
+	else if( gEncode )
+	{
+		//Measure the image and pick (or use) an encoding for the screen's format
+		SDL_Surface* converted = SDL_ConvertSurface( gXOut, gScreenSurface->format, 0 );
+		FlatEncoding encoding = gEncoding;
+		FlatImageStats stats = {};
+		if( converted != NULL && converted->format->BytesPerPixel == 4 )
+		{
+			stats = analyzeFlatSurface( converted );
+			if( encoding == FLAT_ENCODING_AUTO )
+			{
+				encoding = chooseFlatEncoding( stats, true );
+			}
+		}
+		size_t plainBytes = converted != NULL ? (size_t)converted->pitch * converted->h : 0;
+		SDL_FreeSurface( converted );
+
+		size_t bytes = 0;
+		SDL_Surface* encoded = NULL;
+		if( encoding == FLAT_ENCODING_RUNS && encodeFlatRuns( gXOut, gScreenSurface->format, gXOutRuns ) )
+		{
+			gUseRuns = true;
+			bytes = flatRunsBytes( gXOutRuns );
+		}
+		else
+		{
+			//SDL swaps an sdl-rle image's pixels for its runs on the first blit, their size is an estimate
+			encoded = encodeFlatSurface( gXOut, gScreenSurface->format, encoding, &encoding, &bytes );
+			if( encoded == NULL )
+			{
+				printf( "Unable to encode x.bmp! SDL Error: %s\n", SDL_GetError() );
+				success = false;
+			}
+		}
+		SDL_FreeSurface( gXOut );
+		gXOut = encoded;
+
+		if( success )
+		{
+			printf( "x.bmp as %s: %s%.1f KB (%.1f KB as a plain surface)\n", gUseRuns ? "runs" : flatEncodingName( encoding ),
+				encoding == FLAT_ENCODING_SDL_RLE ? "about " : "", bytes / 1024.0, plainBytes / 1024.0 );
+		}
+	}
 
 	return success;
 }
 
 void close()
 {
+	//Report blit cost
+	if( gBlits > 0 )
+	{
+		printf( "Average blit: %.3f ms over %d frames\n", gBlitTicks * 1000.0 / SDL_GetPerformanceFrequency() / gBlits, gBlits );
+	}
+
+	//Report and write the counters
+	if( gPerfCounters.opened > 0 )
+	{
+		printPerfRegion( gPerfLoad );
+		printPerfRegion( gPerfFrame );
+		printPerfRegion( gPerfBlit );
+
+		BenchReport report;
+		report.suite = "03";
+		addPerfRegionResult( report, gPerfCounters, gPerfLoad );
+		addPerfRegionResult( report, gPerfCounters, gPerfFrame );
+		addPerfRegionResult( report, gPerfCounters, gPerfBlit );
+		writeBenchReport( report, gPerfPath );
+		closePerfCounters( gPerfCounters );
+	}
+
 	//Deallocate surface
 	SDL_FreeSurface( gXOut );
 	gXOut = NULL;
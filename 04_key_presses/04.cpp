@@ -7,7 +7,17 @@ and may not be redistributed without written permission.*/
 //Using SDL, standard IO, and strings
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include "../common/strip_qoi.h"
+#include "../common/job_system.h"
+#include "../common/startup_profiler.h"
+#include "../common/hot_reload.h"
+#include "../common/resource_tracker.h"
+#include "../common/flat_image.h"
+#include "../common/frame_recorder.h"
+#include "../common/frame_hud.h"
+#include "../common/telemetry_ring.h"
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -53,6 +63,19 @@ void close();
 //Loads individual image
 SDL_Surface* loadSurface( std::string path );
 
+//Gets a key press surface, loading it on demand if the prefetcher hasn't got to it yet, and optionally makes it the current one.
+//Without waitForLoad it returns NULL instead of waiting for a load already in progress
+SDL_Surface* getKeyPressSurface( int key, bool makeCurrent = false, bool waitForLoad = true );
+
+//Frees the key press image shown least recently to stay under the memory budget
+bool evictKeyPressSurface();
+
+//Queues a job per remaining key press surface to prefetch it
+void startPrefetch();
+
+//Swaps in key press images the hot reloader has decoded since the last frame
+void applyHotReloads();
+
 //+++++++++++
 
 //The window we'll be rendering to
@@ -64,9 +87,68 @@ SDL_Surface* gScreenSurface = NULL;
 //The images that correspond to a keypress
 SDL_Surface* gKeyPressSurfaces[ KEY_PRESS_SURFACE_TOTAL ];
 
-//Current displayed image
+//The files the keypress images are loaded from
+const char* gKeyPressPaths[ KEY_PRESS_SURFACE_TOTAL ] = { "press.bmp", "up.bmp", "down.bmp", "left.bmp", "right.bmp" };
+
+//Load state of each keypress image
+enum KeyPressLoadState
+{
+	KEY_PRESS_LOAD_EMPTY,
+	KEY_PRESS_LOAD_LOADING,
+	KEY_PRESS_LOAD_READY
+};
+KeyPressLoadState gKeyPressStates[ KEY_PRESS_SURFACE_TOTAL ];
+
+//Guards the keypress images and their load states
+SDL_mutex* gKeyPressMutex = NULL;
+
+//Signaled whenever a keypress image finishes loading
+SDL_cond* gKeyPressLoaded = NULL;
+
+//Workers the keypress images are prefetched and .qois strips decoded on, this thread is worker 0
+JobSystem gJobs;
+
+//Prefetch jobs not finished yet
+JobCounter gPrefetchJobs( 0 );
+bool gPrefetchStarted = false;
+
+//Tells prefetch jobs that haven't started to skip their image
+SDL_atomic_t gPrefetchCancel;
+
+//Load every image up front like the original lesson (for comparison)
+bool gEagerLoad = false;
+
+//Reload key press images when their files change (--hot-reload)
+bool gHotReload = false;
+HotReloader gHotReloader;
+int gKeyPressWatches[ KEY_PRESS_SURFACE_TOTAL ];
+
+//Reloads that came in while their image was still loading (maybe from the old file), swapped in once it's ready
+HotReloadResult gPendingReloads[ KEY_PRESS_SURFACE_TOTAL ];
+
+//Current displayed image, changed under gKeyPressMutex so the evictor never frees it
 SDL_Surface* gCurrentSurface = NULL;
 
+//When each keypress image was last made current, for eviction
+Uint64 gKeyPressLastShown[ KEY_PRESS_SURFACE_TOTAL ];
+
+//Cap on surface memory in bytes, 0 for none (--memory-budget MB)
+size_t gMemoryBudget = 0;
+
+//Hold key press images in a compact encoding (--encoding auto|surface|sdl-rle|indexed)
+bool gEncode = false;
+FlatEncoding gEncoding = FLAT_ENCODING_AUTO;
+
+//Record each frame's blit and skip it while the window surface still shows it (--elide-overdraw), and show how many
+//times each pixel was written as a heatmap instead (--overdraw)
+FrameRecorder gFrameRecorder;
+
+//Frame time graph and per frame counts drawn over the image, F3 shows and hides it (--hud starts it shown)
+FrameHud gHud;
+
+//Per frame records in a shared memory ring for tools/telemetry_reader (--telemetry NAME)
+TelemetryRing gTelemetry;
+
 /*
 ------------------------------------------------------------------------------------------------------------------------------------------------
 Along with our usual function prototypes, we have a new function called loadSurface. 
@@ -76,11 +158,67 @@ we're going to use a function to handle that.
 What's important to this specific program is that we have an array of pointers to SDL surfaces called gKeyPressSurfaces to contain 
 all the images we'll be using. Depending on which key the user presses, we'll set gCurrentSurface (which is the image 
 that will be blitted to the screen) to one of these surfaces.
+
+Only press.bmp is needed to show the first frame, so the other four images are filled in lazily. gKeyPressStates tracks whether 
+each slot is empty, being loaded or ready, and gKeyPressMutex/gKeyPressLoaded let the main thread and the prefetch jobs 
+hand images to each other without both loading the same file.
 ------------------------------------------------------------------------------------------------------------------------------------------------
 */
 
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
+	//Time the program started, for time-to-first-frame
+	Uint64 startTime = SDL_GetPerformanceCounter();
+
+	//Check for the old load-everything-first behaviour
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--eager" )
+		{
+			gEagerLoad = true;
+		}
+		else if( std::string( args[ i ] ) == "--hot-reload" )
+		{
+			gHotReload = true;
+		}
+		else if( std::string( args[ i ] ) == "--memory-budget" && i + 1 < argc )
+		{
+			gMemoryBudget = (size_t)( atof( args[ ++i ] ) * 1024.0 * 1024.0 );
+		}
+		else if( std::string( args[ i ] ) == "--elide-overdraw" )
+		{
+			gFrameRecorder.elide = true;
+			gFrameRecorder.retain = true;
+		}
+		else if( std::string( args[ i ] ) == "--overdraw" )
+		{
+			gFrameRecorder.analyze = true;
+		}
+		else if( std::string( args[ i ] ) == "--hud" )
+		{
+			gHud.visible = true;
+		}
+		else if( std::string( args[ i ] ) == "--telemetry" && i + 1 < argc )
+		{
+			openTelemetryWriter( gTelemetry, args[ ++i ] );
+		}
+		else if( std::string( args[ i ] ) == "--encoding" && i + 1 < argc )
+		{
+			//Runs aren't an SDL_Surface, which everything here passes around
+			gEncode = flatEncodingFromName( args[ ++i ], gEncoding ) && gEncoding != FLAT_ENCODING_RUNS;
+			if( !gEncode )
+			{
+				printf( "04 can't hold images as %s, using plain surfaces\n", args[ i ] );
+			}
+		}
+	}
+
+	//Workers for the prefetch and .qois strips
+	startJobSystem( gJobs );
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -95,6 +233,8 @@ int main( int argc, char* args[] )
 		}
 		else
 		{	
+			startupMark( "loadMedia" );
+
 			//Main loop flag
 			bool quit = false;
 
@@ -102,7 +242,17 @@ int main( int argc, char* args[] )
 			SDL_Event e;
 
 			//Set default current surface
-			gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_DEFAULT ];
+			getKeyPressSurface( KEY_PRESS_SURFACE_DEFAULT, true );
+
+			//Latency bookkeeping
+			Uint64 frequency = SDL_GetPerformanceFrequency();
+			double firstFrameMs = -1.0;
+			double worstKeyLatencyMs = 0.0;
+			int keyPresses = 0;
+			int onDemandLoads = 0;
+
+			//When the oldest key press not yet on screen was dequeued (0 if none)
+			Uint64 keyTime = 0;
 
 			//While application is running
 			while( !quit )
@@ -111,39 +261,70 @@ int main( int argc, char* args[] )
 // In the main function before entering the main loop, we set the default surface to display. 
 
 				//Handle events on queue
+				int frameEvents = 0;
 				while( SDL_PollEvent( &e ) != 0 )
 				{
+					++frameEvents;
+
+					//Counted for the HUD, its toggle key only shows or hides it
+					if( handleHudEvent( gHud, e ) )
+					{
+						//Hiding it has to put the image back under it
+						invalidateRecordedFrame( gFrameRecorder );
+					}
 					//User requests quit
-					if( e.type == SDL_QUIT )
+					else if( e.type == SDL_QUIT )
 					{
 						quit = true;
 					}
 					//User presses a key
 					else if( e.type == SDL_KEYDOWN )
 					{
+						//Remember when the key arrived
+						if( keyTime == 0 )
+						{
+							keyTime = SDL_GetPerformanceCounter();
+						}
+						++keyPresses;
+
 						//Select surfaces based on key press
+						int key = KEY_PRESS_SURFACE_DEFAULT;
 						switch( e.key.keysym.sym )
 						{
 							case SDLK_UP:
-							gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_UP ];
+							key = KEY_PRESS_SURFACE_UP;
 							break;
 
 							case SDLK_DOWN:
-							gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_DOWN ];
+							key = KEY_PRESS_SURFACE_DOWN;
 							break;
 
 							case SDLK_LEFT:
-							gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_LEFT ];
+							key = KEY_PRESS_SURFACE_LEFT;
 							break;
 
 							case SDLK_RIGHT:
-							gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_RIGHT ];
+							key = KEY_PRESS_SURFACE_RIGHT;
 							break;
 
 							default:
-							gCurrentSurface = gKeyPressSurfaces[ KEY_PRESS_SURFACE_DEFAULT ];
+							key = KEY_PRESS_SURFACE_DEFAULT;
 							break;
 						}
+
+						//Count keys whose image wasn't prefetched in time
+						SDL_LockMutex( gKeyPressMutex );
+						if( gKeyPressStates[ key ] != KEY_PRESS_LOAD_READY )
+						{
+							++onDemandLoads;
+						}
+						SDL_UnlockMutex( gKeyPressMutex );
+
+						//Blocks until the image is there so the key press is never dropped
+						getKeyPressSurface( key, true );
+
+						//A new image can reuse a freed one's address, so don't trust the last frame's key
+						invalidateRecordedFrame( gFrameRecorder );
 					}
 				}
 
@@ -161,12 +342,83 @@ to see what the other keycodes are for other keys.
 --------------------------------------------------------------------------------------------------------------------------------------------------
 */
 
+				//Pick up reloaded images between frames
+				if( gHotReload )
+				{
+					applyHotReloads();
+				}
+
+				//Print the memory breakdown if SIGUSR1 asked for it
+				pollResourceDump();
+
 				//Apply the current image
-				SDL_BlitSurface( gCurrentSurface, NULL, gScreenSurface, NULL );
+				Uint64 blitStart = SDL_GetPerformanceCounter();
+				if( gFrameRecorder.elide || gFrameRecorder.analyze )
+				{
+					//Recorded, so an unchanged frame isn't blitted again. blitFlatSurface always covers the whole image
+					beginRecordedFrame( gFrameRecorder, gScreenSurface, gScreenSurface->w, gScreenSurface->h, gScreenSurface->format->BytesPerPixel );
+					if( gEncode )
+					{
+						SDL_Surface* surface = gCurrentSurface;
+						SDL_Rect rect = { 0, 0, surface->w, surface->h };
+						recordDraw( gFrameRecorder, &rect, true, [ surface ]() { blitFlatSurface( surface, gScreenSurface, NULL ); }, surface, &rect );
+					}
+					else
+					{
+						recordBlit( gFrameRecorder, gCurrentSurface, NULL, gScreenSurface, NULL );
+					}
+					countHudDraws( gHud, submitRecordedFrame( gFrameRecorder ) );
+					if( gFrameRecorder.analyze )
+					{
+						drawOverdrawHeatmap( gFrameRecorder, gScreenSurface );
+					}
+				}
+				else if( gEncode )
+				{
+					blitFlatSurface( gCurrentSurface, gScreenSurface, NULL );
+					countHudDraws( gHud );
+				}
+				else
+				{
+					SDL_BlitSurface( gCurrentSurface, NULL, gScreenSurface, NULL );
+					countHudDraws( gHud );
+				}
+
+				Uint64 blitEnd = SDL_GetPerformanceCounter();
+
+				//HUD goes on top of whatever this frame drew
+				drawFrameHud( gHud, gScreenSurface );
 			
 				//Update the surface
+				Uint64 presentStart = SDL_GetPerformanceCounter();
 				SDL_UpdateWindowSurface( gWindow );
+				endHudFrame( gHud );
+				writeTelemetry( gTelemetry, frameEvents, ( blitEnd - blitStart ) * 1000.0 / frequency,
+					( SDL_GetPerformanceCounter() - presentStart ) * 1000.0 / frequency );
+				startupFirstFrame( "04" );
+
+				//First frame is up, so start fetching the rest in the background
+				if( firstFrameMs < 0.0 )
+				{
+					firstFrameMs = ( SDL_GetPerformanceCounter() - startTime ) * 1000.0 / frequency;
+					startPrefetch();
+				}
+
+				//Key press made it to the screen
+				if( keyTime != 0 )
+				{
+					double latencyMs = ( SDL_GetPerformanceCounter() - keyTime ) * 1000.0 / frequency;
+					if( latencyMs > worstKeyLatencyMs )
+					{
+						worstKeyLatencyMs = latencyMs;
+					}
+					keyTime = 0;
+				}
 			}
+
+			//Report startup and input latency
+			printf( "Time to first frame: %.2f ms (%s loading)\n", firstFrameMs, gEagerLoad ? "eager" : "lazy" );
+			printf( "Worst key-to-present latency: %.2f ms over %d key presses, %d loaded on demand\n", worstKeyLatencyMs, keyPresses, onDemandLoads );
 		}
 	}
 
@@ -176,6 +428,46 @@ to see what the other keycodes are for other keys.
 	return 0;
 }
 
+/*
+-------------------------------------------------------------------------------------------------------------------------------------------------
+The first present is what the user waits for, so that is the point where we time startup and queue the prefetch jobs. 
+Key presses are timed from the moment they come off the event queue to the moment the frame showing them is presented. 
+If the image behind a key isn't ready yet, getKeyPressSurface loads it right there instead of ignoring the key.
+
+To compare cold and warm page cache, run once after "sync; echo 3 | sudo tee /proc/sys/vm/drop_caches" and once again straight after. 
+Run with --eager to get the old numbers where all five images are loaded before the first frame.
+
+Run with --hot-reload and overwrite one of the .bmp files while the program is up: a watcher thread decodes the new file and the 
+main loop swaps it in between frames, printing the decode time, the change-to-swap latency and what the swap cost the frame. 
+A change that lands while that image is still being loaded is held and swapped in once the load finishes, since the load may have 
+read the old file.
+
+Every surface is registered with the resource tracker, which prints the live and peak surface memory by format and by file on exit 
+and whenever the program gets SIGUSR1 ("kill -USR1 <pid>"). --memory-budget 3 caps surface memory at 3 MB: loading a key press image 
+that doesn't fit first frees the one shown least recently (it is loaded again when its key is pressed) and fails if that isn't enough.
+
+The key press images are a few colors on white. With --encoding auto each one is measured as it loads and held as whichever of an 
+SDL RLE surface keyed on its background or an 8-bit indexed surface is smaller (or as the one named: surface, sdl-rle or indexed), 
+and drawn with blitFlatSurface. The memory report above shows what that saves.
+
+Nothing changes on screen between key presses, yet every frame blits the whole image again. --elide-overdraw records each frame's 
+blit with common/frame_recorder.h, and since the window surface keeps its pixels between frames a frame that would blit the same 
+image to the same place as the last one is skipped. Pressing a key or reloading an image forgets the last frame, so the next one 
+is drawn. --overdraw covers the window with how many times each pixel was written that frame (black for none, blue for once) 
+instead, which also means the window no longer shows the frame so nothing is skipped. Both print the pixel writes per frame and 
+what skipping saved on exit.
+
+For long runs, F3 (or --hud from the start) draws common/frame_hud.h's panel in the top left corner: the last 120 frame times as a 
+graph with a line at 16.7 ms, the frame rate, mean and 99th percentile frame time, events and blits per frame, and what drawing the 
+panel itself costs. It is three SDL_FillRect(s) calls straight onto the window surface, and the last frames' numbers print on exit.
+
+Running as a kiosk there is nobody to read stdout. --telemetry NAME writes every frame's time, events, blit and present times and 
+resident memory into a shared memory ring from common/telemetry_ring.h (/dev/shm/NAME on Linux), which tools/telemetry_reader 
+follows from another process for rolling stats and export. The reader only maps it read only, so however slow it is the frame 
+never waits for it; one that falls more than 4096 frames behind just loses the oldest.
+-------------------------------------------------------------------------------------------------------------------------------------------------
+*/
+
 
 // ===============================================================================================================================================
 
@@ -184,6 +476,10 @@ bool init()
 	//Initialization flag
 	bool success = true;
 
+	//Name this lesson in the memory report and let SIGUSR1 ask for one
+	setResourceLesson( "04" );
+	installResourceDumpSignal();
+
 	//Initialize SDL
 	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
 	{
@@ -192,6 +488,8 @@ bool init()
 	}
 	else
 	{
+		startupMark( "SDL_Init" );
+
 		//Create window
 		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
 		if( gWindow == NULL )
@@ -201,8 +499,12 @@ bool init()
 		}
 		else
 		{
-			//Get window surface
+			startupMark( "SDL_CreateWindow" );
+
+			//Get window surface, the window owns it but it's memory all the same
 			gScreenSurface = SDL_GetWindowSurface( gWindow );
+			trackSurface( gScreenSurface, "window surface" );
+			startupMark( "SDL_GetWindowSurface" );
 		}
 	}
 
@@ -215,60 +517,265 @@ bool loadMedia()
 	//Loading success flag
 	bool success = true;
 
-	//Load default surface
-	gKeyPressSurfaces[ KEY_PRESS_SURFACE_DEFAULT ] = loadSurface( "press.bmp" );
-	if( gKeyPressSurfaces[ KEY_PRESS_SURFACE_DEFAULT ] == NULL )
+	//Create the lock shared with the prefetch jobs
+	gKeyPressMutex = SDL_CreateMutex();
+	gKeyPressLoaded = SDL_CreateCond();
+	if( gKeyPressMutex == NULL || gKeyPressLoaded == NULL )
 	{
-		printf( "Failed to load default image!\n" );
-		success = false;
+		printf( "Unable to create prefetch lock! SDL Error: %s\n", SDL_GetError() );
+		return false;
 	}
+	SDL_AtomicSet( &gPrefetchCancel, 0 );
 
-	//Load up surface
-	gKeyPressSurfaces[ KEY_PRESS_SURFACE_UP ] = loadSurface( "up.bmp" );
-	if( gKeyPressSurfaces[ KEY_PRESS_SURFACE_UP ] == NULL )
+	//Nothing is loaded yet
+	for( int i = 0; i < KEY_PRESS_SURFACE_TOTAL; ++i )
 	{
-		printf( "Failed to load up image!\n" );
-		success = false;
+		gKeyPressSurfaces[ i ] = NULL;
+		gKeyPressStates[ i ] = KEY_PRESS_LOAD_EMPTY;
+		gKeyPressLastShown[ i ] = 0;
 	}
 
-	//Load down surface
-	gKeyPressSurfaces[ KEY_PRESS_SURFACE_DOWN ] = loadSurface( "down.bmp" );
-	if( gKeyPressSurfaces[ KEY_PRESS_SURFACE_DOWN ] == NULL )
+	//Loads past the budget evict key press images first
+	if( gMemoryBudget > 0 )
 	{
-		printf( "Failed to load down image!\n" );
-		success = false;
+		setResourceBudget( gMemoryBudget, evictKeyPressSurface );
 	}
 
-	//Load left surface
-	gKeyPressSurfaces[ KEY_PRESS_SURFACE_LEFT ] = loadSurface( "left.bmp" );
-	if( gKeyPressSurfaces[ KEY_PRESS_SURFACE_LEFT ] == NULL )
+	//Load default surface, the only one the first frame needs
+	if( getKeyPressSurface( KEY_PRESS_SURFACE_DEFAULT ) == NULL )
 	{
-		printf( "Failed to load left image!\n" );
+		printf( "Failed to load default image!\n" );
 		success = false;
 	}
 
-	//Load right surface
-	gKeyPressSurfaces[ KEY_PRESS_SURFACE_RIGHT ] = loadSurface( "right.bmp" );
-	if( gKeyPressSurfaces[ KEY_PRESS_SURFACE_RIGHT ] == NULL )
+	//Watch every key press image, the watcher decodes changed files with the same loadSurface
+	for( int i = 0; i < KEY_PRESS_SURFACE_TOTAL; ++i )
 	{
-		printf( "Failed to load right image!\n" );
-		success = false;
+		gKeyPressWatches[ i ] = gHotReload ? watchHotAsset( gHotReloader, gKeyPressPaths[ i ], loadSurface ) : -1;
+	}
+	if( gHotReload && !startHotReload( gHotReloader ) )
+	{
+		//Not fatal, changes just need a restart like before
+		printf( "Unable to start hot reload! SDL Error: %s\n", SDL_GetError() );
+		gHotReload = false;
+	}
+
+	//Load the rest up front if asked to
+	if( gEagerLoad )
+	{
+		for( int i = KEY_PRESS_SURFACE_UP; i < KEY_PRESS_SURFACE_TOTAL; ++i )
+		{
+			if( getKeyPressSurface( i ) == NULL )
+			{
+				printf( "Failed to load %s!\n", gKeyPressPaths[ i ] );
+				success = false;
+			}
+		}
 	}
 
 	return success;
 }
 
-// Here in the loadMedia function we load all of the images we're going to render to the screen
+// Here in the loadMedia function we load the default image; the rest are left to the prefetch jobs
+
+SDL_Surface* getKeyPressSurface( int key, bool makeCurrent, bool waitForLoad )
+{
+	SDL_LockMutex( gKeyPressMutex );
+
+	//Someone else is loading it, nothing left for a prefetch job to do
+	if( !waitForLoad && gKeyPressStates[ key ] == KEY_PRESS_LOAD_LOADING )
+	{
+		SDL_UnlockMutex( gKeyPressMutex );
+		return NULL;
+	}
+
+	//A prefetch job is loading it, wait for it rather than loading it twice
+	while( gKeyPressStates[ key ] == KEY_PRESS_LOAD_LOADING )
+	{
+		SDL_CondWait( gKeyPressLoaded, gKeyPressMutex );
+	}
+
+	//Nobody has loaded it yet, load it here
+	if( gKeyPressStates[ key ] == KEY_PRESS_LOAD_EMPTY )
+	{
+		gKeyPressStates[ key ] = KEY_PRESS_LOAD_LOADING;
+		SDL_UnlockMutex( gKeyPressMutex );
+
+		SDL_Surface* loadedSurface = loadSurface( gKeyPressPaths[ key ] );
+
+		//A failed load (say over the memory budget) leaves the slot empty so the next key press tries again
+		SDL_LockMutex( gKeyPressMutex );
+		gKeyPressSurfaces[ key ] = loadedSurface;
+		gKeyPressStates[ key ] = loadedSurface != NULL ? KEY_PRESS_LOAD_READY : KEY_PRESS_LOAD_EMPTY;
+		SDL_CondBroadcast( gKeyPressLoaded );
+	}
+
+	SDL_Surface* keySurface = gKeyPressSurfaces[ key ];
+	if( makeCurrent && keySurface != NULL )
+	{
+		gCurrentSurface = keySurface;
+		gKeyPressLastShown[ key ] = SDL_GetPerformanceCounter();
+	}
+	SDL_UnlockMutex( gKeyPressMutex );
+
+	return keySurface;
+}
+
+bool evictKeyPressSurface()
+{
+	//Least recently shown loaded image that isn't on screen
+	SDL_LockMutex( gKeyPressMutex );
+	int victim = -1;
+	for( int i = 0; i < KEY_PRESS_SURFACE_TOTAL; ++i )
+	{
+		if( gKeyPressStates[ i ] == KEY_PRESS_LOAD_READY && gKeyPressSurfaces[ i ] != gCurrentSurface &&
+			( victim < 0 || gKeyPressLastShown[ i ] < gKeyPressLastShown[ victim ] ) )
+		{
+			victim = i;
+		}
+	}
+
+	//Back to empty, getKeyPressSurface loads it again when it's next needed
+	SDL_Surface* evicted = NULL;
+	if( victim >= 0 )
+	{
+		evicted = gKeyPressSurfaces[ victim ];
+		gKeyPressSurfaces[ victim ] = NULL;
+		gKeyPressStates[ victim ] = KEY_PRESS_LOAD_EMPTY;
+	}
+	SDL_UnlockMutex( gKeyPressMutex );
+
+	freeTrackedSurface( evicted );
+	return victim >= 0;
+}
+
+void applyHotReloads()
+{
+	for( int i = 0; i < KEY_PRESS_SURFACE_TOTAL; ++i )
+	{
+		//A newer decode replaces one still waiting for its image to finish loading
+		HotReloadResult reload;
+		if( takeHotReload( gHotReloader, gKeyPressWatches[ i ], reload ) )
+		{
+			freeTrackedSurface( gPendingReloads[ i ].surface );
+		}
+		else if( gPendingReloads[ i ].surface != NULL )
+		{
+			reload = gPendingReloads[ i ];
+		}
+		else
+		{
+			continue;
+		}
+		gPendingReloads[ i ].surface = NULL;
+
+		//Swap the pointer under the lock, an image that isn't loaded yet will be read from the new file anyway
+		Uint64 swapStart = SDL_GetPerformanceCounter();
+		SDL_Surface* oldSurface = reload.surface;
+		SDL_LockMutex( gKeyPressMutex );
+		if( gKeyPressStates[ i ] == KEY_PRESS_LOAD_LOADING )
+		{
+			//The load in flight may have read the old file, keep this one and try again next frame
+			SDL_UnlockMutex( gKeyPressMutex );
+			gPendingReloads[ i ] = reload;
+			continue;
+		}
+		if( gKeyPressStates[ i ] == KEY_PRESS_LOAD_READY )
+		{
+			oldSurface = gKeyPressSurfaces[ i ];
+			gKeyPressSurfaces[ i ] = reload.surface;
+			if( gCurrentSurface == oldSurface )
+			{
+				gCurrentSurface = reload.surface;
+			}
+		}
+		SDL_UnlockMutex( gKeyPressMutex );
+		freeTrackedSurface( oldSurface );
+		invalidateRecordedFrame( gFrameRecorder );
+
+		recordHotReloadSwap( gHotReloader, gKeyPressWatches[ i ], reload, swapStart );
+	}
+}
+
+void startPrefetch()
+{
+	//Already queued or everything was loaded up front
+	if( gPrefetchStarted || gEagerLoad )
+	{
+		return;
+	}
+	gPrefetchStarted = true;
+
+	//One job per image so idle workers load them side by side
+	for( int i = KEY_PRESS_SURFACE_UP; i < KEY_PRESS_SURFACE_TOTAL; ++i )
+	{
+		submitJob( gJobs, [ i ]()
+		{
+			//Loads it unless a key press already has, is loading it, or the program is shutting down
+			if( !SDL_AtomicGet( &gPrefetchCancel ) )
+			{
+				getKeyPressSurface( i, false, false );
+			}
+		}, &gPrefetchJobs );
+	}
+}
+
+/*
+-------------------------------------------------------------------------------------------------------------------------------------------------
+getKeyPressSurface is the only place that loads a key press image. Whoever gets to an empty slot first marks it as loading and 
+does the actual SDL_LoadBMP outside the lock, so the main thread is never stuck behind a load of a different image. 
+If the main thread asks for an image a prefetch job is in the middle of loading, it waits on the condition variable for that load 
+to finish since that's always quicker than starting a new one. A slot only becomes loading once its job actually runs, so a key 
+pressed before a worker got to its job just loads the image there and the job later finds it ready. The prefetch jobs run on 
+common/job_system.h's workers, which are started once and also decode .qois strips, instead of a thread of their own. 
+A prefetch job never waits for a load already in progress, it just returns: a thread waiting for its .qois strips runs other 
+queued jobs meanwhile, and that could be the prefetch job for the very image the same thread is loading.
+-------------------------------------------------------------------------------------------------------------------------------------------------
+*/
 
 void close()
 {
+	//Finish the prefetch jobs before freeing what they load, the ones not started yet skip their image
+	SDL_AtomicSet( &gPrefetchCancel, 1 );
+	waitForJobs( gJobs, gPrefetchJobs );
+
+	//Stop watching before freeing what the watcher swaps, then the workers its decodes may use
+	stopHotReload( gHotReloader );
+	printHotReloadSummary( gHotReloader );
+	stopJobSystem( gJobs );
+	for( int i = 0; i < KEY_PRESS_SURFACE_TOTAL; ++i )
+	{
+		freeTrackedSurface( gPendingReloads[ i ].surface );
+		gPendingReloads[ i ].surface = NULL;
+	}
+
+	//Pixel writes per frame
+	printOverdrawReport( gFrameRecorder, "04" );
+
+	//Frame times the HUD was keeping
+	printFrameHudReport( gHud, "04" );
+
+	//Remove the telemetry ring, attached readers see the writer gone
+	closeTelemetryRing( gTelemetry );
+
+	//What was still resident at exit
+	printResourceReport();
+
 	//Deallocate surfaces
+	untrackResource( gScreenSurface );
 	for( int i = 0; i < KEY_PRESS_SURFACE_TOTAL; ++i )
 	{
-		SDL_FreeSurface( gKeyPressSurfaces[ i ] );
+		freeTrackedSurface( gKeyPressSurfaces[ i ] );
 		gKeyPressSurfaces[ i ] = NULL;
+		gKeyPressStates[ i ] = KEY_PRESS_LOAD_EMPTY;
 	}
 
+	//Destroy prefetch lock
+	SDL_DestroyCond( gKeyPressLoaded );
+	gKeyPressLoaded = NULL;
+	SDL_DestroyMutex( gKeyPressMutex );
+	gKeyPressMutex = NULL;
+
 	//Destroy window
 	SDL_DestroyWindow( gWindow );
 	gWindow = NULL;
@@ -279,8 +786,24 @@ void close()
 
 SDL_Surface* loadSurface( std::string path )
 {
-	//Load image at specified path
-	SDL_Surface* loadedSurface = SDL_LoadBMP( path.c_str() );
+	//Load image at specified path, .qoi/.qois go through the parallel QOI decoder
+	SDL_Surface* loadedSurface = isQOIPath( path ) ? loadStripQOI( path, &gJobs ) : SDL_LoadBMP( path.c_str() );
+
+	//Swap it for its compact encoding, this also runs on job system workers and the hot reload thread
+	size_t bytes = 0;
+	if( loadedSurface != NULL && gEncode )
+	{
+		FlatEncoding encoding;
+		SDL_Surface* encodedSurface = encodeFlatSurface( loadedSurface, gScreenSurface->format, gEncoding, &encoding, &bytes );
+		SDL_FreeSurface( loadedSurface );
+		loadedSurface = encodedSurface;
+		if( encodedSurface != NULL )
+		{
+			printf( "Holding %s as %s (%.1f KB)\n", path.c_str(), flatEncodingName( encoding ), bytes / 1024.0 );
+		}
+	}
+
+	loadedSurface = trackSurface( loadedSurface, path, bytes );
 	if( loadedSurface == NULL )
 	{
 		printf( "Unable to load image %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
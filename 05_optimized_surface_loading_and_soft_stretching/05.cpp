@@ -6,7 +6,11 @@ and may not be redistributed without written permission.*/
 //Using SDL, standard IO, and strings
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include "../common/startup_profiler.h"
+#include "../common/integer_scale.h"
+#include "../common/job_system.h"
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -24,6 +28,9 @@ void close();
 //Loads individual image
 SDL_Surface* loadSurface( std::string path );
 
+//Picks up the window surface and the integer scale after the window changes size
+void resizeScaled();
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 	
@@ -33,6 +40,23 @@ SDL_Surface* gScreenSurface = NULL;
 //Current displayed image
 SDL_Surface* gStretchedSurface = NULL;
 
+//Window size as a multiple of the screen size, above 1 the scene is drawn at 640x480 and scaled up (--scale N)
+int gScale = 1;
+
+//Scale up with SDL_BlitScaled instead of integerScaleSurface (--scale-mode blit)
+bool gScaleBlit = false;
+
+//The scene at the logical resolution and where it goes in the window
+SDL_Surface* gLogicalSurface = NULL;
+SDL_Rect gScaleRect = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+
+//Time spent scaling up
+Uint64 gScaleTicks = 0;
+int gScaleFrames = 0;
+
+//Workers the scaling is split across, started once for --scale
+JobSystem gJobs;
+
 bool init()
 {
 	//Initialization flag
@@ -46,8 +70,11 @@ bool init()
 	}
 	else
 	{
+		startupMark( "SDL_Init" );
+
 		//Create window
-		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
+		Uint32 windowFlags = gScale > 1 ? SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE : SDL_WINDOW_SHOWN;
+		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH * gScale, SCREEN_HEIGHT * gScale, windowFlags );
 		if( gWindow == NULL )
 		{
 			printf( "Window could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -55,8 +82,26 @@ bool init()
 		}
 		else
 		{
+			startupMark( "SDL_CreateWindow" );
+
 			//Get window surface
 			gScreenSurface = SDL_GetWindowSurface( gWindow );
+			startupMark( "SDL_GetWindowSurface" );
+
+			//Draw at the logical resolution in the window's format so scaling up is a straight copy
+			if( gScale > 1 )
+			{
+				gLogicalSurface = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, gScreenSurface->format->format );
+				if( gLogicalSurface == NULL )
+				{
+					printf( "Unable to create logical surface! SDL Error: %s\n", SDL_GetError() );
+					success = false;
+				}
+				else
+				{
+					resizeScaled();
+				}
+			}
 		}
 	}
 
@@ -81,9 +126,24 @@ bool loadMedia()
 
 void close()
 {
+	//Report what scaling up cost
+	if( gScaleFrames > 0 )
+	{
+		printf( "Scaling %dx%d up %dx with %s: %.3f ms a frame over %d frames\n", SCREEN_WIDTH, SCREEN_HEIGHT, gScaleRect.w / SCREEN_WIDTH,
+			gScaleBlit ? "SDL_BlitScaled" : scalePathName( bestScalePath() ), gScaleTicks * 1000.0 / SDL_GetPerformanceFrequency() / gScaleFrames, gScaleFrames );
+	}
+
 	//Free loaded image
 	SDL_FreeSurface( gStretchedSurface );
 	gStretchedSurface = NULL;
+	SDL_FreeSurface( gLogicalSurface );
+	gLogicalSurface = NULL;
+
+	//Stop the scaling workers
+	if( jobWorkerCount( gJobs ) > 0 )
+	{
+		stopJobSystem( gJobs );
+	}
 
 	//Destroy window
 	SDL_DestroyWindow( gWindow );
@@ -149,8 +209,44 @@ After the image is loaded and converted, we return the final optimized image.
 -------------------------------------------------------------------------------------------------------------------------------------------------
 */
 
+void resizeScaled()
+{
+	//The old window surface is gone after a resize
+	gScreenSurface = SDL_GetWindowSurface( gWindow );
+	if( gScreenSurface == NULL )
+	{
+		return;
+	}
+
+	//Biggest whole factor that fits, centered with black bars that only need clearing now
+	int factor = integerScaleFactor( SCREEN_WIDTH, SCREEN_HEIGHT, gScreenSurface->w, gScreenSurface->h );
+	gScaleRect = integerScaleRect( SCREEN_WIDTH, SCREEN_HEIGHT, gScreenSurface->w, gScreenSurface->h, factor );
+	SDL_FillRect( gScreenSurface, NULL, SDL_MapRGB( gScreenSurface->format, 0x00, 0x00, 0x00 ) );
+}
+
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
+	//Check for a scaled up window
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--scale" && i + 1 < argc )
+		{
+			gScale = atoi( args[ ++i ] );
+			gScale = SDL_max( 1, gScale );
+		}
+		else if( std::string( args[ i ] ) == "--scale-mode" && i + 1 < argc )
+		{
+			gScaleBlit = std::string( args[ ++i ] ) == "blit";
+		}
+	}
+	if( gScale > 1 && !gScaleBlit )
+	{
+		startJobSystem( gJobs );
+	}
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -165,6 +261,8 @@ int main( int argc, char* args[] )
 		}
 		else
 		{	
+			startupMark( "loadMedia" );
+
 			//Main loop flag
 			bool quit = false;
 
@@ -182,6 +280,11 @@ int main( int argc, char* args[] )
 					{
 						quit = true;
 					}
+					//The window surface has to be fetched again after a resize
+					else if( e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && gLogicalSurface != NULL )
+					{
+						resizeScaled();
+					}
 				}
 
 				//Apply the image stretched
@@ -190,7 +293,23 @@ int main( int argc, char* args[] )
 				stretchRect.y = 0;
 				stretchRect.w = SCREEN_WIDTH;
 				stretchRect.h = SCREEN_HEIGHT;
-				SDL_BlitScaled( gStretchedSurface, NULL, gScreenSurface, &stretchRect );
+				SDL_BlitScaled( gStretchedSurface, NULL, gLogicalSurface != NULL ? gLogicalSurface : gScreenSurface, &stretchRect );
+
+				//Scale the finished scene up to the window
+				if( gLogicalSurface != NULL && gScreenSurface != NULL )
+				{
+					Uint64 scaleStart = SDL_GetPerformanceCounter();
+					if( gScaleBlit )
+					{
+						SDL_BlitScaled( gLogicalSurface, NULL, gScreenSurface, &gScaleRect );
+					}
+					else
+					{
+						integerScaleSurface( gLogicalSurface, gScreenSurface, gScaleRect.x, gScaleRect.y, gScaleRect.w / SCREEN_WIDTH, SCALE_PATH_AUTO, &gJobs );
+					}
+					gScaleTicks += SDL_GetPerformanceCounter() - scaleStart;
+					++gScaleFrames;
+				}
 			
 /*
 ------------------------------------------------------------------------------------------------------------------------------------------------
@@ -200,11 +319,19 @@ SDL_Rect which defines the position and size of the image you are blitting.
 
 So if we want to take an image that's smaller than the screen and make it the size of the screen, 
 you make the destination width/height to be the width/height of the screen. 
+
+SDL_BlitScaled works out a source pixel for every destination pixel, which is what it takes for any size but is wasted work 
+when the destination is a whole multiple of the source. Run with --scale 2 (or 3, or 6) for a window that many times the size: 
+the scene is drawn at 640x480 into gLogicalSurface as before and integerScaleSurface from common/integer_scale.h copies every 
+pixel into a 2x2 (3x3, 6x6) block with SIMD row kernels, in jobs on a job system started once (common/job_system.h). 
+Resizing the window picks the biggest whole factor that still fits and centers it. --scale-mode blit does the scaling with 
+SDL_BlitScaled for comparison, the average cost a frame prints on exit either way.
 ------------------------------------------------------------------------------------------------------------------------------------------------1
 */
 
 				//Update the surface
 				SDL_UpdateWindowSurface( gWindow );
+				startupFirstFrame( "05" );
 			}
 		}
 	}
@@ -6,6 +6,12 @@ and may not be redistributed without written permission.*/
 #include <SDL2/SDL_image.h>
 #include <stdio.h>
 #include <string>
+#include "../common/strip_qoi.h"
+#include "../common/image_cache.h"
+#include "../common/job_system.h"
+#include "../common/startup_profiler.h"
+#include "../common/alpha_blend.h"
+#include "../common/frame_recorder.h"
 
 /*
 -------------------------------------------------------------------------------------------------------------------------------------------------
@@ -38,11 +44,37 @@ SDL_Surface* gScreenSurface = NULL;
 //Current displayed PNG image
 SDL_Surface* gPNGSurface = NULL;
 
+//The image being decoded while the window comes up, as a job on gJobs
+AsyncImageLoad gPNGLoad;
+JobSystem gJobs;
+
+//Initialize SDL_image and decode up front like the original lesson instead of overlapping them with startup
+bool gLegacyStartup = false;
+
+//Image with alpha blended over the PNG when --overlay is given, premultiplied at load
+std::string gOverlayPath;
+SDL_Surface* gOverlaySurface = NULL;
+BlendOp gOverlayOp = BLEND_OVER;
+
+//Overlay blit timing
+Uint64 gOverlayTicks = 0;
+int gOverlayFrames = 0;
+
+//Record each frame's blits and skip them while the window surface still shows them (--elide-overdraw), and show how many
+//times each pixel was written as a heatmap instead (--overdraw)
+FrameRecorder gFrameRecorder;
+
 bool init()
 {
 	//Initialization flag
 	bool success = true;
 
+	//Start decoding the image now, window surfaces are almost always XRGB8888 and loadSurface converts if not
+	if( !gLegacyStartup )
+	{
+		startAsyncImageLoad( gPNGLoad, gJobs, "lamine.jpg", SDL_PIXELFORMAT_RGB888 );
+	}
+
 	//Initialize SDL
 	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
 	{
@@ -51,6 +83,8 @@ bool init()
 	}
 	else
 	{
+		startupMark( "SDL_Init" );
+
 		//Create window
 		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
 		if( gWindow == NULL )
@@ -60,17 +94,25 @@ bool init()
 		}
 		else
 		{
-			//Initialize PNG loading
+			startupMark( "SDL_CreateWindow" );
+
+			//Initialize PNG loading, normally left to the first PNG decode
 			int imgFlags = IMG_INIT_PNG;
-			if( !( IMG_Init( imgFlags ) & imgFlags ) )
+			if( gLegacyStartup && !( IMG_Init( imgFlags ) & imgFlags ) )
 			{
 				printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );  // +++
 				success = false;
 			}
 			else
 			{
+				if( gLegacyStartup )
+				{
+					startupMark( "IMG_Init" );
+				}
+
 				//Get window surface
 				gScreenSurface = SDL_GetWindowSurface( gWindow );
+				startupMark( "SDL_GetWindowSurface" );
 			}
 		}
 	}
@@ -123,15 +165,43 @@ bool loadMedia()
 		success = false;
 	}
 
+	//Load the overlay as ARGB8888 and premultiply it once so every frame's blend skips the multiply by alpha
+	if( !gOverlayPath.empty() )
+	{
+		ImageCacheResult cacheResult;
+		gOverlaySurface = loadCachedImage( gOverlayPath, SDL_PIXELFORMAT_ARGB8888, &cacheResult, &gJobs );
+		if( gOverlaySurface == NULL || !premultiplySurfaceAlpha( gOverlaySurface ) )
+		{
+			printf( "Failed to load overlay image %s! SDL Error: %s\n", gOverlayPath.c_str(), SDL_GetError() );
+			success = false;
+		}
+	}
+
 	return success;
 }
 
 void close()
 {
+	//Report the overlay blend cost
+	if( gOverlayFrames > 0 )
+	{
+		printf( "Overlay %s blend (%s): %.3f ms/frame over %d frames\n", blendOpName( gOverlayOp ), blendPathName( bestBlendPath() ),
+			gOverlayTicks * 1000.0 / SDL_GetPerformanceFrequency() / gOverlayFrames, gOverlayFrames );
+	}
+	freeCachedImage( gOverlaySurface );
+	gOverlaySurface = NULL;
+
+	//Pixel writes per frame
+	printOverdrawReport( gFrameRecorder, "06" );
+
 	//Free loaded image
-	SDL_FreeSurface( gPNGSurface );
+	waitAsyncImageLoad( gPNGLoad );
+	freeCachedImage( gPNGSurface );
 	gPNGSurface = NULL;
 
+	//Nothing is loading anymore
+	stopJobSystem( gJobs );
+
 	//Destroy window
 	SDL_DestroyWindow( gWindow );
 	gWindow = NULL;
@@ -143,26 +213,28 @@ void close()
 
 SDL_Surface* loadSurface( std::string path )
 {
-	//The final optimized image
-	SDL_Surface* optimizedSurface = NULL;
+	Uint64 start = SDL_GetPerformanceCounter();
 
-	//Load image at specified path
-	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
-	if( loadedSurface == NULL )
+	//Load image already converted to screen format, from the decoded image cache when it's there
+	//A background load that failed is reported below rather than decoded a second time
+	ImageCacheResult cacheResult;
+	SDL_Surface* optimizedSurface = NULL;
+	if( asyncImageLoadPending( gPNGLoad, path ) )
 	{
-		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+		optimizedSurface = finishAsyncImageLoad( gPNGLoad, path, gScreenSurface->format->format, &cacheResult );
 	}
 	else
 	{
-		//Convert surface to screen format
-		optimizedSurface = SDL_ConvertSurface( loadedSurface, gScreenSurface->format, 0 );
-		if( optimizedSurface == NULL )
-		{
-			printf( "Unable to optimize image %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
-		}
-
-		//Get rid of old loaded surface
-		SDL_FreeSurface( loadedSurface );
+		optimizedSurface = loadCachedImage( path, gScreenSurface->format->format, &cacheResult, &gJobs );
+	}
+	if( optimizedSurface == NULL )
+	{
+		printf( "Unable to optimize image %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+	}
+	else
+	{
+		double loadMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+		printf( "Loaded %s in %.2f ms (%s)\n", path.c_str(), loadMs, imageCacheResultName( cacheResult ) );
 	}
 
 	return optimizedSurface;
@@ -173,11 +245,58 @@ SDL_Surface* loadSurface( std::string path )
 Our image loading function is pretty much the same as before, only now it uses IMG_Load as opposed to SDL_LoadBMP. 
 IMG_Load can load many different types of format which you can find out about in the SDL_image documentation. Like with IMG_Init, 
 when there's an error with IMG_Load, we call IMG_GetError to get the error string. 
+
+The decode and the conversion to the screen format happen inside loadCachedImage. The first run stores the converted pixels in 
+.imgcache and every run after that maps them back in instead of decoding, which is what the "Loaded ... in ... ms" line shows. 
+Delete .imgcache (or touch the image) to see the cold number again.
+
+The decode doesn't have to wait for the window either. init() starts it as a job on a job system (common/job_system.h) before 
+SDL_Init, guessing the screen format, and loadSurface just collects the result (converting it if the guess was wrong). IMG_Init is left to the first 
+image that actually needs a codec. Run with --legacy-startup to get the old serial order and compare the startup profiles.
+
+The picture never changes, yet every frame blits all of it again (and blends the overlay on top again). --elide-overdraw records 
+the frame's blits with common/frame_recorder.h, and since the window surface keeps its pixels between frames, a frame identical to 
+the last one is skipped. The overlay is blended, not opaque, so nothing it covers could be dropped within a frame. --overdraw 
+covers the window with how many times each pixel was written, blue for once and green under the overlay. Both print the pixel 
+writes per frame and what skipping saved on exit.
 -----------------------------------------------------------------------------------------------------------------------------------------------
 */
 
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
+	//Check for the old startup order (for comparison)
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--legacy-startup" )
+		{
+			gLegacyStartup = true;
+		}
+		else if( std::string( args[ i ] ) == "--overlay" && i + 1 < argc )
+		{
+			gOverlayPath = args[ ++i ];
+		}
+		else if( std::string( args[ i ] ) == "--blend" && i + 1 < argc )
+		{
+			std::string op = args[ ++i ];
+			gOverlayOp = op == "add" ? BLEND_ADD : op == "mod" ? BLEND_MOD : BLEND_OVER;
+		}
+		else if( std::string( args[ i ] ) == "--elide-overdraw" )
+		{
+			gFrameRecorder.elide = true;
+			gFrameRecorder.retain = true;
+		}
+		else if( std::string( args[ i ] ) == "--overdraw" )
+		{
+			gFrameRecorder.analyze = true;
+		}
+	}
+
+	//Workers for the background decode and .qois strips, this thread is worker 0
+	startJobSystem( gJobs );
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -192,6 +311,8 @@ int main( int argc, char* args[] )
 		}
 		else
 		{	
+			startupMark( "loadMedia" );
+
 			//Main loop flag
 			bool quit = false;
 
@@ -211,11 +332,46 @@ int main( int argc, char* args[] )
 					}
 				}
 
-				//Apply the PNG image
-				SDL_BlitSurface( gPNGSurface, NULL, gScreenSurface, NULL );
+				//Blends the overlay on top, centered
+				auto blendOverlay = []()
+				{
+					Uint64 start = SDL_GetPerformanceCounter();
+					SDL_Rect overlayRect = { ( SCREEN_WIDTH - gOverlaySurface->w ) / 2, ( SCREEN_HEIGHT - gOverlaySurface->h ) / 2, 0, 0 };
+					blitPremultiplied( gOverlaySurface, NULL, gScreenSurface, &overlayRect, gOverlayOp );
+					gOverlayTicks += SDL_GetPerformanceCounter() - start;
+					++gOverlayFrames;
+				};
+
+				if( gFrameRecorder.elide || gFrameRecorder.analyze )
+				{
+					//Recorded, so a frame the window surface already shows isn't drawn again
+					beginRecordedFrame( gFrameRecorder, gScreenSurface, gScreenSurface->w, gScreenSurface->h, gScreenSurface->format->BytesPerPixel );
+					recordBlit( gFrameRecorder, gPNGSurface, NULL, gScreenSurface, NULL );
+					if( gOverlaySurface != NULL )
+					{
+						SDL_Rect overlayRect = { ( SCREEN_WIDTH - gOverlaySurface->w ) / 2, ( SCREEN_HEIGHT - gOverlaySurface->h ) / 2, gOverlaySurface->w, gOverlaySurface->h };
+						recordDraw( gFrameRecorder, &overlayRect, false, blendOverlay, gOverlaySurface, &overlayRect );
+					}
+					submitRecordedFrame( gFrameRecorder );
+					if( gFrameRecorder.analyze )
+					{
+						drawOverdrawHeatmap( gFrameRecorder, gScreenSurface );
+					}
+				}
+				else
+				{
+					//Apply the PNG image
+					SDL_BlitSurface( gPNGSurface, NULL, gScreenSurface, NULL );
+
+					if( gOverlaySurface != NULL )
+					{
+						blendOverlay();
+					}
+				}
 			
 				//Update the surface
 				SDL_UpdateWindowSurface( gWindow );
+				startupFirstFrame( "06" );
 			}
 		}
 	}
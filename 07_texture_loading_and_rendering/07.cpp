@@ -5,7 +5,18 @@ and may not be redistributed without written permission.*/
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
+#include "../common/strip_qoi.h"
+#include "../common/image_cache.h"
+#include "../common/job_system.h"
+#include "../common/startup_profiler.h"
+#include "../common/renderer_probe.h"
+#include "../common/hot_reload.h"
+#include "../common/resource_tracker.h"
+#include "../common/stream_framebuffer.h"
+#include "../common/frame_recorder.h"
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -23,6 +34,21 @@ void close();
 //Loads individual image as texture
 SDL_Texture* loadTexture( std::string path );
 
+//Decodes a changed texture.png on the hot reload thread
+SDL_Surface* decodeReloadedTexture( std::string path );
+
+//Swaps in a reloaded texture if the watcher has one
+void applyHotReload();
+
+//Sets up the source and target of --cpu-frame
+bool loadCpuFrame();
+
+//Draws this frame's CPU frame into target, the texture scrolled sideways
+void drawCpuFrame( SDL_Surface* target, CpuFrameStats& stats );
+
+//Draws the CPU frame and renders it the --cpu-frame way
+void renderCpuFrame();
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
@@ -32,6 +58,47 @@ SDL_Renderer* gRenderer = NULL;
 //Current displayed texture
 SDL_Texture* gTexture = NULL;
 
+//texture.png being decoded while the window and renderer come up
+AsyncImageLoad gTextureLoad;
+
+//Workers the texture is decoded on, this thread is worker 0
+JobSystem gJobs;
+
+//Initialize SDL_image and decode up front like the original lesson instead of overlapping them with startup
+bool gLegacyStartup = false;
+
+//Format loadTexture picked for the renderer, reloads decode to it too
+Uint32 gTextureFormat = SDL_PIXELFORMAT_ARGB8888;
+
+//Reload texture.png when the file changes (--hot-reload)
+bool gHotReload = false;
+HotReloader gHotReloader;
+int gTextureWatch = -1;
+
+//Cap on surface and texture memory in bytes, 0 for none (--memory-budget MB)
+size_t gMemoryBudget = 0;
+
+//Window size as a multiple of the screen size, above 1 the renderer scales 640x480 up by whole pixels (--scale N)
+int gScale = 1;
+
+//Show a frame drawn on the CPU every frame instead of the static texture, uploaded by making a texture from a surface
+//(--cpu-frame surface) or drawn straight into streaming textures (--cpu-frame stream, --stream-buffers N)
+std::string gCpuFrame;
+int gStreamBuffers = 2;
+
+//texture.png in the frame format, the surface the surface path draws into and the streaming framebuffer
+SDL_Surface* gCpuSource = NULL;
+SDL_Surface* gCpuSurface = NULL;
+StreamFramebuffer gFramebuffer;
+CpuFrameStats gCpuSurfaceStats = {};
+int gCpuScroll = 0;
+
+//Record each frame's draws and drop the ones later opaque draws cover (--elide-overdraw), and show how many times each
+//pixel was written as a heatmap instead of the frame (--overdraw)
+FrameRecorder gFrameRecorder;
+SDL_Surface* gHeatmapSurface = NULL;
+SDL_Texture* gHeatmapTexture = NULL;
+
 /*
 --------------------------------------------------------------------------------------------------------------------------------------------------
 Textures in SDL have their own data type intuitively called an SDL_Texture. When we deal with SDL textures you need an SDL_Renderer to render it 
@@ -46,6 +113,17 @@ bool init()
 	//Initialization flag
 	bool success = true;
 
+	//Name this lesson in the memory report and let SIGUSR1 ask for one
+	setResourceLesson( "07" );
+	installResourceDumpSignal();
+	setResourceBudget( gMemoryBudget );
+
+	//Start decoding the texture now, most renderers want ARGB8888 and loadTexture converts if not
+	if( !gLegacyStartup )
+	{
+		startAsyncImageLoad( gTextureLoad, gJobs, "texture.png", SDL_PIXELFORMAT_ARGB8888 );
+	}
+
 	//Initialize SDL
 	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
 	{
@@ -54,14 +132,17 @@ bool init()
 	}
 	else
 	{
-		//Set texture filtering to linear
-		if( !SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "1" ) )
+		startupMark( "SDL_Init" );
+
+		//Set texture filtering to linear, or nearest when scaling up so pixels stay square blocks
+		if( !SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, gScale > 1 ? "0" : "1" ) )
 		{
 			printf( "Warning: Linear texture filtering not enabled!" );
 		}
 
 		//Create window
-		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
+		Uint32 windowFlags = gScale > 1 ? SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE : SDL_WINDOW_SHOWN;
+		gWindow = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH * gScale, SCREEN_HEIGHT * gScale, windowFlags );
 		if( gWindow == NULL )
 		{
 			printf( "Window could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -69,8 +150,10 @@ bool init()
 		}
 		else
 		{
-			//Create renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED );
+			startupMark( "SDL_CreateWindow" );
+
+			//Create renderer for window on the fastest backend this machine has (probed once, then read from renderer.cfg)
+			gRenderer = createProbedRenderer( gWindow );
 			if( gRenderer == NULL )
 			{
 				printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -81,12 +164,24 @@ bool init()
 				//Initialize renderer color
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 
-				//Initialize PNG loading
+				//Keep drawing in 640x480 coordinates and let the renderer scale that up by the biggest whole factor that fits
+				if( gScale > 1 && ( SDL_RenderSetLogicalSize( gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT ) < 0 || SDL_RenderSetIntegerScale( gRenderer, SDL_TRUE ) < 0 ) )
+				{
+					printf( "Warning: Unable to set integer scaled logical size! SDL Error: %s\n", SDL_GetError() );
+				}
+
+				startupMark( "SDL_CreateRenderer" );
+
+				//Initialize PNG loading, normally left to the first PNG decode
 				int imgFlags = IMG_INIT_PNG;
-				if( !( IMG_Init( imgFlags ) & imgFlags ) )
+				if( gLegacyStartup )
 				{
-					printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
-					success = false;
+					if( !( IMG_Init( imgFlags ) & imgFlags ) )
+					{
+						printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+						success = false;
+					}
+					startupMark( "IMG_Init" );
 				}
 			}
 		}
@@ -94,10 +189,19 @@ bool init()
 /*
 ----------------------------------------------------------------------------------------------------------------------------------------------
 After we create our window, we have to create a renderer for our window so we can render textures on it. 
-Fortunately this is easily done with a call to SDL_CreateRenderer.
+Fortunately this is easily done with a call to SDL_CreateRenderer. Here it's wrapped in createProbedRenderer, which the first time 
+round benchmarks every backend SDL has on this machine and saves the fastest to renderer.cfg, so a GPU-less server ends up on 
+whichever of software or Mesa's OpenGL is quicker instead of whatever SDL tries first.
 
 After creating the renderer, we want to initialize the rendering color using SDL_SetRenderDrawColor. 
 This controls what color is used for various rendering operations.
+
+Before any of that, init() hands texture.png to a job on a job system (common/job_system.h) so the decode overlaps SDL_Init, 
+SDL_CreateWindow and SDL_CreateRenderer, and IMG_Init only happens once that decode needs it. Run with --legacy-startup for the old serial order.
+
+--scale 2 (or 3, or 6) opens the window that many times bigger. SDL_RenderSetLogicalSize keeps every draw call in 640x480 
+coordinates and SDL_RenderSetIntegerScale limits the scale-up to whole factors, letterboxing whatever is left over, with nearest 
+filtering so each pixel becomes a sharp block. The scaling happens as part of the draw on the GPU, there is no extra pass.
 -----------------------------------------------------------------------------------------------------------------------------------------------
 */
 
@@ -119,21 +223,75 @@ bool loadMedia()
 		success = false;
 	}
 
+	//Set up the CPU drawn frame
+	if( success && !gCpuFrame.empty() && !loadCpuFrame() )
+	{
+		printf( "Unable to set up the CPU frame! SDL Error: %s\n", SDL_GetError() );
+		success = false;
+	}
+
+	//The heatmap is drawn on the CPU and uploaded every frame
+	if( success && gFrameRecorder.analyze )
+	{
+		gHeatmapSurface = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888 );
+		gHeatmapTexture = SDL_CreateTexture( gRenderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT );
+		if( gHeatmapSurface == NULL || gHeatmapTexture == NULL )
+		{
+			printf( "Unable to create the overdraw heatmap! SDL Error: %s\n", SDL_GetError() );
+			success = false;
+		}
+	}
+
+	//Watch the texture's file
+	if( gHotReload )
+	{
+		gTextureWatch = watchHotAsset( gHotReloader, "texture.png", decodeReloadedTexture );
+		if( gTextureWatch < 0 || !startHotReload( gHotReloader ) )
+		{
+			//Not fatal, changes just need a restart like before
+			printf( "Unable to start hot reload! SDL Error: %s\n", SDL_GetError() );
+			gHotReload = false;
+		}
+	}
+
 	return success;
 }
 
 void close()
 {
-	//Free loaded image
-	SDL_DestroyTexture( gTexture );
+	//Stop watching, then free loaded image
+	stopHotReload( gHotReloader );
+	printHotReloadSummary( gHotReloader );
+	waitAsyncImageLoad( gTextureLoad );
+	printResourceReport();
+	destroyTrackedTexture( gTexture );
 	gTexture = NULL;
 
+	//Report and free the CPU frame
+	printCpuFrameStats( gCpuSurfaceStats, "surface, SDL_CreateTextureFromSurface every frame" );
+	printCpuFrameStats( gFramebuffer.stats, gFramebuffer.bufferCount > 1 ? "stream, double buffered" : "stream, single buffered" );
+	destroyStreamFramebuffer( gFramebuffer );
+	SDL_FreeSurface( gCpuSurface );
+	gCpuSurface = NULL;
+	freeTrackedSurface( gCpuSource );
+	gCpuSource = NULL;
+
+	//Report overdraw and free the heatmap
+	printOverdrawReport( gFrameRecorder, "07" );
+	SDL_DestroyTexture( gHeatmapTexture );
+	gHeatmapTexture = NULL;
+	SDL_FreeSurface( gHeatmapSurface );
+	gHeatmapSurface = NULL;
+
 	//Destroy window	
 	SDL_DestroyRenderer( gRenderer );
 	SDL_DestroyWindow( gWindow );
 	gWindow = NULL;
 	gRenderer = NULL;
 
+	//Nothing is decoding anymore, the hot reload watcher was stopped first
+	stopJobSystem( gJobs );
+
 	//Quit SDL subsystems
 	IMG_Quit();
 	SDL_Quit();
@@ -150,8 +308,31 @@ SDL_Texture* loadTexture( std::string path )
 	//The final texture
 	SDL_Texture* newTexture = NULL;
 
-	//Load image at specified path
-	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+	//Decode straight to the renderer's preferred texture format so texture creation is a plain copy
+	Uint32 textureFormat = SDL_PIXELFORMAT_ARGB8888;
+	SDL_RendererInfo info;
+	if( SDL_GetRendererInfo( gRenderer, &info ) == 0 && info.num_texture_formats > 0 && SDL_BYTESPERPIXEL( info.texture_formats[ 0 ] ) == 4 )
+	{
+		textureFormat = info.texture_formats[ 0 ];
+	}
+	gTextureFormat = textureFormat;
+
+	//Load image at specified path, from the decoded image cache when it's there
+	Uint64 start = SDL_GetPerformanceCounter();
+	//A background load that failed is reported below rather than decoded a second time
+	ImageCacheResult cacheResult;
+	SDL_Surface* loadedSurface = NULL;
+	if( asyncImageLoadPending( gTextureLoad, path ) )
+	{
+		loadedSurface = finishAsyncImageLoad( gTextureLoad, path, textureFormat, &cacheResult );
+	}
+	else
+	{
+		loadedSurface = loadCachedImage( path, textureFormat, &cacheResult, &gJobs );
+	}
+
+	//The decoded pixels only live until the upload but count towards the peak, and can fail the load under a budget
+	loadedSurface = trackSurface( loadedSurface, path, 0, freeCachedImage );
 	if( loadedSurface == NULL )
 	{
 		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
@@ -159,30 +340,201 @@ SDL_Texture* loadTexture( std::string path )
 	else
 	{
 		//Create texture from surface pixels
-        newTexture = SDL_CreateTextureFromSurface( gRenderer, loadedSurface );
+        newTexture = trackTexture( SDL_CreateTextureFromSurface( gRenderer, loadedSurface ), path );
 		if( newTexture == NULL )
 		{
 			printf( "Unable to create texture from %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
 		}
+		else
+		{
+			//Blending pixels that are all opaque changes nothing, and without it the renderer and the frame recorder know the
+			//texture covers what it is drawn over
+			if( surfaceIsOpaque( loadedSurface ) )
+			{
+				SDL_SetTextureBlendMode( newTexture, SDL_BLENDMODE_NONE );
+			}
+
+			double loadMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+			printf( "Loaded %s in %.2f ms (%s)\n", path.c_str(), loadMs, imageCacheResultName( cacheResult ) );
+		}
 
 		//Get rid of old loaded surface
-		SDL_FreeSurface( loadedSurface );
+		freeCachedImage( loadedSurface );
 	}
 
 	return newTexture;
 }
 
+SDL_Surface* decodeReloadedTexture( std::string path )
+{
+	//Decode and convert off the main thread, only the upload is left for the frame boundary
+	return trackSurface( decodeImageToFormat( path, gTextureFormat, &gJobs ), path );
+}
+
+void applyHotReload()
+{
+	HotReloadResult reload;
+	if( !takeHotReload( gHotReloader, gTextureWatch, reload ) )
+	{
+		return;
+	}
+
+	//Textures can only be made on the render thread, the surface is already in the texture's format so this is a plain upload
+	Uint64 swapStart = SDL_GetPerformanceCounter();
+	SDL_Texture* newTexture = trackTexture( SDL_CreateTextureFromSurface( gRenderer, reload.surface ), "texture.png" );
+	if( newTexture != NULL && surfaceIsOpaque( reload.surface ) )
+	{
+		SDL_SetTextureBlendMode( newTexture, SDL_BLENDMODE_NONE );
+	}
+	freeTrackedSurface( reload.surface );
+	if( newTexture == NULL )
+	{
+		printf( "Unable to create reloaded texture! SDL Error: %s\n", SDL_GetError() );
+		return;
+	}
+
+	SDL_Texture* oldTexture = gTexture;
+	gTexture = newTexture;
+	destroyTrackedTexture( oldTexture );
+
+	recordHotReloadSwap( gHotReloader, gTextureWatch, reload, swapStart );
+}
+
+bool loadCpuFrame()
+{
+	//Everything in the format the renderer takes as is, so neither path converts
+	Uint32 format = preferredStreamFormat( gRenderer );
+	gCpuSource = trackSurface( decodeImageToFormat( "texture.png", format, &gJobs ), "cpu frame source" );
+	if( gCpuSource == NULL )
+	{
+		return false;
+	}
+
+	if( gCpuFrame == "stream" )
+	{
+		return createStreamFramebuffer( gRenderer, gFramebuffer, gCpuSource->w, gCpuSource->h, gStreamBuffers, format );
+	}
+
+	gCpuSurface = SDL_CreateRGBSurfaceWithFormat( 0, gCpuSource->w, gCpuSource->h, 32, format );
+	return gCpuSurface != NULL;
+}
+
+void drawCpuFrame( SDL_Surface* target, CpuFrameStats& stats )
+{
+	//Every row is the source row rotated left by the scroll, which writes every pixel as a locked texture needs
+	Uint64 start = SDL_GetPerformanceCounter();
+	int width = SDL_min( target->w, gCpuSource->w );
+	int height = SDL_min( target->h, gCpuSource->h );
+	int scroll = gCpuScroll % width;
+	for( int y = 0; y < height; ++y )
+	{
+		const Uint8* in = (const Uint8*)gCpuSource->pixels + y * gCpuSource->pitch;
+		Uint8* out = (Uint8*)target->pixels + y * target->pitch;
+		memcpy( out, in + scroll * 4, ( width - scroll ) * 4 );
+		memcpy( out + ( width - scroll ) * 4, in, scroll * 4 );
+	}
+	gCpuScroll = scroll + 2;
+	stats.drawTicks += SDL_GetPerformanceCounter() - start;
+}
+
+void renderCpuFrame()
+{
+	if( gCpuFrame == "stream" )
+	{
+		//Draw straight into the texture, then render it
+		SDL_Surface* target = lockStreamFramebuffer( gFramebuffer );
+		if( target != NULL )
+		{
+			drawCpuFrame( target, gFramebuffer.stats );
+			SDL_RenderCopy( gRenderer, unlockStreamFramebuffer( gFramebuffer ), NULL, NULL );
+		}
+	}
+	else
+	{
+		//Draw into a surface, copy it into a new texture, render that and throw it away
+		drawCpuFrame( gCpuSurface, gCpuSurfaceStats );
+		SDL_Texture* frame = uploadSurfaceFrame( gRenderer, gCpuSurface, gCpuSurfaceStats );
+		SDL_RenderCopy( gRenderer, frame, NULL, NULL );
+		Uint64 start = SDL_GetPerformanceCounter();
+		SDL_DestroyTexture( frame );
+		gCpuSurfaceStats.uploadTicks += SDL_GetPerformanceCounter() - start;
+	}
+}
+
 /*
 ------------------------------------------------------------------------------------------------------------------------------------------------
 Our texture loading function looks largely the same as before only now instead of converting the loaded surface to the display format, 
 we create a texture from the loaded surface using SDL_CreateTextureFromSurface. 
 Like before, this function creates a new texture from an existing surface which means like before we have 
 to free the loaded surface and then return the loaded texture.
+
+With --hot-reload, saving a new texture.png while the program runs gets it decoded on a watcher thread and swapped in at the next 
+frame boundary. Only the texture upload happens on the main thread, and each reload prints how long it took.
+
+The texture and the surfaces it is decoded into are registered with the resource tracker, which prints live and peak memory by format 
+and by file on exit and on SIGUSR1. --memory-budget caps that memory in MB, a load that would go over it fails instead. A hot reload 
+briefly holds the old texture, the new one and the decoded surface, so the peak shows how much room reloading needs.
+
+--cpu-frame shows texture.png scrolling sideways, drawn on the CPU every frame, to compare two ways of getting CPU pixels onto 
+the renderer. "surface" is the obvious one: draw into a surface, SDL_CreateTextureFromSurface, render, destroy, which allocates 
+a texture and copies the whole frame every frame (and destroying a texture the renderer still has queued makes SDL flush). 
+"stream" draws straight into a streaming texture locked with SDL_LockTextureToSurface, two of them taking turns unless 
+--stream-buffers says otherwise, so there's nothing to allocate or copy. Both print their per frame cost on exit.
+
+The clear above is wasted work whenever the texture is opaque, every pixel it writes is written again by the SDL_RenderCopy. 
+--elide-overdraw records the frame's draws with common/frame_recorder.h first and drops any draw later opaque draws cover 
+completely, here the clear (loadTexture turns blending off for textures without transparent pixels, which is what tells the 
+recorder the copy covers it). --overdraw shows how many times each pixel was written instead of the frame, black for never, 
+then blue, green, yellow, orange and red, and both print the pixel writes per frame and what dropping saved on exit.
 ------------------------------------------------------------------------------------------------------------------------------------------------
 */
 
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
+	//Check for the old startup order (for comparison)
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--legacy-startup" )
+		{
+			gLegacyStartup = true;
+		}
+		else if( std::string( args[ i ] ) == "--hot-reload" )
+		{
+			gHotReload = true;
+		}
+		else if( std::string( args[ i ] ) == "--memory-budget" && i + 1 < argc )
+		{
+			gMemoryBudget = (size_t)( atof( args[ ++i ] ) * 1024.0 * 1024.0 );
+		}
+		else if( std::string( args[ i ] ) == "--scale" && i + 1 < argc )
+		{
+			gScale = atoi( args[ ++i ] );
+			gScale = SDL_max( 1, gScale );
+		}
+		else if( std::string( args[ i ] ) == "--cpu-frame" && i + 1 < argc )
+		{
+			gCpuFrame = std::string( args[ ++i ] ) == "stream" ? "stream" : "surface";
+		}
+		else if( std::string( args[ i ] ) == "--stream-buffers" && i + 1 < argc )
+		{
+			gStreamBuffers = atoi( args[ ++i ] );
+		}
+		else if( std::string( args[ i ] ) == "--elide-overdraw" )
+		{
+			gFrameRecorder.elide = true;
+		}
+		else if( std::string( args[ i ] ) == "--overdraw" )
+		{
+			gFrameRecorder.analyze = true;
+		}
+	}
+
+	//Workers for the background decode and .qois strips
+	startJobSystem( gJobs );
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -197,6 +549,8 @@ int main( int argc, char* args[] )
 		}
 		else
 		{	
+			startupMark( "loadMedia" );
+
 			//Main loop flag
 			bool quit = false;
 
@@ -216,14 +570,66 @@ int main( int argc, char* args[] )
 					}
 				}
 
-				//Clear screen
-				SDL_RenderClear( gRenderer );
+				//Pick up a reloaded texture between frames
+				if( gHotReload )
+				{
+					applyHotReload();
+				}
+
+				//Print the memory breakdown if SIGUSR1 asked for it
+				pollResourceDump();
 
-				//Render texture to screen
-				SDL_RenderCopy( gRenderer, gTexture, NULL, NULL );
+				if( gFrameRecorder.elide || gFrameRecorder.analyze )
+				{
+					//Record the same frame, then draw what is left of it. With a logical size the clear also covers the
+					//letterbox, which nothing drawn in 640x480 coordinates does, so it can't be dropped
+					beginRecordedFrame( gFrameRecorder, gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT );
+					if( gScale > 1 )
+					{
+						SDL_RenderClear( gRenderer );
+					}
+					else
+					{
+						recordClear( gFrameRecorder, gRenderer );
+					}
+					if( gCpuFrame.empty() )
+					{
+						recordCopy( gFrameRecorder, gRenderer, gTexture, NULL, NULL );
+					}
+					else
+					{
+						//createStreamFramebuffer turns blending off on its textures, textures made from surfaces keep it
+						recordDraw( gFrameRecorder, NULL, gCpuFrame == "stream", renderCpuFrame );
+					}
+					submitRecordedFrame( gFrameRecorder );
+
+					//Cover the frame with how many times each pixel of it was written
+					if( gHeatmapTexture != NULL )
+					{
+						drawOverdrawHeatmap( gFrameRecorder, gHeatmapSurface );
+						SDL_UpdateTexture( gHeatmapTexture, NULL, gHeatmapSurface->pixels, gHeatmapSurface->pitch );
+						SDL_RenderCopy( gRenderer, gHeatmapTexture, NULL, NULL );
+					}
+				}
+				else
+				{
+					//Clear screen
+					SDL_RenderClear( gRenderer );
+
+					//Render texture to screen, or the CPU drawn frame
+					if( gCpuFrame.empty() )
+					{
+						SDL_RenderCopy( gRenderer, gTexture, NULL, NULL );
+					}
+					else
+					{
+						renderCpuFrame();
+					}
+				}
 
 				//Update screen
 				SDL_RenderPresent( gRenderer );
+				startupFirstFrame( "07" );
 			}
 
 /*
@@ -5,8 +5,21 @@ and may not be redistributed without written permission.*/
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <cmath>
+#include <vector>
+#include "../common/startup_profiler.h"
+#include "../common/renderer_probe.h"
+#include "../common/lazy_image_init.h"
+#include "../common/entity_store.h"
+#include "../common/spatial_grid.h"
+#include "../common/job_system.h"
+#include "../common/stream_framebuffer.h"
+#include "../common/fill_engine.h"
+#include "../common/render_state.h"
+#include "../common/frame_hud.h"
+#include <algorithm>
 
 //Screen dimension constants
 const int SCREEN_WIDTH = 640;
@@ -24,12 +37,97 @@ void close();
 //Loads individual image as texture
 SDL_Texture* loadTexture( std::string path );
 
+//Moves and draws the animated entities
+void renderEntities();
+
+//The stages of renderEntities, which the frame graph runs as separate tasks
+void moveEntities();
+void regridEntities();
+void cullEntities();
+void submitEntities();
+
+//Sets up the per-frame task graph for --jobs
+void buildFrameGraph( bool& quit );
+
+//Draws the state heavy sprite scene of --state-stress
+void renderStateStress();
+
+//Fills the visible entities' rects into target on the CPU
+void rasterizeEntities( SDL_Surface* target, CpuFrameStats& stats );
+
+//Scrolls the view and picks entities under the mouse
+void handleEntityEvent( SDL_Event& e );
+
 //The window we'll be rendering to
 SDL_Window* gWindow = NULL;
 
 //The window renderer
 SDL_Renderer* gRenderer = NULL;
 
+//Initialize SDL_image up front like the original lesson instead of on first use
+bool gLegacyStartup = false;
+
+//Animated entities drawn instead of the static scene when --entities is given
+int gEntityCount = 0;
+EntityStore gEntities;
+std::vector<SDL_Vertex> gEntityVertices;
+std::vector<int> gEntityIndices;
+
+//The entities roam a world bigger than the screen, the arrow keys scroll the view over it
+const int ENTITY_WORLD_WIDTH = SCREEN_WIDTH * 4;
+const int ENTITY_WORLD_HEIGHT = SCREEN_HEIGHT * 4;
+const float ENTITY_GRID_CELL = 64.0f;
+SDL_FRect gView = { 0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT };
+
+//Grid over the entities for culling and picking, --no-cull submits everything for comparison
+SpatialGrid gEntityGrid;
+std::vector<int> gVisibleEntities;
+bool gEntityCull = true;
+
+//Entity under the mouse, -1 if none
+int gHoveredEntity = -1;
+
+//Entity frame timing
+Uint64 gLastEntityUpdate = 0;
+Uint64 gEntityUpdateTicks = 0;
+Uint64 gEntityGridTicks = 0;
+Uint64 gEntitySubmitTicks = 0;
+Uint64 gEntityPickTicks = 0;
+int gEntityPicks = 0;
+int gEntityFrames = 0;
+
+//Run loading and the entity frame as task graphs on a work-stealing job system (--jobs N, 0 for every CPU). The system
+//also runs whenever there are entities, for the CPU fills, without --jobs on every CPU
+bool gUseJobs = false;
+int gJobWorkers = 0;
+JobSystem gJobs;
+TaskGraph gLoadGraph;
+TaskGraph gFrameGraph;
+
+//Entities per parallelFor job when writing vertices
+const int VERTEX_JOB_GRAIN = 8192;
+
+//Draw the entities on the CPU instead of with SDL_RenderGeometry, into a surface made into a texture every frame
+//(--cpu-raster surface) or straight into streaming textures (--cpu-raster stream)
+std::string gCpuRaster;
+SDL_Surface* gRasterSurface = NULL;
+StreamFramebuffer gFramebuffer;
+CpuFrameStats gRasterSurfaceStats = {};
+
+//Renderer state shadow, skipping state calls that change nothing with --state-cache and only counting them without
+RenderStateCache gRenderState;
+bool gStateCache = false;
+
+//Sprites of the state heavy scene drawn instead of the static one (--state-stress N), in this many tint and blend combinations
+int gStressSprites = 0;
+const int STRESS_MATERIALS = 8;
+SDL_Texture* gStressTexture = NULL;
+Uint64 gStressTicks = 0;
+int gStressFrames = 0;
+
+//Frame time graph and per frame counts drawn over the scene, F3 shows and hides it (--hud starts it shown)
+FrameHud gHud;
+
 bool init()
 {
 	//Initialization flag
@@ -43,6 +141,8 @@ bool init()
 	}
 	else
 	{
+		startupMark( "SDL_Init" );
+
 		//Set texture filtering to linear
 		if( !SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "1" ) )
 		{
@@ -58,8 +158,10 @@ bool init()
 		}
 		else
 		{
-			//Create renderer for window
-			gRenderer = SDL_CreateRenderer( gWindow, -1, SDL_RENDERER_ACCELERATED );
+			startupMark( "SDL_CreateWindow" );
+
+			//Create renderer for window on the fastest backend this machine has (probed once, then read from renderer.cfg)
+			gRenderer = createProbedRenderer( gWindow );
 			if( gRenderer == NULL )
 			{
 				printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
@@ -69,13 +171,20 @@ bool init()
 			{
 				//Initialize renderer color
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
+				initRenderStateCache( gRenderState, gRenderer, gStateCache );
+
+				startupMark( "SDL_CreateRenderer" );
 
-				//Initialize PNG loading
+				//Initialize PNG loading, this lesson never loads a PNG so normally loadTexture does it on demand
 				int imgFlags = IMG_INIT_PNG;
-				if( !( IMG_Init( imgFlags ) & imgFlags ) )
+				if( gLegacyStartup )
 				{
-					printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
-					success = false;
+					if( !( IMG_Init( imgFlags ) & imgFlags ) )
+					{
+						printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+						success = false;
+					}
+					startupMark( "IMG_Init" );
 				}
 			}
 		}
@@ -89,7 +198,83 @@ bool loadMedia()
 	//Loading success flag
 	bool success = true;
 
-	//Nothing to load
+	//The stress scene's sprite, a white square every sprite tints
+	if( gStressSprites > 0 )
+	{
+		SDL_Surface* square = SDL_CreateRGBSurfaceWithFormat( 0, 16, 16, 32, SDL_PIXELFORMAT_ARGB8888 );
+		if( square != NULL )
+		{
+			SDL_FillRect( square, NULL, SDL_MapRGBA( square->format, 0xFF, 0xFF, 0xFF, 0xFF ) );
+			gStressTexture = SDL_CreateTextureFromSurface( gRenderer, square );
+			SDL_FreeSurface( square );
+		}
+		if( gStressTexture == NULL )
+		{
+			printf( "Unable to create the stress sprite! SDL Error: %s\n", SDL_GetError() );
+			success = false;
+		}
+	}
+
+	//Nothing to load unless there are entities to animate
+	if( gEntityCount > 0 )
+	{
+		SDL_FRect bounds = { 0.0f, 0.0f, (float)ENTITY_WORLD_WIDTH, (float)ENTITY_WORLD_HEIGHT };
+		if( !createEntityStore( gEntities, gEntityCount, bounds ) )
+		{
+			printf( "Unable to allocate %d entities! SDL Error: %s\n", gEntityCount, SDL_GetError() );
+			success = false;
+		}
+		else
+		{
+			//The grid needs the spawned entities, the vertex and index buffers only need the count
+			int spawn = addTask( gLoadGraph, "spawn", [ bounds ]()
+			{
+				spawnRandomEntities( gEntities, gEntityCount, 12345 );
+				createSpatialGrid( gEntityGrid, bounds, ENTITY_GRID_CELL );
+			} );
+			int grid = addTask( gLoadGraph, "grid", []()
+			{
+				for( int i = 0; i < gEntities.count; ++i )
+				{
+					SDL_FRect rect = { gEntities.x[ i ], gEntities.y[ i ], gEntities.w[ i ], gEntities.h[ i ] };
+					insertGridItem( gEntityGrid, i, rect );
+				}
+			} );
+			addTask( gLoadGraph, "vertices", []() { gEntityVertices.resize( gEntityCount * 4 ); } );
+			addTask( gLoadGraph, "indices", []() { buildQuadIndices( gEntityIndices, gEntityCount ); } );
+			addTaskDependency( gLoadGraph, spawn, grid );
+
+			//Without jobs the tasks just run in the order they were added, which satisfies the dependency
+			if( gUseJobs )
+			{
+				runTaskGraph( gJobs, gLoadGraph );
+			}
+			else
+			{
+				for( size_t i = 0; i < gLoadGraph.nodes.size(); ++i )
+				{
+					gLoadGraph.nodes[ i ].run();
+				}
+			}
+			gLastEntityUpdate = SDL_GetPerformanceCounter();
+
+			//The CPU rasterizer's target, in the format the renderer takes as is
+			if( gCpuRaster == "stream" )
+			{
+				success = createStreamFramebuffer( gRenderer, gFramebuffer, SCREEN_WIDTH, SCREEN_HEIGHT );
+			}
+			else if( gCpuRaster == "surface" )
+			{
+				gRasterSurface = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, preferredStreamFormat( gRenderer ) );
+				success = gRasterSurface != NULL;
+			}
+			if( !success )
+			{
+				printf( "Unable to create the CPU raster target! SDL Error: %s\n", SDL_GetError() );
+			}
+		}
+	}
+
 	return success;
 }
 
@@ -97,11 +282,77 @@ bool loadMedia()
 ------------------------------------------------------------------------------------------------------------------------------------------------
 So as you can see in our media loading function, we load no media. 
 SDL's primitive rendering allows you to render shapes without loading special graphics. 
+
+With --entities the setup is written as a small task graph: spawning, then filling the grid, with the vertex and index buffers 
+built alongside. Run with --jobs N (0 for one worker per core) and that graph, and every entity frame after it, runs on the 
+work-stealing job system from common/job_system.h: input, update, grid, render prep and present are tasks that wait for each 
+other, the update and the vertex writes are split into blocks with parallelFor, and input and present are marked main thread 
+tasks because SDL's events and renderer have to stay there. On exit it prints each task's time and how many jobs each worker 
+ran and stole; tools/job_bench runs the same frame without a window at 1 to N workers.
+
+--cpu-raster surface or stream draws the entities on the CPU with SDL_FillRect instead of SDL_RenderGeometry and renders the 
+result with one SDL_RenderCopy, to compare getting CPU pixels onto the renderer by making a texture from a surface every 
+frame against drawing straight into a double buffered streaming texture (common/stream_framebuffer.h). The white clear at the 
+start of each CPU frame goes through fillSurface from common/fill_engine.h, split into jobs with SIMD stores on the same job 
+system, which runs whenever there are entities (every core unless --jobs says otherwise); the 
+SDL_RenderClear of the GPU paths stays, a renderer clears its own target far faster than anything the CPU could upload.
+
+The state calls of the entity frame (its clear and outline colors) go through a state cache from common/render_state.h, 
+which remembers what the renderer is set to; the static scene below calls SDL_SetRenderDrawColor itself. With --state-cache a 
+call that sets what is already set never reaches SDL; either way it counts issued and skipped calls per frame and prints them on 
+exit. --state-stress N draws N tinted sprites in four clipped panels instead of the static scene, setting viewport, clip rect, 
+blend mode, color and alpha mod before each sprite like typical drawing code, which is where most calls turn out to be redundant.
+
+F3 (or --hud from the start) draws common/frame_hud.h's panel over any of these scenes: the last 120 frame times as a graph with a 
+line at 16.7 ms, the frame rate, mean and 99th percentile frame time, events and draw calls per frame, and what the panel itself 
+costs to submit. It is one translucent SDL_RenderFillRect and two SDL_RenderFillRects batches, the whole graph in one of them, and 
+it puts back the draw color and blend mode it found so the state cache's shadow stays right.
 ------------------------------------------------------------------------------------------------------------------------------------------------
 */
 
 void close()
 {
+	//Report and free the entities
+	if( gEntityFrames > 0 )
+	{
+		double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+		printf( "%d entities: update %.3f ms/frame, grid %.3f ms/frame, submit %.3f ms/frame (%s) over %d frames\n", gEntities.count,
+			gEntityUpdateTicks * toMs / gEntityFrames, gEntityGridTicks * toMs / gEntityFrames, gEntitySubmitTicks * toMs / gEntityFrames,
+			gEntityCull ? "culled" : "not culled", gEntityFrames );
+		if( gEntityPicks > 0 )
+		{
+			printf( "%d picks, %.4f ms each\n", gEntityPicks, gEntityPickTicks * toMs / gEntityPicks );
+		}
+	}
+	printCpuFrameStats( gRasterSurfaceStats, "surface, SDL_CreateTextureFromSurface every frame" );
+	printCpuFrameStats( gFramebuffer.stats, "stream, double buffered" );
+	destroyStreamFramebuffer( gFramebuffer );
+	SDL_FreeSurface( gRasterSurface );
+	gRasterSurface = NULL;
+	if( gUseJobs )
+	{
+		printTaskGraphReport( gLoadGraph, "Load" );
+		printTaskGraphReport( gFrameGraph, "Frame" );
+		printJobReport( gJobs );
+	}
+	if( jobWorkerCount( gJobs ) > 0 )
+	{
+		stopJobSystem( gJobs );
+	}
+	freeEntityStore( gEntities );
+
+	//Report state calls and free the stress scene
+	if( gStressFrames > 0 )
+	{
+		printf( "%d stress sprites: %.3f ms/frame of drawing over %d frames\n", gStressSprites,
+			gStressTicks * 1000.0 / SDL_GetPerformanceFrequency() / gStressFrames, gStressFrames );
+	}
+	printRenderStateReport( gRenderState, "08" );
+	printFrameHudReport( gHud, "08" );
+	forgetTextureState( gRenderState, gStressTexture );
+	SDL_DestroyTexture( gStressTexture );
+	gStressTexture = NULL;
+
 	//Destroy window	
 	SDL_DestroyRenderer( gRenderer );
 	SDL_DestroyWindow( gWindow );
@@ -118,8 +369,8 @@ SDL_Texture* loadTexture( std::string path )
 	//The final texture
 	SDL_Texture* newTexture = NULL;
 
-	//Load image at specified path
-	SDL_Surface* loadedSurface = IMG_Load( path.c_str() );
+	//Load image at specified path, bringing up SDL_image first if nothing has yet
+	SDL_Surface* loadedSurface = ensureImageInit( imageInitFlagsForPath( path ) ) ? IMG_Load( path.c_str() ) : NULL;
 	if( loadedSurface == NULL )
 	{
 		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
@@ -140,8 +391,329 @@ SDL_Texture* loadTexture( std::string path )
 	return newTexture;
 }
 
+void renderEntities()
+{
+	moveEntities();
+	regridEntities();
+	cullEntities();
+	submitEntities();
+}
+
+void moveEntities()
+{
+	//Move everything by the time since the last frame, in blocks across the job system's workers
+	Uint64 start = SDL_GetPerformanceCounter();
+	float dt = SDL_min( ( start - gLastEntityUpdate ) / (float)SDL_GetPerformanceFrequency(), 0.1f );
+	gLastEntityUpdate = start;
+	updateEntities( gEntities, dt, NULL, NULL, &gJobs );
+	gEntityUpdateTicks += SDL_GetPerformanceCounter() - start;
+}
+
+void regridEntities()
+{
+	//Keep the grid up to date, most entities stay in their cells and only get their rect stored
+	Uint64 start = SDL_GetPerformanceCounter();
+	for( int i = 0; i < gEntities.count; ++i )
+	{
+		SDL_FRect rect = { gEntities.x[ i ], gEntities.y[ i ], gEntities.w[ i ], gEntities.h[ i ] };
+		moveGridItem( gEntityGrid, i, rect );
+	}
+	gEntityGridTicks += SDL_GetPerformanceCounter() - start;
+}
+
+void cullEntities()
+{
+	//Only what's in view goes to the renderer, sorted so the draw order (and so the topmost pick) doesn't change
+	Uint64 start = SDL_GetPerformanceCounter();
+	gVisibleEntities.clear();
+	if( gEntityCull )
+	{
+		queryGridRect( gEntityGrid, gView, gVisibleEntities );
+		std::sort( gVisibleEntities.begin(), gVisibleEntities.end() );
+	}
+	else
+	{
+		for( int i = 0; i < gEntities.count; ++i )
+		{
+			gVisibleEntities.push_back( i );
+		}
+	}
+	int visible = gVisibleEntities.size();
+	if( gUseJobs )
+	{
+		parallelFor( gJobs, 0, visible, VERTEX_JOB_GRAIN, []( int first, int last )
+		{
+			writeEntityVerticesIndexed( gEntities, gVisibleEntities.data() + first, last - first, -gView.x, -gView.y, gEntityVertices.data() + first * 4 );
+		} );
+	}
+	else
+	{
+		writeEntityVerticesIndexed( gEntities, gVisibleEntities.data(), visible, -gView.x, -gView.y, gEntityVertices.data() );
+	}
+	gEntitySubmitTicks += SDL_GetPerformanceCounter() - start;
+}
+
+void submitEntities()
+{
+	//Renderer calls, main thread only
+	Uint64 start = SDL_GetPerformanceCounter();
+	int visible = gVisibleEntities.size();
+	if( gCpuRaster == "stream" )
+	{
+		SDL_Surface* target = lockStreamFramebuffer( gFramebuffer );
+		if( target != NULL )
+		{
+			rasterizeEntities( target, gFramebuffer.stats );
+			SDL_RenderCopy( gRenderer, unlockStreamFramebuffer( gFramebuffer ), NULL, NULL );
+			countHudDraws( gHud );
+		}
+	}
+	else if( gCpuRaster == "surface" )
+	{
+		rasterizeEntities( gRasterSurface, gRasterSurfaceStats );
+		SDL_Texture* frame = uploadSurfaceFrame( gRenderer, gRasterSurface, gRasterSurfaceStats );
+		SDL_RenderCopy( gRenderer, frame, NULL, NULL );
+		countHudDraws( gHud );
+		Uint64 destroyStart = SDL_GetPerformanceCounter();
+		SDL_DestroyTexture( frame );
+		gRasterSurfaceStats.uploadTicks += SDL_GetPerformanceCounter() - destroyStart;
+	}
+	else
+	{
+		SDL_RenderGeometry( gRenderer, NULL, gEntityVertices.data(), visible * 4, gEntityIndices.data(), visible * 6 );
+		countHudDraws( gHud );
+	}
+
+	//Outline the hovered entity
+	if( gHoveredEntity >= 0 && gHoveredEntity < gEntities.count )
+	{
+		SDL_FRect outline = { gEntities.x[ gHoveredEntity ] - gView.x - 2, gEntities.y[ gHoveredEntity ] - gView.y - 2, gEntities.w[ gHoveredEntity ] + 4, gEntities.h[ gHoveredEntity ] + 4 };
+		cachedSetDrawColor( gRenderState, 0x00, 0x00, 0x00, 0xFF );
+		SDL_RenderDrawRectF( gRenderer, &outline );
+		countHudDraws( gHud );
+	}
+
+	gEntitySubmitTicks += SDL_GetPerformanceCounter() - start;
+	++gEntityFrames;
+}
+
+void rasterizeEntities( SDL_Surface* target, CpuFrameStats& stats )
+{
+	//Clear, since a locked texture's old pixels are undefined, then one fill per visible entity in draw order
+	Uint64 start = SDL_GetPerformanceCounter();
+	fillSurface( target, NULL, solidFill( SDL_MapRGB( target->format, 0xFF, 0xFF, 0xFF ) ), FILL_PATH_AUTO, &gJobs );
+	for( size_t v = 0; v < gVisibleEntities.size(); ++v )
+	{
+		int i = gVisibleEntities[ v ];
+		SDL_Color color;
+		memcpy( &color, &gEntities.color[ i ], sizeof( color ) );
+		SDL_Rect rect = { (int)( gEntities.x[ i ] - gView.x ), (int)( gEntities.y[ i ] - gView.y ), (int)gEntities.w[ i ], (int)gEntities.h[ i ] };
+		SDL_FillRect( target, &rect, SDL_MapRGB( target->format, color.r, color.g, color.b ) );
+	}
+	stats.drawTicks += SDL_GetPerformanceCounter() - start;
+}
+
+void renderStateStress()
+{
+	//Four panels, each its own viewport and clip rect, and sprites in STRESS_MATERIALS tint and blend combinations, sorted by
+	//panel and then material the way a batching renderer would. Each sprite still sets everything it needs, as drawing
+	//code usually does, so almost all of it is already set
+	Uint64 start = SDL_GetPerformanceCounter();
+	const SDL_BlendMode blends[ 3 ] = { SDL_BLENDMODE_NONE, SDL_BLENDMODE_BLEND, SDL_BLENDMODE_ADD };
+	int panelWidth = SCREEN_WIDTH / 2;
+	int panelHeight = SCREEN_HEIGHT / 2;
+	int perPanel = ( gStressSprites + 3 ) / 4;
+	for( int s = 0; s < gStressSprites; ++s )
+	{
+		int panel = s / perPanel;
+		int material = ( s % perPanel ) * STRESS_MATERIALS / perPanel;
+		SDL_Rect viewport = { ( panel % 2 ) * panelWidth, ( panel / 2 ) * panelHeight, panelWidth, panelHeight };
+		SDL_Rect clip = { 4, 4, panelWidth - 8, panelHeight - 8 };
+		cachedSetViewport( gRenderState, &viewport );
+		cachedSetClipRect( gRenderState, &clip );
+		cachedSetTextureBlendMode( gRenderState, gStressTexture, blends[ material % 3 ] );
+		cachedSetTextureColorMod( gRenderState, gStressTexture, 0x40 + material * 0x18, 0xFF - material * 0x18, 0x80 );
+		cachedSetTextureAlphaMod( gRenderState, gStressTexture, 0xC0 );
+
+		//Scattered over the panel, drifting right a pixel a frame
+		SDL_Rect rect = { ( s * 37 + gStressFrames ) % panelWidth, ( s * 91 ) % panelHeight, 12, 12 };
+		SDL_RenderCopy( gRenderer, gStressTexture, NULL, &rect );
+
+		cachedSetDrawBlendMode( gRenderState, SDL_BLENDMODE_NONE );
+		cachedSetDrawColor( gRenderState, 0x00, 0x00, 0x00, 0xFF );
+		SDL_RenderDrawRect( gRenderer, &rect );
+		countHudDraws( gHud, 2 );
+	}
+	cachedSetClipRect( gRenderState, NULL );
+	cachedSetViewport( gRenderState, NULL );
+
+	gStressTicks += SDL_GetPerformanceCounter() - start;
+	++gStressFrames;
+}
+
+void buildFrameGraph( bool& quit )
+{
+	//Events and the renderer belong to the main thread, everything between them can run on any worker
+	int input = addTask( gFrameGraph, "input", [ &quit ]()
+	{
+		SDL_Event e;
+		while( SDL_PollEvent( &e ) != 0 )
+		{
+			if( handleHudEvent( gHud, e ) )
+			{
+				continue;
+			}
+			if( e.type == SDL_QUIT )
+			{
+				quit = true;
+			}
+			else
+			{
+				handleEntityEvent( e );
+			}
+		}
+	}, true );
+	int update = addTask( gFrameGraph, "update", moveEntities );
+	int grid = addTask( gFrameGraph, "grid", regridEntities );
+	int prep = addTask( gFrameGraph, "render prep", cullEntities );
+	int present = addTask( gFrameGraph, "present", []()
+	{
+		cachedSetDrawColor( gRenderState, 0xFF, 0xFF, 0xFF, 0xFF );
+		SDL_RenderClear( gRenderer );
+		countHudDraws( gHud );
+		submitEntities();
+		drawFrameHud( gHud, gRenderer );
+		SDL_RenderPresent( gRenderer );
+		endHudFrame( gHud );
+		endRenderStateFrame( gRenderState );
+		startupFirstFrame( "08" );
+	}, true );
+
+	//Picking removes entities, so input goes first, and the grid, culling and drawing need this frame's positions
+	addTaskDependency( gFrameGraph, input, update );
+	addTaskDependency( gFrameGraph, update, grid );
+	addTaskDependency( gFrameGraph, grid, prep );
+	addTaskDependency( gFrameGraph, prep, present );
+}
+
+//Takes an entity out of the store and the grid, the store fills the hole with its last entity
+void removeEntityAt( int i )
+{
+	removeGridItem( gEntityGrid, i );
+	int moved = removeEntity( gEntities, i );
+	if( moved >= 0 )
+	{
+		renumberGridItem( gEntityGrid, moved, i );
+	}
+}
+
+void handleEntityEvent( SDL_Event& e )
+{
+	if( e.type == SDL_KEYDOWN )
+	{
+		//Scroll the view, staying inside the world
+		switch( e.key.keysym.sym )
+		{
+			case SDLK_LEFT: gView.x -= 32; break;
+			case SDLK_RIGHT: gView.x += 32; break;
+			case SDLK_UP: gView.y -= 32; break;
+			case SDLK_DOWN: gView.y += 32; break;
+		}
+		gView.x = SDL_max( 0.0f, SDL_min( gView.x, (float)( ENTITY_WORLD_WIDTH - SCREEN_WIDTH ) ) );
+		gView.y = SDL_max( 0.0f, SDL_min( gView.y, (float)( ENTITY_WORLD_HEIGHT - SCREEN_HEIGHT ) ) );
+	}
+	else if( e.type == SDL_MOUSEMOTION )
+	{
+		//Point query for the entity under the cursor
+		Uint64 start = SDL_GetPerformanceCounter();
+		gHoveredEntity = pickGridPoint( gEntityGrid, gView.x + e.motion.x, gView.y + e.motion.y );
+		gEntityPickTicks += SDL_GetPerformanceCounter() - start;
+		++gEntityPicks;
+	}
+	else if( e.type == SDL_MOUSEBUTTONDOWN )
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		float x = gView.x + e.button.x;
+		float y = gView.y + e.button.y;
+		if( e.button.button == SDL_BUTTON_LEFT )
+		{
+			//Left click removes the entity under the cursor
+			int picked = pickGridPoint( gEntityGrid, x, y );
+			if( picked >= 0 )
+			{
+				removeEntityAt( picked );
+			}
+		}
+		else
+		{
+			//Other buttons remove everything in a box around it, highest ids first so the hole filling doesn't move a hit
+			std::vector<int> hits;
+			SDL_FRect box = { x - 32, y - 32, 64, 64 };
+			queryGridRect( gEntityGrid, box, hits );
+			std::sort( hits.begin(), hits.end() );
+			for( int i = hits.size() - 1; i >= 0; --i )
+			{
+				removeEntityAt( hits[ i ] );
+			}
+		}
+		gHoveredEntity = -1;
+		gEntityPickTicks += SDL_GetPerformanceCounter() - start;
+		++gEntityPicks;
+	}
+}
+
 int main( int argc, char* args[] )
 {
+	//Time startup phases from here
+	startupBegin();
+
+	//Check for the old startup order (for comparison)
+	for( int i = 1; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--legacy-startup" )
+		{
+			gLegacyStartup = true;
+		}
+		else if( std::string( args[ i ] ) == "--entities" && i + 1 < argc )
+		{
+			gEntityCount = atoi( args[ ++i ] );
+			gEntityCount = SDL_max( 0, gEntityCount );
+		}
+		else if( std::string( args[ i ] ) == "--no-cull" )
+		{
+			gEntityCull = false;
+		}
+		else if( std::string( args[ i ] ) == "--cpu-raster" && i + 1 < argc )
+		{
+			gCpuRaster = std::string( args[ ++i ] ) == "stream" ? "stream" : "surface";
+		}
+		else if( std::string( args[ i ] ) == "--state-cache" )
+		{
+			gStateCache = true;
+		}
+		else if( std::string( args[ i ] ) == "--state-stress" && i + 1 < argc )
+		{
+			gStressSprites = atoi( args[ ++i ] );
+			gStressSprites = SDL_max( 0, gStressSprites );
+		}
+		else if( std::string( args[ i ] ) == "--hud" )
+		{
+			gHud.visible = true;
+		}
+		else if( std::string( args[ i ] ) == "--jobs" && i + 1 < argc )
+		{
+			gUseJobs = true;
+			gJobWorkers = atoi( args[ ++i ] );
+		}
+	}
+
+	//Workers come up before anything else so loading can use them, this thread is worker 0
+	if( gUseJobs || gEntityCount > 0 )
+	{
+		startJobSystem( gJobs, gJobWorkers );
+		printf( "Job system running on %d workers\n", jobWorkerCount( gJobs ) );
+	}
+
 	//Start up SDL and create window
 	if( !init() )
 	{
@@ -156,29 +728,74 @@ int main( int argc, char* args[] )
 		}
 		else
 		{	
+			startupMark( "loadMedia" );
+
 			//Main loop flag
 			bool quit = false;
 
 			//Event handler
 			SDL_Event e;
 
+			//With jobs the whole entity frame is one task graph run
+			if( gUseJobs && gEntityCount > 0 )
+			{
+				buildFrameGraph( quit );
+				while( !quit )
+				{
+					runTaskGraph( gJobs, gFrameGraph );
+				}
+			}
+
 			//While application is running
 			while( !quit )
 			{
 				//Handle events on queue
 				while( SDL_PollEvent( &e ) != 0 )
 				{
+					//Counted for the HUD, its toggle key only shows or hides it
+					if( handleHudEvent( gHud, e ) )
+					{
+						continue;
+					}
+
 					//User requests quit
 					if( e.type == SDL_QUIT )
 					{
 						quit = true;
 					}
+					else if( gEntityCount > 0 )
+					{
+						handleEntityEvent( e );
+					}
+				}
+
+				//Animated entities or the stress scene replace the static scene, their state calls go through the cache
+				if( gEntityCount > 0 || gStressSprites > 0 )
+				{
+					cachedSetDrawColor( gRenderState, 0xFF, 0xFF, 0xFF, 0xFF );
+					SDL_RenderClear( gRenderer );
+					countHudDraws( gHud );
+
+					if( gEntityCount > 0 )
+					{
+						renderEntities();
+					}
+					else
+					{
+						renderStateStress();
+					}
+					drawFrameHud( gHud, gRenderer );
+					SDL_RenderPresent( gRenderer );
+					endHudFrame( gHud );
+					endRenderStateFrame( gRenderState );
+					startupFirstFrame( "08" );
+					continue;
 				}
 
 				//Clear screen
 				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0xFF, 0xFF, 0xFF );
 				SDL_RenderClear( gRenderer );
-
+				countHudDraws( gHud );
 
 /*
 ----------------------------------------------------------------------------------------------------------------------------------------------
@@ -191,8 +808,9 @@ in the initialization function. We'll cover why this happens when we get to the
 
 				//Render red filled quad
 				SDL_Rect fillRect = { SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 };
-				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0x00, 0x00, 0xFF );		
+				SDL_SetRenderDrawColor( gRenderer, 0xFF, 0x00, 0x00, 0xFF );
 				SDL_RenderFillRect( gRenderer, &fillRect );
+				countHudDraws( gHud );
 
 /*
 ------------------------------------------------------------------------------------------------------------------------------------------------
@@ -217,8 +835,9 @@ After the rectangle and color have been set, SDL_RenderFillRect is called to dra
 
 				//Render green outlined quad
 				SDL_Rect outlineRect = { SCREEN_WIDTH / 6, SCREEN_HEIGHT / 6, SCREEN_WIDTH * 2 / 3, SCREEN_HEIGHT * 2 / 3 };
-				SDL_SetRenderDrawColor( gRenderer, 0x00, 0xFF, 0x00, 0xFF );		
+				SDL_SetRenderDrawColor( gRenderer, 0x00, 0xFF, 0x00, 0xFF );
 				SDL_RenderDrawRect( gRenderer, &outlineRect );
+				countHudDraws( gHud );
 
 /*
 --------------------------------------------------------------------------------------------------------------------------------------------------
@@ -230,8 +849,9 @@ the screen in size and that the color we're using here is green.
 
 				
 				//Draw blue horizontal line
-				SDL_SetRenderDrawColor( gRenderer, 0x00, 0x00, 0xFF, 0xFF );		
+				SDL_SetRenderDrawColor( gRenderer, 0x00, 0x00, 0xFF, 0xFF );
 				SDL_RenderDrawLine( gRenderer, 0, SCREEN_HEIGHT / 2, SCREEN_WIDTH, SCREEN_HEIGHT / 2 );
+				countHudDraws( gHud );
 
 /*
 -------------------------------------------------------------------------------------------------------------------------------------------------
@@ -245,10 +865,16 @@ the rendering calls the starting x/y position and ending x/y position. These pos
 				for( int i = 0; i < SCREEN_HEIGHT; i += 4 )
 				{
 					SDL_RenderDrawPoint( gRenderer, SCREEN_WIDTH / 2, i );
+					countHudDraws( gHud );
 				}
 
+				//Frame time HUD over the scene
+				drawFrameHud( gHud, gRenderer );
+
 				//Update screen
 				SDL_RenderPresent( gRenderer );
+				endHudFrame( gHud );
+				startupFirstFrame( "08" );
 			}
 
 /*
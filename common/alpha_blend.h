@@ -0,0 +1,399 @@
+/*Premultiplied alpha blits for ARGB8888 sources onto 32-bit screen surfaces.
+
+SDL_BlitSurface with SDL_BLENDMODE_BLEND runs SDL's generic per-pixel blend loop, which multiplies by alpha for every
+pixel of every frame. premultiplySurfaceAlpha does that multiply once at load time, after which source-over is just
+dst = src + dst * ( 255 - a ) / 255. blitPremultiplied blends a premultiplied ARGB8888 surface onto an XRGB8888 or ARGB8888
+surface with one of three ops:
+	BLEND_OVER  source-over, what SDL_BLENDMODE_BLEND does
+	BLEND_ADD   dst + src, saturating, what SDL_BLENDMODE_ADD does
+	BLEND_MOD   dst * ( src + 255 - a ) / 255, which is SDL_BLENDMODE_MOD with transparent pixels leaving dst alone
+Rows are blended 8 pixels at a time with AVX2 when the CPU has it, 4 at a time with SSE2 otherwise, and groups of pixels
+that are all fully transparent are skipped (and for BLEND_OVER, all fully opaque groups are copied), which is most of a
+typical sprite. The scalar path does the same math and is what non-x86 builds get.
+*/
+
+#ifndef ALPHA_BLEND_H
+#define ALPHA_BLEND_H
+
+#include <SDL2/SDL.h>
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <immintrin.h>
+#define ALPHA_BLEND_SSE2 1
+#if defined( __GNUC__ ) || defined( _MSC_VER )
+#define ALPHA_BLEND_AVX2 1
+#endif
+#endif
+
+//GCC and Clang need AVX2 code marked so the rest of the file can stay plain SSE2
+#if defined( ALPHA_BLEND_AVX2 ) && defined( __GNUC__ )
+#define ALPHA_BLEND_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+#define ALPHA_BLEND_TARGET_AVX2
+#endif
+
+//How a premultiplied source combines with the destination
+enum BlendOp
+{
+	BLEND_OVER,
+	BLEND_ADD,
+	BLEND_MOD,
+	BLEND_OP_TOTAL
+};
+
+//Which row kernels to use
+enum BlendPath
+{
+	BLEND_PATH_AUTO,
+	BLEND_PATH_SCALAR,
+	BLEND_PATH_SSE2,
+	BLEND_PATH_AVX2
+};
+
+inline const char* blendOpName( BlendOp op )
+{
+	switch( op )
+	{
+		case BLEND_OVER: return "over";
+		case BLEND_ADD: return "add";
+		case BLEND_MOD: return "mod";
+		default: return "unknown";
+	}
+}
+
+inline const char* blendPathName( BlendPath path )
+{
+	switch( path )
+	{
+		case BLEND_PATH_SCALAR: return "scalar";
+		case BLEND_PATH_SSE2: return "sse2";
+		case BLEND_PATH_AVX2: return "avx2";
+		default: return "auto";
+	}
+}
+
+//The fastest kernels this CPU runs
+inline BlendPath bestBlendPath()
+{
+#ifdef ALPHA_BLEND_AVX2
+	if( SDL_HasAVX2() )
+	{
+		return BLEND_PATH_AVX2;
+	}
+#endif
+#ifdef ALPHA_BLEND_SSE2
+	if( SDL_HasSSE2() )
+	{
+		return BLEND_PATH_SSE2;
+	}
+#endif
+	return BLEND_PATH_SCALAR;
+}
+
+//x / 255 rounded, exact for x up to 255 * 255
+inline Uint32 div255( Uint32 x )
+{
+	x += 128;
+	return ( x + ( x >> 8 ) ) >> 8;
+}
+
+//Multiplies the color channels of an ARGB8888 surface by its alpha in place, returns false for other formats
+inline bool premultiplySurfaceAlpha( SDL_Surface* surface )
+{
+	if( surface == NULL || surface->format->format != SDL_PIXELFORMAT_ARGB8888 )
+	{
+		SDL_SetError( "Premultiplying needs an ARGB8888 surface" );
+		return false;
+	}
+
+	if( SDL_MUSTLOCK( surface ) )
+	{
+		SDL_LockSurface( surface );
+	}
+	for( int y = 0; y < surface->h; ++y )
+	{
+		Uint32* row = (Uint32*)( (Uint8*)surface->pixels + y * surface->pitch );
+		for( int x = 0; x < surface->w; ++x )
+		{
+			Uint32 pixel = row[ x ];
+			Uint32 a = pixel >> 24;
+			if( a == 0 )
+			{
+				row[ x ] = 0;
+			}
+			else if( a != 0xFF )
+			{
+				row[ x ] = ( a << 24 ) | ( div255( ( ( pixel >> 16 ) & 0xFF ) * a ) << 16 ) | ( div255( ( ( pixel >> 8 ) & 0xFF ) * a ) << 8 ) | div255( ( pixel & 0xFF ) * a );
+			}
+		}
+	}
+	if( SDL_MUSTLOCK( surface ) )
+	{
+		SDL_UnlockSurface( surface );
+	}
+
+	return true;
+}
+
+//Blends one pixel, the tail of every vector row and the whole row on the scalar path
+inline Uint32 blendPixel( Uint32 src, Uint32 dst, BlendOp op )
+{
+	Uint32 a = src >> 24;
+	Uint32 result = 0;
+	for( int shift = 0; shift < 32; shift += 8 )
+	{
+		Uint32 s = ( src >> shift ) & 0xFF;
+		Uint32 d = ( dst >> shift ) & 0xFF;
+		Uint32 c;
+		if( op == BLEND_OVER )
+		{
+			c = SDL_min( s + div255( d * ( 255 - a ) ), 255u );
+		}
+		else if( op == BLEND_ADD )
+		{
+			c = SDL_min( s + d, 255u );
+		}
+		else
+		{
+			c = div255( d * ( s + 255 - a ) );
+		}
+		result |= c << shift;
+	}
+
+	return result;
+}
+
+inline void blendRowScalar( const Uint32* src, Uint32* dst, int count, BlendOp op )
+{
+	for( int i = 0; i < count; ++i )
+	{
+		Uint32 s = src[ i ];
+		if( s == 0 )
+		{
+			continue;
+		}
+		if( op == BLEND_OVER && ( s >> 24 ) == 0xFF )
+		{
+			dst[ i ] = s;
+			continue;
+		}
+		dst[ i ] = blendPixel( s, dst[ i ], op );
+	}
+}
+
+#ifdef ALPHA_BLEND_SSE2
+//d * f / 255 on 16-bit lanes
+inline __m128i mulDiv255SSE2( __m128i d, __m128i f )
+{
+	__m128i x = _mm_add_epi16( _mm_mullo_epi16( d, f ), _mm_set1_epi16( 128 ) );
+	return _mm_mulhi_epu16( x, _mm_set1_epi16( 257 ) );
+}
+
+//The per-channel factor dst gets multiplied by for 2 pixels widened to 16 bits
+inline __m128i blendFactorSSE2( __m128i s16, BlendOp op )
+{
+	__m128i alpha = _mm_shufflehi_epi16( _mm_shufflelo_epi16( s16, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+	__m128i inverse = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+	return op == BLEND_OVER ? inverse : _mm_add_epi16( s16, inverse );
+}
+
+inline void blendRowSSE2( const Uint32* src, Uint32* dst, int count, BlendOp op )
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i alphaMask = _mm_set1_epi32( (int)0xFF000000 );
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i s = _mm_loadu_si128( (const __m128i*)( src + i ) );
+
+		//Fully transparent premultiplied pixels are all zero and change nothing
+		if( _mm_movemask_epi8( _mm_cmpeq_epi32( s, zero ) ) == 0xFFFF )
+		{
+			continue;
+		}
+		if( op == BLEND_OVER && _mm_movemask_epi8( _mm_cmpeq_epi32( _mm_and_si128( s, alphaMask ), alphaMask ) ) == 0xFFFF )
+		{
+			_mm_storeu_si128( (__m128i*)( dst + i ), s );
+			continue;
+		}
+
+		__m128i d = _mm_loadu_si128( (const __m128i*)( dst + i ) );
+		if( op == BLEND_ADD )
+		{
+			d = _mm_adds_epu8( d, s );
+		}
+		else
+		{
+			__m128i sLo = _mm_unpacklo_epi8( s, zero );
+			__m128i sHi = _mm_unpackhi_epi8( s, zero );
+			__m128i dLo = mulDiv255SSE2( _mm_unpacklo_epi8( d, zero ), blendFactorSSE2( sLo, op ) );
+			__m128i dHi = mulDiv255SSE2( _mm_unpackhi_epi8( d, zero ), blendFactorSSE2( sHi, op ) );
+			d = _mm_packus_epi16( dLo, dHi );
+			if( op == BLEND_OVER )
+			{
+				d = _mm_adds_epu8( d, s );
+			}
+		}
+		_mm_storeu_si128( (__m128i*)( dst + i ), d );
+	}
+
+	blendRowScalar( src + i, dst + i, count - i, op );
+}
+#endif
+
+#ifdef ALPHA_BLEND_AVX2
+ALPHA_BLEND_TARGET_AVX2 inline __m256i mulDiv255AVX2( __m256i d, __m256i f )
+{
+	__m256i x = _mm256_add_epi16( _mm256_mullo_epi16( d, f ), _mm256_set1_epi16( 128 ) );
+	return _mm256_mulhi_epu16( x, _mm256_set1_epi16( 257 ) );
+}
+
+ALPHA_BLEND_TARGET_AVX2 inline __m256i blendFactorAVX2( __m256i s16, BlendOp op )
+{
+	__m256i alpha = _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( s16, _MM_SHUFFLE( 3, 3, 3, 3 ) ), _MM_SHUFFLE( 3, 3, 3, 3 ) );
+	__m256i inverse = _mm256_sub_epi16( _mm256_set1_epi16( 255 ), alpha );
+	return op == BLEND_OVER ? inverse : _mm256_add_epi16( s16, inverse );
+}
+
+//Same as the SSE2 row, 8 pixels at a time (unpack and pack work within 128-bit lanes so pixel order is kept)
+ALPHA_BLEND_TARGET_AVX2 inline void blendRowAVX2( const Uint32* src, Uint32* dst, int count, BlendOp op )
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i alphaMask = _mm256_set1_epi32( (int)0xFF000000 );
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256i s = _mm256_loadu_si256( (const __m256i*)( src + i ) );
+		if( _mm256_testz_si256( s, s ) )
+		{
+			continue;
+		}
+		if( op == BLEND_OVER && _mm256_movemask_epi8( _mm256_cmpeq_epi32( _mm256_and_si256( s, alphaMask ), alphaMask ) ) == -1 )
+		{
+			_mm256_storeu_si256( (__m256i*)( dst + i ), s );
+			continue;
+		}
+
+		__m256i d = _mm256_loadu_si256( (const __m256i*)( dst + i ) );
+		if( op == BLEND_ADD )
+		{
+			d = _mm256_adds_epu8( d, s );
+		}
+		else
+		{
+			__m256i sLo = _mm256_unpacklo_epi8( s, zero );
+			__m256i sHi = _mm256_unpackhi_epi8( s, zero );
+			__m256i dLo = mulDiv255AVX2( _mm256_unpacklo_epi8( d, zero ), blendFactorAVX2( sLo, op ) );
+			__m256i dHi = mulDiv255AVX2( _mm256_unpackhi_epi8( d, zero ), blendFactorAVX2( sHi, op ) );
+			d = _mm256_packus_epi16( dLo, dHi );
+			if( op == BLEND_OVER )
+			{
+				d = _mm256_adds_epu8( d, s );
+			}
+		}
+		_mm256_storeu_si256( (__m256i*)( dst + i ), d );
+	}
+
+	blendRowScalar( src + i, dst + i, count - i, op );
+}
+#endif
+
+//Blends one row with the given kernels
+inline void blendRow( const Uint32* src, Uint32* dst, int count, BlendOp op, BlendPath path )
+{
+	if( path == BLEND_PATH_AUTO )
+	{
+		static BlendPath best = bestBlendPath();
+		path = best;
+	}
+
+#ifdef ALPHA_BLEND_AVX2
+	if( path == BLEND_PATH_AVX2 )
+	{
+		blendRowAVX2( src, dst, count, op );
+		return;
+	}
+#endif
+#ifdef ALPHA_BLEND_SSE2
+	if( path == BLEND_PATH_SSE2 || path == BLEND_PATH_AVX2 )
+	{
+		blendRowSSE2( src, dst, count, op );
+		return;
+	}
+#endif
+	blendRowScalar( src, dst, count, op );
+}
+
+/*Blends a premultiplied ARGB8888 surface onto a 32-bit XRGB8888 or ARGB8888 surface, clipped like SDL_BlitSurface.
+dstRect only supplies the position and gets the final blended rect written back, returns 0 or -1 with SDL_GetError set*/
+inline int blitPremultiplied( SDL_Surface* src, const SDL_Rect* srcRect, SDL_Surface* dst, SDL_Rect* dstRect, BlendOp op, BlendPath path = BLEND_PATH_AUTO )
+{
+	if( src == NULL || dst == NULL )
+	{
+		return SDL_SetError( "blitPremultiplied: passed a NULL surface" );
+	}
+	if( src->format->format != SDL_PIXELFORMAT_ARGB8888 || ( dst->format->format != SDL_PIXELFORMAT_RGB888 && dst->format->format != SDL_PIXELFORMAT_ARGB8888 ) )
+	{
+		return SDL_SetError( "blitPremultiplied: needs an ARGB8888 source and an XRGB8888 or ARGB8888 destination" );
+	}
+
+	//Source area, clipped to the source
+	SDL_Rect from = { 0, 0, src->w, src->h };
+	if( srcRect != NULL )
+	{
+		SDL_Rect full = from;
+		if( !SDL_IntersectRect( srcRect, &full, &from ) )
+		{
+			from.w = from.h = 0;
+		}
+	}
+
+	//Where it lands, clipped to the destination's clip rect with the source area trimmed to match
+	SDL_Rect to = { dstRect != NULL ? dstRect->x : 0, dstRect != NULL ? dstRect->y : 0, from.w, from.h };
+	if( srcRect != NULL )
+	{
+		to.x += from.x - srcRect->x;
+		to.y += from.y - srcRect->y;
+	}
+	SDL_Rect clipped;
+	if( from.w <= 0 || from.h <= 0 || !SDL_IntersectRect( &to, &dst->clip_rect, &clipped ) )
+	{
+		if( dstRect != NULL )
+		{
+			dstRect->w = dstRect->h = 0;
+		}
+		return 0;
+	}
+	from.x += clipped.x - to.x;
+	from.y += clipped.y - to.y;
+
+	if( SDL_MUSTLOCK( src ) )
+	{
+		SDL_LockSurface( src );
+	}
+	if( SDL_MUSTLOCK( dst ) )
+	{
+		SDL_LockSurface( dst );
+	}
+	for( int y = 0; y < clipped.h; ++y )
+	{
+		const Uint32* srcRow = (const Uint32*)( (const Uint8*)src->pixels + ( from.y + y ) * src->pitch ) + from.x;
+		Uint32* dstRow = (Uint32*)( (Uint8*)dst->pixels + ( clipped.y + y ) * dst->pitch ) + clipped.x;
+		blendRow( srcRow, dstRow, clipped.w, op, path );
+	}
+	if( SDL_MUSTLOCK( dst ) )
+	{
+		SDL_UnlockSurface( dst );
+	}
+	if( SDL_MUSTLOCK( src ) )
+	{
+		SDL_UnlockSurface( src );
+	}
+
+	if( dstRect != NULL )
+	{
+		*dstRect = clipped;
+	}
+	return 0;
+}
+
+#endif
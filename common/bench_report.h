@@ -0,0 +1,283 @@
+/*Shared timing and result reporting for the benchmark tools.
+
+Every tool collects its numbers into a BenchReport and writes it out as one JSON document so results can be compared
+between runs and machines:
+
+	{ "suite": "decode_bench", "build": { ... }, "results": [ { "name": "...", "params": { ... }, "metrics": { ... } }, ... ] }
+
+A result can also carry series, one value per frame or call ("series": { "cycles": [ ... ] }), left out when it has none.
+build says what made the numbers: the git revision and compiler flags the makefile passes in as BENCH_GIT_REV and
+BENCH_BUILD_FLAGS, the compiler, and the CPU's model and count. tools/bench_history keeps reports with it.
+*/
+
+#ifndef BENCH_REPORT_H
+#define BENCH_REPORT_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+//Revision and flags the benchmark was built from, set by the makefiles
+#ifndef BENCH_GIT_REV
+#define BENCH_GIT_REV ""
+#endif
+#ifndef BENCH_BUILD_FLAGS
+#define BENCH_BUILD_FLAGS ""
+#endif
+
+//One measured configuration
+struct BenchResult
+{
+	std::string name;
+	std::vector< std::pair<std::string, std::string> > params;
+	std::vector< std::pair<std::string, double> > metrics;
+	std::vector< std::pair<std::string, std::vector<double> > > series;
+};
+
+//A whole benchmark run
+struct BenchReport
+{
+	std::string suite;
+	std::vector<BenchResult> results;
+};
+
+//Summary of repeated timings in milliseconds
+struct BenchStats
+{
+	int samples;
+	double min;
+	double median;
+	double mean;
+	double p99;
+	double max;
+};
+
+//Current time in milliseconds on the performance counter
+inline double benchNowMs()
+{
+	return SDL_GetPerformanceCounter() * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+//Summarizes a set of timings
+inline BenchStats summarizeSamples( std::vector<double> samples )
+{
+	BenchStats stats = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	if( samples.empty() )
+	{
+		return stats;
+	}
+
+	std::sort( samples.begin(), samples.end() );
+
+	double sum = 0.0;
+	for( size_t i = 0; i < samples.size(); ++i )
+	{
+		sum += samples[ i ];
+	}
+
+	stats.samples = samples.size();
+	stats.min = samples.front();
+	stats.median = samples[ samples.size() / 2 ];
+	stats.mean = sum / samples.size();
+	stats.p99 = samples[ std::min( samples.size() - 1, (size_t)( samples.size() * 0.99 ) ) ];
+	stats.max = samples.back();
+
+	return stats;
+}
+
+//Drops samples far outside the middle half (Tukey's outer fences, 3 interquartile ranges out) and returns how many,
+//for timings that an interrupt or page fault can blow up; needs 4 samples to say anything
+inline int removeOutliers( std::vector<double>& samples )
+{
+	if( samples.size() < 4 )
+	{
+		return 0;
+	}
+
+	std::vector<double> sorted = samples;
+	std::sort( sorted.begin(), sorted.end() );
+	double q1 = sorted[ sorted.size() / 4 ];
+	double q3 = sorted[ sorted.size() * 3 / 4 ];
+	double low = q1 - 3.0 * ( q3 - q1 );
+	double high = q3 + 3.0 * ( q3 - q1 );
+
+	size_t before = samples.size();
+	samples.erase( std::remove_if( samples.begin(), samples.end(), [ low, high ]( double sample ) { return sample < low || sample > high; } ), samples.end() );
+	return before - samples.size();
+}
+
+//Adds the usual timing metrics of a stats summary to a result
+inline void addStatsMetrics( BenchResult& result, BenchStats stats )
+{
+	result.metrics.push_back( std::make_pair( "samples", (double)stats.samples ) );
+	result.metrics.push_back( std::make_pair( "min_ms", stats.min ) );
+	result.metrics.push_back( std::make_pair( "median_ms", stats.median ) );
+	result.metrics.push_back( std::make_pair( "mean_ms", stats.mean ) );
+	result.metrics.push_back( std::make_pair( "p99_ms", stats.p99 ) );
+	result.metrics.push_back( std::make_pair( "max_ms", stats.max ) );
+}
+
+//Writes a number, null if it isn't finite
+inline void writeJsonNumber( FILE* file, double value )
+{
+	if( std::isfinite( value ) )
+	{
+		fprintf( file, "%.6g", value );
+	}
+	else
+	{
+		fprintf( file, "null" );
+	}
+}
+
+//Writes a string as a quoted JSON string
+inline void writeJsonString( FILE* file, std::string text )
+{
+	fputc( '"', file );
+	for( size_t i = 0; i < text.size(); ++i )
+	{
+		unsigned char c = text[ i ];
+		if( c == '"' || c == '\\' )
+		{
+			fprintf( file, "\\%c", c );
+		}
+		else if( c < 0x20 )
+		{
+			fprintf( file, "\\u%04x", c );
+		}
+		else
+		{
+			fputc( c, file );
+		}
+	}
+	fputc( '"', file );
+}
+
+//Writes one result as a JSON object, series included if asked for
+inline void writeBenchResult( FILE* file, const BenchResult& result, bool withSeries )
+{
+	fprintf( file, "{ \"name\": " );
+	writeJsonString( file, result.name );
+
+	fprintf( file, ", \"params\": {" );
+	for( size_t i = 0; i < result.params.size(); ++i )
+	{
+		fprintf( file, i == 0 ? " " : ", " );
+		writeJsonString( file, result.params[ i ].first );
+		fprintf( file, ": " );
+		writeJsonString( file, result.params[ i ].second );
+	}
+
+	fprintf( file, " }, \"metrics\": {" );
+	for( size_t i = 0; i < result.metrics.size(); ++i )
+	{
+		fprintf( file, i == 0 ? " " : ", " );
+		writeJsonString( file, result.metrics[ i ].first );
+		fprintf( file, ": " );
+		writeJsonNumber( file, result.metrics[ i ].second );
+	}
+	fprintf( file, " }" );
+
+	if( withSeries && !result.series.empty() )
+	{
+		fprintf( file, ", \"series\": {" );
+		for( size_t i = 0; i < result.series.size(); ++i )
+		{
+			fprintf( file, i == 0 ? " " : ", " );
+			writeJsonString( file, result.series[ i ].first );
+			fprintf( file, ": [" );
+			const std::vector<double>& values = result.series[ i ].second;
+			for( size_t v = 0; v < values.size(); ++v )
+			{
+				fprintf( file, v == 0 ? " " : ", " );
+				writeJsonNumber( file, values[ v ] );
+			}
+			fprintf( file, " ]" );
+		}
+		fprintf( file, " }" );
+	}
+
+	fprintf( file, " }" );
+}
+
+//The CPU's model name, the platform's name where it can't be read
+inline std::string benchCpuModel()
+{
+	std::string model;
+#ifdef __linux__
+	FILE* cpuinfo = fopen( "/proc/cpuinfo", "r" );
+	if( cpuinfo != NULL )
+	{
+		char line[ 512 ];
+		while( model.empty() && fgets( line, sizeof( line ), cpuinfo ) != NULL )
+		{
+			std::string text = line;
+			size_t colon = text.find( ':' );
+			if( text.compare( 0, 10, "model name" ) == 0 && colon != std::string::npos )
+			{
+				model = text.substr( text.find_first_not_of( " \t", colon + 1 ) );
+				model.erase( model.find_last_not_of( " \t\r\n" ) + 1 );
+			}
+		}
+		fclose( cpuinfo );
+	}
+#endif
+
+	return model.empty() ? std::string( SDL_GetPlatform() ) : model;
+}
+
+//Writes the build and machine the report came from
+inline void writeBenchBuild( FILE* file )
+{
+	fprintf( file, "{ \"rev\": " );
+	writeJsonString( file, BENCH_GIT_REV );
+	fprintf( file, ", \"flags\": " );
+	writeJsonString( file, BENCH_BUILD_FLAGS );
+	fprintf( file, ", \"compiler\": " );
+#ifdef __VERSION__
+	writeJsonString( file, __VERSION__ );
+#else
+	writeJsonString( file, "" );
+#endif
+	fprintf( file, ", \"cpu\": " );
+	writeJsonString( file, benchCpuModel() );
+	fprintf( file, ", \"cpus\": %d }", SDL_GetCPUCount() );
+}
+
+//Writes the report as JSON to a file, or to stdout if path is NULL or "-"
+inline bool writeBenchReport( const BenchReport& report, const char* path )
+{
+	bool toStdout = path == NULL || std::string( path ) == "-";
+	FILE* file = toStdout ? stdout : fopen( path, "w" );
+	if( file == NULL )
+	{
+		printf( "Unable to write benchmark report %s!\n", path );
+		return false;
+	}
+
+	fprintf( file, "{\n  \"suite\": " );
+	writeJsonString( file, report.suite );
+	fprintf( file, ",\n  \"build\": " );
+	writeBenchBuild( file );
+	fprintf( file, ",\n  \"results\": [\n" );
+	for( size_t r = 0; r < report.results.size(); ++r )
+	{
+		fprintf( file, "    " );
+		writeBenchResult( file, report.results[ r ], true );
+		fprintf( file, "%s\n", r + 1 < report.results.size() ? "," : "" );
+	}
+	fprintf( file, "  ]\n}\n" );
+
+	if( !toStdout )
+	{
+		fclose( file );
+	}
+
+	return true;
+}
+
+#endif
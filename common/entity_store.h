@@ -0,0 +1,336 @@
+/*Structure-of-arrays store for large numbers of animated primitives.
+
+Position, velocity, size and color each live in their own SIMD-aligned array so the update streams through memory four
+entities at a time. updateEntities moves everything, bounces it off the bounds and writes the results straight into the
+SDL_Vertex quads SDL_RenderGeometry takes (or the SDL_FRect array SDL_RenderFillRectsF takes), a block of entities per
+job (see parallelFor in job_system.h). The SSE2 kernels are used whenever the compiler targets SSE2, which every x86-64
+build does; anything else gets the scalar loops, which compute the same thing.
+*/
+
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <SDL2/SDL.h>
+#include <string.h>
+#include <vector>
+#include "job_system.h"
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define ENTITY_STORE_SSE2 1
+#endif
+
+//Entities per job, small enough to stay in L2 between the update and the vertex write
+const int ENTITY_BLOCK = 4096;
+
+//The entities
+struct EntityStore
+{
+	int count;
+	int capacity;
+
+	float* x;
+	float* y;
+	float* vx;
+	float* vy;
+	float* w;
+	float* h;
+
+	//SDL_Color bytes, so a vertex color is a plain copy
+	Uint32* color;
+
+	//What entities bounce off
+	SDL_FRect bounds;
+};
+
+//Allocates room for capacity entities, rounded up to whole SIMD lanes
+inline bool createEntityStore( EntityStore& store, int capacity, SDL_FRect bounds )
+{
+	memset( &store, 0, sizeof( store ) );
+	capacity = ( SDL_max( capacity, 1 ) + 3 ) & ~3;
+
+	float** arrays[] = { &store.x, &store.y, &store.vx, &store.vy, &store.w, &store.h };
+	for( size_t i = 0; i < sizeof( arrays ) / sizeof( arrays[ 0 ] ); ++i )
+	{
+		*arrays[ i ] = (float*)SDL_SIMDAlloc( capacity * sizeof( float ) );
+	}
+	store.color = (Uint32*)SDL_SIMDAlloc( capacity * sizeof( Uint32 ) );
+
+	if( store.x == NULL || store.y == NULL || store.vx == NULL || store.vy == NULL || store.w == NULL || store.h == NULL || store.color == NULL )
+	{
+		SDL_SIMDFree( store.x );
+		SDL_SIMDFree( store.y );
+		SDL_SIMDFree( store.vx );
+		SDL_SIMDFree( store.vy );
+		SDL_SIMDFree( store.w );
+		SDL_SIMDFree( store.h );
+		SDL_SIMDFree( store.color );
+		memset( &store, 0, sizeof( store ) );
+		SDL_OutOfMemory();
+		return false;
+	}
+
+	store.capacity = capacity;
+	store.bounds = bounds;
+	return true;
+}
+
+inline void freeEntityStore( EntityStore& store )
+{
+	SDL_SIMDFree( store.x );
+	SDL_SIMDFree( store.y );
+	SDL_SIMDFree( store.vx );
+	SDL_SIMDFree( store.vy );
+	SDL_SIMDFree( store.w );
+	SDL_SIMDFree( store.h );
+	SDL_SIMDFree( store.color );
+	memset( &store, 0, sizeof( store ) );
+}
+
+//Adds an entity, returns its index or -1 if the store is full
+inline int addEntity( EntityStore& store, float x, float y, float vx, float vy, float w, float h, SDL_Color color )
+{
+	if( store.count >= store.capacity )
+	{
+		return -1;
+	}
+
+	int i = store.count++;
+	store.x[ i ] = x;
+	store.y[ i ] = y;
+	store.vx[ i ] = vx;
+	store.vy[ i ] = vy;
+	store.w[ i ] = w;
+	store.h[ i ] = h;
+	memcpy( &store.color[ i ], &color, sizeof( Uint32 ) );
+	return i;
+}
+
+//Removes an entity by moving the last one into its slot, returns the old index of the entity that moved or -1 if none did
+inline int removeEntity( EntityStore& store, int i )
+{
+	int last = --store.count;
+	if( i == last )
+	{
+		return -1;
+	}
+
+	store.x[ i ] = store.x[ last ];
+	store.y[ i ] = store.y[ last ];
+	store.vx[ i ] = store.vx[ last ];
+	store.vy[ i ] = store.vy[ last ];
+	store.w[ i ] = store.w[ last ];
+	store.h[ i ] = store.h[ last ];
+	store.color[ i ] = store.color[ last ];
+	return last;
+}
+
+//Fills the store with reproducible random entities inside the bounds
+inline void spawnRandomEntities( EntityStore& store, int count, Uint32 seed )
+{
+	for( int i = 0; i < count && store.count < store.capacity; ++i )
+	{
+		//Small LCG so every run gets the same scene
+		seed = seed * 1664525u + 1013904223u;
+		float w = (float)( 2 + ( seed >> 8 ) % 7 );
+		float h = (float)( 2 + ( seed >> 16 ) % 7 );
+		float x = store.bounds.x + ( seed >> 4 ) % (Uint32)SDL_max( 1.0f, store.bounds.w - w );
+		seed = seed * 1664525u + 1013904223u;
+		float y = store.bounds.y + ( seed >> 4 ) % (Uint32)SDL_max( 1.0f, store.bounds.h - h );
+		float vx = ( (int)( ( seed >> 12 ) % 401 ) - 200 ) * 1.0f;
+		float vy = ( (int)( ( seed >> 21 ) % 401 ) - 200 ) * 1.0f;
+		SDL_Color color = { (Uint8)( seed >> 3 ), (Uint8)( seed >> 11 ), (Uint8)( seed >> 19 ), 0xFF };
+		addEntity( store, x, y, vx, vy, w, h, color );
+	}
+}
+
+//Moves entities [begin, end) by dt seconds, an entity that would leave the bounds reverses instead of moving
+inline void updateEntityRange( EntityStore& store, int begin, int end, float dt )
+{
+	int i = begin;
+
+#ifdef ENTITY_STORE_SSE2
+	//Blocks start on multiples of 4 so the aligned loads are safe
+	__m128 vdt = _mm_set1_ps( dt );
+	__m128 vMinX = _mm_set1_ps( store.bounds.x );
+	__m128 vMinY = _mm_set1_ps( store.bounds.y );
+	__m128 vMaxX = _mm_set1_ps( store.bounds.x + store.bounds.w );
+	__m128 vMaxY = _mm_set1_ps( store.bounds.y + store.bounds.h );
+	__m128 sign = _mm_set1_ps( -0.0f );
+	for( ; ( i & 3 ) == 0 && i + 4 <= end; i += 4 )
+	{
+		__m128 x = _mm_load_ps( store.x + i );
+		__m128 vx = _mm_load_ps( store.vx + i );
+		__m128 nx = _mm_add_ps( x, _mm_mul_ps( vx, vdt ) );
+		__m128 outX = _mm_or_ps( _mm_cmplt_ps( nx, vMinX ), _mm_cmpgt_ps( _mm_add_ps( nx, _mm_load_ps( store.w + i ) ), vMaxX ) );
+		_mm_store_ps( store.vx + i, _mm_xor_ps( vx, _mm_and_ps( outX, sign ) ) );
+		_mm_store_ps( store.x + i, _mm_or_ps( _mm_and_ps( outX, x ), _mm_andnot_ps( outX, nx ) ) );
+
+		__m128 y = _mm_load_ps( store.y + i );
+		__m128 vy = _mm_load_ps( store.vy + i );
+		__m128 ny = _mm_add_ps( y, _mm_mul_ps( vy, vdt ) );
+		__m128 outY = _mm_or_ps( _mm_cmplt_ps( ny, vMinY ), _mm_cmpgt_ps( _mm_add_ps( ny, _mm_load_ps( store.h + i ) ), vMaxY ) );
+		_mm_store_ps( store.vy + i, _mm_xor_ps( vy, _mm_and_ps( outY, sign ) ) );
+		_mm_store_ps( store.y + i, _mm_or_ps( _mm_and_ps( outY, y ), _mm_andnot_ps( outY, ny ) ) );
+	}
+#endif
+
+	float maxX = store.bounds.x + store.bounds.w;
+	float maxY = store.bounds.y + store.bounds.h;
+	for( ; i < end; ++i )
+	{
+		float nx = store.x[ i ] + store.vx[ i ] * dt;
+		if( nx < store.bounds.x || nx + store.w[ i ] > maxX )
+		{
+			store.vx[ i ] = -store.vx[ i ];
+		}
+		else
+		{
+			store.x[ i ] = nx;
+		}
+
+		float ny = store.y[ i ] + store.vy[ i ] * dt;
+		if( ny < store.bounds.y || ny + store.h[ i ] > maxY )
+		{
+			store.vy[ i ] = -store.vy[ i ];
+		}
+		else
+		{
+			store.y[ i ] = ny;
+		}
+	}
+}
+
+//Writes entities [begin, end) as untextured quads, 4 vertices each starting at vertices[ begin * 4 ]
+inline void writeEntityVertices( const EntityStore& store, int begin, int end, SDL_Vertex* vertices )
+{
+	SDL_Vertex* vertex = vertices + begin * 4;
+	for( int i = begin; i < end; ++i, vertex += 4 )
+	{
+		float x0 = store.x[ i ];
+		float y0 = store.y[ i ];
+		float x1 = x0 + store.w[ i ];
+		float y1 = y0 + store.h[ i ];
+
+		vertex[ 0 ].position.x = x0;
+		vertex[ 0 ].position.y = y0;
+		vertex[ 1 ].position.x = x1;
+		vertex[ 1 ].position.y = y0;
+		vertex[ 2 ].position.x = x1;
+		vertex[ 2 ].position.y = y1;
+		vertex[ 3 ].position.x = x0;
+		vertex[ 3 ].position.y = y1;
+		for( int v = 0; v < 4; ++v )
+		{
+			memcpy( &vertex[ v ].color, &store.color[ i ], sizeof( Uint32 ) );
+			vertex[ v ].tex_coord.x = 0.0f;
+			vertex[ v ].tex_coord.y = 0.0f;
+		}
+	}
+}
+
+//Writes the listed entities as untextured quads packed from vertices[ 0 ], moved by offset (for culled or scrolled views)
+inline void writeEntityVerticesIndexed( const EntityStore& store, const int* ids, int idCount, float offsetX, float offsetY, SDL_Vertex* vertices )
+{
+	SDL_Vertex* vertex = vertices;
+	for( int n = 0; n < idCount; ++n, vertex += 4 )
+	{
+		int i = ids[ n ];
+		float x0 = store.x[ i ] + offsetX;
+		float y0 = store.y[ i ] + offsetY;
+		float x1 = x0 + store.w[ i ];
+		float y1 = y0 + store.h[ i ];
+
+		vertex[ 0 ].position.x = x0;
+		vertex[ 0 ].position.y = y0;
+		vertex[ 1 ].position.x = x1;
+		vertex[ 1 ].position.y = y0;
+		vertex[ 2 ].position.x = x1;
+		vertex[ 2 ].position.y = y1;
+		vertex[ 3 ].position.x = x0;
+		vertex[ 3 ].position.y = y1;
+		for( int v = 0; v < 4; ++v )
+		{
+			memcpy( &vertex[ v ].color, &store.color[ i ], sizeof( Uint32 ) );
+			vertex[ v ].tex_coord.x = 0.0f;
+			vertex[ v ].tex_coord.y = 0.0f;
+		}
+	}
+}
+
+//Writes entities [begin, end) as rects starting at rects[ begin ]
+inline void writeEntityRects( const EntityStore& store, int begin, int end, SDL_FRect* rects )
+{
+	int i = begin;
+
+#ifdef ENTITY_STORE_SSE2
+	//Four entities' x, y, w, h transposed into four x, y, w, h rects
+	for( ; ( i & 3 ) == 0 && i + 4 <= end; i += 4 )
+	{
+		__m128 x = _mm_load_ps( store.x + i );
+		__m128 y = _mm_load_ps( store.y + i );
+		__m128 w = _mm_load_ps( store.w + i );
+		__m128 h = _mm_load_ps( store.h + i );
+		_MM_TRANSPOSE4_PS( x, y, w, h );
+		float* out = &rects[ i ].x;
+		_mm_storeu_ps( out, x );
+		_mm_storeu_ps( out + 4, y );
+		_mm_storeu_ps( out + 8, w );
+		_mm_storeu_ps( out + 12, h );
+	}
+#endif
+
+	for( ; i < end; ++i )
+	{
+		rects[ i ].x = store.x[ i ];
+		rects[ i ].y = store.y[ i ];
+		rects[ i ].w = store.w[ i ];
+		rects[ i ].h = store.h[ i ];
+	}
+}
+
+//Updates every entity and writes it to whichever of vertices (4 per entity) and rects are given, across jobs's workers
+inline void updateEntities( EntityStore& store, float dt, SDL_Vertex* vertices, SDL_FRect* rects, JobSystem* jobs = NULL )
+{
+	//Each block is written right after it's moved, while it's still in the cache
+	parallelFor( jobs, 0, store.count, ENTITY_BLOCK, [ & ]( int first, int last )
+	{
+		for( int begin = first; begin < last; begin += ENTITY_BLOCK )
+		{
+			int end = SDL_min( begin + ENTITY_BLOCK, last );
+			updateEntityRange( store, begin, end, dt );
+			if( vertices != NULL )
+			{
+				writeEntityVertices( store, begin, end, vertices );
+			}
+			if( rects != NULL )
+			{
+				writeEntityRects( store, begin, end, rects );
+			}
+		}
+	} );
+}
+
+//Fills indices with two triangles per quad for count quads, only growing it when count does
+inline void buildQuadIndices( std::vector<int>& indices, int count )
+{
+	size_t first = indices.size() / 6;
+	if( first >= (size_t)count )
+	{
+		return;
+	}
+
+	indices.resize( count * 6 );
+	for( size_t i = first; i < (size_t)count; ++i )
+	{
+		int v = i * 4;
+		int* index = &indices[ i * 6 ];
+		index[ 0 ] = v;
+		index[ 1 ] = v + 1;
+		index[ 2 ] = v + 2;
+		index[ 3 ] = v + 2;
+		index[ 4 ] = v + 3;
+		index[ 5 ] = v;
+	}
+}
+
+#endif
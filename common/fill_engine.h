@@ -0,0 +1,423 @@
+/*Full surface fills: solid colors, gradients and patterns, threaded and with streaming stores.
+
+SDL_FillRect writes one color through the cache on one thread. That's fine at 640x480, but a 4K or 8K surface is far
+bigger than the caches, so every cache line it writes is first read in from memory and later written back out, and
+one core can't use all the memory bandwidth. fillSurface splits the rows into jobs and, for surfaces bigger than the
+last level cache, writes them with non-temporal (streaming) stores that go straight to memory without the read.
+Each row is written from a template: the color itself for solid fills and vertical gradients, a precomputed row for
+horizontal gradients and for each band of a checker pattern, so the patterns cost what a solid fill does.
+	FILL_SOLID                color0 everywhere
+	FILL_VERTICAL_GRADIENT    color0 at the top blending to color1 at the bottom
+	FILL_HORIZONTAL_GRADIENT  color0 on the left blending to color1 on the right
+	FILL_CHECKER              cell x cell squares of color0 and color1
+Colors are mapped pixel values (SDL_MapRGB for the surface) and gradients blend each byte on its own, which is right
+for any 32-bit format. Rows go 8 pixels at a time with AVX2, 4 with SSE2, and non-x86 builds get the scalar loops.
+Streaming stores only pay off when the pixels won't be read again soon: a surface that fits in the cache is about to be
+blitted or uploaded from there, so FILL_STORES_AUTO only streams surfaces over FILL_STREAM_MIN_BYTES.
+The workers are the caller's job system, started once, so a lesson filling every frame doesn't start and join threads
+every frame or compete with threads of its own.
+*/
+
+#ifndef FILL_ENGINE_H
+#define FILL_ENGINE_H
+
+#include <SDL2/SDL.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "job_system.h"
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <immintrin.h>
+#define FILL_ENGINE_SSE2 1
+#if defined( __GNUC__ ) || defined( _MSC_VER )
+#define FILL_ENGINE_AVX2 1
+#endif
+#endif
+
+//GCC and Clang need AVX2 code marked so the rest of the file can stay plain SSE2
+#if defined( FILL_ENGINE_AVX2 ) && defined( __GNUC__ )
+#define FILL_ENGINE_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+#define FILL_ENGINE_TARGET_AVX2
+#endif
+
+//Rows per job at least
+const int FILL_ROW_BLOCK = 16;
+
+//Bytes a job should have at least, below this handing out jobs costs more than it saves
+const size_t FILL_MIN_BYTES_PER_JOB = 1024 * 1024;
+
+//Surfaces at least this big are streamed with FILL_STORES_AUTO, roughly where they stop fitting in a desktop L3
+const size_t FILL_STREAM_MIN_BYTES = 16 * 1024 * 1024;
+
+enum FillMode
+{
+	FILL_SOLID,
+	FILL_VERTICAL_GRADIENT,
+	FILL_HORIZONTAL_GRADIENT,
+	FILL_CHECKER,
+	FILL_MODE_TOTAL
+};
+
+//Which row kernels to use
+enum FillPath
+{
+	FILL_PATH_AUTO,
+	FILL_PATH_SCALAR,
+	FILL_PATH_SSE2,
+	FILL_PATH_AVX2
+};
+
+//Cached stores, streaming stores, or whichever suits the surface's size
+enum FillStores
+{
+	FILL_STORES_AUTO,
+	FILL_STORES_CACHED,
+	FILL_STORES_STREAMING
+};
+
+//What to fill with
+struct FillSpec
+{
+	FillMode mode;
+	Uint32 color0;
+	Uint32 color1;
+	int cell;
+};
+
+inline FillSpec solidFill( Uint32 color )
+{
+	FillSpec spec = { FILL_SOLID, color, color, 1 };
+	return spec;
+}
+
+inline FillSpec gradientFill( bool vertical, Uint32 from, Uint32 to )
+{
+	FillSpec spec = { vertical ? FILL_VERTICAL_GRADIENT : FILL_HORIZONTAL_GRADIENT, from, to, 1 };
+	return spec;
+}
+
+inline FillSpec checkerFill( Uint32 color0, Uint32 color1, int cell )
+{
+	FillSpec spec = { FILL_CHECKER, color0, color1, SDL_max( 1, cell ) };
+	return spec;
+}
+
+inline const char* fillModeName( FillMode mode )
+{
+	switch( mode )
+	{
+		case FILL_SOLID: return "solid";
+		case FILL_VERTICAL_GRADIENT: return "vertical";
+		case FILL_HORIZONTAL_GRADIENT: return "horizontal";
+		case FILL_CHECKER: return "checker";
+		default: return "unknown";
+	}
+}
+
+//FILL_MODE_TOTAL for names it doesn't know
+inline FillMode fillModeFromName( std::string name )
+{
+	for( int m = 0; m < FILL_MODE_TOTAL; ++m )
+	{
+		if( name == fillModeName( (FillMode)m ) )
+		{
+			return (FillMode)m;
+		}
+	}
+
+	return FILL_MODE_TOTAL;
+}
+
+inline const char* fillPathName( FillPath path )
+{
+	switch( path )
+	{
+		case FILL_PATH_SCALAR: return "scalar";
+		case FILL_PATH_SSE2: return "sse2";
+		case FILL_PATH_AVX2: return "avx2";
+		default: return "auto";
+	}
+}
+
+//The fastest kernels this CPU runs
+inline FillPath bestFillPath()
+{
+#ifdef FILL_ENGINE_AVX2
+	if( SDL_HasAVX2() )
+	{
+		return FILL_PATH_AVX2;
+	}
+#endif
+#ifdef FILL_ENGINE_SSE2
+	if( SDL_HasSSE2() )
+	{
+		return FILL_PATH_SSE2;
+	}
+#endif
+	return FILL_PATH_SCALAR;
+}
+
+//from blended towards to by t / 255, each byte on its own
+inline Uint32 blendFillColor( Uint32 from, Uint32 to, Uint32 t )
+{
+	Uint32 color = 0;
+	for( int shift = 0; shift < 32; shift += 8 )
+	{
+		Uint32 a = ( from >> shift ) & 0xFF;
+		Uint32 b = ( to >> shift ) & 0xFF;
+		color |= ( ( a * ( 255 - t ) + b * t + 127 ) / 255 ) << shift;
+	}
+
+	return color;
+}
+
+//Writes width pixels of row from pattern, which has at least width pixels
+inline void fillRowScalar( Uint32* row, const Uint32* pattern, int width )
+{
+	memcpy( row, pattern, width * 4 );
+}
+
+inline void fillRowSolidScalar( Uint32* row, Uint32 color, int width )
+{
+	for( int x = 0; x < width; ++x )
+	{
+		row[ x ] = color;
+	}
+}
+
+#ifdef FILL_ENGINE_SSE2
+//Pixels until row is aligned to bytes, at most width
+inline int fillHead( const Uint32* row, int width, int bytes )
+{
+	int misaligned = (int)( ( (uintptr_t)row & ( bytes - 1 ) ) / 4 );
+	return misaligned == 0 ? 0 : SDL_min( width, ( bytes / 4 ) - misaligned );
+}
+
+inline void fillRowSSE2( Uint32* row, const Uint32* pattern, int width, bool streaming )
+{
+	//Rows of 32-bit pixels are always 4-byte aligned, so up to 3 pixels get the row to 16 bytes
+	int x = fillHead( row, width, 16 );
+	memcpy( row, pattern, x * 4 );
+	if( streaming )
+	{
+		for( ; x + 4 <= width; x += 4 )
+		{
+			_mm_stream_si128( (__m128i*)( row + x ), _mm_loadu_si128( (const __m128i*)( pattern + x ) ) );
+		}
+	}
+	else
+	{
+		for( ; x + 4 <= width; x += 4 )
+		{
+			_mm_store_si128( (__m128i*)( row + x ), _mm_loadu_si128( (const __m128i*)( pattern + x ) ) );
+		}
+	}
+	memcpy( row + x, pattern + x, ( width - x ) * 4 );
+}
+
+inline void fillRowSolidSSE2( Uint32* row, Uint32 color, int width, bool streaming )
+{
+	int x = fillHead( row, width, 16 );
+	fillRowSolidScalar( row, color, x );
+	__m128i pixels = _mm_set1_epi32( (int)color );
+	if( streaming )
+	{
+		for( ; x + 4 <= width; x += 4 )
+		{
+			_mm_stream_si128( (__m128i*)( row + x ), pixels );
+		}
+	}
+	else
+	{
+		for( ; x + 4 <= width; x += 4 )
+		{
+			_mm_store_si128( (__m128i*)( row + x ), pixels );
+		}
+	}
+	fillRowSolidScalar( row + x, color, width - x );
+}
+#endif
+
+#ifdef FILL_ENGINE_AVX2
+FILL_ENGINE_TARGET_AVX2 inline void fillRowAVX2( Uint32* row, const Uint32* pattern, int width, bool streaming )
+{
+	int x = fillHead( row, width, 32 );
+	memcpy( row, pattern, x * 4 );
+	if( streaming )
+	{
+		for( ; x + 8 <= width; x += 8 )
+		{
+			_mm256_stream_si256( (__m256i*)( row + x ), _mm256_loadu_si256( (const __m256i*)( pattern + x ) ) );
+		}
+	}
+	else
+	{
+		for( ; x + 8 <= width; x += 8 )
+		{
+			_mm256_store_si256( (__m256i*)( row + x ), _mm256_loadu_si256( (const __m256i*)( pattern + x ) ) );
+		}
+	}
+	memcpy( row + x, pattern + x, ( width - x ) * 4 );
+}
+
+FILL_ENGINE_TARGET_AVX2 inline void fillRowSolidAVX2( Uint32* row, Uint32 color, int width, bool streaming )
+{
+	int x = fillHead( row, width, 32 );
+	fillRowSolidScalar( row, color, x );
+	__m256i pixels = _mm256_set1_epi32( (int)color );
+	if( streaming )
+	{
+		for( ; x + 8 <= width; x += 8 )
+		{
+			_mm256_stream_si256( (__m256i*)( row + x ), pixels );
+		}
+	}
+	else
+	{
+		for( ; x + 8 <= width; x += 8 )
+		{
+			_mm256_store_si256( (__m256i*)( row + x ), pixels );
+		}
+	}
+	fillRowSolidScalar( row + x, color, width - x );
+}
+#endif
+
+inline void fillRow( Uint32* row, const Uint32* pattern, int width, FillPath path, bool streaming )
+{
+#ifdef FILL_ENGINE_AVX2
+	if( path == FILL_PATH_AVX2 )
+	{
+		fillRowAVX2( row, pattern, width, streaming );
+		return;
+	}
+#endif
+#ifdef FILL_ENGINE_SSE2
+	if( path == FILL_PATH_SSE2 )
+	{
+		fillRowSSE2( row, pattern, width, streaming );
+		return;
+	}
+#endif
+	fillRowScalar( row, pattern, width );
+}
+
+inline void fillRowSolid( Uint32* row, Uint32 color, int width, FillPath path, bool streaming )
+{
+#ifdef FILL_ENGINE_AVX2
+	if( path == FILL_PATH_AVX2 )
+	{
+		fillRowSolidAVX2( row, color, width, streaming );
+		return;
+	}
+#endif
+#ifdef FILL_ENGINE_SSE2
+	if( path == FILL_PATH_SSE2 )
+	{
+		fillRowSolidSSE2( row, color, width, streaming );
+		return;
+	}
+#endif
+	fillRowSolidScalar( row, color, width );
+}
+
+//Fills rect of a 32-bit surface (all of it for NULL, clipped to the surface) with spec, across jobs's workers.
+//Returns 0 or a negative SDL error like SDL_FillRect
+inline int fillSurface( SDL_Surface* surface, const SDL_Rect* rect, const FillSpec& spec, FillPath path = FILL_PATH_AUTO, JobSystem* jobs = NULL,
+	FillStores stores = FILL_STORES_AUTO )
+{
+	if( surface == NULL || surface->format->BytesPerPixel != 4 )
+	{
+		return SDL_SetError( "fillSurface needs a 32-bit surface" );
+	}
+	if( path == FILL_PATH_AUTO )
+	{
+		path = bestFillPath();
+	}
+
+	SDL_Rect area = { 0, 0, surface->w, surface->h };
+	if( rect != NULL && !SDL_IntersectRect( rect, &area, &area ) )
+	{
+		return 0;
+	}
+
+	//Nothing to fill on an empty surface either
+	if( area.w <= 0 || area.h <= 0 )
+	{
+		return 0;
+	}
+
+	size_t bytes = (size_t)area.w * area.h * 4;
+	bool streaming = stores == FILL_STORES_STREAMING || ( stores == FILL_STORES_AUTO && bytes >= FILL_STREAM_MIN_BYTES );
+	int grain = SDL_max( FILL_ROW_BLOCK, (int)( FILL_MIN_BYTES_PER_JOB / ( (size_t)area.w * 4 ) ) );
+
+	//Template rows: the horizontal gradient, or one row of each checker band phase
+	std::vector<Uint32> patterns;
+	if( spec.mode == FILL_HORIZONTAL_GRADIENT )
+	{
+		patterns.resize( area.w );
+		for( int x = 0; x < area.w; ++x )
+		{
+			patterns[ x ] = blendFillColor( spec.color0, spec.color1, area.w > 1 ? x * 255 / ( area.w - 1 ) : 0 );
+		}
+	}
+	else if( spec.mode == FILL_CHECKER )
+	{
+		patterns.resize( area.w * 2 );
+		for( int x = 0; x < area.w; ++x )
+		{
+			bool odd = ( ( area.x + x ) / spec.cell ) & 1;
+			patterns[ x ] = odd ? spec.color1 : spec.color0;
+			patterns[ area.w + x ] = odd ? spec.color0 : spec.color1;
+		}
+	}
+
+	if( SDL_MUSTLOCK( surface ) && SDL_LockSurface( surface ) < 0 )
+	{
+		return -1;
+	}
+
+	parallelFor( jobs, 0, area.h, grain, [ & ]( int first, int last )
+	{
+		for( int y = first; y < last; ++y )
+		{
+			Uint32* row = (Uint32*)( (Uint8*)surface->pixels + ( area.y + y ) * surface->pitch ) + area.x;
+			switch( spec.mode )
+			{
+				case FILL_VERTICAL_GRADIENT:
+				fillRowSolid( row, blendFillColor( spec.color0, spec.color1, area.h > 1 ? y * 255 / ( area.h - 1 ) : 0 ), area.w, path, streaming );
+				break;
+
+				case FILL_HORIZONTAL_GRADIENT:
+				fillRow( row, patterns.data(), area.w, path, streaming );
+				break;
+
+				case FILL_CHECKER:
+				fillRow( row, patterns.data() + ( ( ( ( area.y + y ) / spec.cell ) & 1 ) ? area.w : 0 ), area.w, path, streaming );
+				break;
+
+				default:
+				fillRowSolid( row, spec.color0, area.w, path, streaming );
+				break;
+			}
+		}
+
+#ifdef FILL_ENGINE_SSE2
+		//Streaming stores are weakly ordered, make them visible before this job counts as done
+		if( streaming )
+		{
+			_mm_sfence();
+		}
+#endif
+	} );
+
+	if( SDL_MUSTLOCK( surface ) )
+	{
+		SDL_UnlockSurface( surface );
+	}
+
+	return 0;
+}
+
+#endif
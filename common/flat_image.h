@@ -0,0 +1,616 @@
+/*Compact in-memory encodings for mostly flat images.
+
+The lessons' BMPs are 640x480 drawings in a handful of colors on a white background, kept as full 24/32-bit surfaces
+(1.2 MB each once converted to the screen format). analyzeFlatSurface counts their colors and same-color runs, and from
+that encodeFlatSurface picks the smallest of these (or the one asked for):
+	surface   the image converted to the screen format, what the lessons did before
+	sdl-rle   the same with the most common color as color key and SDL_RLEACCEL, so SDL keeps only the other pixels as runs
+	          (it releases the full pixels after encoding on the first blit). blitFlatSurface fills the keyed color back in
+	indexed   an 8-bit palettized surface, expanded to 32-bit through the palette by blitFlatSurface with SIMD:
+	          AVX2 gathers, or on CPUs without AVX2 SSSE3 byte shuffles for palettes of up to 32 colors
+and FlatRuns is our own run-length encoding, one color and length per run, whose blitter skips rows and runs outside the
+clip rect without decoding them and skips transparent (color keyed) runs entirely. It isn't an SDL_Surface, so only code
+that owns its image can hold one.
+*/
+
+#ifndef FLAT_IMAGE_H
+#define FLAT_IMAGE_H
+
+#include <SDL2/SDL.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <immintrin.h>
+#define FLAT_IMAGE_SIMD 1
+#endif
+
+//GCC and Clang need the SSSE3 and AVX2 code marked so the rest of the file can stay plain SSE2
+#if defined( FLAT_IMAGE_SIMD ) && defined( __GNUC__ )
+#define FLAT_IMAGE_TARGET_SSSE3 __attribute__( ( target( "ssse3" ) ) )
+#define FLAT_IMAGE_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+#define FLAT_IMAGE_TARGET_SSSE3
+#define FLAT_IMAGE_TARGET_AVX2
+#endif
+
+//How an image is held in memory
+enum FlatEncoding
+{
+	FLAT_ENCODING_AUTO,
+	FLAT_ENCODING_SURFACE,
+	FLAT_ENCODING_SDL_RLE,
+	FLAT_ENCODING_INDEXED,
+	FLAT_ENCODING_RUNS,
+	FLAT_ENCODING_TOTAL
+};
+
+inline const char* flatEncodingName( FlatEncoding encoding )
+{
+	static const char* names[ FLAT_ENCODING_TOTAL ] = { "auto", "surface", "sdl-rle", "indexed", "runs" };
+	return encoding >= 0 && encoding < FLAT_ENCODING_TOTAL ? names[ encoding ] : "unknown";
+}
+
+//Encoding named on a command line, false if there isn't one by that name
+inline bool flatEncodingFromName( std::string name, FlatEncoding& encoding )
+{
+	for( int i = 0; i < FLAT_ENCODING_TOTAL; ++i )
+	{
+		if( name == flatEncodingName( (FlatEncoding)i ) )
+		{
+			encoding = (FlatEncoding)i;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//Most colors analyzeFlatSurface keeps count of, one more means "too many for a palette"
+const int FLAT_MAX_COLORS = 256;
+
+//What a 32-bit image is made of
+struct FlatImageStats
+{
+	int width;
+	int height;
+
+	//Distinct colors, FLAT_MAX_COLORS + 1 if there are more than fit a palette
+	int colors;
+	Uint32 palette[ FLAT_MAX_COLORS ];
+
+	//Runs of one color, counted per row
+	int runs;
+
+	//Most common color and how many pixels have it
+	Uint32 dominant;
+	int dominantCount;
+};
+
+//Index of a color in the stats' palette, -1 if it isn't there
+inline int findFlatColor( const FlatImageStats& stats, Uint32 color )
+{
+	for( int i = 0; i < stats.colors && i < FLAT_MAX_COLORS; ++i )
+	{
+		if( stats.palette[ i ] == color )
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+//Index of a color in the stats' palette, adding it if there is room, -1 if there isn't
+inline int flatColorIndex( FlatImageStats& stats, std::vector<int>& counts, Uint32 color )
+{
+	int found = findFlatColor( stats, color );
+	if( found >= 0 )
+	{
+		return found;
+	}
+	if( stats.colors < FLAT_MAX_COLORS )
+	{
+		stats.palette[ stats.colors ] = color;
+		counts.push_back( 0 );
+		return stats.colors++;
+	}
+
+	stats.colors = FLAT_MAX_COLORS + 1;
+	return -1;
+}
+
+//Counts the colors and runs of a 32-bit surface
+inline FlatImageStats analyzeFlatSurface( SDL_Surface* surface )
+{
+	FlatImageStats stats;
+	stats.width = surface->w;
+	stats.height = surface->h;
+	stats.colors = 0;
+	stats.runs = 0;
+	stats.dominant = 0;
+	stats.dominantCount = 0;
+
+	//Pixels per palette entry, runs of one color only need one lookup
+	std::vector<int> counts;
+	for( int y = 0; y < surface->h; ++y )
+	{
+		const Uint32* row = (const Uint32*)( (const Uint8*)surface->pixels + y * surface->pitch );
+		for( int x = 0; x < surface->w; )
+		{
+			int start = x;
+			while( x < surface->w && row[ x ] == row[ start ] )
+			{
+				++x;
+			}
+			++stats.runs;
+
+			if( stats.colors <= FLAT_MAX_COLORS )
+			{
+				int index = flatColorIndex( stats, counts, row[ start ] );
+				if( index >= 0 )
+				{
+					counts[ index ] += x - start;
+				}
+			}
+		}
+	}
+
+	for( int i = 0; i < (int)counts.size(); ++i )
+	{
+		if( counts[ i ] > stats.dominantCount )
+		{
+			stats.dominant = stats.palette[ i ];
+			stats.dominantCount = counts[ i ];
+		}
+	}
+
+	return stats;
+}
+
+//One run of FlatRuns, length pixels of one color
+struct FlatRun
+{
+	Uint32 color;
+	Uint32 length;
+};
+
+//Roughly what an image takes in each encoding, 0 if it can't be held that way
+inline size_t estimateFlatBytes( const FlatImageStats& stats, FlatEncoding encoding )
+{
+	size_t pixels = (size_t)stats.width * stats.height;
+	switch( encoding )
+	{
+		case FLAT_ENCODING_SURFACE:
+		return pixels * 4;
+
+		//SDL's RLE keeps each row's non-key pixels plus a 4 byte skip/count header per run
+		case FLAT_ENCODING_SDL_RLE:
+		return ( pixels - stats.dominantCount ) * 4 + (size_t)stats.runs * 4 + stats.height * 4;
+
+		case FLAT_ENCODING_INDEXED:
+		return stats.colors <= FLAT_MAX_COLORS ? (size_t)( ( stats.width + 3 ) & ~3 ) * stats.height + stats.colors * 4 : 0;
+
+		case FLAT_ENCODING_RUNS:
+		return (size_t)stats.runs * sizeof( FlatRun ) + ( stats.height + 1 ) * sizeof( Uint32 );
+
+		default:
+		return 0;
+	}
+}
+
+//Smallest encoding for an image, runs only if the caller can hold a FlatRuns
+inline FlatEncoding chooseFlatEncoding( const FlatImageStats& stats, bool allowRuns )
+{
+	FlatEncoding best = FLAT_ENCODING_SURFACE;
+	for( int i = FLAT_ENCODING_SDL_RLE; i < FLAT_ENCODING_TOTAL; ++i )
+	{
+		size_t bytes = estimateFlatBytes( stats, (FlatEncoding)i );
+		if( bytes > 0 && bytes < estimateFlatBytes( stats, best ) && ( i != FLAT_ENCODING_RUNS || allowRuns ) )
+		{
+			best = (FlatEncoding)i;
+		}
+	}
+
+	return best;
+}
+
+//Encodes an image for blitting onto surfaces of the given format, the source is left alone. Images only get the compact
+//encodings when the format is 32-bit, anything else (and FLAT_ENCODING_RUNS, see FlatRuns) gets a plain converted surface.
+//chosen gets the encoding used and bytes what the image takes in it (estimated for sdl-rle, SDL doesn't say)
+inline SDL_Surface* encodeFlatSurface( SDL_Surface* source, const SDL_PixelFormat* format, FlatEncoding encoding, FlatEncoding* chosen = NULL,
+	size_t* bytes = NULL )
+{
+	SDL_Surface* converted = SDL_ConvertSurface( source, format, 0 );
+	if( converted == NULL || format->BytesPerPixel != 4 )
+	{
+		if( chosen != NULL )
+		{
+			*chosen = FLAT_ENCODING_SURFACE;
+		}
+		if( bytes != NULL )
+		{
+			*bytes = converted != NULL ? (size_t)converted->pitch * converted->h : 0;
+		}
+		return converted;
+	}
+
+	FlatImageStats stats = analyzeFlatSurface( converted );
+	if( encoding == FLAT_ENCODING_AUTO )
+	{
+		encoding = chooseFlatEncoding( stats, false );
+	}
+	if( encoding == FLAT_ENCODING_RUNS || ( encoding == FLAT_ENCODING_INDEXED && stats.colors > FLAT_MAX_COLORS ) )
+	{
+		encoding = FLAT_ENCODING_SURFACE;
+	}
+	if( chosen != NULL )
+	{
+		*chosen = encoding;
+	}
+	if( bytes != NULL )
+	{
+		*bytes = encoding == FLAT_ENCODING_SDL_RLE ? estimateFlatBytes( stats, encoding ) : 0;
+	}
+
+	//Key out the most common color and let SDL run-length encode the rest
+	if( encoding == FLAT_ENCODING_SDL_RLE )
+	{
+		SDL_SetColorKey( converted, SDL_TRUE, stats.dominant );
+		SDL_SetSurfaceRLE( converted, 1 );
+	}
+	else if( encoding == FLAT_ENCODING_INDEXED )
+	{
+		//A palette of just the colors used, so the blit knows how many there are
+		SDL_Surface* indexed = SDL_CreateRGBSurfaceWithFormat( 0, converted->w, converted->h, 8, SDL_PIXELFORMAT_INDEX8 );
+		SDL_Palette* palette = SDL_AllocPalette( stats.colors );
+		if( indexed == NULL || palette == NULL )
+		{
+			SDL_FreePalette( palette );
+			SDL_FreeSurface( indexed );
+			SDL_FreeSurface( converted );
+			return NULL;
+		}
+		for( int i = 0; i < stats.colors; ++i )
+		{
+			SDL_Color& color = palette->colors[ i ];
+			SDL_GetRGBA( stats.palette[ i ], format, &color.r, &color.g, &color.b, &color.a );
+		}
+		SDL_SetSurfacePalette( indexed, palette );
+		SDL_FreePalette( palette );
+
+		//Runs again, so only color changes need a palette search
+		for( int y = 0; y < converted->h; ++y )
+		{
+			const Uint32* row = (const Uint32*)( (const Uint8*)converted->pixels + y * converted->pitch );
+			Uint8* out = (Uint8*)indexed->pixels + y * indexed->pitch;
+			Uint32 last = row[ 0 ];
+			Uint8 index = findFlatColor( stats, last );
+			for( int x = 0; x < converted->w; ++x )
+			{
+				if( row[ x ] != last )
+				{
+					last = row[ x ];
+					index = findFlatColor( stats, last );
+				}
+				out[ x ] = index;
+			}
+		}
+
+		SDL_FreeSurface( converted );
+		if( bytes != NULL )
+		{
+			*bytes = (size_t)indexed->pitch * indexed->h;
+		}
+		return indexed;
+	}
+
+	if( bytes != NULL && *bytes == 0 )
+	{
+		*bytes = (size_t)converted->pitch * converted->h;
+	}
+	return converted;
+}
+
+//Expands a row of palette indices through a 32-bit lookup table
+inline void expandIndexedRowScalar( const Uint8* in, Uint32* out, int count, const Uint32* lut )
+{
+	int x = 0;
+	for( ; x + 4 <= count; x += 4 )
+	{
+		out[ x ] = lut[ in[ x ] ];
+		out[ x + 1 ] = lut[ in[ x + 1 ] ];
+		out[ x + 2 ] = lut[ in[ x + 2 ] ];
+		out[ x + 3 ] = lut[ in[ x + 3 ] ];
+	}
+	for( ; x < count; ++x )
+	{
+		out[ x ] = lut[ in[ x ] ];
+	}
+}
+
+#ifdef FLAT_IMAGE_SIMD
+//Up to 32 colors: each byte of the output pixel is a 16 entry table lookup with pshufb, 16 pixels at a time.
+//planes[ t * 4 + k ] holds byte k of colors t * 16 to t * 16 + 15
+FLAT_IMAGE_TARGET_SSSE3 inline void expandIndexedRowSSSE3( const Uint8* in, Uint32* out, int count, const Uint32* lut, const __m128i* planes, int tables )
+{
+	int x = 0;
+	for( ; x + 16 <= count; x += 16 )
+	{
+		__m128i index = _mm_loadu_si128( (const __m128i*)( in + x ) );
+		__m128i bytes[ 4 ] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+		for( int t = 0; t < tables; ++t )
+		{
+			//Indices outside this table get bit 7 set, which makes pshufb return 0 for them
+			__m128i local = _mm_sub_epi8( index, _mm_set1_epi8( (char)( t * 16 ) ) );
+			__m128i inside = _mm_cmpeq_epi8( _mm_min_epu8( local, _mm_set1_epi8( 15 ) ), local );
+			local = _mm_or_si128( local, _mm_andnot_si128( inside, _mm_set1_epi8( (char)0x80 ) ) );
+			for( int k = 0; k < 4; ++k )
+			{
+				bytes[ k ] = _mm_or_si128( bytes[ k ], _mm_shuffle_epi8( planes[ t * 4 + k ], local ) );
+			}
+		}
+
+		//Interleave the byte planes back into pixels
+		__m128i lo01 = _mm_unpacklo_epi8( bytes[ 0 ], bytes[ 1 ] );
+		__m128i hi01 = _mm_unpackhi_epi8( bytes[ 0 ], bytes[ 1 ] );
+		__m128i lo23 = _mm_unpacklo_epi8( bytes[ 2 ], bytes[ 3 ] );
+		__m128i hi23 = _mm_unpackhi_epi8( bytes[ 2 ], bytes[ 3 ] );
+		_mm_storeu_si128( (__m128i*)( out + x ), _mm_unpacklo_epi16( lo01, lo23 ) );
+		_mm_storeu_si128( (__m128i*)( out + x + 4 ), _mm_unpackhi_epi16( lo01, lo23 ) );
+		_mm_storeu_si128( (__m128i*)( out + x + 8 ), _mm_unpacklo_epi16( hi01, hi23 ) );
+		_mm_storeu_si128( (__m128i*)( out + x + 12 ), _mm_unpackhi_epi16( hi01, hi23 ) );
+	}
+
+	expandIndexedRowScalar( in + x, out + x, count - x, lut );
+}
+
+//Any palette, eight gathered lookups at a time. Faster than the shuffles even for small palettes where there is AVX2
+FLAT_IMAGE_TARGET_AVX2 inline void expandIndexedRowAVX2( const Uint8* in, Uint32* out, int count, const Uint32* lut )
+{
+	int x = 0;
+	for( ; x + 8 <= count; x += 8 )
+	{
+		__m256i index = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)( in + x ) ) );
+		_mm256_storeu_si256( (__m256i*)( out + x ), _mm256_i32gather_epi32( (const int*)lut, index, 4 ) );
+	}
+
+	expandIndexedRowScalar( in + x, out + x, count - x, lut );
+}
+#endif
+
+//Clips a width x height image placed at dstRect (or 0, 0) to dst's clip rect. Returns false if nothing is left,
+//otherwise the visible part of the image in from and where it lands in to
+inline bool clipFlatBlit( int width, int height, SDL_Surface* dst, const SDL_Rect* dstRect, SDL_Rect& from, SDL_Rect& to )
+{
+	SDL_Rect placed = { dstRect != NULL ? dstRect->x : 0, dstRect != NULL ? dstRect->y : 0, width, height };
+	if( !SDL_IntersectRect( &placed, &dst->clip_rect, &to ) )
+	{
+		return false;
+	}
+
+	from.x = to.x - placed.x;
+	from.y = to.y - placed.y;
+	from.w = to.w;
+	from.h = to.h;
+	return true;
+}
+
+//Blits a whole surface from encodeFlatSurface like SDL_BlitSurface( src, NULL, dst, dstRect ). A color key on src is taken to
+//mean the keyed color was left out of an sdl-rle image, so it is filled in first
+inline int blitFlatSurface( SDL_Surface* src, SDL_Surface* dst, SDL_Rect* dstRect )
+{
+	Uint32 key;
+	if( src->format->format == SDL_PIXELFORMAT_INDEX8 && dst->format->BytesPerPixel == 4 )
+	{
+		SDL_Rect from, to;
+		if( !clipFlatBlit( src->w, src->h, dst, dstRect, from, to ) )
+		{
+			return 0;
+		}
+
+		//The palette mapped to the destination format
+		SDL_Palette* palette = src->format->palette;
+		Uint32 lut[ FLAT_MAX_COLORS ] = {};
+		for( int i = 0; i < palette->ncolors && i < FLAT_MAX_COLORS; ++i )
+		{
+			lut[ i ] = SDL_MapRGBA( dst->format, palette->colors[ i ].r, palette->colors[ i ].g, palette->colors[ i ].b, palette->colors[ i ].a );
+		}
+
+#ifdef FLAT_IMAGE_SIMD
+		static bool hasSSSE3 = SDL_HasSSE41() == SDL_TRUE;
+		static bool hasAVX2 = SDL_HasAVX2() == SDL_TRUE;
+		int tables = ( palette->ncolors + 15 ) / 16;
+		__m128i planes[ 8 ];
+		if( !hasAVX2 && hasSSSE3 && tables <= 2 )
+		{
+			for( int t = 0; t < tables; ++t )
+			{
+				for( int k = 0; k < 4; ++k )
+				{
+					Uint8 plane[ 16 ];
+					for( int i = 0; i < 16; ++i )
+					{
+						plane[ i ] = (Uint8)( lut[ t * 16 + i ] >> ( k * 8 ) );
+					}
+					planes[ t * 4 + k ] = _mm_loadu_si128( (const __m128i*)plane );
+				}
+			}
+		}
+#endif
+
+		if( SDL_MUSTLOCK( dst ) )
+		{
+			SDL_LockSurface( dst );
+		}
+		for( int y = 0; y < to.h; ++y )
+		{
+			const Uint8* in = (const Uint8*)src->pixels + ( from.y + y ) * src->pitch + from.x;
+			Uint32* out = (Uint32*)( (Uint8*)dst->pixels + ( to.y + y ) * dst->pitch ) + to.x;
+#ifdef FLAT_IMAGE_SIMD
+			if( hasAVX2 )
+			{
+				expandIndexedRowAVX2( in, out, to.w, lut );
+				continue;
+			}
+			if( hasSSSE3 && tables <= 2 )
+			{
+				expandIndexedRowSSSE3( in, out, to.w, lut, planes, tables );
+				continue;
+			}
+#endif
+			expandIndexedRowScalar( in, out, to.w, lut );
+		}
+		if( SDL_MUSTLOCK( dst ) )
+		{
+			SDL_UnlockSurface( dst );
+		}
+
+		if( dstRect != NULL )
+		{
+			*dstRect = to;
+		}
+		return 0;
+	}
+	else if( SDL_GetColorKey( src, &key ) == 0 )
+	{
+		//The key color comes back as a fill, then SDL's RLE blit draws the rest
+		Uint8 r, g, b, a;
+		SDL_GetRGBA( key, src->format, &r, &g, &b, &a );
+		SDL_Rect fill = { dstRect != NULL ? dstRect->x : 0, dstRect != NULL ? dstRect->y : 0, src->w, src->h };
+		SDL_FillRect( dst, &fill, SDL_MapRGBA( dst->format, r, g, b, a ) );
+	}
+
+	return SDL_BlitSurface( src, NULL, dst, dstRect );
+}
+
+//Our own run-length encoding of an image in a 32-bit format
+struct FlatRuns
+{
+	int width;
+	int height;
+	Uint32 format;
+
+	//Runs of this color are transparent, when the source had a color key
+	bool keyed;
+	Uint32 key;
+
+	//Row y's runs are runs[ rows[ y ] ] up to runs[ rows[ y + 1 ] ]
+	std::vector<Uint32> rows;
+	std::vector<FlatRun> runs;
+};
+
+//Encodes an image for blitting onto surfaces of the given 32-bit format, the source is left alone
+inline bool encodeFlatRuns( SDL_Surface* source, const SDL_PixelFormat* format, FlatRuns& image )
+{
+	if( format->BytesPerPixel != 4 )
+	{
+		SDL_SetError( "FlatRuns only encodes 32-bit formats" );
+		return false;
+	}
+	SDL_Surface* converted = SDL_ConvertSurface( source, format, 0 );
+	if( converted == NULL )
+	{
+		return false;
+	}
+
+	image.width = converted->w;
+	image.height = converted->h;
+	image.format = format->format;
+	image.keyed = SDL_GetColorKey( converted, &image.key ) == 0;
+	image.rows.clear();
+	image.runs.clear();
+
+	for( int y = 0; y < converted->h; ++y )
+	{
+		image.rows.push_back( image.runs.size() );
+		const Uint32* row = (const Uint32*)( (const Uint8*)converted->pixels + y * converted->pitch );
+		for( int x = 0; x < converted->w; )
+		{
+			FlatRun run = { row[ x ], 0 };
+			while( x < converted->w && row[ x ] == run.color )
+			{
+				++run.length;
+				++x;
+			}
+			image.runs.push_back( run );
+		}
+	}
+	image.rows.push_back( image.runs.size() );
+	image.runs.shrink_to_fit();
+
+	SDL_FreeSurface( converted );
+	return true;
+}
+
+inline size_t flatRunsBytes( const FlatRuns& image )
+{
+	return image.runs.capacity() * sizeof( FlatRun ) + image.rows.capacity() * sizeof( Uint32 );
+}
+
+//Fills count pixels with one color, four at a time with SSE2
+inline void fillFlatRun( Uint32* out, Uint32 color, int count )
+{
+	int x = 0;
+#ifdef FLAT_IMAGE_SIMD
+	__m128i fill = _mm_set1_epi32( (int)color );
+	for( ; x + 4 <= count; x += 4 )
+	{
+		_mm_storeu_si128( (__m128i*)( out + x ), fill );
+	}
+#endif
+	for( ; x < count; ++x )
+	{
+		out[ x ] = color;
+	}
+}
+
+//Blits runs onto a surface of the format they were encoded for, like SDL_BlitSurface( image, NULL, dst, dstRect )
+inline int blitFlatRuns( const FlatRuns& image, SDL_Surface* dst, SDL_Rect* dstRect )
+{
+	if( dst->format->format != image.format )
+	{
+		return SDL_SetError( "blitFlatRuns: destination isn't the format the runs were encoded for" );
+	}
+
+	SDL_Rect from, to;
+	if( !clipFlatBlit( image.width, image.height, dst, dstRect, from, to ) )
+	{
+		return 0;
+	}
+
+	if( SDL_MUSTLOCK( dst ) )
+	{
+		SDL_LockSurface( dst );
+	}
+	int clipRight = from.x + from.w;
+	for( int y = 0; y < to.h; ++y )
+	{
+		//Rows above and below the clip rect are never looked at, runs left of it are only added up
+		Uint32* out = (Uint32*)( (Uint8*)dst->pixels + ( to.y + y ) * dst->pitch ) + to.x - from.x;
+		const FlatRun* run = &image.runs[ image.rows[ from.y + y ] ];
+		const FlatRun* end = &image.runs[ image.rows[ from.y + y + 1 ] ];
+		int x = 0;
+		for( ; run != end && x < clipRight; x += run->length, ++run )
+		{
+			int start = SDL_max( x, from.x );
+			int stop = SDL_min( x + (int)run->length, clipRight );
+			if( start < stop && !( image.keyed && run->color == image.key ) )
+			{
+				fillFlatRun( out + start, run->color, stop - start );
+			}
+		}
+	}
+	if( SDL_MUSTLOCK( dst ) )
+	{
+		SDL_UnlockSurface( dst );
+	}
+
+	if( dstRect != NULL )
+	{
+		*dstRect = to;
+	}
+	return 0;
+}
+
+#endif
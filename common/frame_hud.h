@@ -0,0 +1,286 @@
+/*On-screen frame time HUD for soak tests, for window surfaces and renderers alike.
+
+A FrameHud keeps the last HUD_HISTORY frames' times, events and draw calls and draws them in the top left corner: a bar
+graph of frame times with a line at the 60 Hz budget, and the frame rate, mean and 99th percentile frame time, events and
+draw calls per frame. F3 shows and hides it. The lesson calls handleHudEvent for every event it polls, countHudDraws for
+its draw calls, drawFrameHud right before presenting and endHudFrame right after, which takes the time since the last one.
+The text is a built-in 3x5 pixel font, so no font library is needed. Everything is rectangles in three colors, and each
+color goes to SDL in one call (SDL_FillRects on a surface, SDL_RenderFillRects on a renderer): the panel, every bar of the
+graph in one batch, and every text pixel run with the budget line in another. The rect lists are built into buffers kept
+between frames. drawFrameHud times itself and shows its own mean cost, so what it adds to the frame times is on screen;
+on a renderer that is the submission, the GPU draws it with the frame. Hidden, the HUD only keeps counting.
+*/
+
+#ifndef FRAME_HUD_H
+#define FRAME_HUD_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <vector>
+#include <algorithm>
+
+//Frames kept, two pixels of graph each
+const int HUD_HISTORY = 120;
+
+//Key that shows and hides the HUD
+const SDL_Keycode HUD_TOGGLE_KEY = SDLK_F3;
+
+//Layout: text scale, graph height and the frame time at its top (two 60 Hz frames, so the budget line is half way)
+const int HUD_SCALE = 2;
+const int HUD_GRAPH_HEIGHT = 48;
+const double HUD_GRAPH_MAX_MS = 1000.0 / 30.0;
+const double HUD_BUDGET_MS = 1000.0 / 60.0;
+const int HUD_PADDING = 4;
+
+struct FrameHud
+{
+	bool visible;
+
+	//Rings of the last HUD_HISTORY frames, head is the next slot to write
+	double frameMs[ HUD_HISTORY ];
+	double hudMs[ HUD_HISTORY ];
+	int events[ HUD_HISTORY ];
+	int draws[ HUD_HISTORY ];
+	int head;
+	int count;
+
+	//The frame in progress
+	Uint64 lastFrame;
+	int frameEvents;
+	int frameDraws;
+	double frameHudMs;
+
+	//Rect lists reused every frame
+	std::vector<SDL_Rect> barRects;
+	std::vector<SDL_Rect> textRects;
+};
+
+//3x5 glyphs, five rows of three bits, top row in the high bits
+inline int hudGlyph( char c )
+{
+	switch( c )
+	{
+		case '0': return 0x7B6F;
+		case '1': return 0x2C97;
+		case '2': return 0x73E7;
+		case '3': return 0x73CF;
+		case '4': return 0x5BC9;
+		case '5': return 0x79CF;
+		case '6': return 0x79EF;
+		case '7': return 0x7249;
+		case '8': return 0x7BEF;
+		case '9': return 0x7BCF;
+		case '.': return 0x0002;
+		case ':': return 0x0410;
+		case '-': return 0x01C0;
+		case 'A': return 0x2BED;
+		case 'C': return 0x7927;
+		case 'D': return 0x6B6E;
+		case 'E': return 0x79E7;
+		case 'F': return 0x79E4;
+		case 'H': return 0x5BED;
+		case 'M': return 0x5FED;
+		case 'P': return 0x7BE4;
+		case 'R': return 0x6BAD;
+		case 'S': return 0x79CF;
+		case 'U': return 0x5B6F;
+		case 'V': return 0x5B6A;
+		case 'W': return 0x5BFD;
+		default: return 0;
+	}
+}
+
+//Adds a text's lit pixels as rects, each row's runs merged into one rect
+inline void addHudText( std::vector<SDL_Rect>& rects, const char* text, int x, int y )
+{
+	for( int i = 0; text[ i ] != '\0'; ++i )
+	{
+		int glyph = hudGlyph( text[ i ] );
+		for( int row = 0; row < 5 && glyph != 0; ++row )
+		{
+			int bits = ( glyph >> ( ( 4 - row ) * 3 ) ) & 7;
+			for( int column = 0; column < 3; )
+			{
+				if( !( bits & ( 4 >> column ) ) )
+				{
+					++column;
+					continue;
+				}
+				int start = column;
+				while( column < 3 && ( bits & ( 4 >> column ) ) )
+				{
+					++column;
+				}
+				SDL_Rect rect = { x + ( i * 4 + start ) * HUD_SCALE, y + row * HUD_SCALE, ( column - start ) * HUD_SCALE, HUD_SCALE };
+				rects.push_back( rect );
+			}
+		}
+	}
+}
+
+//Counts an event and shows or hides the HUD on HUD_TOGGLE_KEY, returns true for that key so the lesson can ignore it
+inline bool handleHudEvent( FrameHud& hud, const SDL_Event& e )
+{
+	++hud.frameEvents;
+	if( e.type == SDL_KEYDOWN && e.key.keysym.sym == HUD_TOGGLE_KEY )
+	{
+		if( e.key.repeat == 0 )
+		{
+			hud.visible = !hud.visible;
+		}
+		return true;
+	}
+	return false;
+}
+
+inline void countHudDraws( FrameHud& hud, int draws = 1 )
+{
+	hud.frameDraws += draws;
+}
+
+//Ends a frame: records the time since the last call and this frame's counts
+inline void endHudFrame( FrameHud& hud )
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	if( hud.lastFrame != 0 )
+	{
+		hud.frameMs[ hud.head ] = ( now - hud.lastFrame ) * 1000.0 / SDL_GetPerformanceFrequency();
+		hud.hudMs[ hud.head ] = hud.frameHudMs;
+		hud.events[ hud.head ] = hud.frameEvents;
+		hud.draws[ hud.head ] = hud.frameDraws;
+		hud.head = ( hud.head + 1 ) % HUD_HISTORY;
+		hud.count = SDL_min( hud.count + 1, HUD_HISTORY );
+	}
+	hud.lastFrame = now;
+	hud.frameEvents = 0;
+	hud.frameDraws = 0;
+	hud.frameHudMs = 0.0;
+}
+
+//Mean and 99th percentile frame time, mean HUD cost, events and draws over the history
+struct FrameHudStats
+{
+	double meanMs;
+	double p99Ms;
+	double hudMs;
+	double events;
+	double draws;
+};
+
+inline FrameHudStats frameHudStats( const FrameHud& hud )
+{
+	FrameHudStats stats = {};
+	if( hud.count == 0 )
+	{
+		return stats;
+	}
+
+	double sorted[ HUD_HISTORY ];
+	for( int i = 0; i < hud.count; ++i )
+	{
+		sorted[ i ] = hud.frameMs[ i ];
+		stats.meanMs += hud.frameMs[ i ];
+		stats.hudMs += hud.hudMs[ i ];
+		stats.events += hud.events[ i ];
+		stats.draws += hud.draws[ i ];
+	}
+	std::sort( sorted, sorted + hud.count );
+	stats.p99Ms = sorted[ SDL_min( hud.count - 1, (int)( hud.count * 0.99 ) ) ];
+	stats.meanMs /= hud.count;
+	stats.hudMs /= hud.count;
+	stats.events /= hud.count;
+	stats.draws /= hud.count;
+	return stats;
+}
+
+//The panel, and fills the bar and text rect lists
+inline SDL_Rect buildFrameHud( FrameHud& hud, int x, int y )
+{
+	int lineHeight = 6 * HUD_SCALE;
+	SDL_Rect panel = { x, y, HUD_HISTORY * 2 + HUD_PADDING * 2, HUD_PADDING * 3 + lineHeight * 2 + HUD_GRAPH_HEIGHT };
+
+	//Oldest frame on the left
+	hud.barRects.clear();
+	int graphLeft = x + HUD_PADDING;
+	int graphBottom = panel.y + panel.h - HUD_PADDING;
+	for( int i = 0; i < hud.count; ++i )
+	{
+		double ms = hud.frameMs[ ( hud.head - hud.count + i + HUD_HISTORY ) % HUD_HISTORY ];
+		int height = SDL_max( 1, (int)( SDL_min( ms, HUD_GRAPH_MAX_MS ) / HUD_GRAPH_MAX_MS * HUD_GRAPH_HEIGHT ) );
+		SDL_Rect bar = { graphLeft + ( HUD_HISTORY - hud.count + i ) * 2, graphBottom - height, 2, height };
+		hud.barRects.push_back( bar );
+	}
+
+	//Budget line and text
+	hud.textRects.clear();
+	SDL_Rect budget = { graphLeft, graphBottom - (int)( HUD_BUDGET_MS / HUD_GRAPH_MAX_MS * HUD_GRAPH_HEIGHT ), HUD_HISTORY * 2, 1 };
+	hud.textRects.push_back( budget );
+
+	FrameHudStats stats = frameHudStats( hud );
+	char line[ 64 ];
+	snprintf( line, sizeof( line ), "FPS %.1f MS %.2f P99 %.2f", stats.meanMs > 0.0 ? 1000.0 / stats.meanMs : 0.0, stats.meanMs, stats.p99Ms );
+	addHudText( hud.textRects, line, x + HUD_PADDING, y + HUD_PADDING );
+	snprintf( line, sizeof( line ), "EV %.1f DRAW %.0f HUD %.3f MS", stats.events, stats.draws, stats.hudMs );
+	addHudText( hud.textRects, line, x + HUD_PADDING, y + HUD_PADDING + lineHeight );
+
+	return panel;
+}
+
+//Draws the HUD onto a surface, three SDL_FillRect(s) calls
+inline void drawFrameHud( FrameHud& hud, SDL_Surface* surface )
+{
+	if( !hud.visible )
+	{
+		return;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	SDL_Rect panel = buildFrameHud( hud, 8, 8 );
+	SDL_FillRect( surface, &panel, SDL_MapRGB( surface->format, 0x20, 0x20, 0x20 ) );
+	SDL_FillRects( surface, hud.barRects.data(), hud.barRects.size(), SDL_MapRGB( surface->format, 0x40, 0xE0, 0x40 ) );
+	SDL_FillRects( surface, hud.textRects.data(), hud.textRects.size(), SDL_MapRGB( surface->format, 0xFF, 0xFF, 0xFF ) );
+	hud.frameHudMs += ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+//Draws the HUD with a renderer, three fill calls on a translucent panel, leaving its draw color and blend mode as they were
+inline void drawFrameHud( FrameHud& hud, SDL_Renderer* renderer )
+{
+	if( !hud.visible )
+	{
+		return;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint8 r, g, b, a;
+	SDL_BlendMode blend;
+	SDL_GetRenderDrawColor( renderer, &r, &g, &b, &a );
+	SDL_GetRenderDrawBlendMode( renderer, &blend );
+
+	SDL_Rect panel = buildFrameHud( hud, 8, 8 );
+	SDL_SetRenderDrawBlendMode( renderer, SDL_BLENDMODE_BLEND );
+	SDL_SetRenderDrawColor( renderer, 0x20, 0x20, 0x20, 0xC0 );
+	SDL_RenderFillRect( renderer, &panel );
+	SDL_SetRenderDrawColor( renderer, 0x40, 0xE0, 0x40, 0xFF );
+	SDL_RenderFillRects( renderer, hud.barRects.data(), hud.barRects.size() );
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderFillRects( renderer, hud.textRects.data(), hud.textRects.size() );
+
+	SDL_SetRenderDrawColor( renderer, r, g, b, a );
+	SDL_SetRenderDrawBlendMode( renderer, blend );
+	hud.frameHudMs += ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+//Prints the last frames' numbers, for the exit report
+inline void printFrameHudReport( const FrameHud& hud, const char* title )
+{
+	if( hud.count == 0 )
+	{
+		return;
+	}
+
+	FrameHudStats stats = frameHudStats( hud );
+	printf( "%s last %d frames: %.2f ms mean, %.2f ms p99, %.1f events and %.0f draw calls per frame, HUD %.3f ms per frame\n", title,
+		hud.count, stats.meanMs, stats.p99Ms, stats.events, stats.draws, stats.hudMs );
+}
+
+#endif
@@ -0,0 +1,431 @@
+/*Frame recorder that drops overdrawn draws, with an overdraw heatmap.
+
+Lessons draw a frame as a list of full screen writes: 07 clears the target and then covers all of it with an opaque
+SDL_RenderCopy, 04 and 06 blit the same opaque image over the window surface every frame whether anything changed or
+not. A FrameRecorder collects a frame's draws (what rectangle each writes, whether it writes it opaquely) instead of
+running them, and submitRecordedFrame runs what is left once:
+	elide   walking back from the last draw, a draw whose rectangle is entirely covered by opaque draws after it is
+	        dropped, so a clear under a full screen opaque image is never done
+	retain  for targets that keep their pixels between frames (window surfaces, not renderers), a frame whose draws are
+	        all keyed (source and rectangles) and identical to the last submitted frame's isn't drawn at all
+	analyze counts how many times each target pixel is written by what was submitted, for drawOverdrawHeatmap
+Only whole draws are dropped, a draw that is partly covered still runs in full. Coverage is worked out exactly by
+subtracting the later opaque rectangles from the draw's one, which is cheap for the handful of draws a lesson frame has.
+The stats count the bytes the submitted draws write and the bytes the dropped ones would have.
+*/
+
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <functional>
+#include <vector>
+
+//Pieces a coverage test may split a rectangle into before giving up and calling it uncovered
+const int RECORDER_MAX_PIECES = 64;
+
+//One recorded draw
+struct RecordedDraw
+{
+	//What it writes, clipped to the target, and whether every pixel of that is overwritten
+	SDL_Rect rect;
+	bool opaque;
+
+	//What it draws from, NULL if it can't be compared between frames
+	const void* source;
+	SDL_Rect sourceRect;
+
+	std::function<void()> draw;
+};
+
+struct OverdrawStats
+{
+	int frames;
+	long long draws;
+	long long dropped;
+	int retainedFrames;
+
+	//Bytes of pixel writes submitted and dropped
+	long long bytesWritten;
+	long long bytesSaved;
+};
+
+struct FrameRecorder
+{
+	bool elide;
+	bool retain;
+	bool analyze;
+
+	//The target this frame draws to
+	const void* target;
+	int width;
+	int height;
+	int bytesPerPixel;
+
+	std::vector<RecordedDraw> draws;
+
+	//Keys of the last submitted frame, empty when the target's pixels can't be trusted to still hold it
+	std::vector<RecordedDraw> lastFrame;
+
+	//Writes per pixel of the last submitted frame
+	std::vector<Uint16> counts;
+	int maxCount;
+
+	OverdrawStats stats;
+};
+
+//Whether blitting surface overwrites every pixel it covers: no color key and no blending that lets the target show through
+inline bool surfaceIsOpaque( SDL_Surface* surface )
+{
+	SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+	Uint8 alpha = 0xFF;
+	SDL_GetSurfaceBlendMode( surface, &mode );
+	SDL_GetSurfaceAlphaMod( surface, &alpha );
+	if( SDL_HasColorKey( surface ) )
+	{
+		return false;
+	}
+	if( mode == SDL_BLENDMODE_NONE || ( mode == SDL_BLENDMODE_BLEND && alpha == 0xFF && surface->format->Amask == 0 ) )
+	{
+		return true;
+	}
+	if( mode != SDL_BLENDMODE_BLEND || alpha != 0xFF || surface->format->BytesPerPixel != 4 )
+	{
+		return false;
+	}
+
+	//Alpha blended, which is opaque only if every pixel is
+	bool opaque = true;
+	if( SDL_MUSTLOCK( surface ) && SDL_LockSurface( surface ) < 0 )
+	{
+		return false;
+	}
+	Uint32 amask = surface->format->Amask;
+	for( int y = 0; y < surface->h && opaque; ++y )
+	{
+		const Uint32* row = (const Uint32*)( (const Uint8*)surface->pixels + y * surface->pitch );
+		for( int x = 0; x < surface->w; ++x )
+		{
+			if( ( row[ x ] & amask ) != amask )
+			{
+				opaque = false;
+				break;
+			}
+		}
+	}
+	if( SDL_MUSTLOCK( surface ) )
+	{
+		SDL_UnlockSurface( surface );
+	}
+
+	return opaque;
+}
+
+//Whether rendering texture overwrites every pixel it covers
+inline bool textureIsOpaque( SDL_Texture* texture )
+{
+	SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+	Uint8 alpha = 0xFF;
+	Uint32 format = 0;
+	if( texture == NULL || SDL_GetTextureBlendMode( texture, &mode ) < 0 || SDL_QueryTexture( texture, &format, NULL, NULL, NULL ) < 0 )
+	{
+		return false;
+	}
+	SDL_GetTextureAlphaMod( texture, &alpha );
+
+	return mode == SDL_BLENDMODE_NONE || ( mode == SDL_BLENDMODE_BLEND && alpha == 0xFF && !SDL_ISPIXELFORMAT_ALPHA( format ) );
+}
+
+//Forgets the last frame, for when something changed the target or a source behind the recorder's back
+inline void invalidateRecordedFrame( FrameRecorder& recorder )
+{
+	recorder.lastFrame.clear();
+}
+
+//Starts a frame drawn to target, width x height pixels of bytesPerPixel
+inline void beginRecordedFrame( FrameRecorder& recorder, const void* target, int width, int height, int bytesPerPixel = 4 )
+{
+	if( target != recorder.target || width != recorder.width || height != recorder.height )
+	{
+		invalidateRecordedFrame( recorder );
+	}
+	recorder.target = target;
+	recorder.width = width;
+	recorder.height = height;
+	recorder.bytesPerPixel = bytesPerPixel;
+	recorder.draws.clear();
+}
+
+//Records a draw of rect (NULL for the whole target). source and sourceRect identify what it draws for retain, NULL if it
+//isn't the same draw every time it is recorded
+inline void recordDraw( FrameRecorder& recorder, const SDL_Rect* rect, bool opaque, std::function<void()> draw, const void* source = NULL,
+	const SDL_Rect* sourceRect = NULL )
+{
+	RecordedDraw recorded;
+	SDL_Rect whole = { 0, 0, recorder.width, recorder.height };
+	if( rect == NULL )
+	{
+		recorded.rect = whole;
+	}
+	else if( !SDL_IntersectRect( rect, &whole, &recorded.rect ) )
+	{
+		recorded.rect = SDL_Rect();
+	}
+	recorded.opaque = opaque;
+	recorded.source = source;
+	recorded.sourceRect = sourceRect != NULL ? *sourceRect : SDL_Rect();
+	recorded.draw = draw;
+	recorder.draws.push_back( recorded );
+}
+
+//SDL_RenderClear with the draw color as it is now
+inline void recordClear( FrameRecorder& recorder, SDL_Renderer* renderer )
+{
+	Uint8 r = 0, g = 0, b = 0, a = 0;
+	SDL_GetRenderDrawColor( renderer, &r, &g, &b, &a );
+	recordDraw( recorder, NULL, true, [ renderer, r, g, b, a ]()
+	{
+		SDL_SetRenderDrawColor( renderer, r, g, b, a );
+		SDL_RenderClear( renderer );
+	} );
+}
+
+//SDL_RenderCopy, srcrect and dstrect like it
+inline void recordCopy( FrameRecorder& recorder, SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* srcrect, const SDL_Rect* dstrect )
+{
+	SDL_Rect src = { 0, 0, 0, 0 };
+	if( srcrect != NULL )
+	{
+		src = *srcrect;
+	}
+	else
+	{
+		SDL_QueryTexture( texture, NULL, NULL, &src.w, &src.h );
+	}
+	SDL_Rect dst = dstrect != NULL ? *dstrect : SDL_Rect{ 0, 0, recorder.width, recorder.height };
+
+	recordDraw( recorder, &dst, textureIsOpaque( texture ), [ renderer, texture, src, dst ]()
+	{
+		SDL_RenderCopy( renderer, texture, &src, &dst );
+	}, texture, &src );
+}
+
+//SDL_BlitSurface onto the recorder's target surface, srcrect and the position in dstrect like it
+inline void recordBlit( FrameRecorder& recorder, SDL_Surface* surface, const SDL_Rect* srcrect, SDL_Surface* target, const SDL_Rect* dstrect )
+{
+	SDL_Rect src = srcrect != NULL ? *srcrect : SDL_Rect{ 0, 0, surface->w, surface->h };
+	SDL_Rect dst = { dstrect != NULL ? dstrect->x : 0, dstrect != NULL ? dstrect->y : 0, src.w, src.h };
+
+	recordDraw( recorder, &dst, surfaceIsOpaque( surface ), [ surface, src, target, dst ]()
+	{
+		SDL_Rect in = src;
+		SDL_Rect out = dst;
+		SDL_BlitSurface( surface, &in, target, &out );
+	}, surface, &src );
+}
+
+//SDL_FillRect of the recorder's target surface
+inline void recordFill( FrameRecorder& recorder, SDL_Surface* target, const SDL_Rect* rect, Uint32 color )
+{
+	SDL_Rect dst = rect != NULL ? *rect : SDL_Rect{ 0, 0, recorder.width, recorder.height };
+	recordDraw( recorder, &dst, true, [ target, dst, color ]()
+	{
+		SDL_FillRect( target, &dst, color );
+	} );
+}
+
+//Whether opaque rectangles cover all of rect
+inline bool rectCovered( const SDL_Rect& rect, const std::vector<SDL_Rect>& opaque )
+{
+	std::vector<SDL_Rect> pieces;
+	if( rect.w > 0 && rect.h > 0 )
+	{
+		pieces.push_back( rect );
+	}
+
+	//Every piece minus each opaque rectangle leaves up to four pieces: above, below, left and right of the overlap
+	for( size_t o = 0; o < opaque.size() && !pieces.empty(); ++o )
+	{
+		std::vector<SDL_Rect> left;
+		for( size_t p = 0; p < pieces.size(); ++p )
+		{
+			SDL_Rect piece = pieces[ p ];
+			SDL_Rect overlap;
+			if( !SDL_IntersectRect( &piece, &opaque[ o ], &overlap ) )
+			{
+				left.push_back( piece );
+				continue;
+			}
+
+			if( overlap.y > piece.y )
+			{
+				left.push_back( SDL_Rect{ piece.x, piece.y, piece.w, overlap.y - piece.y } );
+			}
+			if( overlap.y + overlap.h < piece.y + piece.h )
+			{
+				left.push_back( SDL_Rect{ piece.x, overlap.y + overlap.h, piece.w, piece.y + piece.h - overlap.y - overlap.h } );
+			}
+			if( overlap.x > piece.x )
+			{
+				left.push_back( SDL_Rect{ piece.x, overlap.y, overlap.x - piece.x, overlap.h } );
+			}
+			if( overlap.x + overlap.w < piece.x + piece.w )
+			{
+				left.push_back( SDL_Rect{ overlap.x + overlap.w, overlap.y, piece.x + piece.w - overlap.x - overlap.w, overlap.h } );
+			}
+		}
+		if( (int)left.size() > RECORDER_MAX_PIECES )
+		{
+			return false;
+		}
+		pieces.swap( left );
+	}
+
+	return pieces.empty();
+}
+
+//Whether two draws are the same draw of the same thing
+inline bool sameRecordedDraw( const RecordedDraw& a, const RecordedDraw& b )
+{
+	return a.source != NULL && a.source == b.source && SDL_RectEquals( &a.rect, &b.rect ) && SDL_RectEquals( &a.sourceRect, &b.sourceRect ) &&
+		a.opaque == b.opaque;
+}
+
+//Runs the recorded draws that are still needed in order and returns how many ran
+inline int submitRecordedFrame( FrameRecorder& recorder )
+{
+	size_t count = recorder.draws.size();
+	std::vector<bool> keep( count, true );
+	long long pixelBytes = recorder.bytesPerPixel;
+
+	//Same frame as last time on a target that still shows it
+	bool retained = recorder.retain && count > 0 && recorder.lastFrame.size() == count;
+	for( size_t i = 0; i < count && retained; ++i )
+	{
+		retained = sameRecordedDraw( recorder.draws[ i ], recorder.lastFrame[ i ] );
+	}
+	if( retained )
+	{
+		keep.assign( count, false );
+		++recorder.stats.retainedFrames;
+	}
+	else if( recorder.elide )
+	{
+		std::vector<SDL_Rect> opaque;
+		for( size_t i = count; i-- > 0; )
+		{
+			const RecordedDraw& draw = recorder.draws[ i ];
+			keep[ i ] = !rectCovered( draw.rect, opaque );
+			if( keep[ i ] && draw.opaque && draw.rect.w > 0 && draw.rect.h > 0 )
+			{
+				opaque.push_back( draw.rect );
+			}
+		}
+	}
+
+	if( recorder.analyze )
+	{
+		recorder.counts.assign( (size_t)recorder.width * recorder.height, 0 );
+		recorder.maxCount = 0;
+	}
+
+	int submitted = 0;
+	for( size_t i = 0; i < count; ++i )
+	{
+		const RecordedDraw& draw = recorder.draws[ i ];
+		long long bytes = (long long)draw.rect.w * draw.rect.h * pixelBytes;
+		if( !keep[ i ] )
+		{
+			++recorder.stats.dropped;
+			recorder.stats.bytesSaved += bytes;
+			continue;
+		}
+
+		draw.draw();
+		++submitted;
+		recorder.stats.bytesWritten += bytes;
+		if( recorder.analyze )
+		{
+			for( int y = draw.rect.y; y < draw.rect.y + draw.rect.h; ++y )
+			{
+				Uint16* row = &recorder.counts[ (size_t)y * recorder.width ];
+				for( int x = draw.rect.x; x < draw.rect.x + draw.rect.w; ++x )
+				{
+					int writes = ++row[ x ];
+					recorder.maxCount = SDL_max( recorder.maxCount, writes );
+				}
+			}
+		}
+	}
+
+	recorder.stats.draws += count;
+	++recorder.stats.frames;
+	recorder.lastFrame = recorder.draws;
+	for( size_t i = 0; i < count; ++i )
+	{
+		recorder.lastFrame[ i ].draw = NULL;
+	}
+
+	return submitted;
+}
+
+//Colors the last submitted frame's writes per pixel into a 32-bit target: black for none, then blue, green, yellow, orange
+//and red for 5 or more. Drawing over the recorder's own target means it no longer holds the frame
+inline void drawOverdrawHeatmap( FrameRecorder& recorder, SDL_Surface* target )
+{
+	if( target == recorder.target )
+	{
+		invalidateRecordedFrame( recorder );
+	}
+	if( recorder.counts.empty() || target->format->BytesPerPixel != 4 || ( SDL_MUSTLOCK( target ) && SDL_LockSurface( target ) < 0 ) )
+	{
+		return;
+	}
+
+	const Uint8 heat[ 6 ][ 3 ] = { { 0x00, 0x00, 0x00 }, { 0x20, 0x40, 0xC0 }, { 0x20, 0xC0, 0x40 }, { 0xE0, 0xE0, 0x20 }, { 0xF0, 0x80, 0x10 }, { 0xF0, 0x20, 0x20 } };
+	Uint32 colors[ 6 ];
+	for( int i = 0; i < 6; ++i )
+	{
+		colors[ i ] = SDL_MapRGB( target->format, heat[ i ][ 0 ], heat[ i ][ 1 ], heat[ i ][ 2 ] );
+	}
+
+	int width = SDL_min( target->w, recorder.width );
+	int height = SDL_min( target->h, recorder.height );
+	for( int y = 0; y < height; ++y )
+	{
+		const Uint16* in = &recorder.counts[ (size_t)y * recorder.width ];
+		Uint32* out = (Uint32*)( (Uint8*)target->pixels + y * target->pitch );
+		for( int x = 0; x < width; ++x )
+		{
+			out[ x ] = colors[ SDL_min( (int)in[ x ], 5 ) ];
+		}
+	}
+
+	if( SDL_MUSTLOCK( target ) )
+	{
+		SDL_UnlockSurface( target );
+	}
+}
+
+//Prints draws, drops and bytes per frame
+inline void printOverdrawReport( const FrameRecorder& recorder, const char* title )
+{
+	const OverdrawStats& stats = recorder.stats;
+	if( stats.frames == 0 )
+	{
+		return;
+	}
+
+	double screenBytes = (double)recorder.width * recorder.height * recorder.bytesPerPixel;
+	printf( "%s frames: %.2f draws, %.2f dropped, %d of %d frames retained\n", title, (double)stats.draws / stats.frames,
+		(double)stats.dropped / stats.frames, stats.retainedFrames, stats.frames );
+	printf( "  pixel writes per frame: %.1f KB written (%.2fx the screen), %.1f KB saved\n", stats.bytesWritten / 1024.0 / stats.frames,
+		screenBytes > 0.0 ? stats.bytesWritten / screenBytes / stats.frames : 0.0, stats.bytesSaved / 1024.0 / stats.frames );
+	if( recorder.analyze )
+	{
+		printf( "  most writes to one pixel in the last frame: %d\n", recorder.maxCount );
+	}
+}
+
+#endif
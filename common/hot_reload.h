@@ -0,0 +1,304 @@
+/*Hot reload of image assets with inotify.
+
+watchHotAsset registers a file the lesson loaded along with the function that decodes it. Once startHotReload runs,
+a background thread waits on inotify for the file to be rewritten (IN_CLOSE_WRITE) or replaced by a rename (IN_MOVED_TO,
+what most editors do on save) and decodes the new version right there, so the main thread never waits on a decode.
+At a frame boundary the lesson calls takeHotReload, which hands over the decoded surface with one pointer exchange,
+swaps it in and calls recordHotReloadSwap to print how long the reload took:
+	decode          on the background thread
+	change to swap  from inotify seeing the change to the new image being in use
+	swap            what the swap itself cost the main thread, compared to the frame budget
+Directories are watched rather than files so a save by rename keeps working. Without inotify (anything but Linux)
+startHotReload fails and the lesson runs as it would without it.
+*/
+
+#ifndef HOT_RELOAD_H
+#define HOT_RELOAD_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include "resource_tracker.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+//A swap slower than this would show up as a dropped frame at 60 fps
+const double HOT_RELOAD_FRAME_BUDGET_MS = 1000.0 / 60.0;
+
+//Decodes a file to a surface ready to swap in, called on the watcher thread
+typedef SDL_Surface* ( *HotReloadDecoder )( std::string path );
+
+//A decoded new version of a file
+struct HotReloadResult
+{
+	SDL_Surface* surface;
+
+	//When the change was seen and how long the decode took
+	Uint64 changedAt;
+	double decodeMs;
+};
+
+//One watched file
+struct HotAsset
+{
+	std::string path;
+	std::string name;
+	int watch;
+	HotReloadDecoder decode;
+
+	//Latest decoded version not yet taken by the main thread
+	std::atomic<HotReloadResult*> pending;
+};
+
+//Frees a result the main thread never took
+inline void freeHotReloadResult( HotReloadResult* result )
+{
+	if( result != NULL )
+	{
+		freeTrackedSurface( result->surface );
+		delete result;
+	}
+}
+
+//The watcher, starts out empty so stopHotReload is safe on one that was never started
+struct HotReloader
+{
+	int fd = -1;
+	int wakePipe[ 2 ] = { -1, -1 };
+	std::deque<HotAsset> assets;
+	std::thread thread;
+
+	//Totals for the exit report
+	int reloads = 0;
+	double worstLatencyMs = 0.0;
+	double worstSwapMs = 0.0;
+};
+
+#ifdef __linux__
+
+//Watches a file, returns its id for takeHotReload or -1 on failure, call before startHotReload
+inline int watchHotAsset( HotReloader& reloader, std::string path, HotReloadDecoder decode )
+{
+	if( reloader.fd < 0 )
+	{
+		reloader.fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+		if( reloader.fd < 0 )
+		{
+			SDL_SetError( "inotify_init1 failed: %s", strerror( errno ) );
+			return -1;
+		}
+	}
+
+	size_t slash = path.rfind( '/' );
+	std::string dir = slash == std::string::npos ? "." : path.substr( 0, SDL_max( slash, (size_t)1 ) );
+	int watch = inotify_add_watch( reloader.fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO );
+	if( watch < 0 )
+	{
+		SDL_SetError( "Unable to watch %s: %s", dir.c_str(), strerror( errno ) );
+		return -1;
+	}
+
+	reloader.assets.emplace_back();
+	HotAsset& asset = reloader.assets.back();
+	asset.path = path;
+	asset.name = slash == std::string::npos ? path : path.substr( slash + 1 );
+	asset.watch = watch;
+	asset.decode = decode;
+	asset.pending = NULL;
+
+	return reloader.assets.size() - 1;
+}
+
+//Decodes a changed asset and publishes it, replacing any version the main thread hasn't taken yet
+inline void reloadHotAsset( HotAsset& asset, Uint64 changedAt )
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	SDL_Surface* surface = asset.decode( asset.path );
+	if( surface == NULL )
+	{
+		//Usually a half written file, the next write will bring another event
+		printf( "Hot reload: unable to decode %s, keeping the current version\n", asset.path.c_str() );
+		return;
+	}
+
+	HotReloadResult* result = new HotReloadResult;
+	result->surface = surface;
+	result->changedAt = changedAt;
+	result->decodeMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+	freeHotReloadResult( asset.pending.exchange( result, std::memory_order_acq_rel ) );
+}
+
+//Watcher thread, sleeps in poll until inotify or the wake pipe has something
+inline void runHotReloader( HotReloader* reloader )
+{
+	pollfd fds[ 2 ] = { { reloader->fd, POLLIN, 0 }, { reloader->wakePipe[ 0 ], POLLIN, 0 } };
+	alignas( inotify_event ) char buffer[ 4096 ];
+	while( true )
+	{
+		if( poll( fds, 2, -1 ) < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			break;
+		}
+		if( fds[ 1 ].revents != 0 )
+		{
+			break;
+		}
+
+		//Collect every changed asset first so a burst of events decodes each file once
+		Uint64 changedAt = SDL_GetPerformanceCounter();
+		std::vector<bool> changed( reloader->assets.size(), false );
+		ssize_t length;
+		while( ( length = read( reloader->fd, buffer, sizeof( buffer ) ) ) > 0 )
+		{
+			for( ssize_t offset = 0; offset < length; )
+			{
+				const inotify_event* event = (const inotify_event*)( buffer + offset );
+				for( size_t i = 0; i < reloader->assets.size() && event->len > 0; ++i )
+				{
+					if( reloader->assets[ i ].watch == event->wd && reloader->assets[ i ].name == event->name )
+					{
+						changed[ i ] = true;
+					}
+				}
+				offset += sizeof( inotify_event ) + event->len;
+			}
+		}
+
+		for( size_t i = 0; i < changed.size(); ++i )
+		{
+			if( changed[ i ] )
+			{
+				reloadHotAsset( reloader->assets[ i ], changedAt );
+			}
+		}
+	}
+}
+
+//Starts watching, returns false if there is nothing to watch or the thread can't start
+inline bool startHotReload( HotReloader& reloader )
+{
+	if( reloader.fd < 0 || reloader.assets.empty() )
+	{
+		SDL_SetError( "No assets to watch" );
+		return false;
+	}
+	if( pipe( reloader.wakePipe ) != 0 )
+	{
+		SDL_SetError( "Unable to create wake pipe: %s", strerror( errno ) );
+		return false;
+	}
+
+	reloader.thread = std::thread( runHotReloader, &reloader );
+	return true;
+}
+
+//Stops the watcher and frees anything it decoded that was never taken
+inline void stopHotReload( HotReloader& reloader )
+{
+	if( reloader.thread.joinable() )
+	{
+		char wake = 1;
+		if( write( reloader.wakePipe[ 1 ], &wake, 1 ) != 1 )
+		{
+			printf( "Hot reload: unable to wake watcher thread!\n" );
+		}
+		reloader.thread.join();
+	}
+
+	for( size_t i = 0; i < reloader.assets.size(); ++i )
+	{
+		freeHotReloadResult( reloader.assets[ i ].pending.exchange( NULL ) );
+	}
+	reloader.assets.clear();
+
+	int fds[] = { reloader.fd, reloader.wakePipe[ 0 ], reloader.wakePipe[ 1 ] };
+	for( int i = 0; i < 3; ++i )
+	{
+		if( fds[ i ] >= 0 )
+		{
+			close( fds[ i ] );
+		}
+	}
+	reloader.fd = reloader.wakePipe[ 0 ] = reloader.wakePipe[ 1 ] = -1;
+}
+
+#else
+
+inline int watchHotAsset( HotReloader& reloader, std::string path, HotReloadDecoder decode )
+{
+	SDL_SetError( "Hot reload needs inotify, which this platform doesn't have" );
+	return -1;
+}
+
+inline bool startHotReload( HotReloader& reloader )
+{
+	SDL_SetError( "Hot reload needs inotify, which this platform doesn't have" );
+	return false;
+}
+
+inline void stopHotReload( HotReloader& reloader )
+{
+}
+
+#endif
+
+//Takes the newest decoded version of an asset if there is one, call at a frame boundary. The caller owns result.surface
+inline bool takeHotReload( HotReloader& reloader, int id, HotReloadResult& result )
+{
+	if( id < 0 || id >= (int)reloader.assets.size() || reloader.assets[ id ].pending.load( std::memory_order_relaxed ) == NULL )
+	{
+		return false;
+	}
+
+	HotReloadResult* taken = reloader.assets[ id ].pending.exchange( NULL, std::memory_order_acq_rel );
+	if( taken == NULL )
+	{
+		return false;
+	}
+	result = *taken;
+	delete taken;
+
+	return true;
+}
+
+//Reports a finished swap that started at swapStart
+inline void recordHotReloadSwap( HotReloader& reloader, int id, const HotReloadResult& result, Uint64 swapStart )
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+	double latencyMs = ( now - result.changedAt ) * toMs;
+	double swapMs = ( now - swapStart ) * toMs;
+
+	++reloader.reloads;
+	reloader.worstLatencyMs = SDL_max( reloader.worstLatencyMs, latencyMs );
+	reloader.worstSwapMs = SDL_max( reloader.worstSwapMs, swapMs );
+
+	const HotAsset& asset = reloader.assets[ id ];
+	printf( "Reloaded %s: decode %.2f ms, change to swap %.2f ms, swap %.3f ms%s\n", asset.path.c_str(), result.decodeMs, latencyMs, swapMs,
+		swapMs > HOT_RELOAD_FRAME_BUDGET_MS ? " (over frame budget!)" : "" );
+}
+
+//Prints the totals
+inline void printHotReloadSummary( const HotReloader& reloader )
+{
+	if( reloader.reloads > 0 )
+	{
+		printf( "Hot reload: %d reloads, worst change to swap %.2f ms, worst swap %.3f ms (budget %.1f ms)\n", reloader.reloads,
+			reloader.worstLatencyMs, reloader.worstSwapMs, HOT_RELOAD_FRAME_BUDGET_MS );
+	}
+}
+
+#endif
@@ -0,0 +1,476 @@
+/*Persistent cache of decoded images.
+
+Decoding a PNG through SDL_image's zlib path costs far more than reading the same pixels back raw. The first time an image is
+loaded, loadCachedImage decodes it, converts it to the format the caller is going to use and writes the pixels to a cache entry.
+Later runs check the entry's key (source path, size and mtime) and a checksum of the cached pixels, then map the entry straight
+into memory instead of decoding. The source file is only read and hashed when its size or mtime no longer match: a file that was
+touched but not changed is still a hit, and its entry takes the new mtime so the next run doesn't hash it again. Anything stale
+or corrupt is decoded again and the entry rewritten.
+
+Entries live in $IMAGE_CACHE_DIR, or .imgcache in the working directory. Deleting the directory is always safe.
+A job system passed in decodes .qois strips in parallel, and startAsyncImageLoad runs the whole load as a job on one so
+startup can go on while it decodes.
+*/
+
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "strip_qoi.h"
+#include "job_system.h"
+#include "lazy_image_init.h"
+#include "startup_profiler.h"
+#include "resource_tracker.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Bump whenever the entry layout changes
+const Uint32 IMAGE_CACHE_VERSION = 1;
+
+//Fixed size header at the start of every cache entry, pixels follow at pixelOffset
+struct ImageCacheHeader
+{
+	char magic[ 8 ];
+	Uint32 version;
+	Uint32 format;
+	Uint64 sourceSize;
+	Uint64 sourceMtime;
+	Uint64 sourceHash;
+	Uint64 pathHash;
+	Uint32 width;
+	Uint32 height;
+	Uint32 pitch;
+	Uint32 pixelOffset;
+	Uint64 pixelHash;
+};
+
+//Kept in surface->userdata for surfaces that point into a mapped entry
+struct ImageCacheMapping
+{
+	void* address;
+	size_t length;
+};
+
+//What happened on the last load, for the lessons' startup numbers
+enum ImageCacheResult
+{
+	IMAGE_CACHE_HIT,
+	IMAGE_CACHE_MISS,
+	IMAGE_CACHE_STALE,
+	IMAGE_CACHE_DISABLED
+};
+
+//64 bit hash over a buffer, eight bytes at a time so checking a cached frame stays well under a millisecond
+inline Uint64 imageCacheHash( const void* data, size_t size, Uint64 seed = 0x9E3779B97F4A7C15ull )
+{
+	const Uint8* bytes = (const Uint8*)data;
+	Uint64 h = seed ^ ( size * 0xFF51AFD7ED558CCDull );
+
+	size_t i = 0;
+	for( ; i + 8 <= size; i += 8 )
+	{
+		Uint64 w;
+		memcpy( &w, bytes + i, 8 );
+		h ^= w * 0x87C37B91114253D5ull;
+		h = ( ( h << 31 ) | ( h >> 33 ) ) * 0x4CF5AD432745937Full;
+	}
+	for( ; i < size; ++i )
+	{
+		h = ( h ^ bytes[ i ] ) * 0x100000001B3ull;
+	}
+
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= h >> 33;
+
+	return h;
+}
+
+//Decodes an image the way the lessons load it, initializing SDL_image only if this format needs it
+inline SDL_Surface* decodeImageUncached( std::string path, JobSystem* jobs = NULL )
+{
+	SDL_Surface* loadedSurface = NULL;
+	if( isQOIPath( path ) )
+	{
+		loadedSurface = loadStripQOI( path, jobs );
+	}
+	else if( ensureImageInit( imageInitFlagsForPath( path ) ) )
+	{
+		loadedSurface = IMG_Load( path.c_str() );
+	}
+	if( loadedSurface == NULL )
+	{
+		printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+	}
+
+	return loadedSurface;
+}
+
+//Decodes and converts an image to the target format
+inline SDL_Surface* decodeImageToFormat( std::string path, Uint32 targetFormat, JobSystem* jobs = NULL )
+{
+	SDL_Surface* loadedSurface = decodeImageUncached( path, jobs );
+	if( loadedSurface == NULL || loadedSurface->format->format == targetFormat )
+	{
+		return loadedSurface;
+	}
+
+	SDL_Surface* convertedSurface = SDL_ConvertSurfaceFormat( loadedSurface, targetFormat, 0 );
+	if( convertedSurface == NULL )
+	{
+		printf( "Unable to convert image %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+	}
+	SDL_FreeSurface( loadedSurface );
+
+	return convertedSurface;
+}
+
+#ifdef _WIN32
+
+//No mmap here, always decode
+inline SDL_Surface* loadCachedImage( std::string path, Uint32 targetFormat, ImageCacheResult* result = NULL, JobSystem* jobs = NULL )
+{
+	if( result != NULL )
+	{
+		*result = IMAGE_CACHE_DISABLED;
+	}
+
+	return decodeImageToFormat( path, targetFormat, jobs );
+}
+
+inline void freeCachedImage( SDL_Surface* surface )
+{
+	freeTrackedSurface( surface );
+}
+
+#else
+
+//Where cache entries go
+inline std::string imageCacheDir()
+{
+	const char* dir = getenv( "IMAGE_CACHE_DIR" );
+	return dir != NULL && dir[ 0 ] != '\0' ? dir : ".imgcache";
+}
+
+//Writes an entry to a temporary file and renames it into place so readers never see half an entry
+inline bool writeImageCacheEntry( std::string entryPath, ImageCacheHeader header, SDL_Surface* surface )
+{
+	std::string tempPath = entryPath + ".tmp" + std::to_string( getpid() );
+	FILE* file = fopen( tempPath.c_str(), "wb" );
+	if( file == NULL )
+	{
+		return false;
+	}
+
+	size_t rowBytes = (size_t)surface->w * surface->format->BytesPerPixel;
+	std::vector<Uint8> pixels( (size_t)header.pitch * header.height );
+	SDL_LockSurface( surface );
+	for( int y = 0; y < surface->h; ++y )
+	{
+		memcpy( &pixels[ y * header.pitch ], (const Uint8*)surface->pixels + y * surface->pitch, rowBytes );
+	}
+	SDL_UnlockSurface( surface );
+	header.pixelHash = imageCacheHash( pixels.data(), pixels.size() );
+
+	bool success = fwrite( &header, sizeof( header ), 1, file ) == 1;
+	success = success && fwrite( pixels.data(), 1, pixels.size(), file ) == pixels.size();
+	success = ( fclose( file ) == 0 ) && success;
+	success = success && rename( tempPath.c_str(), entryPath.c_str() ) == 0;
+	if( !success )
+	{
+		remove( tempPath.c_str() );
+	}
+
+	return success;
+}
+
+//Hashes the source file into key, false if it can't be read
+inline bool hashImageCacheSource( std::string path, ImageCacheHeader& key )
+{
+	std::vector<Uint8> source;
+	if( !readImageFile( path, source ) )
+	{
+		return false;
+	}
+
+	key.sourceHash = imageCacheHash( source.data(), source.size() );
+	return true;
+}
+
+//Rewrites an entry's header in place, for a source that was touched but not changed
+inline void refreshImageCacheEntry( std::string entryPath, const ImageCacheHeader& header )
+{
+	int fd = open( entryPath.c_str(), O_WRONLY );
+	if( fd >= 0 )
+	{
+		if( pwrite( fd, &header, sizeof( header ), 0 ) != (ssize_t)sizeof( header ) )
+		{
+			printf( "Warning: Unable to update image cache entry %s!\n", entryPath.c_str() );
+		}
+		close( fd );
+	}
+}
+
+//Loads an image through the cache, decoding on jobs if given. The returned surface must be released with freeCachedImage
+inline SDL_Surface* loadCachedImage( std::string path, Uint32 targetFormat, ImageCacheResult* result = NULL, JobSystem* jobs = NULL )
+{
+	ImageCacheResult outcome = IMAGE_CACHE_MISS;
+
+	//Build the key from the source file's metadata, its contents are only hashed if that doesn't match the entry
+	struct stat sourceStat;
+	if( stat( path.c_str(), &sourceStat ) != 0 )
+	{
+		printf( "Unable to read image %s!\n", path.c_str() );
+		return NULL;
+	}
+
+	ImageCacheHeader key;
+	memset( &key, 0, sizeof( key ) );
+	memcpy( key.magic, "IMGCACHE", 8 );
+	key.version = IMAGE_CACHE_VERSION;
+	key.format = targetFormat;
+	key.sourceSize = sourceStat.st_size;
+	key.sourceMtime = (Uint64)sourceStat.st_mtim.tv_sec * 1000000000ull + sourceStat.st_mtim.tv_nsec;
+	key.pathHash = imageCacheHash( path.data(), path.size() );
+	bool hashed = false;
+
+	//One entry per path and target format
+	char name[ 64 ];
+	snprintf( name, sizeof( name ), "/%016llx-%08x.img", (unsigned long long)key.pathHash, (unsigned)targetFormat );
+	std::string entryPath = imageCacheDir() + name;
+
+	//Try the existing entry
+	int fd = open( entryPath.c_str(), O_RDONLY );
+	if( fd >= 0 )
+	{
+		struct stat entryStat;
+		void* address = MAP_FAILED;
+		size_t length = 0;
+		if( fstat( fd, &entryStat ) == 0 && (size_t)entryStat.st_size >= sizeof( ImageCacheHeader ) )
+		{
+			length = entryStat.st_size;
+			address = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+		}
+		close( fd );
+
+		if( address != MAP_FAILED )
+		{
+			ImageCacheHeader header;
+			memcpy( &header, address, sizeof( header ) );
+
+			//Key has to match exactly and the pixels have to be intact
+			bool valid = memcmp( header.magic, key.magic, 8 ) == 0 && header.version == key.version && header.format == key.format
+				&& header.pathHash == key.pathHash
+				&& header.width > 0 && header.height > 0 && header.pitch >= header.width * SDL_BYTESPERPIXEL( targetFormat )
+				&& header.pixelOffset == sizeof( ImageCacheHeader )
+				&& length - header.pixelOffset == (size_t)header.pitch * header.height;
+
+			//Same size and mtime is the same file, otherwise it's only the same if the contents hash the same
+			bool touched = header.sourceSize != key.sourceSize || header.sourceMtime != key.sourceMtime;
+			if( valid && touched )
+			{
+				hashed = hashImageCacheSource( path, key );
+				valid = hashed && header.sourceSize == key.sourceSize && header.sourceHash == key.sourceHash;
+			}
+			valid = valid && imageCacheHash( (const Uint8*)address + header.pixelOffset, length - header.pixelOffset ) == header.pixelHash;
+
+			//Remember the new mtime so the next run doesn't hash the file again
+			if( valid && touched )
+			{
+				header.sourceMtime = key.sourceMtime;
+				refreshImageCacheEntry( entryPath, header );
+			}
+
+			if( valid )
+			{
+				//Point a surface straight at the mapped pixels
+				SDL_Surface* cachedSurface = SDL_CreateRGBSurfaceWithFormatFrom( (Uint8*)address + header.pixelOffset,
+					header.width, header.height, SDL_BITSPERPIXEL( targetFormat ), header.pitch, targetFormat );
+				ImageCacheMapping* mapping = cachedSurface != NULL ? new ImageCacheMapping : NULL;
+				if( mapping != NULL )
+				{
+					mapping->address = address;
+					mapping->length = length;
+					cachedSurface->userdata = mapping;
+					if( result != NULL )
+					{
+						*result = IMAGE_CACHE_HIT;
+					}
+					return cachedSurface;
+				}
+				SDL_FreeSurface( cachedSurface );
+			}
+			else
+			{
+				outcome = IMAGE_CACHE_STALE;
+			}
+
+			munmap( address, length );
+		}
+		else
+		{
+			outcome = IMAGE_CACHE_STALE;
+		}
+	}
+
+	//Decode the slow way and (re)write the entry
+	SDL_Surface* decodedSurface = decodeImageToFormat( path, targetFormat, jobs );
+	if( decodedSurface != NULL && ( hashed || hashImageCacheSource( path, key ) ) )
+	{
+		key.width = decodedSurface->w;
+		key.height = decodedSurface->h;
+		key.pitch = ( decodedSurface->w * decodedSurface->format->BytesPerPixel + 3 ) & ~3;
+		key.pixelOffset = sizeof( ImageCacheHeader );
+
+		mkdir( imageCacheDir().c_str(), 0755 );
+		if( !writeImageCacheEntry( entryPath, key, decodedSurface ) )
+		{
+			//Not fatal, we still have the image
+			printf( "Warning: Unable to write image cache entry %s!\n", entryPath.c_str() );
+		}
+	}
+
+	if( result != NULL )
+	{
+		*result = outcome;
+	}
+
+	return decodedSurface;
+}
+
+//Frees a surface returned by loadCachedImage
+inline void freeCachedImage( SDL_Surface* surface )
+{
+	if( surface == NULL )
+	{
+		return;
+	}
+
+	ImageCacheMapping* mapping = (ImageCacheMapping*)surface->userdata;
+	freeTrackedSurface( surface );
+	if( mapping != NULL )
+	{
+		munmap( mapping->address, mapping->length );
+		delete mapping;
+	}
+}
+
+#endif
+
+//An image being loaded as a job during startup
+struct AsyncImageLoad
+{
+	std::string path;
+	std::string label;
+	Uint32 format;
+	SDL_Surface* surface;
+	ImageCacheResult result;
+	JobSystem* jobs;
+	JobCounter pending;
+};
+
+//Starts loading an image in the format we expect to need, before we know for sure what that is, as a job on jobs
+inline void startAsyncImageLoad( AsyncImageLoad& load, JobSystem& jobs, std::string path, Uint32 expectedFormat )
+{
+	load.path = path;
+	load.label = "decode " + path;
+	load.format = expectedFormat;
+	load.surface = NULL;
+	load.result = IMAGE_CACHE_MISS;
+	load.jobs = &jobs;
+	load.pending = 0;
+	submitJob( jobs, [ &load ]()
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		load.surface = loadCachedImage( load.path, load.format, &load.result, load.jobs );
+		startupSpan( load.label.c_str(), start, SDL_GetPerformanceCounter() );
+	}, &load.pending );
+}
+
+//Waits for a load started with startAsyncImageLoad, running jobs meanwhile on a job system thread
+inline void waitAsyncImageJob( AsyncImageLoad& load )
+{
+	if( load.jobs != NULL )
+	{
+		waitForJobs( *load.jobs, load.pending );
+		load.jobs = NULL;
+	}
+}
+
+//Whether path is the image being loaded in the background and not collected yet
+inline bool asyncImageLoadPending( const AsyncImageLoad& load, std::string path )
+{
+	return load.jobs != NULL && load.path == path;
+}
+
+//Waits for a background load and converts it if the guessed format was wrong. Returns NULL if path isn't the one being
+//loaded or the load failed, asyncImageLoadPending tells those apart beforehand
+inline SDL_Surface* finishAsyncImageLoad( AsyncImageLoad& load, std::string path, Uint32 targetFormat, ImageCacheResult* result = NULL )
+{
+	if( !asyncImageLoadPending( load, path ) )
+	{
+		return NULL;
+	}
+	waitAsyncImageJob( load );
+
+	SDL_Surface* loadedSurface = load.surface;
+	load.surface = NULL;
+	if( result != NULL )
+	{
+		*result = load.result;
+	}
+
+	if( loadedSurface != NULL && loadedSurface->format->format != targetFormat )
+	{
+		SDL_Surface* convertedSurface = SDL_ConvertSurfaceFormat( loadedSurface, targetFormat, 0 );
+		if( convertedSurface == NULL )
+		{
+			printf( "Unable to convert image %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+		}
+		freeCachedImage( loadedSurface );
+		loadedSurface = convertedSurface;
+	}
+
+	return loadedSurface;
+}
+
+//Waits for a background load nobody collected, for shutdown paths
+inline void waitAsyncImageLoad( AsyncImageLoad& load )
+{
+	waitAsyncImageJob( load );
+
+	freeCachedImage( load.surface );
+	load.surface = NULL;
+}
+
+//Short name of a load outcome for the startup log
+inline const char* imageCacheResultName( ImageCacheResult result )
+{
+	switch( result )
+	{
+		case IMAGE_CACHE_HIT:
+		return "cache hit";
+
+		case IMAGE_CACHE_MISS:
+		return "cache miss";
+
+		case IMAGE_CACHE_STALE:
+		return "stale entry, rewritten";
+
+		default:
+		return "cache disabled";
+	}
+}
+
+#endif
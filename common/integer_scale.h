@@ -0,0 +1,286 @@
+/*Integer upscaling of a fixed logical resolution to a bigger window.
+
+The lessons draw at 640x480, which is a small box on a large display. SDL_BlitScaled (and a linear filtered
+SDL_RenderCopy) stretches to any size, working out a source position per destination pixel. When the window is a whole
+multiple of the logical size none of that is needed: every source pixel becomes a factor x factor block.
+integerScaleSurface does exactly that for 32-bit surfaces, replicating each source row across with a SIMD kernel and then
+copying the finished row down factor - 1 times, blocks of rows at a time as jobs (see parallelFor in job_system.h). The
+result is centered in the destination at the largest factor that fits (integerScaleFactor), the caller clears the border
+once when it changes.
+	AVX2  8 source pixels at a time, one lane permute per 8 output pixels for factors up to 8, broadcasts above that
+	SSE2  unpacks for 2x, shuffles for 3x and broadcast stores for 4x and up
+The renderer path doesn't need any of this: SDL_RenderSetLogicalSize plus SDL_RenderSetIntegerScale with nearest
+sampling gives the same picture with the scaling done by the GPU.
+*/
+
+#ifndef INTEGER_SCALE_H
+#define INTEGER_SCALE_H
+
+#include <SDL2/SDL.h>
+#include <string.h>
+#include "job_system.h"
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <immintrin.h>
+#define INTEGER_SCALE_SSE2 1
+#if defined( __GNUC__ ) || defined( _MSC_VER )
+#define INTEGER_SCALE_AVX2 1
+#endif
+#endif
+
+//GCC and Clang need AVX2 code marked so the rest of the file can stay plain SSE2
+#if defined( INTEGER_SCALE_AVX2 ) && defined( __GNUC__ )
+#define INTEGER_SCALE_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#else
+#define INTEGER_SCALE_TARGET_AVX2
+#endif
+
+//Source rows per job at least
+const int SCALE_ROW_BLOCK = 16;
+
+//Destination pixels a job should have at least, below this handing out jobs costs more than it saves
+const int SCALE_MIN_PIXELS_PER_JOB = 256 * 1024;
+
+//Which row kernels to use
+enum ScalePath
+{
+	SCALE_PATH_AUTO,
+	SCALE_PATH_SCALAR,
+	SCALE_PATH_SSE2,
+	SCALE_PATH_AVX2
+};
+
+inline const char* scalePathName( ScalePath path )
+{
+	switch( path )
+	{
+		case SCALE_PATH_SCALAR: return "scalar";
+		case SCALE_PATH_SSE2: return "sse2";
+		case SCALE_PATH_AVX2: return "avx2";
+		default: return "auto";
+	}
+}
+
+//The fastest kernels this CPU runs
+inline ScalePath bestScalePath()
+{
+#ifdef INTEGER_SCALE_AVX2
+	if( SDL_HasAVX2() )
+	{
+		return SCALE_PATH_AVX2;
+	}
+#endif
+#ifdef INTEGER_SCALE_SSE2
+	if( SDL_HasSSE2() )
+	{
+		return SCALE_PATH_SSE2;
+	}
+#endif
+	return SCALE_PATH_SCALAR;
+}
+
+//Largest whole factor a logical size fits into a window at, at least 1
+inline int integerScaleFactor( int logicalWidth, int logicalHeight, int windowWidth, int windowHeight )
+{
+	return SDL_max( 1, SDL_min( windowWidth / logicalWidth, windowHeight / logicalHeight ) );
+}
+
+//Where the scaled image goes in the window, centered
+inline SDL_Rect integerScaleRect( int logicalWidth, int logicalHeight, int windowWidth, int windowHeight, int factor )
+{
+	SDL_Rect rect = { 0, 0, logicalWidth * factor, logicalHeight * factor };
+	rect.x = SDL_max( 0, ( windowWidth - rect.w ) / 2 );
+	rect.y = SDL_max( 0, ( windowHeight - rect.h ) / 2 );
+	return rect;
+}
+
+//Writes each of width source pixels factor times
+inline void scaleRowScalar( const Uint32* in, int width, Uint32* out, int factor )
+{
+	for( int x = 0; x < width; ++x )
+	{
+		Uint32 pixel = in[ x ];
+		for( int i = 0; i < factor; ++i )
+		{
+			*out++ = pixel;
+		}
+	}
+}
+
+#ifdef INTEGER_SCALE_SSE2
+inline void scaleRowSSE2( const Uint32* in, int width, Uint32* out, int factor )
+{
+	int x = 0;
+	if( factor == 2 )
+	{
+		for( ; x + 4 <= width; x += 4, out += 8 )
+		{
+			__m128i pixels = _mm_loadu_si128( (const __m128i*)( in + x ) );
+			_mm_storeu_si128( (__m128i*)out, _mm_unpacklo_epi32( pixels, pixels ) );
+			_mm_storeu_si128( (__m128i*)( out + 4 ), _mm_unpackhi_epi32( pixels, pixels ) );
+		}
+	}
+	else if( factor == 3 )
+	{
+		//abcd becomes aaab bbcc cddd
+		for( ; x + 4 <= width; x += 4, out += 12 )
+		{
+			__m128i pixels = _mm_loadu_si128( (const __m128i*)( in + x ) );
+			_mm_storeu_si128( (__m128i*)out, _mm_shuffle_epi32( pixels, _MM_SHUFFLE( 1, 0, 0, 0 ) ) );
+			_mm_storeu_si128( (__m128i*)( out + 4 ), _mm_shuffle_epi32( pixels, _MM_SHUFFLE( 2, 2, 1, 1 ) ) );
+			_mm_storeu_si128( (__m128i*)( out + 8 ), _mm_shuffle_epi32( pixels, _MM_SHUFFLE( 3, 3, 3, 2 ) ) );
+		}
+	}
+	else if( factor >= 4 )
+	{
+		//Whole stores of the pixel, the last one overlapping the one before it
+		for( ; x < width; ++x, out += factor )
+		{
+			__m128i pixel = _mm_set1_epi32( (int)in[ x ] );
+			for( int i = 0; i + 4 < factor; i += 4 )
+			{
+				_mm_storeu_si128( (__m128i*)( out + i ), pixel );
+			}
+			_mm_storeu_si128( (__m128i*)( out + factor - 4 ), pixel );
+		}
+	}
+
+	scaleRowScalar( in + x, width - x, out, factor );
+}
+#endif
+
+#ifdef INTEGER_SCALE_AVX2
+INTEGER_SCALE_TARGET_AVX2 inline void scaleRowAVX2( const Uint32* in, int width, Uint32* out, int factor )
+{
+	int x = 0;
+	if( factor <= 8 )
+	{
+		//Output vector j of a group of 8 source pixels takes pixels ( 8j + k ) / factor
+		__m256i lanes[ 8 ];
+		for( int j = 0; j < factor; ++j )
+		{
+			int index[ 8 ];
+			for( int k = 0; k < 8; ++k )
+			{
+				index[ k ] = ( 8 * j + k ) / factor;
+			}
+			lanes[ j ] = _mm256_loadu_si256( (const __m256i*)index );
+		}
+
+		for( ; x + 8 <= width; x += 8, out += 8 * factor )
+		{
+			__m256i pixels = _mm256_loadu_si256( (const __m256i*)( in + x ) );
+			for( int j = 0; j < factor; ++j )
+			{
+				_mm256_storeu_si256( (__m256i*)( out + 8 * j ), _mm256_permutevar8x32_epi32( pixels, lanes[ j ] ) );
+			}
+		}
+	}
+	else
+	{
+		for( ; x < width; ++x, out += factor )
+		{
+			__m256i pixel = _mm256_set1_epi32( (int)in[ x ] );
+			for( int i = 0; i + 8 < factor; i += 8 )
+			{
+				_mm256_storeu_si256( (__m256i*)( out + i ), pixel );
+			}
+			_mm256_storeu_si256( (__m256i*)( out + factor - 8 ), pixel );
+		}
+	}
+
+	scaleRowScalar( in + x, width - x, out, factor );
+}
+#endif
+
+inline void scaleRow( const Uint32* in, int width, Uint32* out, int factor, ScalePath path )
+{
+#ifdef INTEGER_SCALE_AVX2
+	if( path == SCALE_PATH_AVX2 )
+	{
+		scaleRowAVX2( in, width, out, factor );
+		return;
+	}
+#endif
+#ifdef INTEGER_SCALE_SSE2
+	if( path == SCALE_PATH_SSE2 )
+	{
+		scaleRowSSE2( in, width, out, factor );
+		return;
+	}
+#endif
+	scaleRowScalar( in, width, out, factor );
+}
+
+//Draws a 32-bit surface factor times bigger into dst at dstX, dstY, clipped to dst. Both surfaces must share a format.
+//Rows are split across jobs's workers. Returns 0 or a negative SDL error like the SDL blits
+inline int integerScaleSurface( SDL_Surface* src, SDL_Surface* dst, int dstX, int dstY, int factor, ScalePath path = SCALE_PATH_AUTO, JobSystem* jobs = NULL )
+{
+	if( src == NULL || dst == NULL || factor < 1 )
+	{
+		return SDL_SetError( "integerScaleSurface: bad arguments" );
+	}
+	if( src->format->BytesPerPixel != 4 || src->format->format != dst->format->format )
+	{
+		return SDL_SetError( "integerScaleSurface needs 32-bit surfaces of the same format" );
+	}
+	if( path == SCALE_PATH_AUTO )
+	{
+		path = bestScalePath();
+	}
+
+	//Only source pixels that land inside dst, and only whole ones on the left and top edges
+	int firstX = dstX < 0 ? ( -dstX + factor - 1 ) / factor : 0;
+	int firstY = dstY < 0 ? ( -dstY + factor - 1 ) / factor : 0;
+	int columns = SDL_min( src->w, ( dst->w - dstX ) / factor ) - firstX;
+	int rows = SDL_min( src->h, ( dst->h - dstY ) / factor ) - firstY;
+	if( columns <= 0 || rows <= 0 )
+	{
+		return 0;
+	}
+
+	bool lockSrc = SDL_MUSTLOCK( src );
+	bool lockDst = SDL_MUSTLOCK( dst );
+	if( lockSrc && SDL_LockSurface( src ) < 0 )
+	{
+		return -1;
+	}
+	if( lockDst && SDL_LockSurface( dst ) < 0 )
+	{
+		if( lockSrc )
+		{
+			SDL_UnlockSurface( src );
+		}
+		return -1;
+	}
+
+	int grain = SDL_max( SCALE_ROW_BLOCK, SCALE_MIN_PIXELS_PER_JOB / ( columns * factor * factor ) );
+	size_t rowBytes = (size_t)columns * factor * 4;
+
+	//Each source row is spread across its first output row, which is then copied down
+	parallelFor( jobs, 0, rows, grain, [ & ]( int first, int last )
+	{
+		for( int y = first; y < last; ++y )
+		{
+			const Uint32* in = (const Uint32*)( (const Uint8*)src->pixels + ( firstY + y ) * src->pitch ) + firstX;
+			Uint8* out = (Uint8*)dst->pixels + ( dstY + ( firstY + y ) * factor ) * dst->pitch + ( dstX + firstX * factor ) * 4;
+			scaleRow( in, columns, (Uint32*)out, factor, path );
+			for( int i = 1; i < factor; ++i )
+			{
+				memcpy( out + i * dst->pitch, out, rowBytes );
+			}
+		}
+	} );
+
+	if( lockDst )
+	{
+		SDL_UnlockSurface( dst );
+	}
+	if( lockSrc )
+	{
+		SDL_UnlockSurface( src );
+	}
+
+	return 0;
+}
+
+#endif
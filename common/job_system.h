@@ -0,0 +1,408 @@
+/*Work-stealing job system with per-frame task graphs.
+
+startJobSystem starts a worker per core, the calling (main) thread being worker 0 and the rest new threads. Each worker
+has its own deque: jobs a worker submits go on the back of its own deque and it takes its next job from the back too, so
+work stays on the core that made it, while an idle worker steals from the front of someone else's. Every job can count
+down a JobCounter, and waitForJobs runs jobs until that counter reaches zero instead of blocking, so a waiting thread is
+never idle while there is work.
+	parallelFor   splits a range into grain sized jobs and waits for them, from any thread, nested or not; shared code
+	              takes a JobSystem* and runs serially on NULL, so the same call works with and without one
+	TaskGraph     named tasks with dependencies, built once and run every frame by runTaskGraph; a task starts as soon
+	              as the tasks it depends on are done and tasks that don't depend on each other run in parallel
+SDL's video, event and render calls have to stay on the thread that initialized SDL. Jobs submitted with mainThread set
+(and graph tasks added with it) go to a queue only worker 0 takes from, which it does while it waits, so a graph can
+mix main thread tasks (input, present) with tasks any worker runs.
+The deques are plain mutex guarded std::deques: jobs here are whole blocks of entities or rows, thousands of times the
+cost of an uncontended lock, so a lock-free deque wouldn't show.
+*/
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Counts jobs that haven't finished yet
+typedef std::atomic<int> JobCounter;
+
+//One queued job, counter is counted down when it finishes
+struct Job
+{
+	std::function<void()> run;
+	JobCounter* counter;
+};
+
+//A worker's deque and what it has done
+struct JobWorker
+{
+	std::mutex mutex;
+	std::deque<Job> jobs;
+	std::atomic<long long> executed;
+	std::atomic<long long> stolen;
+};
+
+struct JobSystem
+{
+	std::vector<std::unique_ptr<JobWorker> > workers;
+	std::vector<std::thread> threads;
+
+	//Jobs only the main thread (worker 0) runs
+	std::mutex mainMutex;
+	std::deque<Job> mainJobs;
+	std::atomic<long long> mainExecuted;
+
+	//Queued jobs any worker can take, idle workers sleep while it is 0
+	std::atomic<int> pending;
+	std::atomic<bool> running;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+};
+
+//Which worker this thread is, -1 for threads outside the job system
+inline int& currentJobWorker()
+{
+	static thread_local int worker = -1;
+	return worker;
+}
+
+inline int jobWorkerCount( const JobSystem& system )
+{
+	return system.workers.size();
+}
+
+//Finishes a job: runs it and counts its counter down
+inline void executeJob( Job& job )
+{
+	job.run();
+	if( job.counter != NULL )
+	{
+		--*job.counter;
+	}
+}
+
+//Runs one job if there is one for this worker: main thread jobs first on worker 0, then its own newest job, then the
+//oldest job of the next worker round that has any
+inline bool runOneJob( JobSystem& system, int worker )
+{
+	Job job;
+	bool found = false;
+
+	if( worker == 0 )
+	{
+		std::lock_guard<std::mutex> lock( system.mainMutex );
+		if( !system.mainJobs.empty() )
+		{
+			job = system.mainJobs.front();
+			system.mainJobs.pop_front();
+			found = true;
+		}
+		if( found )
+		{
+			++system.mainExecuted;
+		}
+	}
+
+	int count = system.workers.size();
+	for( int i = 0; i < count && !found && worker >= 0; ++i )
+	{
+		int victim = ( worker + i ) % count;
+		JobWorker& queue = *system.workers[ victim ];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		if( !queue.jobs.empty() )
+		{
+			if( victim == worker )
+			{
+				job = queue.jobs.back();
+				queue.jobs.pop_back();
+			}
+			else
+			{
+				job = queue.jobs.front();
+				queue.jobs.pop_front();
+				++system.workers[ worker ]->stolen;
+			}
+			--system.pending;
+			++system.workers[ worker ]->executed;
+			found = true;
+		}
+	}
+
+	if( found )
+	{
+		executeJob( job );
+	}
+	return found;
+}
+
+//A worker thread: run jobs, sleep when there are none
+inline void runJobWorker( JobSystem* system, int worker )
+{
+	currentJobWorker() = worker;
+	while( system->running )
+	{
+		if( !runOneJob( *system, worker ) )
+		{
+			std::unique_lock<std::mutex> lock( system->sleepMutex );
+			system->wake.wait( lock, [ system ]() { return system->pending > 0 || !system->running; } );
+		}
+	}
+}
+
+//Starts workers - 1 threads next to the calling thread, which becomes worker 0 and has to be the main thread. workers <= 0
+//uses every CPU
+inline bool startJobSystem( JobSystem& system, int workers = 0 )
+{
+	if( workers <= 0 )
+	{
+		workers = SDL_GetCPUCount();
+	}
+	workers = SDL_max( 1, workers );
+
+	system.pending = 0;
+	system.mainExecuted = 0;
+	system.running = true;
+	for( int i = 0; i < workers; ++i )
+	{
+		system.workers.emplace_back( new JobWorker() );
+		system.workers.back()->executed = 0;
+		system.workers.back()->stolen = 0;
+	}
+
+	currentJobWorker() = 0;
+	for( int i = 1; i < workers; ++i )
+	{
+		system.threads.emplace_back( runJobWorker, &system, i );
+	}
+
+	return true;
+}
+
+//Stops the worker threads, jobs still queued are dropped
+inline void stopJobSystem( JobSystem& system )
+{
+	{
+		std::lock_guard<std::mutex> lock( system.sleepMutex );
+		system.running = false;
+	}
+	system.wake.notify_all();
+	for( size_t i = 0; i < system.threads.size(); ++i )
+	{
+		system.threads[ i ].join();
+	}
+	system.threads.clear();
+	system.workers.clear();
+	system.mainJobs.clear();
+}
+
+//Queues a job, on the submitting worker's own deque (worker 0's for other threads) or for the main thread only
+inline void submitJob( JobSystem& system, std::function<void()> run, JobCounter* counter = NULL, bool mainThread = false )
+{
+	if( counter != NULL )
+	{
+		++*counter;
+	}
+
+	Job job = { run, counter };
+	if( mainThread )
+	{
+		std::lock_guard<std::mutex> lock( system.mainMutex );
+		system.mainJobs.push_back( job );
+		return;
+	}
+
+	int worker = SDL_max( 0, currentJobWorker() );
+	{
+		JobWorker& queue = *system.workers[ worker ];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		queue.jobs.push_back( job );
+	}
+
+	//Taking the sleep lock between the count and the notify means a worker can't miss it
+	++system.pending;
+	{
+		std::lock_guard<std::mutex> lock( system.sleepMutex );
+	}
+	system.wake.notify_one();
+}
+
+//Runs jobs until counter reaches zero, threads outside the job system just yield
+inline void waitForJobs( JobSystem& system, JobCounter& counter )
+{
+	int worker = currentJobWorker();
+	while( counter > 0 )
+	{
+		if( worker < 0 || !runOneJob( system, worker ) )
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+//Calls body( first, last ) for grain sized pieces of [ begin, end ) across the workers and returns when all are done
+inline void parallelFor( JobSystem& system, int begin, int end, int grain, const std::function<void( int, int )>& body )
+{
+	grain = SDL_max( 1, grain );
+	if( end - begin <= grain || system.workers.size() < 2 )
+	{
+		if( begin < end )
+		{
+			body( begin, end );
+		}
+		return;
+	}
+
+	//Submitted last to first so the owner, popping from the back, starts at the beginning of the range
+	JobCounter counter( 0 );
+	int pieces = ( end - begin + grain - 1 ) / grain;
+	for( int p = pieces - 1; p > 0; --p )
+	{
+		int first = begin + p * grain;
+		int last = SDL_min( first + grain, end );
+		submitJob( system, [ &body, first, last ]() { body( first, last ); }, &counter );
+	}
+	body( begin, SDL_min( begin + grain, end ) );
+	waitForJobs( system, counter );
+}
+
+//The same for code that may not have a job system, NULL runs the whole range on the calling thread
+inline void parallelFor( JobSystem* system, int begin, int end, int grain, const std::function<void( int, int )>& body )
+{
+	if( system != NULL )
+	{
+		parallelFor( *system, begin, end, grain, body );
+	}
+	else if( begin < end )
+	{
+		body( begin, end );
+	}
+}
+
+//Prints how many jobs each worker ran and stole
+inline void printJobReport( JobSystem& system )
+{
+	long long total = system.mainExecuted;
+	for( size_t i = 0; i < system.workers.size(); ++i )
+	{
+		total += system.workers[ i ]->executed;
+	}
+
+	printf( "Job system: %d workers, %lld jobs (%lld main thread only)\n", jobWorkerCount( system ), total, (long long)system.mainExecuted );
+	for( size_t i = 0; i < system.workers.size(); ++i )
+	{
+		printf( "  worker %d: %lld jobs, %lld stolen\n", (int)i, (long long)system.workers[ i ]->executed, (long long)system.workers[ i ]->stolen );
+	}
+}
+
+//One task of a graph
+struct TaskNode
+{
+	std::string name;
+	std::function<void()> run;
+	bool mainThread;
+	std::vector<int> dependents;
+	int dependencies;
+
+	//Dependencies not done yet this run
+	std::atomic<int> remaining;
+
+	//Time spent in the task over every run
+	std::atomic<Uint64> ticks;
+};
+
+//Tasks and their dependencies, built once and run as often as needed
+struct TaskGraph
+{
+	std::deque<TaskNode> nodes;
+	int runs = 0;
+};
+
+//Adds a task and returns its index for addTaskDependency
+inline int addTask( TaskGraph& graph, std::string name, std::function<void()> run, bool mainThread = false )
+{
+	graph.nodes.emplace_back();
+	TaskNode& node = graph.nodes.back();
+	node.name = name;
+	node.run = run;
+	node.mainThread = mainThread;
+	node.dependencies = 0;
+	node.remaining = 0;
+	node.ticks = 0;
+	return graph.nodes.size() - 1;
+}
+
+//Makes after wait for before
+inline void addTaskDependency( TaskGraph& graph, int before, int after )
+{
+	graph.nodes[ before ].dependents.push_back( after );
+	++graph.nodes[ after ].dependencies;
+}
+
+//Queues a task whose dependencies are done, finishing it queues the dependents it was the last dependency of
+inline void submitTask( JobSystem& system, TaskGraph& graph, int index, JobCounter& done )
+{
+	TaskNode& node = graph.nodes[ index ];
+	submitJob( system, [ &system, &graph, &node, &done ]()
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		node.run();
+		node.ticks += SDL_GetPerformanceCounter() - start;
+
+		for( size_t i = 0; i < node.dependents.size(); ++i )
+		{
+			if( --graph.nodes[ node.dependents[ i ] ].remaining == 0 )
+			{
+				submitTask( system, graph, node.dependents[ i ], done );
+			}
+		}
+	}, &done, node.mainThread );
+}
+
+//Runs every task once in dependency order and returns when all are done. Call from the main thread
+inline void runTaskGraph( JobSystem& system, TaskGraph& graph )
+{
+	for( size_t i = 0; i < graph.nodes.size(); ++i )
+	{
+		graph.nodes[ i ].remaining = graph.nodes[ i ].dependencies;
+	}
+
+	//Counted up before anything runs so a quick first task can't take it to zero early
+	JobCounter done( 1 );
+	for( size_t i = 0; i < graph.nodes.size(); ++i )
+	{
+		if( graph.nodes[ i ].dependencies == 0 )
+		{
+			submitTask( system, graph, i, done );
+		}
+	}
+	--done;
+	waitForJobs( system, done );
+	++graph.runs;
+}
+
+//Prints each task's average time per run
+inline void printTaskGraphReport( const TaskGraph& graph, const char* title )
+{
+	if( graph.runs == 0 )
+	{
+		return;
+	}
+
+	double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+	printf( "%s task graph over %d runs:\n", title, graph.runs );
+	for( size_t i = 0; i < graph.nodes.size(); ++i )
+	{
+		const TaskNode& node = graph.nodes[ i ];
+		printf( "  %-16s %8.3f ms%s\n", node.name.c_str(), node.ticks * toMs / graph.runs, node.mainThread ? " (main thread)" : "" );
+	}
+}
+
+#endif
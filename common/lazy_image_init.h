@@ -0,0 +1,92 @@
+/*Deferred SDL_image initialization.
+
+IMG_Init loads the codec libraries, which is wasted startup time for a program that never ends up decoding that format.
+ensureImageInit initializes only the formats an image load actually asks for, the first time it asks, from any thread.
+Each format is initialized once through its own std::call_once, so a thread needing an already loaded format never waits
+on another one loading a codec, and the mutex is only held to update the set of initialized formats. A format that fails
+to initialize reports it once and stays uninitialized.
+*/
+
+#ifndef LAZY_IMAGE_INIT_H
+#define LAZY_IMAGE_INIT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <mutex>
+#include <string>
+
+//IMG_INIT_ flag bits tracked, one per format
+const int IMAGE_INIT_FORMATS = 8;
+
+//Guards the set of initialized SDL_image formats
+inline std::mutex& imageInitMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+//Makes sure each format's IMG_Init runs once
+inline std::once_flag& imageInitOnce( int format )
+{
+	static std::once_flag once[ IMAGE_INIT_FORMATS ];
+	return once[ format ];
+}
+
+//SDL_image formats initialized so far
+inline int& imageInitFlags()
+{
+	static int flags = 0;
+	return flags;
+}
+
+//Initializes the SDL_image formats that haven't been yet, false if any of flags couldn't be
+inline bool ensureImageInit( int flags )
+{
+	for( int format = 0; format < IMAGE_INIT_FORMATS; ++format )
+	{
+		int flag = 1 << format;
+		if( flags & flag )
+		{
+			std::call_once( imageInitOnce( format ), [ flag ]()
+			{
+				int loaded = IMG_Init( flag ) & flag;
+				if( loaded == 0 )
+				{
+					printf( "SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError() );
+				}
+
+				std::lock_guard<std::mutex> lock( imageInitMutex() );
+				imageInitFlags() |= loaded;
+			} );
+		}
+	}
+
+	std::lock_guard<std::mutex> lock( imageInitMutex() );
+	return ( imageInitFlags() & flags ) == flags;
+}
+
+//The SDL_image format flag a file needs, 0 for formats that need no codec library
+inline int imageInitFlagsForPath( std::string path )
+{
+	size_t dot = path.rfind( '.' );
+	std::string ext = dot == std::string::npos ? "" : path.substr( dot );
+	for( size_t i = 0; i < ext.size(); ++i )
+	{
+		ext[ i ] = tolower( ext[ i ] );
+	}
+
+	if( ext == ".png" )
+	{
+		return IMG_INIT_PNG;
+	}
+	if( ext == ".jpg" || ext == ".jpeg" )
+	{
+		return IMG_INIT_JPG;
+	}
+
+	return 0;
+}
+
+#endif
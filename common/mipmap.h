@@ -0,0 +1,246 @@
+/*Mip chains for textures drawn smaller than their size.
+
+SDL's renderers sample a minified texture straight from the full size image, so a 640x480 texture drawn at 32x24 reads
+(and on the software renderer, touches) far more texels than it shows and aliases. buildMipChain halves a 32-bit surface
+repeatedly down to 1x1 with a 2x2 box filter, four output pixels at a time with SSE2 when available. createMipTexture
+uploads every level as its own texture and renderCopyMip picks the level from the destination rect: the smallest one that
+is still at least as big as the destination, so linear filtering never has to cover more than a 2x reduction.
+The filter averages channels as stored, so sources with alpha should be premultiplied first (see alpha_blend.h).
+*/
+
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <vector>
+#if defined( __SSE2__ ) || defined( _M_X64 )
+#include <emmintrin.h>
+#define MIPMAP_SSE2 1
+#endif
+
+//Halves one row pair of a 32-bit image, out[ x ] averages in0[ 2x ], in0[ 2x + 1 ], in1[ 2x ] and in1[ 2x + 1 ] (clamped at the right edge)
+inline void downsampleRow( const Uint32* in0, const Uint32* in1, int inWidth, Uint32* out, int outWidth )
+{
+	int x = 0;
+
+#ifdef MIPMAP_SSE2
+	//Four output pixels from eight input pixels of each row, only where the pairs are all inside the row
+	__m128i zero = _mm_setzero_si128();
+	__m128i two = _mm_set1_epi16( 2 );
+	for( ; x + 4 <= outWidth && 2 * x + 8 <= inWidth; x += 4 )
+	{
+		__m128i a0 = _mm_loadu_si128( (const __m128i*)( in0 + 2 * x ) );
+		__m128i a1 = _mm_loadu_si128( (const __m128i*)( in0 + 2 * x + 4 ) );
+		__m128i b0 = _mm_loadu_si128( (const __m128i*)( in1 + 2 * x ) );
+		__m128i b1 = _mm_loadu_si128( (const __m128i*)( in1 + 2 * x + 4 ) );
+
+		//Vertical sums, two pixels per register in 16-bit channels
+		__m128i p01 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ), _mm_unpacklo_epi8( b0, zero ) );
+		__m128i p23 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ), _mm_unpackhi_epi8( b0, zero ) );
+		__m128i p45 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ), _mm_unpacklo_epi8( b1, zero ) );
+		__m128i p67 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ), _mm_unpackhi_epi8( b1, zero ) );
+
+		//Horizontal pair sums, then the rounded divide by 4
+		__m128i s0123 = _mm_add_epi16( _mm_unpacklo_epi64( p01, p23 ), _mm_unpackhi_epi64( p01, p23 ) );
+		__m128i s4567 = _mm_add_epi16( _mm_unpacklo_epi64( p45, p67 ), _mm_unpackhi_epi64( p45, p67 ) );
+		s0123 = _mm_srli_epi16( _mm_add_epi16( s0123, two ), 2 );
+		s4567 = _mm_srli_epi16( _mm_add_epi16( s4567, two ), 2 );
+
+		_mm_storeu_si128( (__m128i*)( out + x ), _mm_packus_epi16( s0123, s4567 ) );
+	}
+#endif
+
+	for( ; x < outWidth; ++x )
+	{
+		int left = SDL_min( 2 * x, inWidth - 1 );
+		int right = SDL_min( 2 * x + 1, inWidth - 1 );
+		Uint32 pixel = 0;
+		for( int shift = 0; shift < 32; shift += 8 )
+		{
+			Uint32 sum = ( ( in0[ left ] >> shift ) & 0xFF ) + ( ( in0[ right ] >> shift ) & 0xFF ) + ( ( in1[ left ] >> shift ) & 0xFF ) + ( ( in1[ right ] >> shift ) & 0xFF );
+			pixel |= ( ( sum + 2 ) >> 2 ) << shift;
+		}
+		out[ x ] = pixel;
+	}
+}
+
+//Makes a surface half the size of a 32-bit surface (at least 1x1) in the same format
+inline SDL_Surface* downsampleSurface( SDL_Surface* surface )
+{
+	int width = SDL_max( 1, surface->w / 2 );
+	int height = SDL_max( 1, surface->h / 2 );
+	SDL_Surface* half = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, surface->format->format );
+	if( half == NULL )
+	{
+		return NULL;
+	}
+
+	if( SDL_MUSTLOCK( surface ) )
+	{
+		SDL_LockSurface( surface );
+	}
+	for( int y = 0; y < height; ++y )
+	{
+		const Uint32* in0 = (const Uint32*)( (const Uint8*)surface->pixels + SDL_min( 2 * y, surface->h - 1 ) * surface->pitch );
+		const Uint32* in1 = (const Uint32*)( (const Uint8*)surface->pixels + SDL_min( 2 * y + 1, surface->h - 1 ) * surface->pitch );
+		downsampleRow( in0, in1, surface->w, (Uint32*)( (Uint8*)half->pixels + y * half->pitch ), width );
+	}
+	if( SDL_MUSTLOCK( surface ) )
+	{
+		SDL_UnlockSurface( surface );
+	}
+
+	return half;
+}
+
+//Builds the smaller levels of a 32-bit surface, levels[ 0 ] is half size and the last is 1x1. The caller frees them
+inline bool buildMipChain( SDL_Surface* surface, std::vector<SDL_Surface*>& levels )
+{
+	levels.clear();
+	if( surface == NULL || surface->format->BytesPerPixel != 4 )
+	{
+		SDL_SetError( "Mip chains need a 32-bit surface" );
+		return false;
+	}
+
+	SDL_Surface* level = surface;
+	while( level->w > 1 || level->h > 1 )
+	{
+		level = downsampleSurface( level );
+		if( level == NULL )
+		{
+			for( size_t i = 0; i < levels.size(); ++i )
+			{
+				SDL_FreeSurface( levels[ i ] );
+			}
+			levels.clear();
+			return false;
+		}
+		levels.push_back( level );
+	}
+
+	return true;
+}
+
+//A texture and its smaller levels, levels[ 0 ] is the full size texture
+struct MipTexture
+{
+	std::vector<SDL_Texture*> levels;
+	int width;
+	int height;
+};
+
+//Uploads a surface and its mip chain, returns false (with nothing left allocated) on failure
+inline bool createMipTexture( SDL_Renderer* renderer, SDL_Surface* surface, MipTexture& mip )
+{
+	mip.levels.clear();
+	mip.width = surface->w;
+	mip.height = surface->h;
+
+	std::vector<SDL_Surface*> chain;
+	if( !buildMipChain( surface, chain ) )
+	{
+		return false;
+	}
+
+	bool success = true;
+	for( int i = -1; i < (int)chain.size() && success; ++i )
+	{
+		SDL_Texture* texture = SDL_CreateTextureFromSurface( renderer, i < 0 ? surface : chain[ i ] );
+		if( texture == NULL )
+		{
+			success = false;
+		}
+		else
+		{
+			mip.levels.push_back( texture );
+		}
+	}
+	for( size_t i = 0; i < chain.size(); ++i )
+	{
+		SDL_FreeSurface( chain[ i ] );
+	}
+
+	if( !success )
+	{
+		for( size_t i = 0; i < mip.levels.size(); ++i )
+		{
+			SDL_DestroyTexture( mip.levels[ i ] );
+		}
+		mip.levels.clear();
+	}
+
+	return success;
+}
+
+inline void destroyMipTexture( MipTexture& mip )
+{
+	for( size_t i = 0; i < mip.levels.size(); ++i )
+	{
+		SDL_DestroyTexture( mip.levels[ i ] );
+	}
+	mip.levels.clear();
+}
+
+//Applies blend mode and alpha/color mod to every level
+inline void setMipTextureBlendMode( MipTexture& mip, SDL_BlendMode blendMode )
+{
+	for( size_t i = 0; i < mip.levels.size(); ++i )
+	{
+		SDL_SetTextureBlendMode( mip.levels[ i ], blendMode );
+	}
+}
+
+inline void setMipTextureColorMod( MipTexture& mip, Uint8 r, Uint8 g, Uint8 b )
+{
+	for( size_t i = 0; i < mip.levels.size(); ++i )
+	{
+		SDL_SetTextureColorMod( mip.levels[ i ], r, g, b );
+	}
+}
+
+inline void setMipTextureAlphaMod( MipTexture& mip, Uint8 alpha )
+{
+	for( size_t i = 0; i < mip.levels.size(); ++i )
+	{
+		SDL_SetTextureAlphaMod( mip.levels[ i ], alpha );
+	}
+}
+
+//Level to sample for drawing a srcWidth x srcHeight area of the full texture at dstWidth x dstHeight
+inline int selectMipLevel( const MipTexture& mip, float srcWidth, float srcHeight, float dstWidth, float dstHeight )
+{
+	if( mip.levels.empty() || dstWidth <= 0.0f || dstHeight <= 0.0f )
+	{
+		return 0;
+	}
+
+	//The less minified axis decides, so neither axis ends up smaller than its destination
+	float ratio = SDL_min( srcWidth / dstWidth, srcHeight / dstHeight );
+	int level = ratio > 1.0f ? (int)floorf( log2f( ratio ) ) : 0;
+	return SDL_min( level, (int)mip.levels.size() - 1 );
+}
+
+//SDL_RenderCopyEx from the level matching the destination size
+inline int renderCopyMip( SDL_Renderer* renderer, const MipTexture& mip, const SDL_Rect* srcRect, const SDL_Rect* dstRect, SDL_RendererFlip flip = SDL_FLIP_NONE )
+{
+	if( mip.levels.empty() )
+	{
+		return SDL_SetError( "renderCopyMip: empty mip texture" );
+	}
+
+	SDL_Rect full = { 0, 0, mip.width, mip.height };
+	const SDL_Rect* area = srcRect != NULL ? srcRect : &full;
+	int level = 0;
+	if( dstRect != NULL )
+	{
+		level = selectMipLevel( mip, (float)area->w, (float)area->h, (float)dstRect->w, (float)dstRect->h );
+	}
+
+	//The source rect shrinks with the level, never to nothing
+	SDL_Rect levelRect = { area->x >> level, area->y >> level, SDL_max( 1, area->w >> level ), SDL_max( 1, area->h >> level ) };
+	return SDL_RenderCopyEx( renderer, mip.levels[ level ], &levelRect, dstRect, 0.0, NULL, flip );
+}
+
+#endif
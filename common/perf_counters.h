@@ -0,0 +1,310 @@
+/*Hardware performance counters around regions of code, read through Linux's perf_event_open.
+
+A frame or blit time says how long something took, not why. The counters say: cycles against instructions gives the
+instructions per cycle, and a blit running well under one instruction a cycle with many cache and TLB misses per thousand
+instructions is waiting on memory, while one running near the core's width is compute bound. openPerfCounters opens
+cycles, instructions, L1 data and last level cache read misses, branch misses and data TLB read misses for the calling
+thread, user space only, which perf_event_paranoid's default of 2 allows. Each counter is opened on its own, so a CPU or
+VM without one of them still gets the rest (the missing one is null in the JSON), and where none can be opened
+(containers usually block perf_event_open, and only Linux has it) nothing is an error: the PerfCounters has nothing open,
+one line says why and the regions record nothing.
+A PerfRegion collects what the counters went up by between beginPerfRegion and endPerfRegion, totals over every call
+and each call's own counts for the first PERF_MAX_SAMPLES calls. Regions can nest, the counters run free and a region only
+reads them. Only the calling thread is counted, so work handed to other threads (fillSurface's, decode jobs) is not in
+the numbers. When more counters are open than the core has registers the kernel takes turns with them and the counts
+are scaled up from the time each was counting. Reading the counters costs a few system calls, which is noise around a
+frame but not around a tiny blit: keep per call regions around calls that take at least some microseconds.
+*/
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <cmath>
+#include "bench_report.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//What is counted
+enum PerfCounter
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_COUNTER_TOTAL
+};
+
+inline const char* perfCounterName( PerfCounter counter )
+{
+	switch( counter )
+	{
+		case PERF_CYCLES: return "cycles";
+		case PERF_INSTRUCTIONS: return "instructions";
+		case PERF_L1D_MISSES: return "l1d_misses";
+		case PERF_LLC_MISSES: return "llc_misses";
+		case PERF_BRANCH_MISSES: return "branch_misses";
+		case PERF_DTLB_MISSES: return "dtlb_misses";
+		default: return "unknown";
+	}
+}
+
+//Most calls a region keeps its own counts for, the totals take every call
+const size_t PERF_MAX_SAMPLES = 10000;
+
+struct PerfCounters
+{
+	//One file descriptor per counter, -1 where it couldn't be opened
+	int fds[ PERF_COUNTER_TOTAL ];
+	int opened;
+
+	//Why no counter opened, empty when some did
+	std::string unavailable;
+};
+
+struct PerfRegion
+{
+	std::string name;
+	long long calls;
+
+	//Counts over every call and per call, NAN for counters that aren't open
+	double totals[ PERF_COUNTER_TOTAL ];
+	std::vector<double> samples[ PERF_COUNTER_TOTAL ];
+
+	//Counter values at beginPerfRegion
+	bool running;
+	double start[ PERF_COUNTER_TOTAL ];
+};
+
+#ifdef __linux__
+//Sets the perf event type and config of a counter
+inline void setPerfCounterEvent( PerfCounter counter, perf_event_attr& attr )
+{
+	const Uint64 readMiss = ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+	switch( counter )
+	{
+		case PERF_CYCLES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+		case PERF_INSTRUCTIONS: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+		case PERF_L1D_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_L1D | readMiss; break;
+		case PERF_LLC_MISSES: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_LL | readMiss; break;
+		case PERF_BRANCH_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+		default: attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_DTLB | readMiss; break;
+	}
+}
+#endif
+
+//Opens every counter it can for the calling thread, prints why if none could be opened
+inline bool openPerfCounters( PerfCounters& counters )
+{
+	counters = PerfCounters();
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		counters.fds[ i ] = -1;
+	}
+
+#ifdef __linux__
+	int error = 0;
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		perf_event_attr attr;
+		memset( &attr, 0, sizeof( attr ) );
+		attr.size = sizeof( attr );
+		setPerfCounterEvent( (PerfCounter)i, attr );
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		int fd = (int)syscall( __NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC );
+		if( fd < 0 )
+		{
+			error = error != 0 ? error : errno;
+			continue;
+		}
+		counters.fds[ i ] = fd;
+		++counters.opened;
+	}
+
+	if( counters.opened == 0 )
+	{
+		if( error == EACCES || error == EPERM )
+		{
+			counters.unavailable = "not permitted (see /proc/sys/kernel/perf_event_paranoid, containers usually block it)";
+		}
+		else if( error == ENOENT || error == EOPNOTSUPP )
+		{
+			counters.unavailable = "no hardware counters on this CPU or VM";
+		}
+		else
+		{
+			counters.unavailable = strerror( error );
+		}
+	}
+#else
+	counters.unavailable = "perf_event_open is Linux only";
+#endif
+
+	if( counters.opened == 0 )
+	{
+		printf( "Performance counters unavailable: %s\n", counters.unavailable.c_str() );
+	}
+
+	return counters.opened > 0;
+}
+
+//Closes what openPerfCounters opened, does nothing for counters that were never opened
+inline void closePerfCounters( PerfCounters& counters )
+{
+	if( counters.opened == 0 )
+	{
+		return;
+	}
+
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+#ifdef __linux__
+		if( counters.fds[ i ] >= 0 )
+		{
+			::close( counters.fds[ i ] );
+		}
+#endif
+		counters.fds[ i ] = -1;
+	}
+	counters.opened = 0;
+}
+
+//Current counter values, scaled up for time the kernel had them switched out, NAN where not open
+inline void readPerfCounters( const PerfCounters& counters, double values[ PERF_COUNTER_TOTAL ] )
+{
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		values[ i ] = NAN;
+#ifdef __linux__
+		//Value, time enabled and time running
+		Uint64 count[ 3 ];
+		if( counters.fds[ i ] >= 0 && read( counters.fds[ i ], count, sizeof( count ) ) == (ssize_t)sizeof( count ) )
+		{
+			values[ i ] = count[ 2 ] > 0 && count[ 2 ] < count[ 1 ] ? (double)count[ 0 ] * count[ 1 ] / count[ 2 ] : (double)count[ 0 ];
+		}
+#endif
+	}
+}
+
+inline void initPerfRegion( PerfRegion& region, std::string name )
+{
+	region = PerfRegion();
+	region.name = name;
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		region.totals[ i ] = NAN;
+	}
+}
+
+inline void beginPerfRegion( const PerfCounters& counters, PerfRegion& region )
+{
+	if( counters.opened == 0 )
+	{
+		return;
+	}
+
+	readPerfCounters( counters, region.start );
+	region.running = true;
+}
+
+//Adds what the counters went up by since beginPerfRegion as one call
+inline void endPerfRegion( const PerfCounters& counters, PerfRegion& region )
+{
+	if( !region.running )
+	{
+		return;
+	}
+
+	double end[ PERF_COUNTER_TOTAL ];
+	readPerfCounters( counters, end );
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		double delta = end[ i ] - region.start[ i ];
+		region.totals[ i ] = region.calls == 0 ? delta : region.totals[ i ] + delta;
+		if( region.samples[ i ].size() < PERF_MAX_SAMPLES )
+		{
+			region.samples[ i ].push_back( delta );
+		}
+	}
+	++region.calls;
+	region.running = false;
+}
+
+//Count per call, and per thousand instructions for misses
+inline double perfPerCall( const PerfRegion& region, PerfCounter counter )
+{
+	return region.calls > 0 ? region.totals[ counter ] / region.calls : NAN;
+}
+
+inline double perfPerKiloInstruction( const PerfRegion& region, PerfCounter counter )
+{
+	return region.totals[ PERF_INSTRUCTIONS ] > 0.0 ? region.totals[ counter ] * 1000.0 / region.totals[ PERF_INSTRUCTIONS ] : NAN;
+}
+
+//Adds a region's aggregates as metrics and its per call counts as series
+inline void addPerfMetrics( BenchResult& result, const PerfRegion& region )
+{
+	if( region.calls == 0 )
+	{
+		return;
+	}
+
+	result.metrics.push_back( std::make_pair( "perf_calls", (double)region.calls ) );
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		result.metrics.push_back( std::make_pair( std::string( perfCounterName( (PerfCounter)i ) ) + "_per_call", perfPerCall( region, (PerfCounter)i ) ) );
+	}
+	result.metrics.push_back( std::make_pair( "ipc", region.totals[ PERF_CYCLES ] > 0.0 ? region.totals[ PERF_INSTRUCTIONS ] / region.totals[ PERF_CYCLES ] : NAN ) );
+	for( int i = PERF_L1D_MISSES; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		result.metrics.push_back( std::make_pair( std::string( perfCounterName( (PerfCounter)i ) ) + "_pki", perfPerKiloInstruction( region, (PerfCounter)i ) ) );
+	}
+
+	for( int i = 0; i < PERF_COUNTER_TOTAL; ++i )
+	{
+		result.series.push_back( std::make_pair( perfCounterName( (PerfCounter)i ), region.samples[ i ] ) );
+	}
+}
+
+//A result of its own for a region, for reports that have nothing else to put it in
+inline void addPerfRegionResult( BenchReport& report, const PerfCounters& counters, const PerfRegion& region )
+{
+	BenchResult result;
+	result.name = "perf_region";
+	result.params.push_back( std::make_pair( "region", region.name ) );
+	result.params.push_back( std::make_pair( "counters", std::to_string( counters.opened ) + " of " + std::to_string( (int)PERF_COUNTER_TOTAL ) ) );
+	addPerfMetrics( result, region );
+	report.results.push_back( result );
+}
+
+//Prints a region's counts per call, instructions per cycle and misses per thousand instructions
+inline void printPerfRegion( const PerfRegion& region )
+{
+	if( region.calls == 0 )
+	{
+		return;
+	}
+
+	printf( "%s counters per call over %lld calls: %.0f cycles, %.0f instructions, IPC %.2f\n", region.name.c_str(), region.calls,
+		perfPerCall( region, PERF_CYCLES ), perfPerCall( region, PERF_INSTRUCTIONS ),
+		region.totals[ PERF_INSTRUCTIONS ] / region.totals[ PERF_CYCLES ] );
+	printf( "  misses per 1000 instructions: L1D %.2f, LLC %.2f, branch %.2f, dTLB %.2f\n", perfPerKiloInstruction( region, PERF_L1D_MISSES ),
+		perfPerKiloInstruction( region, PERF_LLC_MISSES ), perfPerKiloInstruction( region, PERF_BRANCH_MISSES ),
+		perfPerKiloInstruction( region, PERF_DTLB_MISSES ) );
+}
+
+#endif
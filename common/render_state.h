@@ -0,0 +1,273 @@
+/*Renderer state cache that skips state calls which wouldn't change anything.
+
+Drawing code tends to set every piece of state a draw needs right before it, whatever the last draw left behind: 08's
+entity frame sets its colors every frame, and a real scene sets blend mode, color and alpha mod on a texture and the
+viewport and clip rect for its panel before every sprite. Sorted draws mostly set what is already set. A RenderStateCache
+shadows that state, renderer wide (draw color, draw blend mode, viewport, clip rect) and per texture (blend mode, color and
+alpha mod), and the cached* calls only reach SDL when the value differs from the shadow. SDL itself only stores most of
+these and already leaves repeated viewport and clip rects out of its command queue, so a skipped call saves a function
+call and SDL's checks rather than GPU work; the skipped counts mostly tell how much redundant state a frame carries.
+With caching off every call is passed straight through and still counted, so the same code gives the numbers for both.
+The shadow goes stale if anything sets state behind its back: SDL resets the viewport when the window or logical size
+changes, so call invalidateRenderState then, and forgetTextureState before destroying a texture.
+*/
+
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <map>
+
+//The state calls the cache stands in for
+enum RenderStateCall
+{
+	RENDER_STATE_DRAW_COLOR,
+	RENDER_STATE_DRAW_BLEND,
+	RENDER_STATE_VIEWPORT,
+	RENDER_STATE_CLIP_RECT,
+	RENDER_STATE_TEXTURE_BLEND,
+	RENDER_STATE_TEXTURE_COLOR,
+	RENDER_STATE_TEXTURE_ALPHA,
+	RENDER_STATE_TOTAL
+};
+
+inline const char* renderStateCallName( RenderStateCall call )
+{
+	switch( call )
+	{
+		case RENDER_STATE_DRAW_COLOR: return "SDL_SetRenderDrawColor";
+		case RENDER_STATE_DRAW_BLEND: return "SDL_SetRenderDrawBlendMode";
+		case RENDER_STATE_VIEWPORT: return "SDL_RenderSetViewport";
+		case RENDER_STATE_CLIP_RECT: return "SDL_RenderSetClipRect";
+		case RENDER_STATE_TEXTURE_BLEND: return "SDL_SetTextureBlendMode";
+		case RENDER_STATE_TEXTURE_COLOR: return "SDL_SetTextureColorMod";
+		case RENDER_STATE_TEXTURE_ALPHA: return "SDL_SetTextureAlphaMod";
+		default: return "unknown";
+	}
+}
+
+//A texture's shadowed state, each part unknown until first set through the cache
+struct TextureRenderState
+{
+	bool blendKnown;
+	SDL_BlendMode blend;
+	bool colorKnown;
+	Uint8 r, g, b;
+	bool alphaKnown;
+	Uint8 alpha;
+};
+
+struct RenderStateCache
+{
+	SDL_Renderer* renderer;
+
+	//Skip redundant calls, otherwise only count them
+	bool enabled;
+
+	//Renderer state, each part unknown until first set through the cache
+	bool drawColorKnown;
+	Uint8 drawColor[ 4 ];
+	bool drawBlendKnown;
+	SDL_BlendMode drawBlend;
+	bool viewportKnown;
+	bool viewportFull;
+	SDL_Rect viewport;
+	bool clipKnown;
+	bool clipEnabled;
+	SDL_Rect clip;
+
+	std::map<SDL_Texture*, TextureRenderState> textures;
+
+	//Calls made and skipped this frame and over every finished frame
+	long long frameIssued[ RENDER_STATE_TOTAL ];
+	long long frameSkipped[ RENDER_STATE_TOTAL ];
+	long long issued[ RENDER_STATE_TOTAL ];
+	long long skipped[ RENDER_STATE_TOTAL ];
+	int frames;
+};
+
+//Forgets all shadowed state, the next call of each kind goes to SDL
+inline void invalidateRenderState( RenderStateCache& cache )
+{
+	cache.drawColorKnown = false;
+	cache.drawBlendKnown = false;
+	cache.viewportKnown = false;
+	cache.clipKnown = false;
+	cache.textures.clear();
+}
+
+inline void initRenderStateCache( RenderStateCache& cache, SDL_Renderer* renderer, bool enabled )
+{
+	cache = RenderStateCache();
+	cache.renderer = renderer;
+	cache.enabled = enabled;
+	invalidateRenderState( cache );
+}
+
+//Forgets a texture's state, call before destroying it so a new texture at the same address starts unknown
+inline void forgetTextureState( RenderStateCache& cache, SDL_Texture* texture )
+{
+	cache.textures.erase( texture );
+}
+
+//Counts a call and returns whether it has to go to SDL
+inline bool renderStateChanged( RenderStateCache& cache, RenderStateCall call, bool changed )
+{
+	if( changed || !cache.enabled )
+	{
+		++cache.frameIssued[ call ];
+		return true;
+	}
+
+	++cache.frameSkipped[ call ];
+	return false;
+}
+
+inline int cachedSetDrawColor( RenderStateCache& cache, Uint8 r, Uint8 g, Uint8 b, Uint8 a )
+{
+	bool changed = !cache.drawColorKnown || cache.drawColor[ 0 ] != r || cache.drawColor[ 1 ] != g || cache.drawColor[ 2 ] != b || cache.drawColor[ 3 ] != a;
+	if( !renderStateChanged( cache, RENDER_STATE_DRAW_COLOR, changed ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_SetRenderDrawColor( cache.renderer, r, g, b, a );
+	cache.drawColorKnown = result == 0;
+	cache.drawColor[ 0 ] = r;
+	cache.drawColor[ 1 ] = g;
+	cache.drawColor[ 2 ] = b;
+	cache.drawColor[ 3 ] = a;
+	return result;
+}
+
+inline int cachedSetDrawBlendMode( RenderStateCache& cache, SDL_BlendMode mode )
+{
+	if( !renderStateChanged( cache, RENDER_STATE_DRAW_BLEND, !cache.drawBlendKnown || cache.drawBlend != mode ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_SetRenderDrawBlendMode( cache.renderer, mode );
+	cache.drawBlendKnown = result == 0;
+	cache.drawBlend = mode;
+	return result;
+}
+
+//rect NULL for the whole target, like SDL_RenderSetViewport
+inline int cachedSetViewport( RenderStateCache& cache, const SDL_Rect* rect )
+{
+	bool changed = !cache.viewportKnown || cache.viewportFull != ( rect == NULL ) || ( rect != NULL && !SDL_RectEquals( rect, &cache.viewport ) );
+	if( !renderStateChanged( cache, RENDER_STATE_VIEWPORT, changed ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_RenderSetViewport( cache.renderer, rect );
+	cache.viewportKnown = result == 0;
+	cache.viewportFull = rect == NULL;
+	cache.viewport = rect != NULL ? *rect : SDL_Rect();
+	return result;
+}
+
+//rect NULL to turn clipping off, like SDL_RenderSetClipRect
+inline int cachedSetClipRect( RenderStateCache& cache, const SDL_Rect* rect )
+{
+	bool changed = !cache.clipKnown || cache.clipEnabled != ( rect != NULL ) || ( rect != NULL && !SDL_RectEquals( rect, &cache.clip ) );
+	if( !renderStateChanged( cache, RENDER_STATE_CLIP_RECT, changed ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_RenderSetClipRect( cache.renderer, rect );
+	cache.clipKnown = result == 0;
+	cache.clipEnabled = rect != NULL;
+	cache.clip = rect != NULL ? *rect : SDL_Rect();
+	return result;
+}
+
+inline int cachedSetTextureBlendMode( RenderStateCache& cache, SDL_Texture* texture, SDL_BlendMode mode )
+{
+	TextureRenderState& state = cache.textures[ texture ];
+	if( !renderStateChanged( cache, RENDER_STATE_TEXTURE_BLEND, !state.blendKnown || state.blend != mode ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_SetTextureBlendMode( texture, mode );
+	state.blendKnown = result == 0;
+	state.blend = mode;
+	return result;
+}
+
+inline int cachedSetTextureColorMod( RenderStateCache& cache, SDL_Texture* texture, Uint8 r, Uint8 g, Uint8 b )
+{
+	TextureRenderState& state = cache.textures[ texture ];
+	bool changed = !state.colorKnown || state.r != r || state.g != g || state.b != b;
+	if( !renderStateChanged( cache, RENDER_STATE_TEXTURE_COLOR, changed ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_SetTextureColorMod( texture, r, g, b );
+	state.colorKnown = result == 0;
+	state.r = r;
+	state.g = g;
+	state.b = b;
+	return result;
+}
+
+inline int cachedSetTextureAlphaMod( RenderStateCache& cache, SDL_Texture* texture, Uint8 alpha )
+{
+	TextureRenderState& state = cache.textures[ texture ];
+	if( !renderStateChanged( cache, RENDER_STATE_TEXTURE_ALPHA, !state.alphaKnown || state.alpha != alpha ) )
+	{
+		return 0;
+	}
+
+	int result = SDL_SetTextureAlphaMod( texture, alpha );
+	state.alphaKnown = result == 0;
+	state.alpha = alpha;
+	return result;
+}
+
+//Adds this frame's counts to the totals and starts the next frame
+inline void endRenderStateFrame( RenderStateCache& cache )
+{
+	for( int i = 0; i < RENDER_STATE_TOTAL; ++i )
+	{
+		cache.issued[ i ] += cache.frameIssued[ i ];
+		cache.skipped[ i ] += cache.frameSkipped[ i ];
+		cache.frameIssued[ i ] = 0;
+		cache.frameSkipped[ i ] = 0;
+	}
+	++cache.frames;
+}
+
+//Prints issued and skipped calls per frame for each kind of call made
+inline void printRenderStateReport( const RenderStateCache& cache, const char* title )
+{
+	if( cache.frames == 0 )
+	{
+		return;
+	}
+
+	long long issued = 0;
+	long long skipped = 0;
+	printf( "%s render state calls per frame over %d frames (%s):\n", title, cache.frames, cache.enabled ? "cached" : "not cached" );
+	for( int i = 0; i < RENDER_STATE_TOTAL; ++i )
+	{
+		if( cache.issued[ i ] + cache.skipped[ i ] == 0 )
+		{
+			continue;
+		}
+		printf( "  %-28s %10.1f issued %10.1f skipped\n", renderStateCallName( (RenderStateCall)i ), (double)cache.issued[ i ] / cache.frames,
+			(double)cache.skipped[ i ] / cache.frames );
+		issued += cache.issued[ i ];
+		skipped += cache.skipped[ i ];
+	}
+	printf( "  %-28s %10.1f issued %10.1f skipped (%.1f%% skipped)\n", "all", (double)issued / cache.frames, (double)skipped / cache.frames,
+		issued + skipped > 0 ? 100.0 * skipped / ( issued + skipped ) : 0.0 );
+}
+
+#endif
@@ -0,0 +1,302 @@
+/*Picks the fastest working render backend and remembers it.
+
+SDL_CreateRenderer( window, -1, SDL_RENDERER_ACCELERATED ) takes whatever SDL tries first, which on a machine without a GPU
+either fails outright or lands on something slow. createProbedRenderer instead tries every backend SDL_GetRenderDriverInfo
+lists on a hidden window (software, and OpenGL/GLES through Mesa's llvmpipe when it's installed), runs a short fill and copy
+benchmark into an offscreen target and keeps the fastest. The choice and its texture formats go into renderer.cfg (or
+$RENDERER_CONFIG) and later starts create that backend directly without probing. Set RENDERER_REPROBE=1 to probe again.
+*/
+
+#ifndef RENDERER_PROBE_H
+#define RENDERER_PROBE_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+//Size of the offscreen probe target
+const int PROBE_TARGET_WIDTH = 640;
+const int PROBE_TARGET_HEIGHT = 480;
+
+//Frames drawn per backend, after a few untimed warmup frames
+const int PROBE_WARMUP_FRAMES = 5;
+const int PROBE_FRAMES = 30;
+
+//What a probe or the config file says about a backend
+struct RendererChoice
+{
+	std::string driver;
+	std::string videoDriver;
+	std::vector<std::string> textureFormats;
+	double frameMs;
+};
+
+//Where the choice is kept
+inline std::string rendererConfigPath()
+{
+	const char* path = getenv( "RENDERER_CONFIG" );
+	return path != NULL && path[ 0 ] != '\0' ? path : "renderer.cfg";
+}
+
+//Index of a render driver by name, -1 if this SDL doesn't have it
+inline int findRenderDriver( std::string name )
+{
+	for( int i = 0; i < SDL_GetNumRenderDrivers(); ++i )
+	{
+		SDL_RendererInfo info;
+		if( SDL_GetRenderDriverInfo( i, &info ) == 0 && name == info.name )
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+//Reads a saved choice, returns false if there isn't a usable one
+inline bool readRendererChoice( RendererChoice& choice )
+{
+	FILE* file = fopen( rendererConfigPath().c_str(), "r" );
+	if( file == NULL )
+	{
+		return false;
+	}
+
+	choice = RendererChoice();
+	choice.frameMs = 0.0;
+
+	char line[ 1024 ];
+	while( fgets( line, sizeof( line ), file ) != NULL )
+	{
+		std::string text = line;
+		while( !text.empty() && ( text.back() == '\n' || text.back() == '\r' ) )
+		{
+			text.pop_back();
+		}
+
+		size_t equals = text.find( '=' );
+		if( text.empty() || text[ 0 ] == '#' || equals == std::string::npos )
+		{
+			continue;
+		}
+
+		std::string key = text.substr( 0, equals );
+		std::string value = text.substr( equals + 1 );
+		if( key == "driver" )
+		{
+			choice.driver = value;
+		}
+		else if( key == "video_driver" )
+		{
+			choice.videoDriver = value;
+		}
+		else if( key == "frame_ms" )
+		{
+			choice.frameMs = atof( value.c_str() );
+		}
+		else if( key == "texture_formats" )
+		{
+			size_t start = 0;
+			while( start < value.size() )
+			{
+				size_t comma = value.find( ',', start );
+				if( comma == std::string::npos )
+				{
+					comma = value.size();
+				}
+				choice.textureFormats.push_back( value.substr( start, comma - start ) );
+				start = comma + 1;
+			}
+		}
+	}
+	fclose( file );
+
+	return !choice.driver.empty();
+}
+
+//Saves a choice for the next start
+inline bool writeRendererChoice( const RendererChoice& choice )
+{
+	FILE* file = fopen( rendererConfigPath().c_str(), "w" );
+	if( file == NULL )
+	{
+		printf( "Warning: Unable to save renderer choice to %s!\n", rendererConfigPath().c_str() );
+		return false;
+	}
+
+	fprintf( file, "# Written by the renderer probe, delete to probe again\n" );
+	fprintf( file, "driver=%s\n", choice.driver.c_str() );
+	fprintf( file, "video_driver=%s\n", choice.videoDriver.c_str() );
+	fprintf( file, "frame_ms=%.4f\n", choice.frameMs );
+	fprintf( file, "texture_formats=" );
+	for( size_t i = 0; i < choice.textureFormats.size(); ++i )
+	{
+		fprintf( file, "%s%s", i > 0 ? "," : "", choice.textureFormats[ i ].c_str() );
+	}
+	fprintf( file, "\n" );
+	fclose( file );
+
+	return true;
+}
+
+//Draws probe frames into an offscreen target, returns milliseconds per frame or a negative number if the backend can't
+inline double benchmarkRenderer( SDL_Renderer* renderer )
+{
+	SDL_Texture* target = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, PROBE_TARGET_WIDTH, PROBE_TARGET_HEIGHT );
+	SDL_Texture* sprite = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, 128, 128 );
+	if( target == NULL || sprite == NULL || SDL_SetRenderTarget( renderer, target ) != 0 )
+	{
+		SDL_DestroyTexture( target );
+		SDL_DestroyTexture( sprite );
+		return -1.0;
+	}
+
+	//Something to copy, a simple gradient with alpha
+	std::vector<Uint32> pixels( 128 * 128 );
+	for( int y = 0; y < 128; ++y )
+	{
+		for( int x = 0; x < 128; ++x )
+		{
+			pixels[ y * 128 + x ] = ( (Uint32)( ( x + y ) & 0xFF ) << 24 ) | ( (Uint32)( x * 2 ) << 16 ) | ( (Uint32)( y * 2 ) << 8 ) | 0x80;
+		}
+	}
+	SDL_UpdateTexture( sprite, NULL, pixels.data(), 128 * 4 );
+	SDL_SetTextureBlendMode( sprite, SDL_BLENDMODE_BLEND );
+
+	Uint64 start = 0;
+	for( int frame = 0; frame < PROBE_WARMUP_FRAMES + PROBE_FRAMES; ++frame )
+	{
+		if( frame == PROBE_WARMUP_FRAMES )
+		{
+			start = SDL_GetPerformanceCounter();
+		}
+
+		//Clear, a grid of fills and a grid of blended copies, roughly what the lessons do per frame
+		SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+		SDL_RenderClear( renderer );
+		for( int i = 0; i < 64; ++i )
+		{
+			SDL_Rect fillRect = { ( i % 8 ) * 80, ( i / 8 ) * 60, 70, 50 };
+			SDL_SetRenderDrawColor( renderer, i * 4, 0xFF - i * 4, 0x80, 0xFF );
+			SDL_RenderFillRect( renderer, &fillRect );
+		}
+		for( int i = 0; i < 64; ++i )
+		{
+			SDL_Rect copyRect = { ( i * 37 + frame * 3 ) % ( PROBE_TARGET_WIDTH - 128 ), ( i * 53 ) % ( PROBE_TARGET_HEIGHT - 128 ), 128, 128 };
+			SDL_RenderCopy( renderer, sprite, NULL, &copyRect );
+		}
+
+		//Reading a pixel back makes GPU backends actually finish the frame
+		Uint32 pixel;
+		SDL_Rect one = { 0, 0, 1, 1 };
+		SDL_RenderReadPixels( renderer, &one, SDL_PIXELFORMAT_ARGB8888, &pixel, 4 );
+	}
+	double frameMs = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency() / PROBE_FRAMES;
+
+	SDL_SetRenderTarget( renderer, NULL );
+	SDL_DestroyTexture( sprite );
+	SDL_DestroyTexture( target );
+
+	return frameMs;
+}
+
+//Tries every backend and returns the fastest, false if none work
+inline bool probeRenderers( RendererChoice& best )
+{
+	bool found = false;
+	best.frameMs = 0.0;
+
+	for( int i = 0; i < SDL_GetNumRenderDrivers(); ++i )
+	{
+		SDL_RendererInfo info;
+		if( SDL_GetRenderDriverInfo( i, &info ) != 0 )
+		{
+			continue;
+		}
+
+		//Each backend gets its own hidden window since GL backends recreate the window they're given
+		SDL_Window* window = SDL_CreateWindow( "Renderer probe", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, PROBE_TARGET_WIDTH, PROBE_TARGET_HEIGHT, SDL_WINDOW_HIDDEN );
+		SDL_Renderer* renderer = window != NULL ? SDL_CreateRenderer( window, i, 0 ) : NULL;
+		if( renderer == NULL )
+		{
+			printf( "Renderer probe: %-12s unavailable (%s)\n", info.name, SDL_GetError() );
+		}
+		else
+		{
+			double frameMs = benchmarkRenderer( renderer );
+			if( frameMs < 0.0 )
+			{
+				printf( "Renderer probe: %-12s no offscreen targets (%s)\n", info.name, SDL_GetError() );
+			}
+			else
+			{
+				printf( "Renderer probe: %-12s %8.3f ms/frame\n", info.name, frameMs );
+				if( !found || frameMs < best.frameMs )
+				{
+					//Keep the formats the created renderer reports, the driver list can be incomplete
+					SDL_RendererInfo created;
+					SDL_GetRendererInfo( renderer, &created );
+
+					best.driver = info.name;
+					best.frameMs = frameMs;
+					best.textureFormats.clear();
+					for( Uint32 f = 0; f < created.num_texture_formats; ++f )
+					{
+						best.textureFormats.push_back( SDL_GetPixelFormatName( created.texture_formats[ f ] ) );
+					}
+					found = true;
+				}
+			}
+			SDL_DestroyRenderer( renderer );
+		}
+		SDL_DestroyWindow( window );
+	}
+
+	const char* videoDriver = SDL_GetCurrentVideoDriver();
+	best.videoDriver = videoDriver != NULL ? videoDriver : "";
+
+	return found;
+}
+
+//Creates the window's renderer on the saved backend, probing first if there's no saved backend for this video driver
+inline SDL_Renderer* createProbedRenderer( SDL_Window* window )
+{
+	const char* videoDriver = SDL_GetCurrentVideoDriver();
+	std::string currentVideo = videoDriver != NULL ? videoDriver : "";
+	const char* reprobe = getenv( "RENDERER_REPROBE" );
+
+	//Use the saved choice if it was made for this video driver and still works
+	RendererChoice choice;
+	if( ( reprobe == NULL || atoi( reprobe ) == 0 ) && readRendererChoice( choice ) && choice.videoDriver == currentVideo )
+	{
+		int index = findRenderDriver( choice.driver );
+		SDL_Renderer* renderer = index >= 0 ? SDL_CreateRenderer( window, index, 0 ) : NULL;
+		if( renderer != NULL )
+		{
+			printf( "Using saved %s renderer (%.3f ms/frame when probed)\n", choice.driver.c_str(), choice.frameMs );
+			return renderer;
+		}
+		printf( "Saved %s renderer no longer works, probing again\n", choice.driver.c_str() );
+	}
+
+	//Probe and remember
+	if( probeRenderers( choice ) )
+	{
+		SDL_Renderer* renderer = SDL_CreateRenderer( window, findRenderDriver( choice.driver ), 0 );
+		if( renderer != NULL )
+		{
+			writeRendererChoice( choice );
+			printf( "Picked %s renderer\n", choice.driver.c_str() );
+			return renderer;
+		}
+	}
+
+	//Nothing probed well, let SDL pick like before
+	printf( "Renderer probe found nothing usable, falling back to SDL's default\n" );
+	return SDL_CreateRenderer( window, -1, SDL_RENDERER_ACCELERATED );
+}
+
+#endif
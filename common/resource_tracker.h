@@ -0,0 +1,327 @@
+/*Memory accounting for surfaces and textures.
+
+SDL doesn't say how much memory a program's surfaces and textures take, so the lessons register each one as it is made:
+trackSurface and trackTexture record its format, size and bytes under an owner tag (the asset path, or what it's for),
+freeTrackedSurface and destroyTrackedTexture drop the record and free it. The tracker keeps the live and peak totals and
+printResourceReport lists the live resources grouped by format and size and by owner, along with the process's peak RSS.
+The report prints on exit and, after installResourceDumpSignal, whenever the process gets SIGUSR1 (checked once a frame
+by pollResourceDump, since a signal handler can't print).
+
+With a budget set, a resource that would take the total over it first makes the tracker call the lesson's evictor until
+there is room, and is freed with the load failing (NULL and an SDL error) if there still isn't.
+Texture bytes are what the pixels take in the texture's format, the driver's own copies and padding aren't visible to SDL.
+*/
+
+#ifndef RESOURCE_TRACKER_H
+#define RESOURCE_TRACKER_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <string>
+#include <map>
+#include <mutex>
+
+//Frees one resource to make room, returns false when there is nothing left it can free. Called without the tracker locked
+typedef bool ( *ResourceEvictor )();
+
+//One live surface or texture
+struct TrackedResource
+{
+	bool texture;
+	Uint32 format;
+	int width;
+	int height;
+	size_t bytes;
+	std::string owner;
+};
+
+//Everything tracked so far
+struct ResourceTracker
+{
+	std::mutex mutex;
+	std::map<const void*, TrackedResource> live;
+	std::string lesson;
+
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+
+	//0 for no budget
+	size_t budgetBytes = 0;
+	ResourceEvictor evictor = NULL;
+	int evictions = 0;
+	int refused = 0;
+};
+
+inline ResourceTracker& resourceTracker()
+{
+	static ResourceTracker tracker;
+	return tracker;
+}
+
+//Set by SIGUSR1, cleared by pollResourceDump
+inline volatile sig_atomic_t& resourceDumpRequested()
+{
+	static volatile sig_atomic_t requested = 0;
+	return requested;
+}
+
+//Names the lesson in the report
+inline void setResourceLesson( std::string lesson )
+{
+	resourceTracker().lesson = lesson;
+}
+
+//Caps live bytes, with an optional evictor to call before refusing a resource
+inline void setResourceBudget( size_t bytes, ResourceEvictor evictor = NULL )
+{
+	ResourceTracker& tracker = resourceTracker();
+	std::lock_guard<std::mutex> lock( tracker.mutex );
+	tracker.budgetBytes = bytes;
+	tracker.evictor = evictor;
+}
+
+//Bytes a width x height image takes in a format, planar YUV formats are 12 bits per pixel
+inline size_t resourceBytes( Uint32 format, int width, int height )
+{
+	if( SDL_ISPIXELFORMAT_FOURCC( format ) )
+	{
+		return (size_t)width * height * 3 / 2;
+	}
+
+	return (size_t)width * height * SDL_BYTESPERPIXEL( format );
+}
+
+//Format name without SDL's prefix
+inline const char* resourceFormatName( Uint32 format )
+{
+	const char* name = SDL_GetPixelFormatName( format );
+	return strncmp( name, "SDL_PIXELFORMAT_", 16 ) == 0 ? name + 16 : name;
+}
+
+//Records a resource, evicting or refusing it if it doesn't fit the budget
+inline bool trackResource( const void* handle, TrackedResource resource )
+{
+	ResourceTracker& tracker = resourceTracker();
+	std::unique_lock<std::mutex> lock( tracker.mutex );
+
+	//Make room, the evictor frees through the tracker so it has to run unlocked
+	while( tracker.budgetBytes > 0 && tracker.liveBytes + resource.bytes > tracker.budgetBytes && tracker.evictor != NULL )
+	{
+		ResourceEvictor evictor = tracker.evictor;
+		lock.unlock();
+		bool evicted = evictor();
+		lock.lock();
+		if( !evicted )
+		{
+			break;
+		}
+		++tracker.evictions;
+	}
+	if( tracker.budgetBytes > 0 && tracker.liveBytes + resource.bytes > tracker.budgetBytes )
+	{
+		++tracker.refused;
+		SDL_SetError( "%s (%zu bytes) doesn't fit the %zu byte memory budget, %zu bytes in use", resource.owner.c_str(), resource.bytes,
+			tracker.budgetBytes, tracker.liveBytes );
+		return false;
+	}
+
+	//A handle SDL reused after a free we didn't see replaces the old record
+	std::map<const void*, TrackedResource>::iterator old = tracker.live.find( handle );
+	if( old != tracker.live.end() )
+	{
+		tracker.liveBytes -= old->second.bytes;
+		tracker.live.erase( old );
+	}
+
+	tracker.live[ handle ] = resource;
+	tracker.liveBytes += resource.bytes;
+	tracker.peakBytes = SDL_max( tracker.peakBytes, tracker.liveBytes );
+	return true;
+}
+
+//Drops a resource's record, untracked handles are ignored
+inline void untrackResource( const void* handle )
+{
+	if( handle == NULL )
+	{
+		return;
+	}
+
+	ResourceTracker& tracker = resourceTracker();
+	std::lock_guard<std::mutex> lock( tracker.mutex );
+	std::map<const void*, TrackedResource>::iterator found = tracker.live.find( handle );
+	if( found != tracker.live.end() )
+	{
+		tracker.liveBytes -= found->second.bytes;
+		tracker.live.erase( found );
+	}
+}
+
+//Tracks a surface and returns it, or frees it (with release if it needs more than SDL_FreeSurface) and returns NULL
+//if it is over budget. bytes overrides what the pixels take, for surfaces SDL stores some other way. Passes NULL through
+inline SDL_Surface* trackSurface( SDL_Surface* surface, std::string owner, size_t bytes = 0, void ( *release )( SDL_Surface* ) = NULL )
+{
+	if( surface == NULL )
+	{
+		return NULL;
+	}
+
+	TrackedResource resource = { false, surface->format->format, surface->w, surface->h, bytes > 0 ? bytes : (size_t)surface->pitch * surface->h, owner };
+	if( !trackResource( surface, resource ) )
+	{
+		if( release != NULL )
+		{
+			release( surface );
+		}
+		else
+		{
+			SDL_FreeSurface( surface );
+		}
+		return NULL;
+	}
+
+	return surface;
+}
+
+//Tracks a texture and returns it, or destroys it and returns NULL if it is over budget. Passes NULL through
+inline SDL_Texture* trackTexture( SDL_Texture* texture, std::string owner )
+{
+	if( texture == NULL )
+	{
+		return NULL;
+	}
+
+	TrackedResource resource = { true, SDL_PIXELFORMAT_UNKNOWN, 0, 0, 0, owner };
+	SDL_QueryTexture( texture, &resource.format, NULL, &resource.width, &resource.height );
+	resource.bytes = resourceBytes( resource.format, resource.width, resource.height );
+	if( !trackResource( texture, resource ) )
+	{
+		SDL_DestroyTexture( texture );
+		return NULL;
+	}
+
+	return texture;
+}
+
+inline void freeTrackedSurface( SDL_Surface* surface )
+{
+	untrackResource( surface );
+	SDL_FreeSurface( surface );
+}
+
+inline void destroyTrackedTexture( SDL_Texture* texture )
+{
+	untrackResource( texture );
+	SDL_DestroyTexture( texture );
+}
+
+//Peak resident set size of the whole process in bytes, 0 where /proc isn't there
+inline size_t processPeakRSS()
+{
+	size_t kilobytes = 0;
+	FILE* status = fopen( "/proc/self/status", "r" );
+	if( status != NULL )
+	{
+		char line[ 256 ];
+		while( fgets( line, sizeof( line ), status ) != NULL )
+		{
+			if( sscanf( line, "VmHWM: %zu kB", &kilobytes ) == 1 )
+			{
+				break;
+			}
+		}
+		fclose( status );
+	}
+
+	return kilobytes * 1024;
+}
+
+//Prints the totals and the live resources grouped by format and size and by owner
+inline void printResourceReport()
+{
+	ResourceTracker& tracker = resourceTracker();
+	std::lock_guard<std::mutex> lock( tracker.mutex );
+	const double MB = 1024.0 * 1024.0;
+
+	printf( "%s resource memory: live %.2f MB in %d resources, peak %.2f MB", tracker.lesson.c_str(), tracker.liveBytes / MB,
+		(int)tracker.live.size(), tracker.peakBytes / MB );
+	if( tracker.budgetBytes > 0 )
+	{
+		printf( ", budget %.2f MB (%d evictions, %d refused)", tracker.budgetBytes / MB, tracker.evictions, tracker.refused );
+	}
+	size_t rss = processPeakRSS();
+	if( rss > 0 )
+	{
+		printf( ", process peak RSS %.2f MB", rss / MB );
+	}
+	printf( "\n" );
+
+	//Group by format and size, then by owner
+	struct Group
+	{
+		int count;
+		size_t bytes;
+	};
+	std::map<std::string, Group> byShape;
+	std::map<std::string, Group> byOwner;
+	for( std::map<const void*, TrackedResource>::const_iterator i = tracker.live.begin(); i != tracker.live.end(); ++i )
+	{
+		const TrackedResource& resource = i->second;
+		char shape[ 96 ];
+		SDL_snprintf( shape, sizeof( shape ), "%s %dx%d %s", resourceFormatName( resource.format ), resource.width, resource.height,
+			resource.texture ? "texture" : "surface" );
+
+		Group& shapeGroup = byShape[ shape ];
+		++shapeGroup.count;
+		shapeGroup.bytes += resource.bytes;
+		Group& ownerGroup = byOwner[ resource.owner ];
+		++ownerGroup.count;
+		ownerGroup.bytes += resource.bytes;
+	}
+
+	std::map<std::string, Group>* groups[ 2 ] = { &byShape, &byOwner };
+	const char* titles[ 2 ] = { "by format and size", "by owner" };
+	for( int g = 0; g < 2; ++g )
+	{
+		if( groups[ g ]->empty() )
+		{
+			continue;
+		}
+		printf( "  %s:\n", titles[ g ] );
+		for( std::map<std::string, Group>::const_iterator i = groups[ g ]->begin(); i != groups[ g ]->end(); ++i )
+		{
+			printf( "    %-40s %4d %10.2f MB\n", i->first.c_str(), i->second.count, i->second.bytes / MB );
+		}
+	}
+}
+
+#ifdef SIGUSR1
+inline void requestResourceDump( int signal )
+{
+	resourceDumpRequested() = 1;
+}
+
+//kill -USR1 <pid> asks for a report at the next pollResourceDump
+inline void installResourceDumpSignal()
+{
+	signal( SIGUSR1, requestResourceDump );
+}
+#else
+inline void installResourceDumpSignal()
+{
+}
+#endif
+
+//Prints the report if a signal asked for one, call once a frame
+inline void pollResourceDump()
+{
+	if( resourceDumpRequested() )
+	{
+		resourceDumpRequested() = 0;
+		printResourceReport();
+	}
+}
+
+#endif
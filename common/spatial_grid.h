@@ -0,0 +1,243 @@
+/*Uniform grid over 2D rects for culling and picking.
+
+The bounds are split into square cells and every item is listed in each cell its rect touches, so a view or point query
+only looks at the items in the cells it covers instead of at every item. Items are identified by caller chosen ids
+(entity indices) and can be inserted, moved and removed one at a time. A move that stays in the same cells only updates
+the stored rect. Items outside the bounds are kept in the edge cells, so queries stay correct, just slower out there.
+*/
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <SDL2/SDL.h>
+#include <math.h>
+#include <vector>
+
+//Where an item is
+struct SpatialGridItem
+{
+	SDL_FRect rect;
+
+	//Cell range the item is listed in, inclusive, x0 > x1 if the item isn't in the grid
+	int x0, y0, x1, y1;
+
+	//Last query that reported this item, so items spanning cells are reported once
+	Uint32 stamp;
+};
+
+//The grid
+struct SpatialGrid
+{
+	SDL_FRect bounds;
+	float cellSize;
+	int columns;
+	int rows;
+
+	//Ids listed in each cell, row by row
+	std::vector< std::vector<int> > cells;
+
+	//Indexed by id
+	std::vector<SpatialGridItem> items;
+
+	Uint32 stamp;
+};
+
+//Sets up an empty grid over bounds
+inline void createSpatialGrid( SpatialGrid& grid, SDL_FRect bounds, float cellSize )
+{
+	grid.bounds = bounds;
+	grid.cellSize = SDL_max( cellSize, 1.0f );
+	grid.columns = SDL_max( 1, (int)ceilf( bounds.w / grid.cellSize ) );
+	grid.rows = SDL_max( 1, (int)ceilf( bounds.h / grid.cellSize ) );
+	grid.cells.assign( grid.columns * grid.rows, std::vector<int>() );
+	grid.items.clear();
+	grid.stamp = 0;
+}
+
+//Whether two rects overlap, touching edges don't count
+inline bool gridRectsOverlap( const SDL_FRect& a, const SDL_FRect& b )
+{
+	return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+//Cell column or row of a coordinate, clamped to the grid
+inline int gridCell( float value, float origin, float cellSize, int cellCount )
+{
+	int cell = (int)floorf( ( value - origin ) / cellSize );
+	return SDL_max( 0, SDL_min( cell, cellCount - 1 ) );
+}
+
+//Cell range a rect touches
+inline void gridCellRange( const SpatialGrid& grid, const SDL_FRect& rect, int& x0, int& y0, int& x1, int& y1 )
+{
+	x0 = gridCell( rect.x, grid.bounds.x, grid.cellSize, grid.columns );
+	y0 = gridCell( rect.y, grid.bounds.y, grid.cellSize, grid.rows );
+	x1 = gridCell( rect.x + rect.w, grid.bounds.x, grid.cellSize, grid.columns );
+	y1 = gridCell( rect.y + rect.h, grid.bounds.y, grid.cellSize, grid.rows );
+}
+
+//Lists or unlists an id in its item's cells
+inline void gridLink( SpatialGrid& grid, int id )
+{
+	const SpatialGridItem& item = grid.items[ id ];
+	for( int y = item.y0; y <= item.y1; ++y )
+	{
+		for( int x = item.x0; x <= item.x1; ++x )
+		{
+			grid.cells[ y * grid.columns + x ].push_back( id );
+		}
+	}
+}
+
+inline void gridUnlink( SpatialGrid& grid, int id )
+{
+	const SpatialGridItem& item = grid.items[ id ];
+	for( int y = item.y0; y <= item.y1; ++y )
+	{
+		for( int x = item.x0; x <= item.x1; ++x )
+		{
+			//Order in a cell doesn't matter, swap with the back and pop
+			std::vector<int>& cell = grid.cells[ y * grid.columns + x ];
+			for( size_t i = 0; i < cell.size(); ++i )
+			{
+				if( cell[ i ] == id )
+				{
+					cell[ i ] = cell.back();
+					cell.pop_back();
+					break;
+				}
+			}
+		}
+	}
+}
+
+//Whether an id is in the grid
+inline bool inSpatialGrid( const SpatialGrid& grid, int id )
+{
+	return id >= 0 && id < (int)grid.items.size() && grid.items[ id ].x0 <= grid.items[ id ].x1;
+}
+
+//Adds an item, or moves it if the id is already in the grid
+inline void insertGridItem( SpatialGrid& grid, int id, SDL_FRect rect )
+{
+	if( id >= (int)grid.items.size() )
+	{
+		SpatialGridItem empty = { { 0.0f, 0.0f, 0.0f, 0.0f }, 0, 0, -1, -1, 0 };
+		grid.items.resize( id + 1, empty );
+	}
+	else if( inSpatialGrid( grid, id ) )
+	{
+		gridUnlink( grid, id );
+	}
+
+	SpatialGridItem& item = grid.items[ id ];
+	item.rect = rect;
+	gridCellRange( grid, rect, item.x0, item.y0, item.x1, item.y1 );
+	gridLink( grid, id );
+}
+
+//Updates an item's rect, only touching the cell lists if it crossed into different cells
+inline void moveGridItem( SpatialGrid& grid, int id, SDL_FRect rect )
+{
+	if( !inSpatialGrid( grid, id ) )
+	{
+		insertGridItem( grid, id, rect );
+		return;
+	}
+
+	SpatialGridItem& item = grid.items[ id ];
+	item.rect = rect;
+
+	int x0, y0, x1, y1;
+	gridCellRange( grid, rect, x0, y0, x1, y1 );
+	if( x0 != item.x0 || y0 != item.y0 || x1 != item.x1 || y1 != item.y1 )
+	{
+		gridUnlink( grid, id );
+		item.x0 = x0;
+		item.y0 = y0;
+		item.x1 = x1;
+		item.y1 = y1;
+		gridLink( grid, id );
+	}
+}
+
+//Takes an item out of the grid
+inline void removeGridItem( SpatialGrid& grid, int id )
+{
+	if( inSpatialGrid( grid, id ) )
+	{
+		gridUnlink( grid, id );
+		grid.items[ id ].x0 = 0;
+		grid.items[ id ].x1 = -1;
+	}
+}
+
+//Gives an item a new id, for stores that fill holes by moving their last element (the new id must not be in the grid)
+inline void renumberGridItem( SpatialGrid& grid, int from, int to )
+{
+	if( !inSpatialGrid( grid, from ) || inSpatialGrid( grid, to ) )
+	{
+		return;
+	}
+
+	SpatialGridItem item = grid.items[ from ];
+	removeGridItem( grid, from );
+	insertGridItem( grid, to, item.rect );
+}
+
+//Appends the ids of every item overlapping rect, each once, in no particular order
+inline void queryGridRect( SpatialGrid& grid, SDL_FRect rect, std::vector<int>& ids )
+{
+	//A new stamp marks this query, wrapping means old stamps could collide so clear them
+	if( ++grid.stamp == 0 )
+	{
+		for( size_t i = 0; i < grid.items.size(); ++i )
+		{
+			grid.items[ i ].stamp = 0;
+		}
+		grid.stamp = 1;
+	}
+
+	int x0, y0, x1, y1;
+	gridCellRange( grid, rect, x0, y0, x1, y1 );
+	for( int y = y0; y <= y1; ++y )
+	{
+		for( int x = x0; x <= x1; ++x )
+		{
+			const std::vector<int>& cell = grid.cells[ y * grid.columns + x ];
+			for( size_t i = 0; i < cell.size(); ++i )
+			{
+				SpatialGridItem& item = grid.items[ cell[ i ] ];
+				if( item.stamp != grid.stamp && gridRectsOverlap( item.rect, rect ) )
+				{
+					item.stamp = grid.stamp;
+					ids.push_back( cell[ i ] );
+				}
+			}
+		}
+	}
+}
+
+//The highest id whose rect contains the point, which is the topmost item when ids are drawn in order, -1 if none does
+inline int pickGridPoint( const SpatialGrid& grid, float x, float y )
+{
+	if( grid.items.empty() )
+	{
+		return -1;
+	}
+
+	int picked = -1;
+	const std::vector<int>& cell = grid.cells[ gridCell( y, grid.bounds.y, grid.cellSize, grid.rows ) * grid.columns + gridCell( x, grid.bounds.x, grid.cellSize, grid.columns ) ];
+	for( size_t i = 0; i < cell.size(); ++i )
+	{
+		const SDL_FRect& rect = grid.items[ cell[ i ] ].rect;
+		if( cell[ i ] > picked && x >= rect.x && x < rect.x + rect.w && y >= rect.y && y < rect.y + rect.h )
+		{
+			picked = cell[ i ];
+		}
+	}
+
+	return picked;
+}
+
+#endif
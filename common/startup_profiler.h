@@ -0,0 +1,111 @@
+/*Startup phase profiler.
+
+Call startupBegin() first thing in main, startupMark( "phase" ) after every startup step and startupFirstFrame() after every
+present (only the first one counts). Each mark is timed from the previous mark, so the breakdown adds up to the total time to first frame.
+Work done on other threads is recorded with startupSpan and listed separately since it overlaps the main thread phases.
+*/
+
+#ifndef STARTUP_PROFILER_H
+#define STARTUP_PROFILER_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+//Most phases any lesson records
+const int STARTUP_MAX_PHASES = 32;
+
+//One timed phase
+struct StartupPhase
+{
+	const char* name;
+	Uint64 start;
+	Uint64 end;
+	bool background;
+};
+
+//The recorded phases
+struct StartupProfile
+{
+	Uint64 begin;
+	Uint64 last;
+	int count;
+	bool printed;
+	SDL_SpinLock lock;
+	StartupPhase phases[ STARTUP_MAX_PHASES ];
+};
+
+inline StartupProfile& startupProfile()
+{
+	static StartupProfile profile = {};
+	return profile;
+}
+
+//Starts the clock, the performance counter works before SDL_Init
+inline void startupBegin()
+{
+	StartupProfile& profile = startupProfile();
+	profile.begin = SDL_GetPerformanceCounter();
+	profile.last = profile.begin;
+	profile.count = 0;
+	profile.printed = false;
+}
+
+//Records a phase running from start to end
+inline void startupSpan( const char* name, Uint64 start, Uint64 end, bool background = true )
+{
+	StartupProfile& profile = startupProfile();
+	SDL_AtomicLock( &profile.lock );
+	if( profile.count < STARTUP_MAX_PHASES )
+	{
+		StartupPhase phase = { name, start, end, background };
+		profile.phases[ profile.count++ ] = phase;
+	}
+	SDL_AtomicUnlock( &profile.lock );
+}
+
+//Records a main thread phase that ran from the previous mark until now
+inline void startupMark( const char* name )
+{
+	StartupProfile& profile = startupProfile();
+	Uint64 now = SDL_GetPerformanceCounter();
+	startupSpan( name, profile.last, now, false );
+	profile.last = now;
+}
+
+//Prints the breakdown, only the first call does anything
+inline void printStartupProfile( const char* lesson )
+{
+	StartupProfile& profile = startupProfile();
+	if( profile.printed )
+	{
+		return;
+	}
+	profile.printed = true;
+
+	double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+
+	SDL_AtomicLock( &profile.lock );
+	printf( "Startup profile (%s):\n", lesson );
+	for( int i = 0; i < profile.count; ++i )
+	{
+		StartupPhase& phase = profile.phases[ i ];
+		printf( "  %-28s %9.3f ms  (at %9.3f ms)%s\n", phase.name, ( phase.end - phase.start ) * toMs,
+			( phase.end - profile.begin ) * toMs, phase.background ? "  [background]" : "" );
+	}
+	printf( "  %-28s %9.3f ms\n", "total to first frame", ( profile.last - profile.begin ) * toMs );
+	SDL_AtomicUnlock( &profile.lock );
+}
+
+//Marks the first present and prints the breakdown, later calls do nothing
+inline void startupFirstFrame( const char* lesson )
+{
+	if( startupProfile().printed )
+	{
+		return;
+	}
+
+	startupMark( "first present" );
+	printStartupProfile( lesson );
+}
+
+#endif
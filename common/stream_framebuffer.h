@@ -0,0 +1,170 @@
+/*Streaming textures as a framebuffer for frames drawn on the CPU.
+
+The lessons only show one way of getting CPU pixels onto a renderer: draw into an SDL_Surface, then
+SDL_CreateTextureFromSurface. Done every frame that allocates a texture, copies the whole frame into it and destroys it
+again. A StreamFramebuffer keeps SDL_TEXTUREACCESS_STREAMING textures instead. lockStreamFramebuffer hands out an
+SDL_Surface over the texture's own pixels (SDL_LockTextureToSurface), so the rasterizer and SDL's blitters write
+straight into what the renderer draws, and unlockStreamFramebuffer returns the texture for SDL_RenderCopy. There is
+no per frame allocation and no copy of ours; on the software renderer the locked pixels are the texture, on GPU
+renderers they are the staging memory the driver uploads from on unlock, the one transfer every path needs.
+With two (or more) buffers each frame locks the texture the previous frame didn't draw from, so the lock doesn't have
+to wait for the GPU to be done with it. A locked texture's old contents are undefined: every frame has to write every
+pixel, clearing first if it doesn't.
+*/
+
+#ifndef STREAM_FRAMEBUFFER_H
+#define STREAM_FRAMEBUFFER_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+//Most textures a framebuffer cycles through
+const int STREAM_MAX_BUFFERS = 3;
+
+//Per frame costs of getting a CPU frame to the renderer, for either path
+struct CpuFrameStats
+{
+	int frames;
+
+	//Drawing the frame, getting it into a texture (lock and unlock, or create from surface) and the frame copies made
+	Uint64 drawTicks;
+	Uint64 uploadTicks;
+	long long copies;
+	long long copiedBytes;
+};
+
+struct StreamFramebuffer
+{
+	SDL_Texture* textures[ STREAM_MAX_BUFFERS ];
+	int bufferCount;
+	int current;
+	int width;
+	int height;
+	Uint32 format;
+
+	//The locked buffer as a surface, NULL while unlocked
+	SDL_Surface* surface;
+
+	CpuFrameStats stats;
+};
+
+//32-bit format the renderer takes without converting, ARGB8888 if it doesn't say
+inline Uint32 preferredStreamFormat( SDL_Renderer* renderer )
+{
+	SDL_RendererInfo info;
+	if( SDL_GetRendererInfo( renderer, &info ) == 0 )
+	{
+		for( Uint32 i = 0; i < info.num_texture_formats; ++i )
+		{
+			if( SDL_BYTESPERPIXEL( info.texture_formats[ i ] ) == 4 && !SDL_ISPIXELFORMAT_FOURCC( info.texture_formats[ i ] ) )
+			{
+				return info.texture_formats[ i ];
+			}
+		}
+	}
+
+	return SDL_PIXELFORMAT_ARGB8888;
+}
+
+inline void destroyStreamFramebuffer( StreamFramebuffer& framebuffer )
+{
+	for( int i = 0; i < framebuffer.bufferCount; ++i )
+	{
+		SDL_DestroyTexture( framebuffer.textures[ i ] );
+		framebuffer.textures[ i ] = NULL;
+	}
+	framebuffer.bufferCount = 0;
+	framebuffer.surface = NULL;
+}
+
+//Makes buffers streaming textures of width x height, format 0 picks the renderer's preferred one. They draw without
+//blending whatever their format's alpha says, since each holds a whole frame
+inline bool createStreamFramebuffer( SDL_Renderer* renderer, StreamFramebuffer& framebuffer, int width, int height, int buffers = 2, Uint32 format = 0 )
+{
+	framebuffer = StreamFramebuffer();
+	framebuffer.width = width;
+	framebuffer.height = height;
+	framebuffer.format = format != 0 ? format : preferredStreamFormat( renderer );
+
+	buffers = SDL_max( 1, SDL_min( buffers, STREAM_MAX_BUFFERS ) );
+	for( int i = 0; i < buffers; ++i )
+	{
+		framebuffer.textures[ i ] = SDL_CreateTexture( renderer, framebuffer.format, SDL_TEXTUREACCESS_STREAMING, width, height );
+		if( framebuffer.textures[ i ] == NULL )
+		{
+			destroyStreamFramebuffer( framebuffer );
+			return false;
+		}
+		framebuffer.bufferCount = i + 1;
+		SDL_SetTextureBlendMode( framebuffer.textures[ i ], SDL_BLENDMODE_NONE );
+	}
+
+	return true;
+}
+
+//Locks the next buffer and returns a surface over its pixels to draw the whole frame into, NULL on failure
+inline SDL_Surface* lockStreamFramebuffer( StreamFramebuffer& framebuffer )
+{
+	if( framebuffer.surface != NULL )
+	{
+		return framebuffer.surface;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	if( SDL_LockTextureToSurface( framebuffer.textures[ framebuffer.current ], NULL, &framebuffer.surface ) < 0 )
+	{
+		framebuffer.surface = NULL;
+	}
+	framebuffer.stats.uploadTicks += SDL_GetPerformanceCounter() - start;
+
+	return framebuffer.surface;
+}
+
+//Unlocks the buffer drawn into and returns its texture to render, the next lock gets the next buffer
+inline SDL_Texture* unlockStreamFramebuffer( StreamFramebuffer& framebuffer )
+{
+	SDL_Texture* texture = framebuffer.textures[ framebuffer.current ];
+	if( framebuffer.surface != NULL )
+	{
+		Uint64 start = SDL_GetPerformanceCounter();
+		SDL_UnlockTexture( texture );
+		framebuffer.surface = NULL;
+		framebuffer.stats.uploadTicks += SDL_GetPerformanceCounter() - start;
+		++framebuffer.stats.frames;
+	}
+
+	framebuffer.current = ( framebuffer.current + 1 ) % framebuffer.bufferCount;
+	return texture;
+}
+
+//The old way for comparison: a texture made from the surface, which the caller destroys after drawing it
+inline SDL_Texture* uploadSurfaceFrame( SDL_Renderer* renderer, SDL_Surface* surface, CpuFrameStats& stats )
+{
+	Uint64 start = SDL_GetPerformanceCounter();
+	SDL_Texture* texture = SDL_CreateTextureFromSurface( renderer, surface );
+	stats.uploadTicks += SDL_GetPerformanceCounter() - start;
+	if( texture != NULL )
+	{
+		++stats.frames;
+		++stats.copies;
+		stats.copiedBytes += (long long)surface->pitch * surface->h;
+	}
+
+	return texture;
+}
+
+//Prints averages per frame
+inline void printCpuFrameStats( const CpuFrameStats& stats, const char* path )
+{
+	if( stats.frames == 0 )
+	{
+		return;
+	}
+
+	double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+	printf( "CPU frames (%s): draw %.3f ms, upload %.3f ms, %.2f frame copies (%.2f MB) per frame over %d frames\n", path,
+		stats.drawTicks * toMs / stats.frames, stats.uploadTicks * toMs / stats.frames, (double)stats.copies / stats.frames,
+		stats.copiedBytes / ( 1024.0 * 1024.0 ) / stats.frames, stats.frames );
+}
+
+#endif
@@ -0,0 +1,497 @@
+/*Fast lossless image loading for the lessons.
+
+QOI ("Quite OK Image", https://qoiformat.org) decodes several times faster than PNG and is a fraction of the size of a raw BMP.
+A plain .qoi file is one long chunk stream, so it can only be decoded by one thread. The .qois container used here splits
+the image into horizontal strips, each encoded as its own QOI stream with the encoder state reset, so strips can be decoded
+in parallel straight into the final surface, one job per strip on the caller's job system (common/job_system.h).
+
+.qois layout (all integers big endian like QOI):
+	char[4]  magic "qois"
+	u32      width
+	u32      height
+	u8       channels (3 = RGB, 4 = RGBA)
+	u8       colorspace
+	u16      rows per strip
+	u32      strip count
+	u32      strip offsets[ strip count + 1 ] (relative to the start of the strip data)
+	...      strip data, each strip a QOI chunk stream without header or end marker
+*/
+
+#ifndef STRIP_QOI_H
+#define STRIP_QOI_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "job_system.h"
+
+//QOI chunk tags
+const Uint8 QOI_OP_INDEX = 0x00;
+const Uint8 QOI_OP_DIFF = 0x40;
+const Uint8 QOI_OP_LUMA = 0x80;
+const Uint8 QOI_OP_RUN = 0xC0;
+const Uint8 QOI_OP_RGB = 0xFE;
+const Uint8 QOI_OP_RGBA = 0xFF;
+const Uint8 QOI_MASK_2 = 0xC0;
+
+//Size of the plain QOI header and end marker
+const int QOI_HEADER_SIZE = 14;
+const int QOI_END_MARKER_SIZE = 8;
+
+//Default strip height, 64 rows of a 640 wide image is 160 KB of decoded pixels
+const int QOIS_DEFAULT_STRIP_ROWS = 64;
+
+//Refuse anything larger than this many pixels (same limit as the reference decoder)
+const Uint32 QOI_PIXELS_MAX = 400000000;
+
+//One RGBA pixel the way QOI hashes and compares it
+struct QoiPixel
+{
+	Uint8 r, g, b, a;
+};
+
+inline int qoiHash( QoiPixel px )
+{
+	return ( px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11 ) % 64;
+}
+
+inline bool qoiSame( QoiPixel a, QoiPixel b )
+{
+	return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+inline void qoiWrite32( std::vector<Uint8>& out, Uint32 v )
+{
+	out.push_back( ( v >> 24 ) & 0xFF );
+	out.push_back( ( v >> 16 ) & 0xFF );
+	out.push_back( ( v >> 8 ) & 0xFF );
+	out.push_back( v & 0xFF );
+}
+
+inline Uint32 qoiRead32( const Uint8* p )
+{
+	return ( (Uint32)p[ 0 ] << 24 ) | ( (Uint32)p[ 1 ] << 16 ) | ( (Uint32)p[ 2 ] << 8 ) | p[ 3 ];
+}
+
+//Encodes rows of RGBA32 pixels as one QOI chunk stream starting from a fresh encoder state
+inline void qoiEncodeRows( const Uint8* pixels, int pitch, int width, int rows, int channels, std::vector<Uint8>& out )
+{
+	QoiPixel index[ 64 ];
+	memset( index, 0, sizeof( index ) );
+
+	QoiPixel prev = { 0, 0, 0, 255 };
+	int run = 0;
+	int total = width * rows;
+
+	for( int i = 0; i < total; ++i )
+	{
+		const Uint8* src = pixels + ( i / width ) * pitch + ( i % width ) * 4;
+		QoiPixel px = { src[ 0 ], src[ 1 ], src[ 2 ], channels == 4 ? src[ 3 ] : (Uint8)255 };
+
+		if( qoiSame( px, prev ) )
+		{
+			++run;
+			if( run == 62 || i == total - 1 )
+			{
+				out.push_back( QOI_OP_RUN | ( run - 1 ) );
+				run = 0;
+			}
+		}
+		else
+		{
+			if( run > 0 )
+			{
+				out.push_back( QOI_OP_RUN | ( run - 1 ) );
+				run = 0;
+			}
+
+			int hash = qoiHash( px );
+			if( qoiSame( index[ hash ], px ) )
+			{
+				out.push_back( QOI_OP_INDEX | hash );
+			}
+			else
+			{
+				index[ hash ] = px;
+
+				if( px.a == prev.a )
+				{
+					Sint8 vr = px.r - prev.r;
+					Sint8 vg = px.g - prev.g;
+					Sint8 vb = px.b - prev.b;
+					Sint8 vgr = vr - vg;
+					Sint8 vgb = vb - vg;
+
+					if( vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2 )
+					{
+						out.push_back( QOI_OP_DIFF | ( vr + 2 ) << 4 | ( vg + 2 ) << 2 | ( vb + 2 ) );
+					}
+					else if( vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8 )
+					{
+						out.push_back( QOI_OP_LUMA | ( vg + 32 ) );
+						out.push_back( ( vgr + 8 ) << 4 | ( vgb + 8 ) );
+					}
+					else
+					{
+						out.push_back( QOI_OP_RGB );
+						out.push_back( px.r );
+						out.push_back( px.g );
+						out.push_back( px.b );
+					}
+				}
+				else
+				{
+					out.push_back( QOI_OP_RGBA );
+					out.push_back( px.r );
+					out.push_back( px.g );
+					out.push_back( px.b );
+					out.push_back( px.a );
+				}
+			}
+		}
+
+		prev = px;
+	}
+}
+
+//Decodes one QOI chunk stream into rows of 32 bit ARGB8888 pixels, returns false on truncated or overlong input
+inline bool qoiDecodeRows( const Uint8* data, size_t size, Uint8* pixels, int pitch, int width, int rows )
+{
+	QoiPixel index[ 64 ];
+	memset( index, 0, sizeof( index ) );
+
+	QoiPixel px = { 0, 0, 0, 255 };
+	int run = 0;
+	size_t p = 0;
+
+	for( int y = 0; y < rows; ++y )
+	{
+		Uint32* dst = (Uint32*)( pixels + y * pitch );
+		for( int x = 0; x < width; ++x )
+		{
+			if( run > 0 )
+			{
+				--run;
+			}
+			else
+			{
+				if( p >= size )
+				{
+					return false;
+				}
+
+				int b1 = data[ p++ ];
+				if( b1 == QOI_OP_RGB )
+				{
+					if( p + 3 > size )
+					{
+						return false;
+					}
+					px.r = data[ p++ ];
+					px.g = data[ p++ ];
+					px.b = data[ p++ ];
+				}
+				else if( b1 == QOI_OP_RGBA )
+				{
+					if( p + 4 > size )
+					{
+						return false;
+					}
+					px.r = data[ p++ ];
+					px.g = data[ p++ ];
+					px.b = data[ p++ ];
+					px.a = data[ p++ ];
+				}
+				else if( ( b1 & QOI_MASK_2 ) == QOI_OP_INDEX )
+				{
+					px = index[ b1 ];
+				}
+				else if( ( b1 & QOI_MASK_2 ) == QOI_OP_DIFF )
+				{
+					px.r += ( ( b1 >> 4 ) & 0x03 ) - 2;
+					px.g += ( ( b1 >> 2 ) & 0x03 ) - 2;
+					px.b += ( b1 & 0x03 ) - 2;
+				}
+				else if( ( b1 & QOI_MASK_2 ) == QOI_OP_LUMA )
+				{
+					if( p >= size )
+					{
+						return false;
+					}
+					int b2 = data[ p++ ];
+					int vg = ( b1 & 0x3F ) - 32;
+					px.r += vg - 8 + ( ( b2 >> 4 ) & 0x0F );
+					px.g += vg;
+					px.b += vg - 8 + ( b2 & 0x0F );
+				}
+				else
+				{
+					run = b1 & 0x3F;
+				}
+
+				index[ qoiHash( px ) ] = px;
+			}
+
+			dst[ x ] = ( (Uint32)px.a << 24 ) | ( (Uint32)px.r << 16 ) | ( (Uint32)px.g << 8 ) | px.b;
+		}
+	}
+
+	//A run may not spill over into the next strip
+	return run == 0;
+}
+
+//Reads a whole file into memory
+inline bool readImageFile( std::string path, std::vector<Uint8>& data )
+{
+	FILE* file = fopen( path.c_str(), "rb" );
+	if( file == NULL )
+	{
+		return false;
+	}
+
+	fseek( file, 0, SEEK_END );
+	long size = ftell( file );
+	fseek( file, 0, SEEK_SET );
+
+	bool success = size > 0;
+	if( success )
+	{
+		data.resize( size );
+		success = fread( data.data(), 1, size, file ) == (size_t)size;
+	}
+	fclose( file );
+
+	return success;
+}
+
+//Writes a buffer out to a file
+inline bool writeImageFile( std::string path, const std::vector<Uint8>& data )
+{
+	FILE* file = fopen( path.c_str(), "wb" );
+	if( file == NULL )
+	{
+		return false;
+	}
+
+	bool success = fwrite( data.data(), 1, data.size(), file ) == data.size();
+	success = ( fclose( file ) == 0 ) && success;
+
+	return success;
+}
+
+//Encodes a surface as .qois (stripRows > 0) or as a plain single stream .qoi (stripRows == 0)
+inline bool encodeStripQOI( SDL_Surface* surface, int stripRows, std::vector<Uint8>& out )
+{
+	//Work on RGBA bytes regardless of what the surface was loaded as
+	SDL_Surface* rgba = SDL_ConvertSurfaceFormat( surface, SDL_PIXELFORMAT_RGBA32, 0 );
+	if( rgba == NULL )
+	{
+		return false;
+	}
+
+	int channels = SDL_ISPIXELFORMAT_ALPHA( surface->format->format ) ? 4 : 3;
+	const Uint8* pixels = (const Uint8*)rgba->pixels;
+	out.clear();
+
+	if( stripRows <= 0 )
+	{
+		//Plain QOI, readable by any QOI tool
+		out.push_back( 'q' ); out.push_back( 'o' ); out.push_back( 'i' ); out.push_back( 'f' );
+		qoiWrite32( out, rgba->w );
+		qoiWrite32( out, rgba->h );
+		out.push_back( channels );
+		out.push_back( 0 );
+		qoiEncodeRows( pixels, rgba->pitch, rgba->w, rgba->h, channels, out );
+		for( int i = 0; i < QOI_END_MARKER_SIZE - 1; ++i )
+		{
+			out.push_back( 0 );
+		}
+		out.push_back( 1 );
+	}
+	else
+	{
+		if( stripRows > 0xFFFF )
+		{
+			stripRows = 0xFFFF;
+		}
+		Uint32 stripCount = ( rgba->h + stripRows - 1 ) / stripRows;
+
+		//Header, offsets are patched in once the strips are encoded
+		out.push_back( 'q' ); out.push_back( 'o' ); out.push_back( 'i' ); out.push_back( 's' );
+		qoiWrite32( out, rgba->w );
+		qoiWrite32( out, rgba->h );
+		out.push_back( channels );
+		out.push_back( 0 );
+		out.push_back( ( stripRows >> 8 ) & 0xFF );
+		out.push_back( stripRows & 0xFF );
+		qoiWrite32( out, stripCount );
+		size_t tableStart = out.size();
+		out.resize( tableStart + ( stripCount + 1 ) * 4 );
+		size_t dataStart = out.size();
+
+		std::vector<Uint8> strip;
+		for( Uint32 s = 0; s < stripCount; ++s )
+		{
+			int y = s * stripRows;
+			int rows = SDL_min( stripRows, rgba->h - y );
+
+			//Offset of this strip
+			Uint32 offset = out.size() - dataStart;
+			for( int b = 0; b < 4; ++b )
+			{
+				out[ tableStart + s * 4 + b ] = ( offset >> ( 24 - b * 8 ) ) & 0xFF;
+			}
+
+			strip.clear();
+			qoiEncodeRows( pixels + y * rgba->pitch, rgba->pitch, rgba->w, rows, channels, strip );
+			out.insert( out.end(), strip.begin(), strip.end() );
+		}
+
+		//End offset
+		Uint32 end = out.size() - dataStart;
+		for( int b = 0; b < 4; ++b )
+		{
+			out[ tableStart + stripCount * 4 + b ] = ( end >> ( 24 - b * 8 ) ) & 0xFF;
+		}
+	}
+
+	SDL_FreeSurface( rgba );
+
+	return true;
+}
+
+//Decodes a .qoi or .qois image held in memory, strips in parallel on jobs
+inline SDL_Surface* decodeStripQOI( const Uint8* data, size_t size, JobSystem* jobs = NULL )
+{
+	if( size < QOI_HEADER_SIZE )
+	{
+		SDL_SetError( "QOI data too short" );
+		return NULL;
+	}
+
+	bool striped = memcmp( data, "qois", 4 ) == 0;
+	if( !striped && memcmp( data, "qoif", 4 ) != 0 )
+	{
+		SDL_SetError( "Not a QOI image" );
+		return NULL;
+	}
+
+	Uint32 width = qoiRead32( data + 4 );
+	Uint32 height = qoiRead32( data + 8 );
+	int channels = data[ 12 ];
+	if( width == 0 || height == 0 || ( channels != 3 && channels != 4 ) || height >= QOI_PIXELS_MAX / width )
+	{
+		SDL_SetError( "Invalid QOI header" );
+		return NULL;
+	}
+
+	//Work out where every strip lives
+	int stripRows = height;
+	std::vector<Uint32> offsets;
+	const Uint8* stripData = data + QOI_HEADER_SIZE;
+	size_t stripDataSize = size - QOI_HEADER_SIZE;
+	if( striped )
+	{
+		if( size < 20 )
+		{
+			SDL_SetError( "QOIS header too short" );
+			return NULL;
+		}
+
+		stripRows = ( data[ 14 ] << 8 ) | data[ 15 ];
+		Uint32 stripCount = qoiRead32( data + 16 );
+		if( stripRows == 0 || stripCount != ( height + stripRows - 1 ) / stripRows || ( size - 20 ) / 4 < (size_t)stripCount + 1 )
+		{
+			SDL_SetError( "Invalid QOIS strip table" );
+			return NULL;
+		}
+
+		offsets.resize( stripCount + 1 );
+		for( Uint32 s = 0; s <= stripCount; ++s )
+		{
+			offsets[ s ] = qoiRead32( data + 20 + s * 4 );
+		}
+		stripData = data + 20 + ( stripCount + 1 ) * 4;
+		stripDataSize = size - 20 - ( stripCount + 1 ) * 4;
+
+		for( Uint32 s = 0; s < stripCount; ++s )
+		{
+			if( offsets[ s ] > offsets[ s + 1 ] || offsets[ s + 1 ] > stripDataSize )
+			{
+				SDL_SetError( "Invalid QOIS strip offset" );
+				return NULL;
+			}
+		}
+	}
+	else
+	{
+		//Plain QOI is one strip covering the whole image
+		offsets.push_back( 0 );
+		offsets.push_back( stripDataSize );
+	}
+
+	//RGB images are decoded without alpha so blits stay opaque
+	Uint32 format = channels == 4 ? SDL_PIXELFORMAT_ARGB8888 : SDL_PIXELFORMAT_RGB888;
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, format );
+	if( surface == NULL )
+	{
+		return NULL;
+	}
+
+	//One job per strip
+	int stripCount = offsets.size() - 1;
+	std::atomic<bool> failed( false );
+	parallelFor( jobs, 0, stripCount, 1, [ & ]( int first, int last )
+	{
+		for( int s = first; s < last; ++s )
+		{
+			int y = s * stripRows;
+			int rows = SDL_min( stripRows, (int)height - y );
+			Uint8* dst = (Uint8*)surface->pixels + y * surface->pitch;
+			if( !qoiDecodeRows( stripData + offsets[ s ], offsets[ s + 1 ] - offsets[ s ], dst, surface->pitch, width, rows ) )
+			{
+				failed = true;
+			}
+		}
+	} );
+
+	if( failed )
+	{
+		SDL_FreeSurface( surface );
+		SDL_SetError( "Corrupt QOI data" );
+		return NULL;
+	}
+
+	return surface;
+}
+
+//Loads a .qoi or .qois file, decoding on jobs like decodeStripQOI
+inline SDL_Surface* loadStripQOI( std::string path, JobSystem* jobs = NULL )
+{
+	std::vector<Uint8> data;
+	if( !readImageFile( path, data ) )
+	{
+		SDL_SetError( "Couldn't read %s", path.c_str() );
+		return NULL;
+	}
+
+	return decodeStripQOI( data.data(), data.size(), jobs );
+}
+
+//Whether a path should go through the QOI loader
+inline bool isQOIPath( std::string path )
+{
+	size_t dot = path.rfind( '.' );
+	if( dot == std::string::npos )
+	{
+		return false;
+	}
+
+	std::string ext = path.substr( dot );
+	return ext == ".qoi" || ext == ".qois";
+}
+
+#endif
@@ -0,0 +1,361 @@
+/*Per frame telemetry in a POSIX shared memory ring, for watching long running lessons from another process.
+
+The writer creates a shared memory object (shm_open, /NAME) holding a TelemetryHeader and a ring of TelemetrySlots, and
+writeTelemetry puts one record in the next slot every frame: frame number, time, frame time since the last record, event
+count, blit and present times and the resident set size. A reader (tools/telemetry_reader) maps the same object read only
+and follows along. Nothing goes from the reader to the writer, so the writer never waits for it: a reader that falls more
+than a ring behind loses the oldest records and counts them.
+Each slot is a seqlock. The writer makes its sequence odd, writes the fields, then makes it even again; a reader loads the
+sequence, copies the fields and loads it again, and keeps the copy only if both loads were the same even number and the
+record is the frame it wanted. Every field is a lock free std::atomic written and read relaxed, ordered by the fences
+around them, so a torn read is detected instead of being a data race. Times are CLOCK_MONOTONIC nanoseconds, the same
+clock in both processes, so the reader can tell how old the newest record is. The resident set size is read from
+/proc/self/statm every TELEMETRY_RSS_INTERVAL frames (it costs a few system calls) and is 0 where there is no /proc.
+The writer unlinks the object when it closes and also before creating it, so a crashed run's leftover is replaced;
+a reader that is still attached keeps the old mapping and sees its pid gone. Without POSIX shared memory (Windows)
+openTelemetryWriter prints why and the writer stays closed, writeTelemetry then does nothing. glibc before 2.34 keeps
+shm_open in librt, link with -lrt there.
+*/
+
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+#include <atomic>
+#include <new>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define TELEMETRY_SHM 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#endif
+
+//"TLM1", and the layout version both sides have to agree on
+const Uint32 TELEMETRY_MAGIC = 0x314D4C54;
+const Uint32 TELEMETRY_VERSION = 1;
+
+//Slots in the ring, a bit over a minute at 60 frames per second
+const Uint32 TELEMETRY_CAPACITY = 4096;
+
+//Frames between resident set size reads
+const int TELEMETRY_RSS_INTERVAL = 30;
+
+//One frame's record, sequence odd while the writer is in the middle of it
+struct TelemetrySlot
+{
+	std::atomic<Uint32> sequence;
+	std::atomic<Uint32> events;
+	std::atomic<Uint64> frame;
+	std::atomic<Uint64> timeNs;
+	std::atomic<Uint64> rssBytes;
+	std::atomic<float> frameMs;
+	std::atomic<float> blitMs;
+	std::atomic<float> presentMs;
+};
+
+//Start of the shared memory, the slots follow it
+struct TelemetryHeader
+{
+	Uint32 magic;
+	Uint32 version;
+	Uint32 slotSize;
+	Uint32 capacity;
+	Uint64 pid;
+	char name[ 32 ];
+
+	//Records published so far, which is also the next frame number
+	std::atomic<Uint64> written;
+};
+
+static_assert( std::atomic<Uint32>::is_always_lock_free && std::atomic<Uint64>::is_always_lock_free && std::atomic<float>::is_always_lock_free,
+	"telemetry slots are shared between processes, their atomics can't use locks" );
+
+//A record copied out of a slot
+struct TelemetryRecord
+{
+	Uint64 frame;
+	Uint64 timeNs;
+	Uint64 rssBytes;
+	Uint32 events;
+	float frameMs;
+	float blitMs;
+	float presentMs;
+};
+
+//Either end of a ring, closed when header is NULL
+struct TelemetryRing
+{
+	std::string name;
+	int fd;
+	void* memory;
+	size_t bytes;
+	TelemetryHeader* header;
+	TelemetrySlot* slots;
+
+	//Created the shared memory, so removes it when closing
+	bool owner;
+
+	//Writer only: last record's time and the last resident set size read
+	Uint64 lastTimeNs;
+	Uint64 rssBytes;
+};
+
+//Shared memory names start with a slash
+inline std::string telemetryShmName( std::string name )
+{
+	return name.empty() || name[ 0 ] != '/' ? "/" + name : name;
+}
+
+inline size_t telemetryBytes( Uint32 capacity )
+{
+	return sizeof( TelemetryHeader ) + capacity * sizeof( TelemetrySlot );
+}
+
+inline Uint64 telemetryNowNs()
+{
+#ifdef TELEMETRY_SHM
+	timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return (Uint64)now.tv_sec * 1000000000ull + now.tv_nsec;
+#else
+	return (Uint64)( SDL_GetPerformanceCounter() * 1000000000.0 / SDL_GetPerformanceFrequency() );
+#endif
+}
+
+//Resident set size in bytes, 0 where it can't be read
+inline Uint64 telemetryResidentBytes()
+{
+#ifdef __linux__
+	FILE* file = fopen( "/proc/self/statm", "r" );
+	if( file == NULL )
+	{
+		return 0;
+	}
+	unsigned long long size = 0;
+	unsigned long long resident = 0;
+	int read = fscanf( file, "%llu %llu", &size, &resident );
+	fclose( file );
+	return read == 2 ? resident * sysconf( _SC_PAGESIZE ) : 0;
+#else
+	return 0;
+#endif
+}
+
+//Unmaps the ring, and as its writer removes the shared memory
+inline void closeTelemetryRing( TelemetryRing& ring )
+{
+#ifdef TELEMETRY_SHM
+	if( ring.memory != NULL )
+	{
+		munmap( ring.memory, ring.bytes );
+	}
+	if( ring.fd >= 0 )
+	{
+		::close( ring.fd );
+	}
+	if( ring.owner )
+	{
+		shm_unlink( ring.name.c_str() );
+	}
+#endif
+	ring.memory = NULL;
+	ring.header = NULL;
+	ring.slots = NULL;
+	ring.fd = -1;
+	ring.owner = false;
+}
+
+//Creates the shared memory for a ring of capacity slots, prints why and returns false if it can't
+inline bool openTelemetryWriter( TelemetryRing& ring, std::string name, Uint32 capacity = TELEMETRY_CAPACITY )
+{
+	ring = TelemetryRing();
+	ring.name = telemetryShmName( name );
+	ring.fd = -1;
+
+#ifdef TELEMETRY_SHM
+	//Replace whatever an earlier run left behind
+	shm_unlink( ring.name.c_str() );
+	ring.fd = shm_open( ring.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+	ring.owner = ring.fd >= 0;
+	ring.bytes = telemetryBytes( capacity );
+	if( ring.fd < 0 || ftruncate( ring.fd, ring.bytes ) != 0 )
+	{
+		printf( "Unable to create telemetry shared memory %s: %s\n", ring.name.c_str(), strerror( errno ) );
+		closeTelemetryRing( ring );
+		return false;
+	}
+
+	ring.memory = mmap( NULL, ring.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, ring.fd, 0 );
+	if( ring.memory == MAP_FAILED )
+	{
+		printf( "Unable to map telemetry shared memory %s: %s\n", ring.name.c_str(), strerror( errno ) );
+		ring.memory = NULL;
+		closeTelemetryRing( ring );
+		return false;
+	}
+
+	//ftruncate zeroed it, so every slot starts at sequence 0 and written at 0; the magic goes last
+	ring.header = new( ring.memory ) TelemetryHeader();
+	ring.slots = (TelemetrySlot*)( (char*)ring.memory + sizeof( TelemetryHeader ) );
+	for( Uint32 i = 0; i < capacity; ++i )
+	{
+		new( &ring.slots[ i ] ) TelemetrySlot();
+	}
+	ring.header->version = TELEMETRY_VERSION;
+	ring.header->slotSize = sizeof( TelemetrySlot );
+	ring.header->capacity = capacity;
+	ring.header->pid = getpid();
+	SDL_strlcpy( ring.header->name, ring.name.c_str(), sizeof( ring.header->name ) );
+	std::atomic_thread_fence( std::memory_order_release );
+	ring.header->magic = TELEMETRY_MAGIC;
+
+	ring.rssBytes = telemetryResidentBytes();
+	printf( "Writing telemetry to shared memory %s (%u frames)\n", ring.name.c_str(), capacity );
+	return true;
+#else
+	printf( "Unable to create telemetry shared memory %s: POSIX shared memory is unavailable\n", ring.name.c_str() );
+	return false;
+#endif
+}
+
+//Maps a writer's ring read only, prints why and returns false if it isn't there or isn't a ring of this version
+inline bool openTelemetryReader( TelemetryRing& ring, std::string name )
+{
+	ring = TelemetryRing();
+	ring.name = telemetryShmName( name );
+	ring.fd = -1;
+
+#ifdef TELEMETRY_SHM
+	struct stat info;
+	ring.fd = shm_open( ring.name.c_str(), O_RDONLY, 0 );
+	if( ring.fd < 0 || fstat( ring.fd, &info ) != 0 )
+	{
+		printf( "Unable to open telemetry shared memory %s: %s\n", ring.name.c_str(), strerror( errno ) );
+		closeTelemetryRing( ring );
+		return false;
+	}
+
+	ring.bytes = info.st_size;
+	ring.memory = ring.bytes >= sizeof( TelemetryHeader ) ? mmap( NULL, ring.bytes, PROT_READ, MAP_SHARED, ring.fd, 0 ) : MAP_FAILED;
+	if( ring.memory == MAP_FAILED )
+	{
+		printf( "Unable to map telemetry shared memory %s: %s\n", ring.name.c_str(), ring.bytes < sizeof( TelemetryHeader ) ? "too small" : strerror( errno ) );
+		ring.memory = NULL;
+		closeTelemetryRing( ring );
+		return false;
+	}
+
+	TelemetryHeader* header = (TelemetryHeader*)ring.memory;
+	bool valid = header->magic == TELEMETRY_MAGIC;
+	std::atomic_thread_fence( std::memory_order_acquire );
+	valid = valid && header->version == TELEMETRY_VERSION && header->slotSize == sizeof( TelemetrySlot ) && header->capacity > 0 &&
+		telemetryBytes( header->capacity ) <= ring.bytes;
+	if( !valid )
+	{
+		printf( "%s is not a version %u telemetry ring\n", ring.name.c_str(), TELEMETRY_VERSION );
+		closeTelemetryRing( ring );
+		return false;
+	}
+
+	ring.header = header;
+	ring.slots = (TelemetrySlot*)( (char*)ring.memory + sizeof( TelemetryHeader ) );
+	return true;
+#else
+	printf( "Unable to open telemetry shared memory %s: POSIX shared memory is unavailable\n", ring.name.c_str() );
+	return false;
+#endif
+}
+
+//Publishes this frame's record, the frame time being the time since the last one. Never waits
+inline void writeTelemetry( TelemetryRing& ring, int events, double blitMs, double presentMs )
+{
+	if( ring.header == NULL )
+	{
+		return;
+	}
+
+	Uint64 frame = ring.header->written.load( std::memory_order_relaxed );
+	Uint64 now = telemetryNowNs();
+	if( frame % TELEMETRY_RSS_INTERVAL == 0 )
+	{
+		ring.rssBytes = telemetryResidentBytes();
+	}
+
+	//Odd while writing, the release fence keeps the field stores after it
+	TelemetrySlot& slot = ring.slots[ frame % ring.header->capacity ];
+	Uint32 sequence = slot.sequence.load( std::memory_order_relaxed );
+	slot.sequence.store( sequence + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_release );
+
+	slot.frame.store( frame, std::memory_order_relaxed );
+	slot.timeNs.store( now, std::memory_order_relaxed );
+	slot.rssBytes.store( ring.rssBytes, std::memory_order_relaxed );
+	slot.events.store( events, std::memory_order_relaxed );
+	slot.frameMs.store( ring.lastTimeNs != 0 ? ( now - ring.lastTimeNs ) / 1000000.0f : 0.0f, std::memory_order_relaxed );
+	slot.blitMs.store( blitMs, std::memory_order_relaxed );
+	slot.presentMs.store( presentMs, std::memory_order_relaxed );
+
+	slot.sequence.store( sequence + 2, std::memory_order_release );
+	ring.header->written.store( frame + 1, std::memory_order_release );
+	ring.lastTimeNs = now;
+}
+
+//Records the writer has published
+inline Uint64 telemetryWritten( const TelemetryRing& ring )
+{
+	return ring.header != NULL ? ring.header->written.load( std::memory_order_acquire ) : 0;
+}
+
+enum TelemetryReadResult
+{
+	TELEMETRY_READ_OK,
+	TELEMETRY_READ_TORN,
+	TELEMETRY_READ_LOST
+};
+
+//Copies frame's record. TORN if the writer was in the middle of its slot (try again), LOST if it has moved past it
+inline TelemetryReadResult readTelemetry( const TelemetryRing& ring, Uint64 frame, TelemetryRecord& record )
+{
+	const TelemetrySlot& slot = ring.slots[ frame % ring.header->capacity ];
+	Uint32 before = slot.sequence.load( std::memory_order_acquire );
+	if( before & 1 )
+	{
+		return TELEMETRY_READ_TORN;
+	}
+
+	record.frame = slot.frame.load( std::memory_order_relaxed );
+	record.timeNs = slot.timeNs.load( std::memory_order_relaxed );
+	record.rssBytes = slot.rssBytes.load( std::memory_order_relaxed );
+	record.events = slot.events.load( std::memory_order_relaxed );
+	record.frameMs = slot.frameMs.load( std::memory_order_relaxed );
+	record.blitMs = slot.blitMs.load( std::memory_order_relaxed );
+	record.presentMs = slot.presentMs.load( std::memory_order_relaxed );
+
+	//The acquire fence keeps the field loads before the second sequence load
+	std::atomic_thread_fence( std::memory_order_acquire );
+	if( slot.sequence.load( std::memory_order_relaxed ) != before )
+	{
+		return TELEMETRY_READ_TORN;
+	}
+	return record.frame == frame ? TELEMETRY_READ_OK : TELEMETRY_READ_LOST;
+}
+
+//Whether the writer process is still running
+inline bool telemetryWriterAlive( const TelemetryRing& ring )
+{
+#ifdef TELEMETRY_SHM
+	return ring.header != NULL && ( kill( (pid_t)ring.header->pid, 0 ) == 0 || errno == EPERM );
+#else
+	return false;
+#endif
+}
+
+#endif
@@ -0,0 +1,934 @@
+/*Benchmark history: keeps every benchmark run in a JSON-lines file and compares revisions.
+
+	bench_history record history.jsonl report.json [--rev REV]
+	bench_history list history.jsonl
+	bench_history compare history.jsonl BASE NEW [--metric median_ms] [--threshold 5] [--test bootstrap|mann-whitney] [--alpha 0.05]
+
+record appends a report a benchmark wrote (the tools' --json, 03's --perf) as one line: suite, git revision, build flags,
+compiler, CPU model, the time, and every result's params and metrics. Series are left out, they would make the lines
+huge. The revision is --rev if given, else the one the makefile built the benchmark at, else git describe run here.
+list prints each revision in the file with the runs it has of each suite.
+compare takes every run of each suite at BASE and at NEW (a revision prefix will do) and compares one metric of each
+result between them, each run one sample, so run a benchmark several times per revision, five or more, for the tests to
+mean anything. The change is NEW's median over BASE's. A result is a regression when it changed for the worse by more than
+--threshold percent and the change is significant: with bootstrap (the default) the 95% interval of the change, from 2000
+resamples of both sides, has to leave out zero; with mann-whitney the rank test's two-sided p has to be under --alpha.
+Improvements are the same the other way. Rates (metrics ending in _per_s, _per_ms or fps), speedup_ and saved_ metrics,
+savings and ipc are better higher, every other one (times like per_sprite_ms, bytes, misses) lower. With fewer than two runs on a side there is no test and no verdict.
+Prints a table per suite and exits with 2 if anything regressed, 1 on errors, 0 otherwise.
+*/
+
+//Using SDL, standard IO, strings and the benchmark report writer
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include "../../common/bench_report.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+//A parsed JSON value, only what benchmark reports use
+struct JsonValue
+{
+	enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+	Type type = JSON_NULL;
+	double number = 0.0;
+	std::string text;
+	std::vector<JsonValue> items;
+	std::vector< std::pair<std::string, JsonValue> > members;
+};
+
+//A member of an object, NULL if missing
+const JsonValue* jsonMember( const JsonValue& value, const char* name )
+{
+	for( size_t i = 0; i < value.members.size(); ++i )
+	{
+		if( value.members[ i ].first == name )
+		{
+			return &value.members[ i ].second;
+		}
+	}
+	return NULL;
+}
+
+std::string jsonText( const JsonValue& value, const char* name )
+{
+	const JsonValue* member = jsonMember( value, name );
+	return member != NULL && member->type == JsonValue::JSON_STRING ? member->text : std::string();
+}
+
+void skipJsonSpace( const char*& p )
+{
+	while( *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' )
+	{
+		++p;
+	}
+}
+
+bool parseJsonValue( const char*& p, JsonValue& value );
+
+bool parseJsonString( const char*& p, std::string& text )
+{
+	if( *p != '"' )
+	{
+		return false;
+	}
+	++p;
+
+	text.clear();
+	while( *p != '"' )
+	{
+		if( *p == '\0' )
+		{
+			return false;
+		}
+		if( *p != '\\' )
+		{
+			text += *p++;
+			continue;
+		}
+
+		++p;
+		switch( *p )
+		{
+			case 'b': text += '\b'; break;
+			case 'f': text += '\f'; break;
+			case 'n': text += '\n'; break;
+			case 'r': text += '\r'; break;
+			case 't': text += '\t'; break;
+			case 'u':
+			{
+				//Basic plane only, as UTF-8
+				char hex[ 5 ] = {};
+				for( int i = 0; i < 4; ++i )
+				{
+					if( !isxdigit( (unsigned char)p[ 1 + i ] ) )
+					{
+						return false;
+					}
+					hex[ i ] = p[ 1 + i ];
+				}
+				unsigned int code = strtoul( hex, NULL, 16 );
+				if( code < 0x80 )
+				{
+					text += (char)code;
+				}
+				else if( code < 0x800 )
+				{
+					text += (char)( 0xC0 | ( code >> 6 ) );
+					text += (char)( 0x80 | ( code & 0x3F ) );
+				}
+				else
+				{
+					text += (char)( 0xE0 | ( code >> 12 ) );
+					text += (char)( 0x80 | ( ( code >> 6 ) & 0x3F ) );
+					text += (char)( 0x80 | ( code & 0x3F ) );
+				}
+				p += 4;
+				break;
+			}
+			case '\0': return false;
+			default: text += *p; break;
+		}
+		++p;
+	}
+	++p;
+
+	return true;
+}
+
+bool parseJsonValue( const char*& p, JsonValue& value )
+{
+	skipJsonSpace( p );
+	value = JsonValue();
+
+	if( *p == '{' )
+	{
+		value.type = JsonValue::JSON_OBJECT;
+		++p;
+		skipJsonSpace( p );
+		if( *p == '}' )
+		{
+			++p;
+			return true;
+		}
+		while( true )
+		{
+			std::pair<std::string, JsonValue> member;
+			skipJsonSpace( p );
+			if( !parseJsonString( p, member.first ) )
+			{
+				return false;
+			}
+			skipJsonSpace( p );
+			if( *p++ != ':' || !parseJsonValue( p, member.second ) )
+			{
+				return false;
+			}
+			value.members.push_back( member );
+			skipJsonSpace( p );
+			if( *p == '}' )
+			{
+				++p;
+				return true;
+			}
+			if( *p++ != ',' )
+			{
+				return false;
+			}
+		}
+	}
+	else if( *p == '[' )
+	{
+		value.type = JsonValue::JSON_ARRAY;
+		++p;
+		skipJsonSpace( p );
+		if( *p == ']' )
+		{
+			++p;
+			return true;
+		}
+		while( true )
+		{
+			JsonValue item;
+			if( !parseJsonValue( p, item ) )
+			{
+				return false;
+			}
+			value.items.push_back( item );
+			skipJsonSpace( p );
+			if( *p == ']' )
+			{
+				++p;
+				return true;
+			}
+			if( *p++ != ',' )
+			{
+				return false;
+			}
+		}
+	}
+	else if( *p == '"' )
+	{
+		value.type = JsonValue::JSON_STRING;
+		return parseJsonString( p, value.text );
+	}
+	else if( strncmp( p, "null", 4 ) == 0 )
+	{
+		p += 4;
+		return true;
+	}
+	else if( strncmp( p, "true", 4 ) == 0 || strncmp( p, "false", 5 ) == 0 )
+	{
+		value.type = JsonValue::JSON_BOOL;
+		value.number = *p == 't' ? 1.0 : 0.0;
+		p += *p == 't' ? 4 : 5;
+		return true;
+	}
+
+	char* end = NULL;
+	value.type = JsonValue::JSON_NUMBER;
+	value.number = strtod( p, &end );
+	if( end == p )
+	{
+		return false;
+	}
+	p = end;
+	return true;
+}
+
+//Parses a whole document, nothing but space allowed after it
+bool parseJson( const std::string& text, JsonValue& value )
+{
+	const char* p = text.c_str();
+	if( !parseJsonValue( p, value ) )
+	{
+		return false;
+	}
+	skipJsonSpace( p );
+	return *p == '\0';
+}
+
+//A benchmark result back from JSON
+BenchResult resultFromJson( const JsonValue& value )
+{
+	BenchResult result;
+	result.name = jsonText( value, "name" );
+
+	const JsonValue* params = jsonMember( value, "params" );
+	for( size_t i = 0; params != NULL && i < params->members.size(); ++i )
+	{
+		result.params.push_back( std::make_pair( params->members[ i ].first, params->members[ i ].second.text ) );
+	}
+
+	//null metrics come back as NAN
+	const JsonValue* metrics = jsonMember( value, "metrics" );
+	for( size_t i = 0; metrics != NULL && i < metrics->members.size(); ++i )
+	{
+		const JsonValue& metric = metrics->members[ i ].second;
+		result.metrics.push_back( std::make_pair( metrics->members[ i ].first, metric.type == JsonValue::JSON_NUMBER ? metric.number : NAN ) );
+	}
+
+	return result;
+}
+
+//One recorded run of a suite
+struct HistoryRun
+{
+	std::string suite;
+	std::string rev;
+	std::string time;
+	std::string flags;
+	std::string compiler;
+	std::string cpu;
+	std::vector<BenchResult> results;
+};
+
+bool readFile( const char* path, std::string& text )
+{
+	FILE* file = fopen( path, "rb" );
+	if( file == NULL )
+	{
+		return false;
+	}
+
+	char buffer[ 65536 ];
+	size_t read = 0;
+	text.clear();
+	while( ( read = fread( buffer, 1, sizeof( buffer ), file ) ) > 0 )
+	{
+		text.append( buffer, read );
+	}
+	fclose( file );
+
+	return true;
+}
+
+//Reads every run in a history file, skipping lines that don't parse
+bool loadHistory( const char* path, std::vector<HistoryRun>& runs )
+{
+	std::string text;
+	if( !readFile( path, text ) )
+	{
+		printf( "Unable to read history %s!\n", path );
+		return false;
+	}
+
+	size_t start = 0;
+	int lineNumber = 0;
+	while( start < text.size() )
+	{
+		size_t end = text.find( '\n', start );
+		end = end == std::string::npos ? text.size() : end;
+		std::string line = text.substr( start, end - start );
+		start = end + 1;
+		++lineNumber;
+
+		if( line.find_first_not_of( " \t\r" ) == std::string::npos )
+		{
+			continue;
+		}
+
+		JsonValue value;
+		const JsonValue* results = NULL;
+		if( !parseJson( line, value ) || ( results = jsonMember( value, "results" ) ) == NULL )
+		{
+			printf( "Skipping line %d of %s, it isn't a recorded run\n", lineNumber, path );
+			continue;
+		}
+
+		HistoryRun run;
+		run.suite = jsonText( value, "suite" );
+		run.rev = jsonText( value, "rev" );
+		run.time = jsonText( value, "time" );
+		run.flags = jsonText( value, "flags" );
+		run.compiler = jsonText( value, "compiler" );
+		run.cpu = jsonText( value, "cpu" );
+		for( size_t i = 0; i < results->items.size(); ++i )
+		{
+			run.results.push_back( resultFromJson( results->items[ i ] ) );
+		}
+		runs.push_back( run );
+	}
+
+	return true;
+}
+
+//git describe of the working directory, empty outside a repository
+std::string gitRevision()
+{
+	std::string rev;
+	FILE* git = popen( "git describe --always --dirty 2>/dev/null", "r" );
+	if( git != NULL )
+	{
+		char line[ 256 ];
+		if( fgets( line, sizeof( line ), git ) != NULL )
+		{
+			rev = line;
+			rev.erase( rev.find_last_not_of( " \r\n" ) + 1 );
+		}
+		pclose( git );
+	}
+	return rev;
+}
+
+int recordRun( const char* historyPath, const char* reportPath, std::string rev )
+{
+	std::string text;
+	JsonValue report;
+	const JsonValue* results = NULL;
+	if( !readFile( reportPath, text ) )
+	{
+		printf( "Unable to read report %s!\n", reportPath );
+		return 1;
+	}
+	if( !parseJson( text, report ) || ( results = jsonMember( report, "results" ) ) == NULL )
+	{
+		printf( "%s is not a benchmark report!\n", reportPath );
+		return 1;
+	}
+
+	//What the benchmark was built from, older reports don't say
+	JsonValue none;
+	const JsonValue* build = jsonMember( report, "build" );
+	build = build != NULL ? build : &none;
+	if( rev.empty() )
+	{
+		rev = jsonText( *build, "rev" );
+	}
+	if( rev.empty() )
+	{
+		rev = gitRevision();
+	}
+	if( rev.empty() )
+	{
+		rev = "unknown";
+	}
+	std::string cpu = jsonText( *build, "cpu" );
+
+	char timeText[ 32 ];
+	time_t now = time( NULL );
+	strftime( timeText, sizeof( timeText ), "%Y-%m-%dT%H:%M:%SZ", gmtime( &now ) );
+
+	FILE* file = fopen( historyPath, "a" );
+	if( file == NULL )
+	{
+		printf( "Unable to open history %s!\n", historyPath );
+		return 1;
+	}
+
+	std::string suite = jsonText( report, "suite" );
+	fprintf( file, "{ \"suite\": " );
+	writeJsonString( file, suite );
+	fprintf( file, ", \"rev\": " );
+	writeJsonString( file, rev );
+	fprintf( file, ", \"time\": " );
+	writeJsonString( file, timeText );
+	fprintf( file, ", \"flags\": " );
+	writeJsonString( file, jsonText( *build, "flags" ) );
+	fprintf( file, ", \"compiler\": " );
+	writeJsonString( file, jsonText( *build, "compiler" ) );
+	fprintf( file, ", \"cpu\": " );
+	writeJsonString( file, cpu.empty() ? benchCpuModel() : cpu );
+	fprintf( file, ", \"results\": [" );
+	for( size_t i = 0; i < results->items.size(); ++i )
+	{
+		fprintf( file, i == 0 ? " " : ", " );
+		writeBenchResult( file, resultFromJson( results->items[ i ] ), false );
+	}
+	fprintf( file, " ] }\n" );
+	fclose( file );
+
+	printf( "Recorded %d %s results at %s in %s\n", (int)results->items.size(), suite.c_str(), rev.c_str(), historyPath );
+	return 0;
+}
+
+int listRuns( const char* historyPath )
+{
+	std::vector<HistoryRun> runs;
+	if( !loadHistory( historyPath, runs ) )
+	{
+		return 1;
+	}
+
+	//Revisions in the order they were first recorded, with runs per suite
+	std::vector<std::string> revs;
+	std::map< std::string, std::map<std::string, int> > counts;
+	std::map<std::string, std::string> firstTime;
+	for( size_t i = 0; i < runs.size(); ++i )
+	{
+		if( counts.find( runs[ i ].rev ) == counts.end() )
+		{
+			revs.push_back( runs[ i ].rev );
+			firstTime[ runs[ i ].rev ] = runs[ i ].time;
+		}
+		++counts[ runs[ i ].rev ][ runs[ i ].suite ];
+	}
+
+	printf( "%-24s %-22s %s\n", "revision", "first recorded", "runs" );
+	for( size_t r = 0; r < revs.size(); ++r )
+	{
+		std::string suites;
+		std::map<std::string, int>& suiteCounts = counts[ revs[ r ] ];
+		for( std::map<std::string, int>::iterator it = suiteCounts.begin(); it != suiteCounts.end(); ++it )
+		{
+			suites += ( suites.empty() ? "" : ", " ) + it->first + " x" + std::to_string( it->second );
+		}
+		printf( "%-24s %-22s %s\n", revs[ r ].c_str(), firstTime[ revs[ r ] ].c_str(), suites.c_str() );
+	}
+
+	return 0;
+}
+
+//The one revision in the history starting with prefix, empty if none or several do
+std::string matchRevision( const std::vector<HistoryRun>& runs, std::string prefix )
+{
+	std::string match;
+	for( size_t i = 0; i < runs.size(); ++i )
+	{
+		if( runs[ i ].rev.compare( 0, prefix.size(), prefix ) != 0 || runs[ i ].rev == match )
+		{
+			continue;
+		}
+		if( runs[ i ].rev == prefix )
+		{
+			return prefix;
+		}
+		if( !match.empty() )
+		{
+			printf( "Revision %s is ambiguous: %s and %s\n", prefix.c_str(), match.c_str(), runs[ i ].rev.c_str() );
+			return std::string();
+		}
+		match = runs[ i ].rev;
+	}
+
+	if( match.empty() )
+	{
+		printf( "No runs at revision %s\n", prefix.c_str() );
+	}
+	return match;
+}
+
+//Whether a metric gets better as it goes up, matched on whole underscore separated words so per_sprite_ms stays a time
+bool higherIsBetter( const std::string& metric )
+{
+	std::string name = "_" + metric + "_";
+	const char* suffixes[] = { "_per_s_", "_per_ms_", "_fps_" };
+	for( int i = 0; i < 3; ++i )
+	{
+		std::string suffix = suffixes[ i ];
+		if( name.size() >= suffix.size() && name.compare( name.size() - suffix.size(), suffix.size(), suffix ) == 0 )
+		{
+			return true;
+		}
+	}
+
+	const char* prefixes[] = { "_speedup_", "_saved_", "_ipc_" };
+	for( int i = 0; i < 3; ++i )
+	{
+		if( name.compare( 0, strlen( prefixes[ i ] ), prefixes[ i ] ) == 0 )
+		{
+			return true;
+		}
+	}
+	return name.find( "_saving_" ) != std::string::npos;
+}
+
+double median( std::vector<double> values )
+{
+	std::sort( values.begin(), values.end() );
+	size_t half = values.size() / 2;
+	return values.size() % 2 == 1 ? values[ half ] : ( values[ half - 1 ] + values[ half ] ) / 2.0;
+}
+
+//95% percentile bootstrap interval of median( b ) / median( a ) - 1
+void bootstrapChange( const std::vector<double>& a, const std::vector<double>& b, double& low, double& high )
+{
+	const int RESAMPLES = 2000;
+
+	//Fixed seed so the same history gives the same table
+	std::mt19937 random( 1 );
+	std::vector<double> changes;
+	std::vector<double> sampleA( a.size() );
+	std::vector<double> sampleB( b.size() );
+	for( int i = 0; i < RESAMPLES; ++i )
+	{
+		for( size_t j = 0; j < a.size(); ++j )
+		{
+			sampleA[ j ] = a[ random() % a.size() ];
+		}
+		for( size_t j = 0; j < b.size(); ++j )
+		{
+			sampleB[ j ] = b[ random() % b.size() ];
+		}
+		double medianA = median( sampleA );
+		if( medianA != 0.0 )
+		{
+			changes.push_back( median( sampleB ) / medianA - 1.0 );
+		}
+	}
+
+	if( changes.empty() )
+	{
+		low = high = NAN;
+		return;
+	}
+	std::sort( changes.begin(), changes.end() );
+	low = changes[ (size_t)( changes.size() * 0.025 ) ];
+	high = changes[ std::min( changes.size() - 1, (size_t)( changes.size() * 0.975 ) ) ];
+}
+
+//Two-sided p of the Mann-Whitney U test, exact for small samples without ties, the normal approximation otherwise
+double mannWhitneyP( const std::vector<double>& a, const std::vector<double>& b )
+{
+	//Mid ranks of both samples together
+	std::vector< std::pair<double, int> > all;
+	for( size_t i = 0; i < a.size(); ++i )
+	{
+		all.push_back( std::make_pair( a[ i ], 0 ) );
+	}
+	for( size_t i = 0; i < b.size(); ++i )
+	{
+		all.push_back( std::make_pair( b[ i ], 1 ) );
+	}
+	std::sort( all.begin(), all.end() );
+
+	double rankSumA = 0.0;
+	double tieTerm = 0.0;
+	for( size_t i = 0; i < all.size(); )
+	{
+		size_t j = i;
+		while( j < all.size() && all[ j ].first == all[ i ].first )
+		{
+			++j;
+		}
+		double rank = ( i + 1 + j ) / 2.0;
+		for( size_t k = i; k < j; ++k )
+		{
+			rankSumA += all[ k ].second == 0 ? rank : 0.0;
+		}
+		double tied = j - i;
+		tieTerm += tied * tied * tied - tied;
+		i = j;
+	}
+
+	int n1 = a.size();
+	int n2 = b.size();
+	double u = rankSumA - n1 * ( n1 + 1 ) / 2.0;
+
+	if( tieTerm == 0.0 && n1 + n2 <= 40 )
+	{
+		//counts[ j ][ u ]: orderings of i of a's and j of b's with a's U of u, built up one i at a time
+		std::vector< std::vector<double> > counts( n2 + 1, std::vector<double>( 1, 1.0 ) );
+		for( int i = 1; i <= n1; ++i )
+		{
+			std::vector< std::vector<double> > next( n2 + 1 );
+			next[ 0 ] = std::vector<double>( 1, 1.0 );
+			for( int j = 1; j <= n2; ++j )
+			{
+				//The largest value is either one of a's (beating all j of b's) or one of b's
+				next[ j ] = std::vector<double>( i * j + 1, 0.0 );
+				for( size_t k = 0; k < counts[ j ].size(); ++k )
+				{
+					next[ j ][ k + j ] += counts[ j ][ k ];
+				}
+				for( size_t k = 0; k < next[ j - 1 ].size(); ++k )
+				{
+					next[ j ][ k ] += next[ j - 1 ][ k ];
+				}
+			}
+			counts = next;
+		}
+
+		const std::vector<double>& distribution = counts[ n2 ];
+		double total = 0.0;
+		double below = 0.0;
+		double above = 0.0;
+		for( size_t k = 0; k < distribution.size(); ++k )
+		{
+			total += distribution[ k ];
+			below += k <= u ? distribution[ k ] : 0.0;
+			above += k >= u ? distribution[ k ] : 0.0;
+		}
+		return std::min( 1.0, 2.0 * std::min( below, above ) / total );
+	}
+
+	double n = n1 + n2;
+	double mean = n1 * n2 / 2.0;
+	double variance = n1 * n2 / 12.0 * ( ( n + 1.0 ) - tieTerm / ( n * ( n - 1.0 ) ) );
+	if( variance <= 0.0 )
+	{
+		return 1.0;
+	}
+	double z = std::max( 0.0, std::fabs( u - mean ) - 0.5 ) / std::sqrt( variance );
+	return std::erfc( z / std::sqrt( 2.0 ) );
+}
+
+//Identifies a result within its suite
+std::string resultKey( const BenchResult& result )
+{
+	std::string key = result.name;
+	for( size_t i = 0; i < result.params.size(); ++i )
+	{
+		key += " " + result.params[ i ].first + "=" + result.params[ i ].second;
+	}
+	return key;
+}
+
+//One result's metric over the runs at both revisions
+struct Comparison
+{
+	std::string key;
+	std::vector<double> base;
+	std::vector<double> next;
+};
+
+int compareRevisions( const char* historyPath, std::string basePrefix, std::string newPrefix, std::string metric, double threshold,
+	bool bootstrap, double alpha )
+{
+	std::vector<HistoryRun> runs;
+	if( !loadHistory( historyPath, runs ) )
+	{
+		return 1;
+	}
+	std::string baseRev = matchRevision( runs, basePrefix );
+	std::string newRev = matchRevision( runs, newPrefix );
+	if( baseRev.empty() || newRev.empty() )
+	{
+		return 1;
+	}
+
+	//Metric values per suite and result, in the order they first appear
+	std::vector<std::string> suites;
+	std::map< std::string, std::vector<Comparison> > comparisons;
+	std::map< std::string, int > baseRuns;
+	std::map< std::string, int > newRuns;
+	std::map< std::string, std::string > baseCpu;
+	std::map< std::string, bool > mixedCpus;
+	for( size_t r = 0; r < runs.size(); ++r )
+	{
+		const HistoryRun& run = runs[ r ];
+		bool isBase = run.rev == baseRev;
+		if( !isBase && run.rev != newRev )
+		{
+			continue;
+		}
+
+		if( comparisons.find( run.suite ) == comparisons.end() )
+		{
+			suites.push_back( run.suite );
+		}
+		std::vector<Comparison>& suite = comparisons[ run.suite ];
+		++( isBase ? baseRuns : newRuns )[ run.suite ];
+
+		//Numbers from different CPUs don't compare
+		if( baseCpu.find( run.suite ) == baseCpu.end() )
+		{
+			baseCpu[ run.suite ] = run.cpu;
+		}
+		mixedCpus[ run.suite ] = mixedCpus[ run.suite ] || baseCpu[ run.suite ] != run.cpu;
+
+		for( size_t i = 0; i < run.results.size(); ++i )
+		{
+			const BenchResult& result = run.results[ i ];
+			for( size_t m = 0; m < result.metrics.size(); ++m )
+			{
+				if( result.metrics[ m ].first != metric || !std::isfinite( result.metrics[ m ].second ) )
+				{
+					continue;
+				}
+
+				std::string key = resultKey( result );
+				size_t c = 0;
+				while( c < suite.size() && suite[ c ].key != key )
+				{
+					++c;
+				}
+				if( c == suite.size() )
+				{
+					suite.push_back( Comparison() );
+					suite[ c ].key = key;
+				}
+				( isBase ? suite[ c ].base : suite[ c ].next ).push_back( result.metrics[ m ].second );
+			}
+		}
+	}
+
+	bool higher = higherIsBetter( metric );
+	printf( "%s (%s is better), base %s against new %s, %.1f%% threshold, %s\n", metric.c_str(), higher ? "higher" : "lower", baseRev.c_str(),
+		newRev.c_str(), threshold, bootstrap ? "bootstrap 95% interval" : "Mann-Whitney U" );
+
+	int regressions = 0;
+	for( size_t s = 0; s < suites.size(); ++s )
+	{
+		std::vector<Comparison>& suite = comparisons[ suites[ s ] ];
+		printf( "\n%s: %d base runs, %d new runs%s\n", suites[ s ].c_str(), baseRuns[ suites[ s ] ], newRuns[ suites[ s ] ],
+			mixedCpus[ suites[ s ] ] ? " (WARNING: runs come from different CPUs)" : "" );
+		printf( "  %-52s %12s %12s %9s %19s  %s\n", "result", "base", "new", "change", bootstrap ? "95% interval" : "p", "verdict" );
+
+		int suiteRegressions = 0;
+		int suiteImprovements = 0;
+		int compared = 0;
+		double logRatios = 0.0;
+		for( size_t c = 0; c < suite.size(); ++c )
+		{
+			Comparison& comparison = suite[ c ];
+			if( comparison.base.empty() || comparison.next.empty() )
+			{
+				continue;
+			}
+
+			double baseMedian = median( comparison.base );
+			double newMedian = median( comparison.next );
+			double change = baseMedian != 0.0 ? newMedian / baseMedian - 1.0 : NAN;
+			if( baseMedian > 0.0 && newMedian > 0.0 )
+			{
+				logRatios += std::log( newMedian / baseMedian );
+				++compared;
+			}
+
+			//How much worse, in percent, whichever way worse is
+			double worse = ( higher ? -change : change ) * 100.0;
+
+			char test[ 32 ] = "-";
+			const char* verdict = "few runs";
+			if( comparison.base.size() >= 2 && comparison.next.size() >= 2 && std::isfinite( change ) )
+			{
+				bool significant = false;
+				if( bootstrap )
+				{
+					double low = 0.0;
+					double high = 0.0;
+					bootstrapChange( comparison.base, comparison.next, low, high );
+					significant = low > 0.0 || high < 0.0;
+					snprintf( test, sizeof( test ), "%+.1f%% .. %+.1f%%", low * 100.0, high * 100.0 );
+				}
+				else
+				{
+					double p = mannWhitneyP( comparison.base, comparison.next );
+					significant = p < alpha;
+					snprintf( test, sizeof( test ), "%.4f", p );
+				}
+
+				verdict = "same";
+				if( significant && worse > threshold )
+				{
+					verdict = "REGRESSION";
+					++suiteRegressions;
+				}
+				else if( significant && worse < -threshold )
+				{
+					verdict = "improved";
+					++suiteImprovements;
+				}
+			}
+
+			printf( "  %-52s %12.4g %12.4g %+8.1f%% %19s  %s\n", comparison.key.substr( 0, 52 ).c_str(), baseMedian, newMedian, change * 100.0, test, verdict );
+		}
+
+		if( compared > 0 )
+		{
+			printf( "  %d compared, %d regressed, %d improved, geometric mean change %+.1f%%\n", compared, suiteRegressions, suiteImprovements,
+				( std::exp( logRatios / compared ) - 1.0 ) * 100.0 );
+		}
+		else
+		{
+			printf( "  no %s at both revisions\n", metric.c_str() );
+		}
+		regressions += suiteRegressions;
+	}
+
+	printf( "\n%d regression%s\n", regressions, regressions == 1 ? "" : "s" );
+	return regressions > 0 ? 2 : 0;
+}
+
+int usage( const char* program )
+{
+	printf( "Usage: %s record history.jsonl report.json [--rev REV]\n", program );
+	printf( "       %s list history.jsonl\n", program );
+	printf( "       %s compare history.jsonl BASE NEW [--metric median_ms] [--threshold 5] [--test bootstrap|mann-whitney] [--alpha 0.05]\n", program );
+	return 1;
+}
+
+int main( int argc, char* args[] )
+{
+	if( argc < 3 )
+	{
+		return usage( args[ 0 ] );
+	}
+
+	std::string command = args[ 1 ];
+	const char* historyPath = args[ 2 ];
+
+	//Positional arguments after the history and options anywhere after them
+	std::vector<std::string> positional;
+	std::string rev;
+	std::string metric = "median_ms";
+	double threshold = 5.0;
+	bool bootstrap = true;
+	double alpha = 0.05;
+	for( int i = 3; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--rev" && i + 1 < argc )
+		{
+			rev = args[ ++i ];
+		}
+		else if( arg == "--metric" && i + 1 < argc )
+		{
+			metric = args[ ++i ];
+		}
+		else if( arg == "--threshold" && i + 1 < argc )
+		{
+			threshold = atof( args[ ++i ] );
+			threshold = SDL_max( 0.0, threshold );
+		}
+		else if( arg == "--test" && i + 1 < argc )
+		{
+			std::string test = args[ ++i ];
+			if( test != "bootstrap" && test != "mann-whitney" )
+			{
+				return usage( args[ 0 ] );
+			}
+			bootstrap = test == "bootstrap";
+		}
+		else if( arg == "--alpha" && i + 1 < argc )
+		{
+			alpha = atof( args[ ++i ] );
+		}
+		else if( arg.size() > 2 && arg.compare( 0, 2, "--" ) == 0 )
+		{
+			return usage( args[ 0 ] );
+		}
+		else
+		{
+			positional.push_back( arg );
+		}
+	}
+
+	if( command == "record" && positional.size() == 1 )
+	{
+		return recordRun( historyPath, positional[ 0 ].c_str(), rev );
+	}
+	else if( command == "list" && positional.empty() )
+	{
+		return listRuns( historyPath );
+	}
+	else if( command == "compare" && positional.size() == 2 )
+	{
+		return compareRevisions( historyPath, positional[ 0 ], positional[ 1 ], metric, threshold, bootstrap, alpha );
+	}
+
+	return usage( args[ 0 ] );
+}
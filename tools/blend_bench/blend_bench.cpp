@@ -0,0 +1,267 @@
+/*Alpha blend benchmark.
+
+	blend_bench [--reps 200] [--json out.json] [image.png ...]
+
+Blends ARGB8888 sprites onto a 640x480 XRGB8888 surface with SDL_BlitSurface (SDL_BLENDMODE_BLEND, ADD and MOD on the
+straight alpha image) and with common/alpha_blend.h on the premultiplied image (scalar, SSE2 and AVX2 kernels), and
+reports megapixels blended per second. Without image arguments it uses generated 256x256 sprites:
+	sprite       a disc with a soft edge, transparent corners and an opaque middle, like most game sprites
+	opaque       every pixel opaque
+	transparent  every pixel transparent
+	gradient     every pixel partially transparent, the worst case for the run fast paths
+*/
+
+//Using SDL, SDL_image, standard IO, strings and the blend kernels
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "../../common/bench_report.h"
+#include "../../common/image_cache.h"
+#include "../../common/alpha_blend.h"
+
+//Destination dimensions, the lessons' screen size
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+
+//Generated sprite size
+const int SPRITE_SIZE = 256;
+
+//A source to blend
+struct BlendSource
+{
+	std::string name;
+	SDL_Surface* straight;
+	SDL_Surface* premultiplied;
+};
+
+//Makes one of the generated sprites with straight alpha
+SDL_Surface* makeSprite( std::string kind )
+{
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat( 0, SPRITE_SIZE, SPRITE_SIZE, 32, SDL_PIXELFORMAT_ARGB8888 );
+	if( surface == NULL )
+	{
+		return NULL;
+	}
+
+	float center = SPRITE_SIZE / 2.0f;
+	for( int y = 0; y < SPRITE_SIZE; ++y )
+	{
+		Uint32* row = (Uint32*)( (Uint8*)surface->pixels + y * surface->pitch );
+		for( int x = 0; x < SPRITE_SIZE; ++x )
+		{
+			Uint32 alpha = 0xFF;
+			if( kind == "sprite" )
+			{
+				//Opaque inside radius 100, fading out to transparent at 120
+				float distance = sqrtf( ( x - center ) * ( x - center ) + ( y - center ) * ( y - center ) );
+				alpha = (Uint32)SDL_max( 0.0f, SDL_min( 255.0f, ( 120.0f - distance ) * 255.0f / 20.0f ) );
+			}
+			else if( kind == "transparent" )
+			{
+				alpha = 0;
+			}
+			else if( kind == "gradient" )
+			{
+				alpha = 1 + ( x + y ) * 253 / ( 2 * SPRITE_SIZE );
+			}
+			row[ x ] = ( alpha << 24 ) | ( (Uint32)x << 16 ) | ( (Uint32)y << 8 ) | 0x80;
+		}
+	}
+
+	return surface;
+}
+
+//Fills the destination with something other than one color so the blend has real work
+void resetDestination( SDL_Surface* screen )
+{
+	for( int y = 0; y < screen->h; ++y )
+	{
+		Uint32* row = (Uint32*)( (Uint8*)screen->pixels + y * screen->pitch );
+		for( int x = 0; x < screen->w; ++x )
+		{
+			row[ x ] = 0xFF000000 | ( (Uint32)( x & 0xFF ) << 16 ) | ( (Uint32)( y & 0xFF ) << 8 ) | (Uint32)( ( x + y ) & 0xFF );
+		}
+	}
+}
+
+//Ways of blending
+enum BlendMethod
+{
+	METHOD_SDL,
+	METHOD_SCALAR,
+	METHOD_SSE2,
+	METHOD_AVX2,
+	METHOD_TOTAL
+};
+const char* METHOD_NAMES[ METHOD_TOTAL ] = { "sdl", "scalar", "sse2", "avx2" };
+
+int main( int argc, char* args[] )
+{
+	int reps = 200;
+	const char* jsonPath = NULL;
+	std::vector<std::string> imagePaths;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--reps" && i + 1 < argc )
+		{
+			reps = atoi( args[ ++i ] );
+			reps = SDL_max( 1, reps );
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else if( arg.size() > 2 && arg.compare( 0, 2, "--" ) == 0 )
+		{
+			printf( "Usage: %s [--reps N] [--json out.json] [image.png ...]\n", args[ 0 ] );
+			return 1;
+		}
+		else
+		{
+			imagePaths.push_back( arg );
+		}
+	}
+
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//Gather the sources in both forms
+	std::vector<BlendSource> sources;
+	if( imagePaths.empty() )
+	{
+		const char* kinds[] = { "sprite", "opaque", "transparent", "gradient" };
+		for( int i = 0; i < 4; ++i )
+		{
+			BlendSource source = { kinds[ i ], makeSprite( kinds[ i ] ), makeSprite( kinds[ i ] ) };
+			sources.push_back( source );
+		}
+	}
+	else
+	{
+		for( size_t i = 0; i < imagePaths.size(); ++i )
+		{
+			SDL_Surface* straight = decodeImageToFormat( imagePaths[ i ], SDL_PIXELFORMAT_ARGB8888 );
+			if( straight == NULL )
+			{
+				printf( "Unable to load %s! SDL Error: %s\n", imagePaths[ i ].c_str(), SDL_GetError() );
+				continue;
+			}
+			BlendSource source = { imagePaths[ i ], straight, SDL_ConvertSurfaceFormat( straight, SDL_PIXELFORMAT_ARGB8888, 0 ) };
+			sources.push_back( source );
+		}
+	}
+
+	SDL_Surface* screen = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGB888 );
+	if( screen == NULL )
+	{
+		printf( "Unable to create destination surface! SDL Error: %s\n", SDL_GetError() );
+		SDL_Quit();
+		return 1;
+	}
+
+	BlendPath best = bestBlendPath();
+	BenchReport report;
+	report.suite = "blend_bench";
+
+	printf( "%d reps per point, best kernels: %s\n", reps, blendPathName( best ) );
+	printf( "%-12s %5s %8s %12s %10s\n", "source", "op", "method", "MPix/s", "vs sdl" );
+	for( size_t s = 0; s < sources.size(); ++s )
+	{
+		BlendSource& source = sources[ s ];
+		if( source.straight == NULL || source.premultiplied == NULL )
+		{
+			continue;
+		}
+		premultiplySurfaceAlpha( source.premultiplied );
+
+		for( int o = 0; o < BLEND_OP_TOTAL; ++o )
+		{
+			BlendOp op = (BlendOp)o;
+			SDL_BlendMode sdlMode = op == BLEND_OVER ? SDL_BLENDMODE_BLEND : op == BLEND_ADD ? SDL_BLENDMODE_ADD : SDL_BLENDMODE_MOD;
+			SDL_SetSurfaceBlendMode( source.straight, sdlMode );
+
+			double sdlRate = 0.0;
+			for( int m = 0; m < METHOD_TOTAL; ++m )
+			{
+				BlendMethod method = (BlendMethod)m;
+				BlendPath path = method == METHOD_SCALAR ? BLEND_PATH_SCALAR : method == METHOD_SSE2 ? BLEND_PATH_SSE2 : BLEND_PATH_AVX2;
+				if( ( method == METHOD_AVX2 && best != BLEND_PATH_AVX2 ) || ( method == METHOD_SSE2 && best == BLEND_PATH_SCALAR ) )
+				{
+					continue;
+				}
+
+				//Each rep blends the source at a different spot, clipped at the edges like a moving sprite would be
+				std::vector<double> samples;
+				long long pixels = 0;
+				resetDestination( screen );
+				for( int rep = -1; rep < reps; ++rep )
+				{
+					SDL_Rect position = { ( rep * 37 ) % SCREEN_WIDTH - source.straight->w / 4, ( rep * 53 ) % SCREEN_HEIGHT - source.straight->h / 4, 0, 0 };
+					double start = benchNowMs();
+					if( method == METHOD_SDL )
+					{
+						SDL_BlitSurface( source.straight, NULL, screen, &position );
+					}
+					else
+					{
+						blitPremultiplied( source.premultiplied, NULL, screen, &position, op, path );
+					}
+					double elapsed = benchNowMs() - start;
+
+					//The first blit is an untimed warmup
+					if( rep >= 0 )
+					{
+						samples.push_back( elapsed );
+						pixels += position.w * position.h;
+					}
+				}
+
+				BenchStats stats = summarizeSamples( samples );
+				double totalMs = stats.mean * stats.samples;
+				double rate = totalMs > 0.0 ? pixels / totalMs / 1000.0 : 0.0;
+				if( method == METHOD_SDL )
+				{
+					sdlRate = rate;
+				}
+				double speedup = sdlRate > 0.0 ? rate / sdlRate : 0.0;
+				printf( "%-12s %5s %8s %12.1f %9.2fx\n", source.name.c_str(), blendOpName( op ), METHOD_NAMES[ m ], rate, speedup );
+
+				BenchResult result;
+				result.name = "blend";
+				result.params.push_back( std::make_pair( "source", source.name ) );
+				result.params.push_back( std::make_pair( "op", blendOpName( op ) ) );
+				result.params.push_back( std::make_pair( "method", METHOD_NAMES[ m ] ) );
+				result.metrics.push_back( std::make_pair( "mpix_per_s", rate ) );
+				result.metrics.push_back( std::make_pair( "speedup_vs_sdl", speedup ) );
+				addStatsMetrics( result, stats );
+				report.results.push_back( result );
+			}
+		}
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	for( size_t s = 0; s < sources.size(); ++s )
+	{
+		SDL_FreeSurface( sources[ s ].straight );
+		SDL_FreeSurface( sources[ s ].premultiplied );
+	}
+	SDL_FreeSurface( screen );
+	IMG_Quit();
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+/*Benchmarks image decode speed of the lessons' own images.
+
+	decode_bench [--reps N] [--threads N] [--json out.json] [images...]
+
+For every image it times file -> SDL_Surface with SDL_LoadBMP (BMP only), IMG_Load, plain single stream .qoi, and striped
+.qois with one thread and on a job system with --threads workers (default: one per CPU). Throughput is decoded MB/s,
+counting 4 bytes per pixel for every loader so the numbers are comparable. Run it from this directory so the default
+image list resolves.
+*/
+
+//Using SDL, SDL_image, standard IO, strings, the QOI codec and the job system
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include "../../common/strip_qoi.h"
+#include "../../common/job_system.h"
+#include "../../common/bench_report.h"
+
+//The repo's images, relative to this directory
+const char* DEFAULT_IMAGES[] =
+{
+	"../../02_getting_an_image_on_the_screen/hello_world.bmp",
+	"../../03_event_driven_programming/x.bmp",
+	"../../04_key_presses/press.bmp",
+	"../../04_key_presses/up.bmp",
+	"../../05_optimized_surface_loading_and_soft_stretching/stretch.bmp",
+	"../../06_extension_libraries_and_loading_other_image_formats/loaded.png",
+	"../../06_extension_libraries_and_loading_other_image_formats/lamine.jpg",
+	"../../07_texture_loading_and_rendering/texture.png"
+};
+
+//Temporary encoded copies
+const char* TEMP_QOI = "decode_bench_tmp.qoi";
+const char* TEMP_QOIS = "decode_bench_tmp.qois";
+
+//Times a loader, returns false if it ever fails
+bool timeLoader( std::function<SDL_Surface*()> loader, int reps, std::vector<double>& samples )
+{
+	//One untimed run to warm the page cache
+	SDL_Surface* warm = loader();
+	if( warm == NULL )
+	{
+		return false;
+	}
+	SDL_FreeSurface( warm );
+
+	for( int i = 0; i < reps; ++i )
+	{
+		double start = benchNowMs();
+		SDL_Surface* surface = loader();
+		samples.push_back( benchNowMs() - start );
+		if( surface == NULL )
+		{
+			return false;
+		}
+		SDL_FreeSurface( surface );
+	}
+
+	return true;
+}
+
+int main( int argc, char* args[] )
+{
+	int reps = 20;
+	int threads = 0;
+	const char* jsonPath = NULL;
+	std::vector<std::string> images;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--reps" && i + 1 < argc )
+		{
+			reps = atoi( args[ ++i ] );
+		}
+		else if( arg == "--threads" && i + 1 < argc )
+		{
+			threads = atoi( args[ ++i ] );
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			images.push_back( arg );
+		}
+	}
+	if( images.empty() )
+	{
+		for( size_t i = 0; i < sizeof( DEFAULT_IMAGES ) / sizeof( DEFAULT_IMAGES[ 0 ] ); ++i )
+		{
+			images.push_back( DEFAULT_IMAGES[ i ] );
+		}
+	}
+
+	//Initialize SDL and the image loaders
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+	IMG_Init( IMG_INIT_PNG | IMG_INIT_JPG );
+
+	//Workers for the parallel .qois decode, this thread being the first
+	JobSystem jobs;
+	startJobSystem( jobs, threads );
+	threads = jobWorkerCount( jobs );
+
+	BenchReport report;
+	report.suite = "decode_bench";
+
+	printf( "%-28s %-12s %10s %10s %10s\n", "image", "loader", "bytes", "median ms", "MB/s" );
+	for( size_t i = 0; i < images.size(); ++i )
+	{
+		std::string path = images[ i ];
+		std::string name = path.substr( path.find_last_of( "/\\" ) + 1 );
+
+		//Make the encoded copies
+		SDL_Surface* source = IMG_Load( path.c_str() );
+		if( source == NULL )
+		{
+			printf( "Unable to load image %s! SDL_image Error: %s\n", path.c_str(), IMG_GetError() );
+			continue;
+		}
+		std::vector<Uint8> plain;
+		std::vector<Uint8> striped;
+		encodeStripQOI( source, 0, plain );
+		encodeStripQOI( source, QOIS_DEFAULT_STRIP_ROWS, striped );
+		writeImageFile( TEMP_QOI, plain );
+		writeImageFile( TEMP_QOIS, striped );
+		double decodedMB = (double)source->w * source->h * 4 / ( 1024.0 * 1024.0 );
+		SDL_FreeSurface( source );
+
+		//File sizes for the report
+		std::vector<Uint8> original;
+		readImageFile( path, original );
+
+		//Loaders to compare
+		struct Loader
+		{
+			std::string name;
+			size_t bytes;
+			std::function<SDL_Surface*()> load;
+		};
+		std::vector<Loader> loaders;
+		bool isBMP = name.size() > 4 && name.substr( name.size() - 4 ) == ".bmp";
+		if( isBMP )
+		{
+			loaders.push_back( { "SDL_LoadBMP", original.size(), [ path ]() { return SDL_LoadBMP( path.c_str() ); } } );
+		}
+		loaders.push_back( { "IMG_Load", original.size(), [ path ]() { return IMG_Load( path.c_str() ); } } );
+		loaders.push_back( { "qoi", plain.size(), []() { return loadStripQOI( TEMP_QOI, NULL ); } } );
+		loaders.push_back( { "qois x1", striped.size(), []() { return loadStripQOI( TEMP_QOIS, NULL ); } } );
+		loaders.push_back( { "qois x" + std::to_string( threads ), striped.size(), [ &jobs ]() { return loadStripQOI( TEMP_QOIS, &jobs ); } } );
+
+		for( size_t l = 0; l < loaders.size(); ++l )
+		{
+			std::vector<double> samples;
+			if( !timeLoader( loaders[ l ].load, reps, samples ) )
+			{
+				printf( "%-28s %-12s failed: %s\n", name.c_str(), loaders[ l ].name.c_str(), SDL_GetError() );
+				continue;
+			}
+
+			BenchStats stats = summarizeSamples( samples );
+			double mbPerSec = stats.median > 0.0 ? decodedMB / ( stats.median / 1000.0 ) : 0.0;
+			printf( "%-28s %-12s %10zu %10.3f %10.1f\n", name.c_str(), loaders[ l ].name.c_str(), loaders[ l ].bytes, stats.median, mbPerSec );
+
+			BenchResult result;
+			result.name = "decode";
+			result.params.push_back( std::make_pair( "image", name ) );
+			result.params.push_back( std::make_pair( "loader", loaders[ l ].name ) );
+			result.metrics.push_back( std::make_pair( "file_bytes", (double)loaders[ l ].bytes ) );
+			result.metrics.push_back( std::make_pair( "decoded_mb_per_s", mbPerSec ) );
+			addStatsMetrics( result, stats );
+			report.results.push_back( result );
+		}
+	}
+
+	remove( TEMP_QOI );
+	remove( TEMP_QOIS );
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	stopJobSystem( jobs );
+	IMG_Quit();
+	SDL_Quit();
+
+	return 0;
+}
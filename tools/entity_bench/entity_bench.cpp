@@ -0,0 +1,269 @@
+/*Entity update and submit benchmark.
+
+	entity_bench [--entities 1000000] [--frames 20] [--threads N] [--no-submit] [--json out.json]
+
+Moves N bouncing rects per frame and writes them as SDL_Vertex quads for one SDL_RenderGeometry call, three ways:
+	aos      array of structs, one entity after another, scalar, one thread (the baseline)
+	soa      common/entity_store.h on one thread
+	soa-mt   common/entity_store.h on a job system with --threads workers (default every CPU)
+Every mode writes into the same reused vertex buffer. update is the move plus the vertex write, submit is
+SDL_RenderGeometry and SDL_RenderPresent on SDL's software renderer into a 640x480 surface.
+*/
+
+//Using SDL, standard IO, strings, the entity store and the job system
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../common/bench_report.h"
+#include "../../common/entity_store.h"
+#include "../../common/job_system.h"
+
+//Screen dimension constants
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+
+//A fixed step so every mode moves the same distance
+const float FRAME_DT = 1.0f / 60.0f;
+
+//One entity in the array of structs baseline
+struct Entity
+{
+	float x, y;
+	float vx, vy;
+	float w, h;
+	SDL_Color color;
+};
+
+//Builds the baseline from the same entities the store has
+std::vector<Entity> copyToStructs( const EntityStore& store )
+{
+	std::vector<Entity> entities( store.count );
+	for( int i = 0; i < store.count; ++i )
+	{
+		Entity& entity = entities[ i ];
+		entity.x = store.x[ i ];
+		entity.y = store.y[ i ];
+		entity.vx = store.vx[ i ];
+		entity.vy = store.vy[ i ];
+		entity.w = store.w[ i ];
+		entity.h = store.h[ i ];
+		memcpy( &entity.color, &store.color[ i ], sizeof( Uint32 ) );
+	}
+
+	return entities;
+}
+
+//The baseline update, the way a straightforward game loop would write it
+void updateStructs( std::vector<Entity>& entities, float dt, SDL_Vertex* vertices )
+{
+	for( size_t i = 0; i < entities.size(); ++i )
+	{
+		Entity& entity = entities[ i ];
+
+		float nx = entity.x + entity.vx * dt;
+		if( nx < 0.0f || nx + entity.w > SCREEN_WIDTH )
+		{
+			entity.vx = -entity.vx;
+		}
+		else
+		{
+			entity.x = nx;
+		}
+
+		float ny = entity.y + entity.vy * dt;
+		if( ny < 0.0f || ny + entity.h > SCREEN_HEIGHT )
+		{
+			entity.vy = -entity.vy;
+		}
+		else
+		{
+			entity.y = ny;
+		}
+
+		SDL_Vertex* vertex = vertices + i * 4;
+		vertex[ 0 ].position = { entity.x, entity.y };
+		vertex[ 1 ].position = { entity.x + entity.w, entity.y };
+		vertex[ 2 ].position = { entity.x + entity.w, entity.y + entity.h };
+		vertex[ 3 ].position = { entity.x, entity.y + entity.h };
+		for( int v = 0; v < 4; ++v )
+		{
+			vertex[ v ].color = entity.color;
+			vertex[ v ].tex_coord = { 0.0f, 0.0f };
+		}
+	}
+}
+
+//Ways of updating
+enum EntityMode
+{
+	ENTITY_MODE_AOS,
+	ENTITY_MODE_SOA,
+	ENTITY_MODE_SOA_MT,
+	ENTITY_MODE_TOTAL
+};
+const char* ENTITY_MODE_NAMES[ ENTITY_MODE_TOTAL ] = { "aos", "soa", "soa-mt" };
+
+int main( int argc, char* args[] )
+{
+	int count = 1000000;
+	int frames = 20;
+	int threads = 0;
+	bool submit = true;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--entities" && i + 1 < argc )
+		{
+			count = atoi( args[ ++i ] );
+			count = SDL_max( 1, count );
+		}
+		else if( arg == "--frames" && i + 1 < argc )
+		{
+			frames = atoi( args[ ++i ] );
+			frames = SDL_max( 1, frames );
+		}
+		else if( arg == "--threads" && i + 1 < argc )
+		{
+			threads = atoi( args[ ++i ] );
+		}
+		else if( arg == "--no-submit" )
+		{
+			submit = false;
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Usage: %s [--entities N] [--frames N] [--threads N] [--no-submit] [--json out.json]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//Software renderer into a plain surface, no window needed
+	SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888 );
+	SDL_Renderer* renderer = target != NULL ? SDL_CreateSoftwareRenderer( target ) : NULL;
+	if( renderer == NULL )
+	{
+		printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
+		SDL_FreeSurface( target );
+		SDL_Quit();
+		return 1;
+	}
+
+	//The same starting entities for every mode
+	SDL_FRect bounds = { 0.0f, 0.0f, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT };
+	EntityStore initial;
+	if( !createEntityStore( initial, count, bounds ) )
+	{
+		printf( "Unable to allocate %d entities! SDL Error: %s\n", count, SDL_GetError() );
+		SDL_DestroyRenderer( renderer );
+		SDL_FreeSurface( target );
+		SDL_Quit();
+		return 1;
+	}
+	spawnRandomEntities( initial, count, 12345 );
+
+	std::vector<SDL_Vertex> vertices( count * 4 );
+	std::vector<int> indices;
+	buildQuadIndices( indices, count );
+
+	//Workers for soa-mt, this thread being the first
+	JobSystem jobs;
+	startJobSystem( jobs, threads );
+	threads = jobWorkerCount( jobs );
+
+	BenchReport report;
+	report.suite = "entity_bench";
+
+	printf( "%d entities, %d frames, %d threads for soa-mt\n", count, frames, threads );
+	printf( "%8s %12s %12s %12s\n", "mode", "update ms", "submit ms", "total ms" );
+	for( int m = 0; m < ENTITY_MODE_TOTAL; ++m )
+	{
+		EntityMode mode = (EntityMode)m;
+
+		EntityStore store;
+		createEntityStore( store, count, bounds );
+		for( int i = 0; i < count; ++i )
+		{
+			SDL_Color color;
+			memcpy( &color, &initial.color[ i ], sizeof( Uint32 ) );
+			addEntity( store, initial.x[ i ], initial.y[ i ], initial.vx[ i ], initial.vy[ i ], initial.w[ i ], initial.h[ i ], color );
+		}
+		std::vector<Entity> entities = copyToStructs( initial );
+
+		//Frame 0 is an untimed warmup
+		std::vector<double> updateSamples, submitSamples, totalSamples;
+		for( int frame = 0; frame <= frames; ++frame )
+		{
+			double start = benchNowMs();
+			if( mode == ENTITY_MODE_AOS )
+			{
+				updateStructs( entities, FRAME_DT, vertices.data() );
+			}
+			else
+			{
+				updateEntities( store, FRAME_DT, vertices.data(), NULL, mode == ENTITY_MODE_SOA ? NULL : &jobs );
+			}
+			double updated = benchNowMs();
+
+			if( submit )
+			{
+				SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+				SDL_RenderClear( renderer );
+				SDL_RenderGeometry( renderer, NULL, vertices.data(), count * 4, indices.data(), count * 6 );
+				SDL_RenderPresent( renderer );
+			}
+			double end = benchNowMs();
+
+			if( frame > 0 )
+			{
+				updateSamples.push_back( updated - start );
+				submitSamples.push_back( end - updated );
+				totalSamples.push_back( end - start );
+			}
+		}
+		freeEntityStore( store );
+
+		BenchStats update = summarizeSamples( updateSamples );
+		BenchStats submitted = summarizeSamples( submitSamples );
+		BenchStats total = summarizeSamples( totalSamples );
+		printf( "%8s %12.3f %12.3f %12.3f\n", ENTITY_MODE_NAMES[ m ], update.median, submitted.median, total.median );
+
+		BenchResult result;
+		result.name = "entities";
+		result.params.push_back( std::make_pair( "mode", ENTITY_MODE_NAMES[ m ] ) );
+		result.params.push_back( std::make_pair( "entities", std::to_string( count ) ) );
+		result.params.push_back( std::make_pair( "threads", std::to_string( mode == ENTITY_MODE_SOA_MT ? threads : 1 ) ) );
+		result.params.push_back( std::make_pair( "submit", submit ? "software" : "none" ) );
+		result.metrics.push_back( std::make_pair( "update_median_ms", update.median ) );
+		result.metrics.push_back( std::make_pair( "submit_median_ms", submitted.median ) );
+		addStatsMetrics( result, total );
+		report.results.push_back( result );
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	stopJobSystem( jobs );
+	freeEntityStore( initial );
+	SDL_DestroyRenderer( renderer );
+	SDL_FreeSurface( target );
+	SDL_Quit();
+
+	return 0;
+}
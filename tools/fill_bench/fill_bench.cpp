@@ -0,0 +1,231 @@
+/*Full surface fill benchmark.
+
+	fill_bench [--reps 50] [--threads N] [--json out.json]
+
+Fills XRGB8888 surfaces from 640x480 to 8K (7680x4320) with every fill mode common/fill_engine.h has, every way:
+	sdl       SDL_FillRect: one call for solid, one per row for the vertical gradient, one per column for the horizontal
+	          one and one per cell for the checker, which is how the lessons would draw them
+	scalar    fillSurface's plain C rows on one thread
+	sse2      its SSE2 rows on one thread, cached stores (skipped on CPUs without SSE2)
+	avx2      its AVX2 rows on one thread, cached stores (skipped on CPUs without AVX2)
+	stream    the best rows on one thread with non-temporal stores
+	threaded  fillSurface's defaults: the best rows on a job system with --threads workers (every CPU by default),
+	          started once before the first fill, streaming stores only for surfaces over FILL_STREAM_MIN_BYTES
+and reports the time per fill and GB/s written. Streaming stores lose on surfaces that fit in the cache and win once
+they don't, so the interesting rows are stream against avx2 at 4K and 8K.
+*/
+
+//Using SDL, standard IO, strings, the fill engine and the job system
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../../common/bench_report.h"
+#include "../../common/fill_engine.h"
+#include "../../common/job_system.h"
+
+//Ways of filling
+enum FillMethod
+{
+	METHOD_SDL,
+	METHOD_SCALAR,
+	METHOD_SSE2,
+	METHOD_AVX2,
+	METHOD_STREAM,
+	METHOD_THREADED,
+	METHOD_TOTAL
+};
+const char* METHOD_NAMES[ METHOD_TOTAL ] = { "sdl", "scalar", "sse2", "avx2", "stream", "threaded" };
+
+//Checker cell size in pixels
+const int CHECKER_CELL = 32;
+
+//The fill done with SDL_FillRect alone
+int fillWithSDL( SDL_Surface* surface, const FillSpec& spec )
+{
+	SDL_Rect rect = { 0, 0, surface->w, surface->h };
+	switch( spec.mode )
+	{
+		case FILL_VERTICAL_GRADIENT:
+		rect.h = 1;
+		for( rect.y = 0; rect.y < surface->h; ++rect.y )
+		{
+			SDL_FillRect( surface, &rect, blendFillColor( spec.color0, spec.color1, surface->h > 1 ? rect.y * 255 / ( surface->h - 1 ) : 0 ) );
+		}
+		return 0;
+
+		case FILL_HORIZONTAL_GRADIENT:
+		rect.w = 1;
+		for( rect.x = 0; rect.x < surface->w; ++rect.x )
+		{
+			SDL_FillRect( surface, &rect, blendFillColor( spec.color0, spec.color1, surface->w > 1 ? rect.x * 255 / ( surface->w - 1 ) : 0 ) );
+		}
+		return 0;
+
+		case FILL_CHECKER:
+		rect.w = spec.cell;
+		rect.h = spec.cell;
+		for( rect.y = 0; rect.y < surface->h; rect.y += spec.cell )
+		{
+			for( rect.x = 0; rect.x < surface->w; rect.x += spec.cell )
+			{
+				SDL_FillRect( surface, &rect, ( ( rect.x / spec.cell + rect.y / spec.cell ) & 1 ) ? spec.color1 : spec.color0 );
+			}
+		}
+		return 0;
+
+		default:
+		return SDL_FillRect( surface, NULL, spec.color0 );
+	}
+}
+
+//Fills surface one way
+int fillFrame( FillMethod method, SDL_Surface* surface, const FillSpec& spec, JobSystem& jobs )
+{
+	switch( method )
+	{
+		case METHOD_SDL:
+		return fillWithSDL( surface, spec );
+
+		case METHOD_SCALAR:
+		return fillSurface( surface, NULL, spec, FILL_PATH_SCALAR, NULL, FILL_STORES_CACHED );
+
+		case METHOD_SSE2:
+		return fillSurface( surface, NULL, spec, FILL_PATH_SSE2, NULL, FILL_STORES_CACHED );
+
+		case METHOD_AVX2:
+		return fillSurface( surface, NULL, spec, FILL_PATH_AVX2, NULL, FILL_STORES_CACHED );
+
+		case METHOD_STREAM:
+		return fillSurface( surface, NULL, spec, FILL_PATH_AUTO, NULL, FILL_STORES_STREAMING );
+
+		default:
+		return fillSurface( surface, NULL, spec, FILL_PATH_AUTO, &jobs );
+	}
+}
+
+int main( int argc, char* args[] )
+{
+	int reps = 50;
+	int threads = 0;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--reps" && i + 1 < argc )
+		{
+			reps = atoi( args[ ++i ] );
+			reps = SDL_max( 1, reps );
+		}
+		else if( arg == "--threads" && i + 1 < argc )
+		{
+			threads = atoi( args[ ++i ] );
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Usage: %s [--reps N] [--threads N] [--json out.json]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//Workers for the threaded fills, this thread being the first
+	JobSystem jobs;
+	startJobSystem( jobs, threads );
+
+	FillPath best = bestFillPath();
+	int cpus = jobWorkerCount( jobs );
+	BenchReport report;
+	report.suite = "fill_bench";
+
+	printf( "%d reps per point, best rows: %s, %d threads\n", reps, fillPathName( best ), cpus );
+	printf( "%-10s %-11s %-9s %10s %10s %10s\n", "size", "mode", "method", "ms", "GB/s", "vs sdl" );
+	const int sizes[][ 2 ] = { { 640, 480 }, { 1920, 1080 }, { 3840, 2160 }, { 7680, 4320 } };
+	for( int s = 0; s < 4; ++s )
+	{
+		SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat( 0, sizes[ s ][ 0 ], sizes[ s ][ 1 ], 32, SDL_PIXELFORMAT_RGB888 );
+		if( surface == NULL )
+		{
+			printf( "Unable to create %dx%d surface! SDL Error: %s\n", sizes[ s ][ 0 ], sizes[ s ][ 1 ], SDL_GetError() );
+			continue;
+		}
+		char size[ 32 ];
+		SDL_snprintf( size, sizeof( size ), "%dx%d", surface->w, surface->h );
+		double gigabytes = (double)surface->pitch * surface->h / 1e9;
+
+		Uint32 light = SDL_MapRGB( surface->format, 0x77, 0xFF, 0xFF );
+		Uint32 dark = SDL_MapRGB( surface->format, 0x10, 0x40, 0x60 );
+		for( int f = 0; f < FILL_MODE_TOTAL; ++f )
+		{
+			FillMode mode = (FillMode)f;
+			FillSpec spec = mode == FILL_SOLID ? solidFill( light ) : mode == FILL_CHECKER ? checkerFill( light, dark, CHECKER_CELL ) :
+				gradientFill( mode == FILL_VERTICAL_GRADIENT, light, dark );
+
+			double sdlRate = 0.0;
+			for( int m = 0; m < METHOD_TOTAL; ++m )
+			{
+				FillMethod method = (FillMethod)m;
+				if( ( method == METHOD_AVX2 && best != FILL_PATH_AVX2 ) || ( method == METHOD_SSE2 && best == FILL_PATH_SCALAR ) )
+				{
+					continue;
+				}
+
+				//The first fill is an untimed warmup, which also faults the pages in
+				std::vector<double> samples;
+				for( int rep = -1; rep < reps; ++rep )
+				{
+					double start = benchNowMs();
+					fillFrame( method, surface, spec, jobs );
+					if( rep >= 0 )
+					{
+						samples.push_back( benchNowMs() - start );
+					}
+				}
+
+				BenchStats stats = summarizeSamples( samples );
+				double rate = stats.median > 0.0 ? gigabytes / stats.median * 1000.0 : 0.0;
+				if( method == METHOD_SDL )
+				{
+					sdlRate = rate;
+				}
+				double speedup = sdlRate > 0.0 ? rate / sdlRate : 0.0;
+				printf( "%-10s %-11s %-9s %10.3f %10.2f %9.2fx\n", size, fillModeName( mode ), METHOD_NAMES[ m ], stats.median, rate, speedup );
+
+				BenchResult result;
+				result.name = "fill";
+				result.params.push_back( std::make_pair( "size", std::string( size ) ) );
+				result.params.push_back( std::make_pair( "mode", fillModeName( mode ) ) );
+				result.params.push_back( std::make_pair( "method", METHOD_NAMES[ m ] ) );
+				result.params.push_back( std::make_pair( "threads", std::to_string( method == METHOD_THREADED ? cpus : 1 ) ) );
+				result.metrics.push_back( std::make_pair( "gb_per_s", rate ) );
+				result.metrics.push_back( std::make_pair( "speedup_vs_sdl", speedup ) );
+				addStatsMetrics( result, stats );
+				report.results.push_back( result );
+			}
+		}
+
+		SDL_FreeSurface( surface );
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	stopJobSystem( jobs );
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,356 @@
+/*In-memory encoding benchmark for the lessons' flat images.
+
+	flat_bench [--reps 200] [--perf] [--json out.json] [image.bmp ...]
+
+Holds each image in every encoding common/flat_image.h has and reports what it takes in memory and how fast it blits
+onto a 640x480 XRGB8888 surface, like a window surface:
+	bmp          the surface SDL_LoadBMP returns, blitted with SDL_BlitSurface, which is what 03 and 04 do
+	surface      converted to the screen format once (what lesson 05 teaches)
+	sdl-rle      the most common color keyed out and SDL_RLEACCEL, drawn with blitFlatSurface (fill plus RLE blit)
+	indexed-sdl  8-bit palettized, SDL_BlitSurface's own 8 to 32-bit blit
+	indexed      8-bit palettized, blitFlatSurface's SIMD palette expand
+	runs         FlatRuns, our own color runs
+Memory is measured, not estimated: SDL's allocations go through counting memory functions, so the SDL numbers include
+whatever SDL keeps on the side (the sdl-rle one is measured after the first blit, when SDL has swapped the pixels for its
+runs). Without arguments it runs on x.bmp from 03 and the five key press images from 04.
+--perf reads the CPU's counters (common/perf_counters.h) around every blit and adds instructions per cycle and cache, TLB
+and branch misses per thousand instructions to the table, and the per blit counts to the JSON, which tells a method that
+saves memory traffic from one that saves instructions.
+*/
+
+//Using SDL, standard IO, strings and the flat image encodings
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include "../../common/bench_report.h"
+#include "../../common/flat_image.h"
+#include "../../common/perf_counters.h"
+
+//Destination dimensions, the lessons' screen size
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+
+//What an image is held as
+enum FlatMethod
+{
+	METHOD_BMP,
+	METHOD_SURFACE,
+	METHOD_SDL_RLE,
+	METHOD_INDEXED_SDL,
+	METHOD_INDEXED,
+	METHOD_RUNS,
+	METHOD_TOTAL
+};
+const char* METHOD_NAMES[ METHOD_TOTAL ] = { "bmp", "surface", "sdl-rle", "indexed-sdl", "indexed", "runs" };
+
+//The method that holds an image the way an encoding does
+FlatMethod methodForEncoding( FlatEncoding encoding )
+{
+	switch( encoding )
+	{
+		case FLAT_ENCODING_SDL_RLE:
+		return METHOD_SDL_RLE;
+
+		case FLAT_ENCODING_INDEXED:
+		return METHOD_INDEXED;
+
+		case FLAT_ENCODING_RUNS:
+		return METHOD_RUNS;
+
+		default:
+		return METHOD_SURFACE;
+	}
+}
+
+//Bytes SDL has allocated and not freed
+std::atomic<long long> gSDLHeapBytes( 0 );
+
+//SDL's allocator with a size header in front of every block so frees can be counted
+const size_t HEAP_HEADER = 16;
+
+void* countingMalloc( size_t size )
+{
+	size_t* block = (size_t*)malloc( size + HEAP_HEADER );
+	if( block == NULL )
+	{
+		return NULL;
+	}
+	block[ 0 ] = size;
+	gSDLHeapBytes += size;
+	return (Uint8*)block + HEAP_HEADER;
+}
+
+void* countingCalloc( size_t count, size_t size )
+{
+	size_t* block = (size_t*)calloc( 1, count * size + HEAP_HEADER );
+	if( block == NULL )
+	{
+		return NULL;
+	}
+	block[ 0 ] = count * size;
+	gSDLHeapBytes += count * size;
+	return (Uint8*)block + HEAP_HEADER;
+}
+
+void* countingRealloc( void* memory, size_t size )
+{
+	if( memory == NULL )
+	{
+		return countingMalloc( size );
+	}
+
+	size_t* block = (size_t*)( (Uint8*)memory - HEAP_HEADER );
+	size_t oldSize = block[ 0 ];
+	block = (size_t*)realloc( block, size + HEAP_HEADER );
+	if( block == NULL )
+	{
+		return NULL;
+	}
+	block[ 0 ] = size;
+	gSDLHeapBytes += (long long)size - (long long)oldSize;
+	return (Uint8*)block + HEAP_HEADER;
+}
+
+void countingFree( void* memory )
+{
+	if( memory != NULL )
+	{
+		size_t* block = (size_t*)( (Uint8*)memory - HEAP_HEADER );
+		gSDLHeapBytes -= block[ 0 ];
+		free( block );
+	}
+}
+
+//One image held one way
+struct FlatHolding
+{
+	SDL_Surface* surface;
+	FlatRuns runs;
+	long long bytes;
+};
+
+//Loads path and holds it as method, measuring what that takes after one blit to screen
+bool holdImage( std::string path, FlatMethod method, SDL_Surface* screen, FlatHolding& holding )
+{
+	holding.surface = NULL;
+	long long before = gSDLHeapBytes;
+
+	SDL_Surface* loaded = SDL_LoadBMP( path.c_str() );
+	if( loaded == NULL )
+	{
+		return false;
+	}
+
+	if( method == METHOD_BMP )
+	{
+		holding.surface = loaded;
+	}
+	else
+	{
+		if( method == METHOD_RUNS )
+		{
+			encodeFlatRuns( loaded, screen->format, holding.runs );
+		}
+		else
+		{
+			FlatEncoding encoding = method == METHOD_SURFACE ? FLAT_ENCODING_SURFACE : method == METHOD_SDL_RLE ? FLAT_ENCODING_SDL_RLE : FLAT_ENCODING_INDEXED;
+			holding.surface = encodeFlatSurface( loaded, screen->format, encoding );
+		}
+		SDL_FreeSurface( loaded );
+		if( method != METHOD_RUNS && holding.surface == NULL )
+		{
+			return false;
+		}
+	}
+
+	//The first blit is when SDL builds its blit map, and its RLE data for sdl-rle
+	if( method == METHOD_RUNS )
+	{
+		blitFlatRuns( holding.runs, screen, NULL );
+	}
+	else if( method == METHOD_BMP || method == METHOD_INDEXED_SDL )
+	{
+		SDL_BlitSurface( holding.surface, NULL, screen, NULL );
+	}
+	else
+	{
+		blitFlatSurface( holding.surface, screen, NULL );
+	}
+
+	holding.bytes = method == METHOD_RUNS ? (long long)flatRunsBytes( holding.runs ) : gSDLHeapBytes - before;
+	return true;
+}
+
+int main( int argc, char* args[] )
+{
+	//Count SDL's allocations, has to happen before SDL allocates anything
+	SDL_SetMemoryFunctions( countingMalloc, countingCalloc, countingRealloc, countingFree );
+
+	int reps = 200;
+	const char* jsonPath = NULL;
+	bool perf = false;
+	std::vector<std::string> imagePaths;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--reps" && i + 1 < argc )
+		{
+			reps = atoi( args[ ++i ] );
+			reps = SDL_max( 1, reps );
+		}
+		else if( arg == "--perf" )
+		{
+			perf = true;
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else if( arg.size() > 2 && arg.compare( 0, 2, "--" ) == 0 )
+		{
+			printf( "Usage: %s [--reps N] [--perf] [--json out.json] [image.bmp ...]\n", args[ 0 ] );
+			return 1;
+		}
+		else
+		{
+			imagePaths.push_back( arg );
+		}
+	}
+	if( imagePaths.empty() )
+	{
+		imagePaths.push_back( "../../03_event_driven_programming/x.bmp" );
+		const char* keys[] = { "press", "up", "down", "left", "right" };
+		for( int i = 0; i < 5; ++i )
+		{
+			imagePaths.push_back( std::string( "../../04_key_presses/" ) + keys[ i ] + ".bmp" );
+		}
+	}
+
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	SDL_Surface* screen = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGB888 );
+	if( screen == NULL )
+	{
+		printf( "Unable to create destination surface! SDL Error: %s\n", SDL_GetError() );
+		SDL_Quit();
+		return 1;
+	}
+
+	PerfCounters counters = PerfCounters();
+	if( perf )
+	{
+		openPerfCounters( counters );
+	}
+
+	BenchReport report;
+	report.suite = "flat_bench";
+
+	printf( "%d reps per point\n", reps );
+	printf( "%-12s %7s %7s %-12s %10s %10s %12s %10s\n", "image", "colors", "runs", "method", "KB", "vs bmp", "MPix/s", "vs bmp" );
+	for( size_t p = 0; p < imagePaths.size(); ++p )
+	{
+		std::string path = imagePaths[ p ];
+		std::string name = path.substr( path.rfind( '/' ) + 1 );
+
+		//What auto would pick, from the image converted to the screen format
+		SDL_Surface* loaded = SDL_LoadBMP( path.c_str() );
+		if( loaded == NULL )
+		{
+			printf( "Unable to load %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+			continue;
+		}
+		SDL_Surface* converted = SDL_ConvertSurface( loaded, screen->format, 0 );
+		FlatImageStats stats = analyzeFlatSurface( converted );
+		SDL_FreeSurface( converted );
+		SDL_FreeSurface( loaded );
+		FlatMethod autoMethod = methodForEncoding( chooseFlatEncoding( stats, true ) );
+
+		long long bmpBytes = 0;
+		double bmpRate = 0.0;
+		for( int m = 0; m < METHOD_TOTAL; ++m )
+		{
+			FlatMethod method = (FlatMethod)m;
+			FlatHolding holding;
+			if( !holdImage( path, method, screen, holding ) )
+			{
+				printf( "Unable to hold %s as %s! SDL Error: %s\n", name.c_str(), METHOD_NAMES[ m ], SDL_GetError() );
+				continue;
+			}
+
+			PerfRegion region;
+			initPerfRegion( region, "blit" );
+			std::vector<double> samples;
+			for( int rep = 0; rep < reps; ++rep )
+			{
+				double start = benchNowMs();
+				beginPerfRegion( counters, region );
+				if( method == METHOD_RUNS )
+				{
+					blitFlatRuns( holding.runs, screen, NULL );
+				}
+				else if( method == METHOD_BMP || method == METHOD_INDEXED_SDL )
+				{
+					SDL_BlitSurface( holding.surface, NULL, screen, NULL );
+				}
+				else
+				{
+					blitFlatSurface( holding.surface, screen, NULL );
+				}
+				endPerfRegion( counters, region );
+				samples.push_back( benchNowMs() - start );
+			}
+			SDL_FreeSurface( holding.surface );
+
+			BenchStats blitStats = summarizeSamples( samples );
+			double rate = blitStats.median > 0.0 ? (double)stats.width * stats.height / blitStats.median / 1000.0 : 0.0;
+			if( method == METHOD_BMP )
+			{
+				bmpBytes = holding.bytes;
+				bmpRate = rate;
+			}
+			double memoryRatio = holding.bytes > 0 ? (double)bmpBytes / holding.bytes : 0.0;
+			double speedup = bmpRate > 0.0 ? rate / bmpRate : 0.0;
+			printf( "%-12s %7d %7d %-12s %10.1f %9.1fx %12.1f %9.2fx%s\n", name.c_str(), stats.colors, stats.runs, METHOD_NAMES[ m ], holding.bytes / 1024.0,
+				memoryRatio, rate, speedup, method == autoMethod ? "  (auto)" : "" );
+			if( region.calls > 0 )
+			{
+				printf( "%-12s %7s %7s %-12s IPC %.2f, misses per 1000 instructions: L1D %.2f, LLC %.2f, branch %.2f, dTLB %.2f\n", "", "", "", "",
+					region.totals[ PERF_INSTRUCTIONS ] / region.totals[ PERF_CYCLES ], perfPerKiloInstruction( region, PERF_L1D_MISSES ),
+					perfPerKiloInstruction( region, PERF_LLC_MISSES ), perfPerKiloInstruction( region, PERF_BRANCH_MISSES ),
+					perfPerKiloInstruction( region, PERF_DTLB_MISSES ) );
+			}
+
+			BenchResult result;
+			result.name = "flat_image";
+			result.params.push_back( std::make_pair( "image", name ) );
+			result.params.push_back( std::make_pair( "method", METHOD_NAMES[ m ] ) );
+			result.metrics.push_back( std::make_pair( "bytes", (double)holding.bytes ) );
+			result.metrics.push_back( std::make_pair( "mpix_per_s", rate ) );
+			result.metrics.push_back( std::make_pair( "memory_saving_vs_bmp", memoryRatio ) );
+			result.metrics.push_back( std::make_pair( "speedup_vs_bmp", speedup ) );
+			addStatsMetrics( result, blitStats );
+			addPerfMetrics( result, region );
+			report.results.push_back( result );
+		}
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	closePerfCounters( counters );
+	SDL_FreeSurface( screen );
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,305 @@
+/*Job system scaling benchmark.
+
+	job_bench [--entities 1000000] [--frames 50] [--workers N] [--no-cull] [--json out.json]
+
+Runs 08's entity frame without a window on common/job_system.h at 1, 2, 4, ... up to --workers workers (every CPU by
+default) and reports the frame time, each task's share of it and the speedup over 1 worker. The frame is the same task
+graph 08 --jobs runs, minus its main thread input and present tasks:
+	update       updateEntityRange in ENTITY_BLOCK sized parallelFor jobs
+	grid         moveGridItem for every entity, serial (the grid isn't thread safe)
+	render prep  the grid query for the view, sorted, and the vertex writes in parallelFor jobs (all entities with --no-cull)
+For comparison spawn is the same update with threads started and joined every call at the same thread count, what
+updating without a job system costs, and jobs/s is how many empty jobs submitted from the main thread the workers get through, the job system's overhead.
+*/
+
+//Using SDL, standard IO, strings and the job system
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "../../common/bench_report.h"
+#include "../../common/entity_store.h"
+#include "../../common/spatial_grid.h"
+#include "../../common/job_system.h"
+
+//08's world and view
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int WORLD_WIDTH = SCREEN_WIDTH * 4;
+const int WORLD_HEIGHT = SCREEN_HEIGHT * 4;
+const float GRID_CELL = 64.0f;
+
+//A fixed step so every run moves the same distance
+const float FRAME_DT = 1.0f / 60.0f;
+
+//Entities per vertex writing job, like 08
+const int VERTEX_JOB_GRAIN = 8192;
+
+//Empty jobs per overhead run
+const int OVERHEAD_JOBS = 100000;
+
+//The update on threads started and joined every call, pulling ENTITY_BLOCK blocks off a shared counter
+void spawnUpdateEntities( EntityStore& store, float dt, int threads )
+{
+	int blockCount = ( store.count + ENTITY_BLOCK - 1 ) / ENTITY_BLOCK;
+	std::atomic<int> nextBlock( 0 );
+	auto updateBlocks = [ & ]()
+	{
+		for( int b = nextBlock++; b < blockCount; b = nextBlock++ )
+		{
+			updateEntityRange( store, b * ENTITY_BLOCK, SDL_min( ( b + 1 ) * ENTITY_BLOCK, store.count ), dt );
+		}
+	};
+
+	std::vector<std::thread> spawned;
+	for( int i = 1; i < threads; ++i )
+	{
+		spawned.emplace_back( updateBlocks );
+	}
+	updateBlocks();
+	for( size_t i = 0; i < spawned.size(); ++i )
+	{
+		spawned[ i ].join();
+	}
+}
+
+//One frame's state
+struct FrameScene
+{
+	EntityStore entities;
+	SpatialGrid grid;
+	std::vector<int> visible;
+	std::vector<SDL_Vertex> vertices;
+	SDL_FRect view;
+	bool cull;
+};
+
+bool createScene( FrameScene& scene, int count, bool cull )
+{
+	SDL_FRect bounds = { 0.0f, 0.0f, (float)WORLD_WIDTH, (float)WORLD_HEIGHT };
+	if( !createEntityStore( scene.entities, count, bounds ) )
+	{
+		return false;
+	}
+
+	spawnRandomEntities( scene.entities, count, 12345 );
+	createSpatialGrid( scene.grid, bounds, GRID_CELL );
+	for( int i = 0; i < count; ++i )
+	{
+		SDL_FRect rect = { scene.entities.x[ i ], scene.entities.y[ i ], scene.entities.w[ i ], scene.entities.h[ i ] };
+		insertGridItem( scene.grid, i, rect );
+	}
+	scene.vertices.resize( count * 4 );
+	scene.view = { (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT, (float)SCREEN_WIDTH, (float)SCREEN_HEIGHT };
+	scene.cull = cull;
+	return true;
+}
+
+//08's frame tasks, minus input and present
+void buildSceneGraph( TaskGraph& graph, JobSystem& jobs, FrameScene& scene )
+{
+	int update = addTask( graph, "update", [ &jobs, &scene ]()
+	{
+		parallelFor( jobs, 0, scene.entities.count, ENTITY_BLOCK, [ &scene ]( int first, int last ) { updateEntityRange( scene.entities, first, last, FRAME_DT ); } );
+	} );
+	int grid = addTask( graph, "grid", [ &scene ]()
+	{
+		for( int i = 0; i < scene.entities.count; ++i )
+		{
+			SDL_FRect rect = { scene.entities.x[ i ], scene.entities.y[ i ], scene.entities.w[ i ], scene.entities.h[ i ] };
+			moveGridItem( scene.grid, i, rect );
+		}
+	} );
+	int prep = addTask( graph, "render prep", [ &jobs, &scene ]()
+	{
+		scene.visible.clear();
+		if( scene.cull )
+		{
+			queryGridRect( scene.grid, scene.view, scene.visible );
+			std::sort( scene.visible.begin(), scene.visible.end() );
+		}
+		else
+		{
+			for( int i = 0; i < scene.entities.count; ++i )
+			{
+				scene.visible.push_back( i );
+			}
+		}
+		parallelFor( jobs, 0, scene.visible.size(), VERTEX_JOB_GRAIN, [ &scene ]( int first, int last )
+		{
+			writeEntityVerticesIndexed( scene.entities, scene.visible.data() + first, last - first, -scene.view.x, -scene.view.y, scene.vertices.data() + first * 4 );
+		} );
+	} );
+	addTaskDependency( graph, update, grid );
+	addTaskDependency( graph, grid, prep );
+}
+
+int main( int argc, char* args[] )
+{
+	int count = 1000000;
+	int frames = 50;
+	int maxWorkers = 0;
+	bool cull = true;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--entities" && i + 1 < argc )
+		{
+			count = atoi( args[ ++i ] );
+		}
+		else if( arg == "--frames" && i + 1 < argc )
+		{
+			frames = atoi( args[ ++i ] );
+		}
+		else if( arg == "--workers" && i + 1 < argc )
+		{
+			maxWorkers = atoi( args[ ++i ] );
+		}
+		else if( arg == "--no-cull" )
+		{
+			cull = false;
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Usage: %s [--entities N] [--frames N] [--workers N] [--no-cull] [--json out.json]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+	count = SDL_max( 1, count );
+	frames = SDL_max( 1, frames );
+	if( maxWorkers <= 0 )
+	{
+		maxWorkers = SDL_GetCPUCount();
+	}
+
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//1, 2, 4, ... and the maximum itself
+	std::vector<int> workerCounts;
+	for( int workers = 1; workers < maxWorkers; workers *= 2 )
+	{
+		workerCounts.push_back( workers );
+	}
+	workerCounts.push_back( maxWorkers );
+
+	BenchReport report;
+	report.suite = "job_bench";
+	double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+
+	printf( "%d entities, %d frames per point, %s\n", count, frames, cull ? "culled" : "not culled" );
+	printf( "%8s %10s %10s %10s %12s %10s %10s %12s %14s\n", "workers", "frame ms", "update", "grid", "render prep", "speedup", "spawn ms", "steals/frame", "jobs/s" );
+	double baseFrameMs = 0.0;
+	for( size_t w = 0; w < workerCounts.size(); ++w )
+	{
+		int workers = workerCounts[ w ];
+
+		//A fresh scene per point so every point starts from the same entities
+		FrameScene scene;
+		if( !createScene( scene, count, cull ) )
+		{
+			printf( "Unable to allocate %d entities! SDL Error: %s\n", count, SDL_GetError() );
+			SDL_Quit();
+			return 1;
+		}
+
+		JobSystem jobs;
+		startJobSystem( jobs, workers );
+		TaskGraph graph;
+		buildSceneGraph( graph, jobs, scene );
+
+		//Frame 0 is an untimed warmup
+		std::vector<double> samples;
+		for( int frame = -1; frame < frames; ++frame )
+		{
+			double start = benchNowMs();
+			runTaskGraph( jobs, graph );
+			if( frame >= 0 )
+			{
+				samples.push_back( benchNowMs() - start );
+			}
+		}
+		BenchStats stats = summarizeSamples( samples );
+		long long steals = 0;
+		for( int i = 0; i < jobWorkerCount( jobs ); ++i )
+		{
+			steals += jobs.workers[ i ]->stolen;
+		}
+
+		//The same update with threads started every frame
+		std::vector<double> spawnSamples;
+		for( int frame = 0; frame < frames; ++frame )
+		{
+			double start = benchNowMs();
+			spawnUpdateEntities( scene.entities, FRAME_DT, workers );
+			spawnSamples.push_back( benchNowMs() - start );
+		}
+		BenchStats spawnStats = summarizeSamples( spawnSamples );
+
+		//Empty jobs, what the queues cost per job
+		JobCounter overhead( 0 );
+		double overheadStart = benchNowMs();
+		for( int i = 0; i < OVERHEAD_JOBS; ++i )
+		{
+			submitJob( jobs, []() {}, &overhead );
+		}
+		waitForJobs( jobs, overhead );
+		double overheadMs = benchNowMs() - overheadStart;
+		double jobsPerSecond = overheadMs > 0.0 ? OVERHEAD_JOBS / overheadMs * 1000.0 : 0.0;
+
+		stopJobSystem( jobs );
+		freeEntityStore( scene.entities );
+
+		if( w == 0 )
+		{
+			baseFrameMs = stats.median;
+		}
+		double speedup = stats.median > 0.0 ? baseFrameMs / stats.median : 0.0;
+		double runs = graph.runs;
+		double taskMs[ 3 ];
+		for( int t = 0; t < 3; ++t )
+		{
+			taskMs[ t ] = graph.nodes[ t ].ticks * toMs / runs;
+		}
+		printf( "%8d %10.3f %10.3f %10.3f %12.3f %9.2fx %10.3f %12.1f %14.0f\n", workers, stats.median, taskMs[ 0 ], taskMs[ 1 ], taskMs[ 2 ], speedup,
+			spawnStats.median, steals / runs, jobsPerSecond );
+
+		BenchResult result;
+		result.name = "job_frame";
+		result.params.push_back( std::make_pair( "workers", std::to_string( workers ) ) );
+		result.params.push_back( std::make_pair( "entities", std::to_string( count ) ) );
+		result.params.push_back( std::make_pair( "cull", cull ? "on" : "off" ) );
+		result.metrics.push_back( std::make_pair( "update_ms", taskMs[ 0 ] ) );
+		result.metrics.push_back( std::make_pair( "grid_ms", taskMs[ 1 ] ) );
+		result.metrics.push_back( std::make_pair( "render_prep_ms", taskMs[ 2 ] ) );
+		result.metrics.push_back( std::make_pair( "speedup_vs_1_worker", speedup ) );
+		result.metrics.push_back( std::make_pair( "spawn_update_ms", spawnStats.median ) );
+		result.metrics.push_back( std::make_pair( "steals_per_frame", steals / runs ) );
+		result.metrics.push_back( std::make_pair( "jobs_per_s", jobsPerSecond ) );
+		addStatsMetrics( result, stats );
+		report.results.push_back( result );
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	SDL_Quit();
+
+	return 0;
+}
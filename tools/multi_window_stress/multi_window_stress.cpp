@@ -0,0 +1,411 @@
+/*Multi-window scaling stress test.
+
+	multi_window_stress [--windows 1,2,4,8,16] [--scene geometry|surface] [--threading shared|per-window]
+	                    [--frames 300] [--json out.json]
+
+Opens N windows in one process and drives each with either 08's geometry scene through its own SDL_Renderer or 04's
+key press scene blitted into the window surface. With --threading shared one thread renders every window in turn, with
+per-window each window gets its own render thread while the main thread keeps pumping events. For every N it reports
+aggregate frames/s across all windows and per-window p99 frame time, which shows where one process stops scaling. A window's
+frame time is the time between its successive presents (its first frame counts from the start of the run), so in shared
+mode it includes waiting for every other window's turn.
+
+The offscreen video driver is used unless SDL_VIDEODRIVER says otherwise. Per-window threading renders off the main thread,
+which the offscreen and software paths are fine with but some windowing systems aren't.
+*/
+
+//Using SDL, standard IO, strings, threads and the benchmark report
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include "../../common/bench_report.h"
+
+//Screen dimension constants
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+
+//The key press images from 04, cycled through like someone holding the arrow keys
+const char* KEY_PRESS_PATHS[] =
+{
+	"../../04_key_presses/press.bmp",
+	"../../04_key_presses/up.bmp",
+	"../../04_key_presses/down.bmp",
+	"../../04_key_presses/left.bmp",
+	"../../04_key_presses/right.bmp"
+};
+const int KEY_PRESS_TOTAL = 5;
+
+//Everything one window needs to draw itself
+struct StressWindow
+{
+	SDL_Window* window;
+	SDL_Renderer* renderer;
+	SDL_Surface* screenSurface;
+	SDL_Surface* keyPressSurfaces[ KEY_PRESS_TOTAL ];
+	std::vector<double> frameMs;
+
+	//When this window last presented, or the run started
+	double lastPresent;
+};
+
+//The key press images as loaded, converted per window later
+SDL_Surface* gKeyPressImages[ KEY_PRESS_TOTAL ];
+
+//Draws 08's scene
+void renderGeometry( SDL_Renderer* renderer )
+{
+	//Clear screen
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderClear( renderer );
+
+	//Render red filled quad
+	SDL_Rect fillRect = { SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2 };
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0x00, 0x00, 0xFF );
+	SDL_RenderFillRect( renderer, &fillRect );
+
+	//Render green outlined quad
+	SDL_Rect outlineRect = { SCREEN_WIDTH / 6, SCREEN_HEIGHT / 6, SCREEN_WIDTH * 2 / 3, SCREEN_HEIGHT * 2 / 3 };
+	SDL_SetRenderDrawColor( renderer, 0x00, 0xFF, 0x00, 0xFF );
+	SDL_RenderDrawRect( renderer, &outlineRect );
+
+	//Draw blue horizontal line
+	SDL_SetRenderDrawColor( renderer, 0x00, 0x00, 0xFF, 0xFF );
+	SDL_RenderDrawLine( renderer, 0, SCREEN_HEIGHT / 2, SCREEN_WIDTH, SCREEN_HEIGHT / 2 );
+
+	//Draw vertical line of yellow dots
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0x00, 0xFF );
+	for( int i = 0; i < SCREEN_HEIGHT; i += 4 )
+	{
+		SDL_RenderDrawPoint( renderer, SCREEN_WIDTH / 2, i );
+	}
+
+	//Update screen
+	SDL_RenderPresent( renderer );
+}
+
+//Sets up the window's renderer or surface, on whichever thread will draw it
+bool prepareWindow( StressWindow& stress, bool geometry )
+{
+	if( geometry )
+	{
+		stress.renderer = SDL_CreateRenderer( stress.window, -1, 0 );
+		if( stress.renderer == NULL )
+		{
+			printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
+			return false;
+		}
+	}
+	else
+	{
+		stress.screenSurface = SDL_GetWindowSurface( stress.window );
+		if( stress.screenSurface == NULL )
+		{
+			printf( "Window surface could not be created! SDL Error: %s\n", SDL_GetError() );
+			return false;
+		}
+
+		//Every window gets its own converted copy, blitting one source into several targets at once isn't thread safe
+		for( int i = 0; i < KEY_PRESS_TOTAL; ++i )
+		{
+			stress.keyPressSurfaces[ i ] = SDL_ConvertSurface( gKeyPressImages[ i ], stress.screenSurface->format, 0 );
+			if( stress.keyPressSurfaces[ i ] == NULL )
+			{
+				printf( "Unable to optimize key press image! SDL Error: %s\n", SDL_GetError() );
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+//Draws and presents one frame of a window, recording the time since its last present
+void renderWindowFrame( StressWindow& stress, bool geometry, int frame )
+{
+	if( geometry )
+	{
+		renderGeometry( stress.renderer );
+	}
+	else
+	{
+		//Apply the current image
+		SDL_BlitSurface( stress.keyPressSurfaces[ ( frame / 10 ) % KEY_PRESS_TOTAL ], NULL, stress.screenSurface, NULL );
+
+		//Update the surface
+		SDL_UpdateWindowSurface( stress.window );
+	}
+
+	double now = benchNowMs();
+	stress.frameMs.push_back( now - stress.lastPresent );
+	stress.lastPresent = now;
+}
+
+//Frees what prepareWindow made
+void releaseWindow( StressWindow& stress )
+{
+	for( int i = 0; i < KEY_PRESS_TOTAL; ++i )
+	{
+		SDL_FreeSurface( stress.keyPressSurfaces[ i ] );
+		stress.keyPressSurfaces[ i ] = NULL;
+	}
+	SDL_DestroyRenderer( stress.renderer );
+	stress.renderer = NULL;
+}
+
+//Runs one configuration, returns the wall clock time in ms or a negative number on failure
+double runStress( std::vector<StressWindow>& windows, bool geometry, bool perWindowThreads, int frames )
+{
+	bool success = true;
+	double start = 0.0;
+
+	if( !perWindowThreads )
+	{
+		//One thread draws all windows in turn
+		for( size_t w = 0; w < windows.size() && success; ++w )
+		{
+			success = prepareWindow( windows[ w ], geometry );
+		}
+
+		start = benchNowMs();
+		for( size_t w = 0; w < windows.size(); ++w )
+		{
+			windows[ w ].lastPresent = start;
+		}
+		for( int frame = 0; frame < frames && success; ++frame )
+		{
+			SDL_PumpEvents();
+			for( size_t w = 0; w < windows.size(); ++w )
+			{
+				renderWindowFrame( windows[ w ], geometry, frame );
+			}
+		}
+	}
+	else
+	{
+		//A thread per window, the main thread only pumps events
+		std::atomic<int> ready( 0 );
+		std::atomic<int> failed( 0 );
+		std::atomic<bool> go( false );
+		std::atomic<int> finished( 0 );
+		std::vector<std::thread> threads;
+		for( size_t w = 0; w < windows.size(); ++w )
+		{
+			threads.emplace_back( [ &, w ]()
+			{
+				if( !prepareWindow( windows[ w ], geometry ) )
+				{
+					++failed;
+				}
+				++ready;
+
+				while( !go )
+				{
+					std::this_thread::yield();
+				}
+
+				for( int frame = 0; frame < frames && failed == 0; ++frame )
+				{
+					renderWindowFrame( windows[ w ], geometry, frame );
+				}
+				++finished;
+			} );
+		}
+
+		//Start everyone at once
+		while( ready < (int)windows.size() )
+		{
+			SDL_PumpEvents();
+			std::this_thread::yield();
+		}
+		start = benchNowMs();
+		for( size_t w = 0; w < windows.size(); ++w )
+		{
+			windows[ w ].lastPresent = start;
+		}
+		go = true;
+
+		while( finished < (int)windows.size() )
+		{
+			SDL_PumpEvents();
+			SDL_Delay( 1 );
+		}
+		for( size_t t = 0; t < threads.size(); ++t )
+		{
+			threads[ t ].join();
+		}
+		success = failed == 0;
+	}
+
+	double wallMs = benchNowMs() - start;
+	for( size_t w = 0; w < windows.size(); ++w )
+	{
+		releaseWindow( windows[ w ] );
+	}
+
+	return success ? wallMs : -1.0;
+}
+
+int main( int argc, char* args[] )
+{
+	std::vector<int> windowCounts = { 1, 2, 4, 8, 16 };
+	bool geometry = true;
+	bool perWindowThreads = false;
+	int frames = 300;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--windows" && i + 1 < argc )
+		{
+			windowCounts.clear();
+			std::string list = args[ ++i ];
+			for( size_t start = 0; start < list.size(); )
+			{
+				size_t comma = list.find( ',', start );
+				if( comma == std::string::npos )
+				{
+					comma = list.size();
+				}
+				int count = atoi( list.substr( start, comma - start ).c_str() );
+				if( count > 0 )
+				{
+					windowCounts.push_back( count );
+				}
+				start = comma + 1;
+			}
+		}
+		else if( arg == "--scene" && i + 1 < argc )
+		{
+			geometry = std::string( args[ ++i ] ) != "surface";
+		}
+		else if( arg == "--threading" && i + 1 < argc )
+		{
+			perWindowThreads = std::string( args[ ++i ] ) == "per-window";
+		}
+		else if( arg == "--frames" && i + 1 < argc )
+		{
+			frames = atoi( args[ ++i ] );
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Usage: %s [--windows 1,2,4] [--scene geometry|surface] [--threading shared|per-window] [--frames N] [--json out.json]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+	if( frames < 1 )
+	{
+		printf( "--frames must be at least 1\n" );
+		return 1;
+	}
+
+	//Run headless unless told otherwise
+	if( getenv( "SDL_VIDEODRIVER" ) == NULL )
+	{
+		SDL_SetHint( SDL_HINT_VIDEODRIVER, "offscreen" );
+	}
+
+	//Initialize SDL
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//Load 04's images for the surface scene
+	bool success = true;
+	for( int i = 0; i < KEY_PRESS_TOTAL; ++i )
+	{
+		gKeyPressImages[ i ] = geometry ? NULL : SDL_LoadBMP( KEY_PRESS_PATHS[ i ] );
+		if( !geometry && gKeyPressImages[ i ] == NULL )
+		{
+			printf( "Unable to load image %s! SDL Error: %s\n", KEY_PRESS_PATHS[ i ], SDL_GetError() );
+			success = false;
+		}
+	}
+
+	BenchReport report;
+	report.suite = "multi_window_stress";
+	const char* sceneName = geometry ? "geometry" : "surface";
+	const char* threadingName = perWindowThreads ? "per-window" : "shared";
+
+	printf( "video driver %s, %s scene, %s threading, %d frames\n", SDL_GetCurrentVideoDriver(), sceneName, threadingName, frames );
+	printf( "%8s %14s %16s %16s %16s\n", "windows", "aggregate fps", "mean window fps", "median p99 ms", "worst p99 ms" );
+	for( size_t c = 0; c < windowCounts.size() && success; ++c )
+	{
+		int count = windowCounts[ c ];
+
+		//Open the windows
+		std::vector<StressWindow> windows( count );
+		for( int w = 0; w < count; ++w )
+		{
+			windows[ w ] = StressWindow();
+			windows[ w ].window = SDL_CreateWindow( "SDL Tutorial", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN );
+			if( windows[ w ].window == NULL )
+			{
+				printf( "Window could not be created! SDL Error: %s\n", SDL_GetError() );
+				success = false;
+			}
+		}
+
+		double wallMs = success ? runStress( windows, geometry, perWindowThreads, frames ) : -1.0;
+		if( wallMs < 0.0 )
+		{
+			success = false;
+		}
+		else
+		{
+			//Per window p99s
+			std::vector<double> p99s;
+			double windowFpsSum = 0.0;
+			for( int w = 0; w < count; ++w )
+			{
+				BenchStats stats = summarizeSamples( windows[ w ].frameMs );
+				p99s.push_back( stats.p99 );
+				windowFpsSum += stats.mean > 0.0 ? 1000.0 / stats.mean : 0.0;
+			}
+			BenchStats p99Stats = summarizeSamples( p99s );
+			double aggregateFps = (double)count * frames * 1000.0 / wallMs;
+
+			printf( "%8d %14.1f %16.1f %16.3f %16.3f\n", count, aggregateFps, windowFpsSum / count, p99Stats.median, p99Stats.max );
+
+			BenchResult result;
+			result.name = "multi_window";
+			result.params.push_back( std::make_pair( "scene", sceneName ) );
+			result.params.push_back( std::make_pair( "threading", threadingName ) );
+			result.params.push_back( std::make_pair( "windows", std::to_string( count ) ) );
+			result.metrics.push_back( std::make_pair( "aggregate_fps", aggregateFps ) );
+			result.metrics.push_back( std::make_pair( "mean_window_fps", windowFpsSum / count ) );
+			result.metrics.push_back( std::make_pair( "median_window_p99_ms", p99Stats.median ) );
+			result.metrics.push_back( std::make_pair( "worst_window_p99_ms", p99Stats.max ) );
+			report.results.push_back( result );
+		}
+
+		for( int w = 0; w < count; ++w )
+		{
+			SDL_DestroyWindow( windows[ w ].window );
+		}
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	for( int i = 0; i < KEY_PRESS_TOTAL; ++i )
+	{
+		SDL_FreeSurface( gKeyPressImages[ i ] );
+	}
+	SDL_Quit();
+
+	return success ? 0 : 1;
+}
@@ -0,0 +1,810 @@
+/*Microbenchmarks of the SDL calls the lessons are built on, over a grid of sizes, formats, blend modes and backends.
+
+	op_bench [--ops all] [--sizes 64,256,1024] [--formats XRGB8888,ARGB8888,ABGR8888,RGB565,RGB24,INDEX8]
+	         [--dst-formats XRGB8888,ARGB8888] [--blends none,blend,add,mod] [--drivers software]
+	         [--warmup 3] [--reps 20] [--json out.json]
+
+Surface operations, run once for every point of the grid that applies to them:
+	load-bmp        SDL_LoadBMP and SDL_FreeSurface of a size x size BMP that SDL_SaveBMP wrote from a surface in format
+	img-load        IMG_Load and SDL_FreeSurface of a PNG that IMG_SavePNG wrote
+	convert         SDL_ConvertSurface from format to dst-format
+	blit            SDL_BlitSurface, format onto dst-format, with the source's blend mode set to blend
+	blit-scaled     SDL_BlitScaled of a size/2 square source stretched 2x onto the size x size destination
+	fill-rect       SDL_FillRect over the whole destination
+Renderer operations, on each --drivers backend (all for every one SDL has, software draws into a surface, the others
+into a target texture on a hidden window):
+	create-texture  SDL_CreateTextureFromSurface and SDL_DestroyTexture from a surface in format
+	render-copy     SDL_RenderCopy of a size x size texture created in format, with blend
+	render-fill     SDL_RenderFillRect of a size x size rect, with blend
+	render-point    size*16 SDL_RenderDrawPoint calls, with blend
+	render-points   the same points in one SDL_RenderDrawPoints call
+The source is 256 colors with varying alpha so every format, INDEX8 included, holds the same picture.
+Each point runs --warmup untimed repetitions, the last of which sets the batch: enough operations per sample to take half a
+millisecond, so fast small operations aren't lost in the timer. Then --reps samples of a batch each; renderer samples end
+by reading a pixel back, so they include the GPU work and not just the queueing. Outliers (Tukey's outer fences) are
+dropped and counted, and the median per operation is reported with megapixels per second. The JSON has every point and,
+as "fastest" results, the quickest format and destination format for each operation, size, backend and blend mode, for
+the loaders and blitters to pick from.
+*/
+
+//Using SDL, SDL_image, standard IO, strings and the benchmark report
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <cmath>
+#include "../../common/bench_report.h"
+#include "../../common/renderer_probe.h"
+
+//Samples take at least this long, fast operations are batched up to it
+const double MIN_SAMPLE_MS = 0.5;
+const int MAX_BATCH = 100000;
+
+//Where the load benchmarks write their files
+const char* TEMP_BMP_PATH = "op_bench_temp.bmp";
+const char* TEMP_PNG_PATH = "op_bench_temp.png";
+
+//The operations
+enum OpKind
+{
+	OP_LOAD_BMP,
+	OP_IMG_LOAD,
+	OP_CONVERT,
+	OP_BLIT,
+	OP_BLIT_SCALED,
+	OP_FILL_RECT,
+	OP_CREATE_TEXTURE,
+	OP_RENDER_COPY,
+	OP_RENDER_FILL,
+	OP_RENDER_POINT,
+	OP_RENDER_POINTS,
+	OP_TOTAL
+};
+const char* OP_NAMES[ OP_TOTAL ] = { "load-bmp", "img-load", "convert", "blit", "blit-scaled", "fill-rect", "create-texture", "render-copy",
+	"render-fill", "render-point", "render-points" };
+
+//Which grid axes an operation runs over
+bool opUsesFormat( OpKind op )
+{
+	return op != OP_FILL_RECT && op != OP_RENDER_FILL && op != OP_RENDER_POINT && op != OP_RENDER_POINTS;
+}
+
+bool opUsesDstFormat( OpKind op )
+{
+	return op == OP_CONVERT || op == OP_BLIT || op == OP_BLIT_SCALED || op == OP_FILL_RECT;
+}
+
+bool opUsesBlend( OpKind op )
+{
+	return op == OP_BLIT || op == OP_BLIT_SCALED || op == OP_RENDER_COPY || op == OP_RENDER_FILL || op == OP_RENDER_POINT || op == OP_RENDER_POINTS;
+}
+
+bool opUsesRenderer( OpKind op )
+{
+	return op >= OP_CREATE_TEXTURE;
+}
+
+//Formats that can be asked for by name
+const Uint32 KNOWN_FORMATS[] = { SDL_PIXELFORMAT_RGB888, SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGBA8888,
+	SDL_PIXELFORMAT_BGRA8888, SDL_PIXELFORMAT_BGR888, SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_BGR24, SDL_PIXELFORMAT_RGB565,
+	SDL_PIXELFORMAT_ARGB1555, SDL_PIXELFORMAT_ARGB4444, SDL_PIXELFORMAT_INDEX8 };
+
+//A format's name without SDL's prefix, RGB888 and BGR888 under their XRGB8888 and XBGR8888 names
+std::string formatName( Uint32 format )
+{
+	std::string name = SDL_GetPixelFormatName( format );
+	name = name.compare( 0, 16, "SDL_PIXELFORMAT_" ) == 0 ? name.substr( 16 ) : name;
+	return name == "RGB888" ? "XRGB8888" : name == "BGR888" ? "XBGR8888" : name;
+}
+
+Uint32 formatFromName( std::string name )
+{
+	for( size_t i = 0; i < sizeof( KNOWN_FORMATS ) / sizeof( KNOWN_FORMATS[ 0 ] ); ++i )
+	{
+		if( formatName( KNOWN_FORMATS[ i ] ) == name || SDL_GetPixelFormatName( KNOWN_FORMATS[ i ] ) == "SDL_PIXELFORMAT_" + name )
+		{
+			return KNOWN_FORMATS[ i ];
+		}
+	}
+	return SDL_PIXELFORMAT_UNKNOWN;
+}
+
+//Blend modes by name
+const SDL_BlendMode BLEND_MODES[] = { SDL_BLENDMODE_NONE, SDL_BLENDMODE_BLEND, SDL_BLENDMODE_ADD, SDL_BLENDMODE_MOD };
+const char* BLEND_NAMES[] = { "none", "blend", "add", "mod" };
+
+bool blendFromName( std::string name, SDL_BlendMode& mode )
+{
+	for( int i = 0; i < 4; ++i )
+	{
+		if( name == BLEND_NAMES[ i ] )
+		{
+			mode = BLEND_MODES[ i ];
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* blendName( SDL_BlendMode mode )
+{
+	for( int i = 0; i < 4; ++i )
+	{
+		if( mode == BLEND_MODES[ i ] )
+		{
+			return BLEND_NAMES[ i ];
+		}
+	}
+	return "unknown";
+}
+
+//Splits a comma separated list
+std::vector<std::string> splitList( std::string list )
+{
+	std::vector<std::string> items;
+	for( size_t start = 0; start < list.size(); )
+	{
+		size_t comma = list.find( ',', start );
+		comma = comma == std::string::npos ? list.size() : comma;
+		if( comma > start )
+		{
+			items.push_back( list.substr( start, comma - start ) );
+		}
+		start = comma + 1;
+	}
+	return items;
+}
+
+//The test picture's palette, 256 colors with alpha going from transparent to opaque
+SDL_Color gPalette[ 256 ];
+
+void makePalette()
+{
+	for( int i = 0; i < 256; ++i )
+	{
+		gPalette[ i ].r = ( i * 37 ) & 0xFF;
+		gPalette[ i ].g = ( i * 91 + 64 ) & 0xFF;
+		gPalette[ i ].b = ( i * 173 + 128 ) & 0xFF;
+		gPalette[ i ].a = i;
+	}
+}
+
+//A size x size test picture in format, NULL if SDL can't make one
+SDL_Surface* makeSource( int size, Uint32 format )
+{
+	SDL_Surface* indexed = SDL_CreateRGBSurfaceWithFormat( 0, size, size, 8, SDL_PIXELFORMAT_INDEX8 );
+	if( indexed == NULL )
+	{
+		return NULL;
+	}
+	SDL_SetPaletteColors( indexed->format->palette, gPalette, 0, 256 );
+
+	//Diagonal bands, so rows differ and runs are short
+	for( int y = 0; y < size; ++y )
+	{
+		Uint8* row = (Uint8*)indexed->pixels + y * indexed->pitch;
+		for( int x = 0; x < size; ++x )
+		{
+			row[ x ] = ( ( x + y ) / 3 + ( x ^ y ) ) & 0xFF;
+		}
+	}
+	if( format == SDL_PIXELFORMAT_INDEX8 )
+	{
+		return indexed;
+	}
+
+	//Through ARGB8888, so the palette's alpha survives into formats that have it
+	SDL_Surface* argb = SDL_ConvertSurfaceFormat( indexed, SDL_PIXELFORMAT_ARGB8888, 0 );
+	SDL_FreeSurface( indexed );
+	if( argb == NULL || format == SDL_PIXELFORMAT_ARGB8888 )
+	{
+		return argb;
+	}
+	SDL_Surface* converted = SDL_ConvertSurfaceFormat( argb, format, 0 );
+	SDL_FreeSurface( argb );
+	return converted;
+}
+
+//Renderer under test and what it draws into
+struct OpRenderer
+{
+	std::string driver;
+	SDL_Window* window;
+	SDL_Surface* targetSurface;
+	SDL_Texture* targetTexture;
+	SDL_Renderer* renderer;
+};
+
+void destroyOpRenderer( OpRenderer& target )
+{
+	SDL_DestroyTexture( target.targetTexture );
+	SDL_DestroyRenderer( target.renderer );
+	SDL_FreeSurface( target.targetSurface );
+	SDL_DestroyWindow( target.window );
+	target = OpRenderer();
+}
+
+//Software into a surface, anything else into a target texture on a hidden window
+bool createOpRenderer( std::string driver, int size, OpRenderer& target )
+{
+	target = OpRenderer();
+	target.driver = driver;
+	if( driver == "software" )
+	{
+		target.targetSurface = SDL_CreateRGBSurfaceWithFormat( 0, size, size, 32, SDL_PIXELFORMAT_ARGB8888 );
+		target.renderer = target.targetSurface != NULL ? SDL_CreateSoftwareRenderer( target.targetSurface ) : NULL;
+	}
+	else
+	{
+		target.window = SDL_CreateWindow( "Op bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_HIDDEN );
+		int index = findRenderDriver( driver );
+		target.renderer = target.window != NULL && index >= 0 ? SDL_CreateRenderer( target.window, index, SDL_RENDERER_TARGETTEXTURE ) : NULL;
+		target.targetTexture = target.renderer != NULL ? SDL_CreateTexture( target.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, size, size ) : NULL;
+		if( target.targetTexture == NULL || SDL_SetRenderTarget( target.renderer, target.targetTexture ) < 0 )
+		{
+			//Texture first, destroying the renderer frees it and destroyOpRenderer mustn't free it again
+			if( target.targetTexture != NULL )
+			{
+				SDL_DestroyTexture( target.targetTexture );
+				target.targetTexture = NULL;
+			}
+			if( target.renderer != NULL )
+			{
+				SDL_DestroyRenderer( target.renderer );
+				target.renderer = NULL;
+			}
+		}
+	}
+
+	if( target.renderer == NULL )
+	{
+		printf( "Unable to create %s renderer! SDL Error: %s\n", driver.c_str(), SDL_GetError() );
+		destroyOpRenderer( target );
+		return false;
+	}
+	return true;
+}
+
+//Waits for everything queued on the renderer by reading a pixel back
+void syncRenderer( SDL_Renderer* renderer )
+{
+	SDL_Rect pixel = { 0, 0, 1, 1 };
+	Uint32 value = 0;
+	SDL_RenderReadPixels( renderer, &pixel, SDL_PIXELFORMAT_ARGB8888, &value, 4 );
+}
+
+//Timing of one grid point
+struct OpTiming
+{
+	int batch;
+	int outliers;
+	BenchStats stats;
+};
+
+//Warms up, picks a batch size, then takes reps samples of ms per operation with outliers dropped
+OpTiming timeOp( std::function<void()> op, SDL_Renderer* renderer, int warmup, int reps )
+{
+	OpTiming timing;
+	timing.batch = 1;
+	for( int i = 0; i < warmup; ++i )
+	{
+		double start = benchNowMs();
+		op();
+		if( renderer != NULL )
+		{
+			syncRenderer( renderer );
+		}
+		double elapsed = benchNowMs() - start;
+		timing.batch = elapsed > 0.0 ? SDL_min( MAX_BATCH, (int)( MIN_SAMPLE_MS / elapsed ) + 1 ) : MAX_BATCH;
+	}
+
+	std::vector<double> samples;
+	for( int rep = 0; rep < reps; ++rep )
+	{
+		double start = benchNowMs();
+		for( int i = 0; i < timing.batch; ++i )
+		{
+			op();
+		}
+		if( renderer != NULL )
+		{
+			syncRenderer( renderer );
+		}
+		samples.push_back( ( benchNowMs() - start ) / timing.batch );
+	}
+
+	timing.outliers = removeOutliers( samples );
+	timing.stats = summarizeSamples( samples );
+	return timing;
+}
+
+//One measured grid point, what it covered and where it goes in the report
+struct OpPoint
+{
+	OpKind op;
+	std::string driver;
+	int size;
+	std::string format;
+	std::string dstFormat;
+	std::string blend;
+	double pixels;
+};
+
+void reportPoint( BenchReport& report, const OpPoint& point, const OpTiming& timing )
+{
+	double mpixPerS = timing.stats.median > 0.0 ? point.pixels / timing.stats.median / 1000.0 : 0.0;
+	printf( "%-14s %-9s %5d %-9s %-9s %-6s %7d %12.2f %10.1f %4d\n", OP_NAMES[ point.op ], point.driver.empty() ? "-" : point.driver.c_str(), point.size,
+		point.format.empty() ? "-" : point.format.c_str(), point.dstFormat.empty() ? "-" : point.dstFormat.c_str(),
+		point.blend.empty() ? "-" : point.blend.c_str(), timing.batch, timing.stats.median * 1000.0, mpixPerS, timing.outliers );
+
+	BenchResult result;
+	result.name = "sdl_op";
+	result.params.push_back( std::make_pair( "op", OP_NAMES[ point.op ] ) );
+	result.params.push_back( std::make_pair( "size", std::to_string( point.size ) ) );
+	if( !point.driver.empty() )
+	{
+		result.params.push_back( std::make_pair( "renderer", point.driver ) );
+	}
+	if( !point.format.empty() )
+	{
+		result.params.push_back( std::make_pair( "format", point.format ) );
+	}
+	if( !point.dstFormat.empty() )
+	{
+		result.params.push_back( std::make_pair( "dst_format", point.dstFormat ) );
+	}
+	if( !point.blend.empty() )
+	{
+		result.params.push_back( std::make_pair( "blend", point.blend ) );
+	}
+	result.metrics.push_back( std::make_pair( "mpix_per_s", mpixPerS ) );
+	result.metrics.push_back( std::make_pair( "batch", (double)timing.batch ) );
+	result.metrics.push_back( std::make_pair( "outliers", (double)timing.outliers ) );
+	addStatsMetrics( result, timing.stats );
+	report.results.push_back( result );
+}
+
+//A metric of a result, NAN if it doesn't have it
+double resultMetric( const BenchResult& result, std::string name )
+{
+	for( size_t m = 0; m < result.metrics.size(); ++m )
+	{
+		if( result.metrics[ m ].first == name )
+		{
+			return result.metrics[ m ].second;
+		}
+	}
+	return NAN;
+}
+
+//Adds the fastest source and destination format for each operation, size, renderer and blend mode as "fastest" results
+//and prints them; the blend mode stays fixed since what is drawn decides it, the formats are the loader's choice
+void reportFastest( BenchReport& report )
+{
+	std::vector<std::string> order;
+	std::map<std::string, size_t> best;
+	for( size_t r = 0; r < report.results.size(); ++r )
+	{
+		const BenchResult& result = report.results[ r ];
+		std::string key;
+		for( size_t p = 0; p < result.params.size(); ++p )
+		{
+			if( result.params[ p ].first != "format" && result.params[ p ].first != "dst_format" )
+			{
+				key += result.params[ p ].first + "=" + result.params[ p ].second + " ";
+			}
+		}
+
+		std::map<std::string, size_t>::iterator it = best.find( key );
+		if( it == best.end() )
+		{
+			order.push_back( key );
+			best[ key ] = r;
+		}
+		else if( resultMetric( result, "median_ms" ) < resultMetric( report.results[ it->second ], "median_ms" ) )
+		{
+			it->second = r;
+		}
+	}
+
+	printf( "\nFastest formats per operation, size, renderer and blend mode:\n" );
+	for( size_t i = 0; i < order.size(); ++i )
+	{
+		BenchResult fastest = report.results[ best[ order[ i ] ] ];
+		fastest.name = "fastest";
+
+		std::string choice;
+		for( size_t p = 0; p < fastest.params.size(); ++p )
+		{
+			choice += ( p == 0 ? "" : " " ) + fastest.params[ p ].first + "=" + fastest.params[ p ].second;
+		}
+		printf( "  %-72s %10.1f MPix/s\n", choice.c_str(), resultMetric( fastest, "mpix_per_s" ) );
+		report.results.push_back( fastest );
+	}
+}
+
+int main( int argc, char* args[] )
+{
+	std::vector<std::string> opNames;
+	std::vector<int> sizes = { 64, 256, 1024 };
+	std::vector<Uint32> formats = { SDL_PIXELFORMAT_RGB888, SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888, SDL_PIXELFORMAT_RGB565,
+		SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_INDEX8 };
+	std::vector<Uint32> dstFormats = { SDL_PIXELFORMAT_RGB888, SDL_PIXELFORMAT_ARGB8888 };
+	std::vector<SDL_BlendMode> blends = { SDL_BLENDMODE_NONE, SDL_BLENDMODE_BLEND, SDL_BLENDMODE_ADD, SDL_BLENDMODE_MOD };
+	std::vector<std::string> drivers = { "software" };
+	int warmup = 3;
+	int reps = 20;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	bool valid = true;
+	for( int i = 1; i < argc && valid; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--ops" && i + 1 < argc )
+		{
+			opNames = splitList( args[ ++i ] );
+		}
+		else if( arg == "--sizes" && i + 1 < argc )
+		{
+			sizes.clear();
+			std::vector<std::string> list = splitList( args[ ++i ] );
+			for( size_t s = 0; s < list.size(); ++s )
+			{
+				int size = atoi( list[ s ].c_str() );
+				if( size >= 2 )
+				{
+					sizes.push_back( size );
+				}
+			}
+		}
+		else if( ( arg == "--formats" || arg == "--dst-formats" ) && i + 1 < argc )
+		{
+			std::vector<Uint32>& list = arg == "--formats" ? formats : dstFormats;
+			std::vector<std::string> names = splitList( args[ ++i ] );
+			list.clear();
+			for( size_t f = 0; f < names.size(); ++f )
+			{
+				Uint32 format = formatFromName( names[ f ] );
+				if( format == SDL_PIXELFORMAT_UNKNOWN )
+				{
+					printf( "Unknown pixel format %s\n", names[ f ].c_str() );
+					valid = false;
+				}
+				list.push_back( format );
+			}
+		}
+		else if( arg == "--blends" && i + 1 < argc )
+		{
+			std::vector<std::string> names = splitList( args[ ++i ] );
+			blends.clear();
+			for( size_t b = 0; b < names.size(); ++b )
+			{
+				SDL_BlendMode mode;
+				valid = valid && blendFromName( names[ b ], mode );
+				blends.push_back( mode );
+			}
+		}
+		else if( arg == "--drivers" && i + 1 < argc )
+		{
+			drivers = splitList( args[ ++i ] );
+		}
+		else if( arg == "--warmup" && i + 1 < argc )
+		{
+			warmup = atoi( args[ ++i ] );
+			warmup = SDL_max( 1, warmup );
+		}
+		else if( arg == "--reps" && i + 1 < argc )
+		{
+			reps = atoi( args[ ++i ] );
+			reps = SDL_max( 1, reps );
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			valid = false;
+		}
+	}
+
+	//Operations by name, all of them by default
+	bool runOp[ OP_TOTAL ] = {};
+	for( int op = 0; op < OP_TOTAL; ++op )
+	{
+		runOp[ op ] = opNames.empty();
+	}
+	for( size_t n = 0; n < opNames.size(); ++n )
+	{
+		bool known = opNames[ n ] == "all";
+		for( int op = 0; op < OP_TOTAL; ++op )
+		{
+			if( opNames[ n ] == "all" || opNames[ n ] == OP_NAMES[ op ] )
+			{
+				runOp[ op ] = true;
+				known = true;
+			}
+		}
+		if( !known )
+		{
+			printf( "Unknown operation %s\n", opNames[ n ].c_str() );
+			valid = false;
+		}
+	}
+
+	if( !valid || sizes.empty() )
+	{
+		printf( "Usage: %s [--ops all|load-bmp,img-load,...] [--sizes 64,256] [--formats XRGB8888,...] [--dst-formats XRGB8888,...]\n", args[ 0 ] );
+		printf( "       [--blends none,blend,add,mod] [--drivers software,opengl|all] [--warmup N] [--reps N] [--json out.json]\n" );
+		return 1;
+	}
+
+	//Run headless unless told otherwise
+	if( getenv( "SDL_VIDEODRIVER" ) == NULL )
+	{
+		SDL_SetHint( SDL_HINT_VIDEODRIVER, "offscreen" );
+	}
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+	if( !( IMG_Init( IMG_INIT_PNG ) & IMG_INIT_PNG ) )
+	{
+		printf( "SDL_image could not initialize, skipping img-load! SDL_image Error: %s\n", IMG_GetError() );
+		runOp[ OP_IMG_LOAD ] = false;
+	}
+
+	//Every backend SDL has, for --drivers all
+	if( drivers.size() == 1 && drivers[ 0 ] == "all" )
+	{
+		drivers.clear();
+		for( int i = 0; i < SDL_GetNumRenderDrivers(); ++i )
+		{
+			SDL_RendererInfo info;
+			if( SDL_GetRenderDriverInfo( i, &info ) == 0 )
+			{
+				drivers.push_back( info.name );
+			}
+		}
+	}
+
+	makePalette();
+	int largest = 0;
+	for( size_t s = 0; s < sizes.size(); ++s )
+	{
+		largest = SDL_max( largest, sizes[ s ] );
+	}
+
+	BenchReport report;
+	report.suite = "op_bench";
+
+	printf( "%d warmup and %d timed samples per point, %.1f ms or more per sample\n", warmup, reps, MIN_SAMPLE_MS );
+	printf( "%-14s %-9s %5s %-9s %-9s %-6s %7s %12s %10s %4s\n", "op", "renderer", "size", "format", "dst", "blend", "batch", "median us",
+		"MPix/s", "out" );
+
+	//Surface operations
+	for( int o = 0; o < OP_TOTAL; ++o )
+	{
+		OpKind op = (OpKind)o;
+		if( !runOp[ op ] || opUsesRenderer( op ) )
+		{
+			continue;
+		}
+
+		for( size_t s = 0; s < sizes.size(); ++s )
+		{
+			int size = sizes[ s ];
+			std::vector<Uint32> sourceFormats = opUsesFormat( op ) ? formats : std::vector<Uint32>( 1, SDL_PIXELFORMAT_UNKNOWN );
+			for( size_t f = 0; f < sourceFormats.size(); ++f )
+			{
+				//The source, half size for the stretch
+				SDL_Surface* source = NULL;
+				if( opUsesFormat( op ) )
+				{
+					source = makeSource( op == OP_BLIT_SCALED ? SDL_max( 1, size / 2 ) : size, sourceFormats[ f ] );
+					if( source == NULL )
+					{
+						printf( "Unable to make a %s source! SDL Error: %s\n", formatName( sourceFormats[ f ] ).c_str(), SDL_GetError() );
+						continue;
+					}
+				}
+
+				//The loads read back a file written from the source
+				if( op == OP_LOAD_BMP || op == OP_IMG_LOAD )
+				{
+					bool saved = op == OP_LOAD_BMP ? SDL_SaveBMP( source, TEMP_BMP_PATH ) == 0 : IMG_SavePNG( source, TEMP_PNG_PATH ) == 0;
+					if( !saved )
+					{
+						printf( "Unable to save a %s %s! SDL Error: %s\n", formatName( sourceFormats[ f ] ).c_str(), op == OP_LOAD_BMP ? "BMP" : "PNG", SDL_GetError() );
+						SDL_FreeSurface( source );
+						continue;
+					}
+
+					OpPoint point = { op, "", size, formatName( sourceFormats[ f ] ), "", "", (double)size * size };
+					OpTiming timing = timeOp( [ op ]()
+					{
+						SDL_FreeSurface( op == OP_LOAD_BMP ? SDL_LoadBMP( TEMP_BMP_PATH ) : IMG_Load( TEMP_PNG_PATH ) );
+					}, NULL, warmup, reps );
+					reportPoint( report, point, timing );
+					remove( op == OP_LOAD_BMP ? TEMP_BMP_PATH : TEMP_PNG_PATH );
+					SDL_FreeSurface( source );
+					continue;
+				}
+
+				std::vector<Uint32> destinations = opUsesDstFormat( op ) ? dstFormats : std::vector<Uint32>( 1, SDL_PIXELFORMAT_UNKNOWN );
+				for( size_t d = 0; d < destinations.size(); ++d )
+				{
+					SDL_Surface* destination = SDL_CreateRGBSurfaceWithFormat( 0, size, size, SDL_BITSPERPIXEL( destinations[ d ] ), destinations[ d ] );
+					SDL_PixelFormat* dstFormat = SDL_AllocFormat( destinations[ d ] );
+					if( destination == NULL || dstFormat == NULL )
+					{
+						printf( "Unable to make a %s destination! SDL Error: %s\n", formatName( destinations[ d ] ).c_str(), SDL_GetError() );
+						SDL_FreeSurface( destination );
+						SDL_FreeFormat( dstFormat );
+						continue;
+					}
+
+					std::vector<SDL_BlendMode> modes = opUsesBlend( op ) ? blends : std::vector<SDL_BlendMode>( 1, SDL_BLENDMODE_NONE );
+					for( size_t b = 0; b < modes.size(); ++b )
+					{
+						OpPoint point = { op, "", size, opUsesFormat( op ) ? formatName( sourceFormats[ f ] ) : "", formatName( destinations[ d ] ),
+							opUsesBlend( op ) ? blendName( modes[ b ] ) : "", (double)size * size };
+						if( source != NULL )
+						{
+							SDL_SetSurfaceBlendMode( source, modes[ b ] );
+						}
+
+						std::function<void()> run;
+						if( op == OP_CONVERT )
+						{
+							run = [ source, dstFormat ]() { SDL_FreeSurface( SDL_ConvertSurface( source, dstFormat, 0 ) ); };
+						}
+						else if( op == OP_BLIT )
+						{
+							run = [ source, destination ]() { SDL_BlitSurface( source, NULL, destination, NULL ); };
+						}
+						else if( op == OP_BLIT_SCALED )
+						{
+							run = [ source, destination ]() { SDL_BlitScaled( source, NULL, destination, NULL ); };
+						}
+						else
+						{
+							Uint32 color = SDL_MapRGBA( destination->format, 0x40, 0x80, 0xC0, 0xFF );
+							run = [ destination, color ]() { SDL_FillRect( destination, NULL, color ); };
+						}
+						reportPoint( report, point, timeOp( run, NULL, warmup, reps ) );
+					}
+
+					SDL_FreeFormat( dstFormat );
+					SDL_FreeSurface( destination );
+				}
+				SDL_FreeSurface( source );
+			}
+		}
+	}
+
+	//Renderer operations, on each backend
+	for( size_t r = 0; r < drivers.size(); ++r )
+	{
+		OpRenderer target;
+		if( !createOpRenderer( drivers[ r ], largest, target ) )
+		{
+			continue;
+		}
+		SDL_Renderer* renderer = target.renderer;
+
+		for( int o = OP_CREATE_TEXTURE; o < OP_TOTAL; ++o )
+		{
+			OpKind op = (OpKind)o;
+			if( !runOp[ op ] )
+			{
+				continue;
+			}
+
+			for( size_t s = 0; s < sizes.size(); ++s )
+			{
+				int size = sizes[ s ];
+				std::vector<Uint32> sourceFormats = opUsesFormat( op ) ? formats : std::vector<Uint32>( 1, SDL_PIXELFORMAT_UNKNOWN );
+				for( size_t f = 0; f < sourceFormats.size(); ++f )
+				{
+					//The source surface, and for render-copy a texture in its format (renderers that don't have the format convert it)
+					SDL_Surface* source = opUsesFormat( op ) ? makeSource( size, sourceFormats[ f ] ) : NULL;
+					SDL_Texture* texture = NULL;
+					if( op == OP_RENDER_COPY && source != NULL )
+					{
+						texture = SDL_CreateTexture( renderer, sourceFormats[ f ], SDL_TEXTUREACCESS_STATIC, size, size );
+						if( texture != NULL && SDL_UpdateTexture( texture, NULL, source->pixels, source->pitch ) < 0 )
+						{
+							SDL_DestroyTexture( texture );
+							texture = NULL;
+						}
+					}
+					if( opUsesFormat( op ) && ( source == NULL || ( op == OP_RENDER_COPY && texture == NULL ) ) )
+					{
+						printf( "%s: no %s %s on %s, skipped (%s)\n", OP_NAMES[ op ], formatName( sourceFormats[ f ] ).c_str(),
+							op == OP_RENDER_COPY ? "texture" : "surface", drivers[ r ].c_str(), SDL_GetError() );
+						SDL_FreeSurface( source );
+						continue;
+					}
+
+					//Points spread over the size x size square
+					std::vector<SDL_Point> points( size * 16 );
+					Uint32 seed = 12345;
+					for( size_t p = 0; p < points.size(); ++p )
+					{
+						seed = seed * 1664525u + 1013904223u;
+						points[ p ].x = ( seed >> 8 ) % size;
+						points[ p ].y = ( seed >> 20 ) % size;
+					}
+
+					std::vector<SDL_BlendMode> modes = opUsesBlend( op ) ? blends : std::vector<SDL_BlendMode>( 1, SDL_BLENDMODE_NONE );
+					for( size_t b = 0; b < modes.size(); ++b )
+					{
+						bool pointOp = op == OP_RENDER_POINT || op == OP_RENDER_POINTS;
+						OpPoint point = { op, drivers[ r ], size, opUsesFormat( op ) ? formatName( sourceFormats[ f ] ) : "", "",
+							opUsesBlend( op ) ? blendName( modes[ b ] ) : "", pointOp ? (double)points.size() : (double)size * size };
+						SDL_SetRenderDrawColor( renderer, 0x40, 0x80, 0xC0, 0x80 );
+						SDL_SetRenderDrawBlendMode( renderer, modes[ b ] );
+						if( texture != NULL )
+						{
+							SDL_SetTextureBlendMode( texture, modes[ b ] );
+						}
+
+						std::function<void()> run;
+						SDL_Rect rect = { 0, 0, size, size };
+						if( op == OP_CREATE_TEXTURE )
+						{
+							run = [ renderer, source ]() { SDL_DestroyTexture( SDL_CreateTextureFromSurface( renderer, source ) ); };
+						}
+						else if( op == OP_RENDER_COPY )
+						{
+							run = [ renderer, texture, rect ]() { SDL_RenderCopy( renderer, texture, NULL, &rect ); };
+						}
+						else if( op == OP_RENDER_FILL )
+						{
+							run = [ renderer, rect ]() { SDL_RenderFillRect( renderer, &rect ); };
+						}
+						else if( op == OP_RENDER_POINT )
+						{
+							run = [ renderer, &points ]()
+							{
+								for( size_t p = 0; p < points.size(); ++p )
+								{
+									SDL_RenderDrawPoint( renderer, points[ p ].x, points[ p ].y );
+								}
+							};
+						}
+						else
+						{
+							run = [ renderer, &points ]() { SDL_RenderDrawPoints( renderer, points.data(), points.size() ); };
+						}
+						reportPoint( report, point, timeOp( run, renderer, warmup, reps ) );
+					}
+
+					SDL_DestroyTexture( texture );
+					SDL_FreeSurface( source );
+				}
+			}
+		}
+
+		destroyOpRenderer( target );
+	}
+
+	reportFastest( report );
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	IMG_Quit();
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*Converts the lesson images to and from the fast lossless .qoi/.qois formats.
+
+	qoi_convert [--strip-rows N] input output
+
+The input can be anything SDL_image reads (BMP, PNG, JPG) or a .qoi/.qois file. The output format is picked from the
+extension: .qois writes striped QOI that the lessons decode in parallel, .qoi writes plain single stream QOI that other
+QOI tools understand, .bmp and .png decode back out for checking. Every encode is decoded again and compared pixel for pixel.
+*/
+
+//Using SDL, SDL_image, standard IO, strings, the QOI codec and the job system
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include "../../common/strip_qoi.h"
+#include "../../common/job_system.h"
+
+//Workers .qois strips are decoded on
+JobSystem gJobs;
+
+//Ends with a given extension
+bool hasExtension( std::string path, std::string ext )
+{
+	return path.size() >= ext.size() && path.compare( path.size() - ext.size(), ext.size(), ext ) == 0;
+}
+
+//Loads any supported input image
+SDL_Surface* loadInput( std::string path )
+{
+	SDL_Surface* loadedSurface = isQOIPath( path ) ? loadStripQOI( path, &gJobs ) : IMG_Load( path.c_str() );
+	if( loadedSurface == NULL )
+	{
+		printf( "Unable to load image %s! SDL Error: %s\n", path.c_str(), SDL_GetError() );
+	}
+
+	return loadedSurface;
+}
+
+//Checks two surfaces hold the same pixels (alpha ignored for images without it)
+bool samePixels( SDL_Surface* a, SDL_Surface* b, bool compareAlpha )
+{
+	SDL_Surface* ca = SDL_ConvertSurfaceFormat( a, SDL_PIXELFORMAT_ARGB8888, 0 );
+	SDL_Surface* cb = SDL_ConvertSurfaceFormat( b, SDL_PIXELFORMAT_ARGB8888, 0 );
+	bool same = ca != NULL && cb != NULL && ca->w == cb->w && ca->h == cb->h;
+	Uint32 mask = compareAlpha ? 0xFFFFFFFF : 0x00FFFFFF;
+
+	for( int y = 0; same && y < ca->h; ++y )
+	{
+		const Uint32* ra = (const Uint32*)( (const Uint8*)ca->pixels + y * ca->pitch );
+		const Uint32* rb = (const Uint32*)( (const Uint8*)cb->pixels + y * cb->pitch );
+		for( int x = 0; x < ca->w; ++x )
+		{
+			if( ( ra[ x ] & mask ) != ( rb[ x ] & mask ) )
+			{
+				same = false;
+				break;
+			}
+		}
+	}
+
+	SDL_FreeSurface( ca );
+	SDL_FreeSurface( cb );
+
+	return same;
+}
+
+int main( int argc, char* args[] )
+{
+	int stripRows = QOIS_DEFAULT_STRIP_ROWS;
+	std::string input;
+	std::string output;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--strip-rows" && i + 1 < argc )
+		{
+			stripRows = atoi( args[ ++i ] );
+		}
+		else if( input.empty() )
+		{
+			input = arg;
+		}
+		else if( output.empty() )
+		{
+			output = arg;
+		}
+	}
+
+	if( input.empty() || output.empty() || stripRows <= 0 )
+	{
+		printf( "Usage: %s [--strip-rows N] input output(.qois|.qoi|.bmp|.png)\n", args[ 0 ] );
+		return 1;
+	}
+
+	//SDL_image is only needed for the formats it decodes
+	IMG_Init( IMG_INIT_PNG | IMG_INIT_JPG );
+	startJobSystem( gJobs );
+
+	int result = 1;
+	SDL_Surface* image = loadInput( input );
+	if( image != NULL )
+	{
+		if( isQOIPath( output ) )
+		{
+			//Encode
+			std::vector<Uint8> encoded;
+			if( !encodeStripQOI( image, hasExtension( output, ".qois" ) ? stripRows : 0, encoded ) )
+			{
+				printf( "Unable to encode %s! SDL Error: %s\n", input.c_str(), SDL_GetError() );
+			}
+			else
+			{
+				//Make sure it comes back out the same before writing it
+				SDL_Surface* decoded = decodeStripQOI( encoded.data(), encoded.size(), &gJobs );
+				if( decoded == NULL || !samePixels( image, decoded, SDL_ISPIXELFORMAT_ALPHA( image->format->format ) ) )
+				{
+					printf( "Round trip check failed for %s!\n", input.c_str() );
+				}
+				else if( !writeImageFile( output, encoded ) )
+				{
+					printf( "Unable to write %s!\n", output.c_str() );
+				}
+				else
+				{
+					size_t rawSize = (size_t)image->w * image->h * image->format->BytesPerPixel;
+					printf( "%s -> %s: %dx%d, %zu bytes raw, %zu bytes encoded (%.1f%%)\n", input.c_str(), output.c_str(),
+						image->w, image->h, rawSize, encoded.size(), 100.0 * encoded.size() / rawSize );
+					result = 0;
+				}
+				SDL_FreeSurface( decoded );
+			}
+		}
+		else if( hasExtension( output, ".png" ) )
+		{
+			//Decode to PNG
+			if( IMG_SavePNG( image, output.c_str() ) == 0 )
+			{
+				result = 0;
+			}
+			else
+			{
+				printf( "Unable to write %s! SDL_image Error: %s\n", output.c_str(), IMG_GetError() );
+			}
+		}
+		else
+		{
+			//Decode to BMP
+			if( SDL_SaveBMP( image, output.c_str() ) == 0 )
+			{
+				result = 0;
+			}
+			else
+			{
+				printf( "Unable to write %s! SDL Error: %s\n", output.c_str(), SDL_GetError() );
+			}
+		}
+
+		SDL_FreeSurface( image );
+	}
+
+	stopJobSystem( gJobs );
+	IMG_Quit();
+	SDL_Quit();
+
+	return result;
+}
@@ -0,0 +1,265 @@
+/*Integer upscaling benchmark.
+
+	scale_bench [--reps 100] [--threads N] [--json out.json] [image.bmp ...]
+
+Scales a 640x480 XRGB8888 frame up 2x, 3x and 6x (1280x960, 1920x1440 and 3840x2880) every way the lessons can:
+	blit-scaled  SDL_BlitScaled, SDL's nearest neighbour stretch, what 05 --scale-mode blit does
+	renderer-sw  the frame uploaded to a streaming texture and drawn by the software renderer with SDL_RenderSetLogicalSize
+	             and SDL_RenderSetIntegerScale, what 07 --scale does when there is no GPU
+	scalar       integerScaleSurface's plain C row kernel on one thread
+	sse2, avx2   its SIMD row kernels on one thread (skipped on CPUs without them)
+	threaded     the best kernel on a job system with --threads workers (every CPU by default), what 05 --scale does
+and reports the time per frame and output megapixels per second. Without arguments the frame is a generated pattern with
+no two neighbouring pixels alike, image arguments are scaled as they are.
+*/
+
+//Using SDL, standard IO, strings, the integer scaler and the job system
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../../common/bench_report.h"
+#include "../../common/integer_scale.h"
+#include "../../common/job_system.h"
+
+//Logical resolution, the lessons' screen size
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+
+//Ways of scaling up
+enum ScaleMethod
+{
+	METHOD_BLIT_SCALED,
+	METHOD_RENDERER_SW,
+	METHOD_SCALAR,
+	METHOD_SSE2,
+	METHOD_AVX2,
+	METHOD_THREADED,
+	METHOD_TOTAL
+};
+const char* METHOD_NAMES[ METHOD_TOTAL ] = { "blit-scaled", "renderer-sw", "scalar", "sse2", "avx2", "threaded" };
+
+//A frame at the logical resolution
+SDL_Surface* makePattern()
+{
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_RGB888 );
+	if( surface == NULL )
+	{
+		return NULL;
+	}
+
+	for( int y = 0; y < surface->h; ++y )
+	{
+		Uint32* row = (Uint32*)( (Uint8*)surface->pixels + y * surface->pitch );
+		for( int x = 0; x < surface->w; ++x )
+		{
+			row[ x ] = ( (Uint32)( x & 0xFF ) << 16 ) | ( (Uint32)( y & 0xFF ) << 8 ) | (Uint32)( ( x * 7 + y * 13 ) & 0xFF );
+		}
+	}
+
+	return surface;
+}
+
+//Scales source up factor times onto destination one way, false if this method can't run here
+bool scaleFrame( ScaleMethod method, SDL_Surface* source, SDL_Surface* destination, int factor, JobSystem& jobs, SDL_Renderer* renderer, SDL_Texture* texture )
+{
+	SDL_Rect rect = { 0, 0, source->w * factor, source->h * factor };
+	switch( method )
+	{
+		case METHOD_BLIT_SCALED:
+		return SDL_BlitScaled( source, NULL, destination, &rect ) == 0;
+
+		case METHOD_RENDERER_SW:
+		SDL_UpdateTexture( texture, NULL, source->pixels, source->pitch );
+		SDL_RenderCopy( renderer, texture, NULL, NULL );
+		return SDL_RenderFlush( renderer ) == 0;
+
+		case METHOD_SCALAR:
+		return integerScaleSurface( source, destination, 0, 0, factor, SCALE_PATH_SCALAR, NULL ) == 0;
+
+		case METHOD_SSE2:
+		return integerScaleSurface( source, destination, 0, 0, factor, SCALE_PATH_SSE2, NULL ) == 0;
+
+		case METHOD_AVX2:
+		return integerScaleSurface( source, destination, 0, 0, factor, SCALE_PATH_AVX2, NULL ) == 0;
+
+		default:
+		return integerScaleSurface( source, destination, 0, 0, factor, SCALE_PATH_AUTO, &jobs ) == 0;
+	}
+}
+
+int main( int argc, char* args[] )
+{
+	int reps = 100;
+	int threads = 0;
+	const char* jsonPath = NULL;
+	std::vector<std::string> imagePaths;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--reps" && i + 1 < argc )
+		{
+			reps = atoi( args[ ++i ] );
+			reps = SDL_max( 1, reps );
+		}
+		else if( arg == "--threads" && i + 1 < argc )
+		{
+			threads = atoi( args[ ++i ] );
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else if( arg.size() > 2 && arg.compare( 0, 2, "--" ) == 0 )
+		{
+			printf( "Usage: %s [--reps N] [--threads N] [--json out.json] [image.bmp ...]\n", args[ 0 ] );
+			return 1;
+		}
+		else
+		{
+			imagePaths.push_back( arg );
+		}
+	}
+
+	if( SDL_Init( 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//Nearest sampling for the renderer, like 07 --scale
+	SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "0" );
+
+	//Gather the frames, all in the destination's format
+	std::vector<std::pair<std::string, SDL_Surface*> > sources;
+	if( imagePaths.empty() )
+	{
+		sources.push_back( std::make_pair( std::string( "pattern" ), makePattern() ) );
+	}
+	for( size_t i = 0; i < imagePaths.size(); ++i )
+	{
+		SDL_Surface* loaded = SDL_LoadBMP( imagePaths[ i ].c_str() );
+		if( loaded == NULL )
+		{
+			printf( "Unable to load %s! SDL Error: %s\n", imagePaths[ i ].c_str(), SDL_GetError() );
+			continue;
+		}
+		std::string name = imagePaths[ i ].substr( imagePaths[ i ].rfind( '/' ) + 1 );
+		sources.push_back( std::make_pair( name, SDL_ConvertSurfaceFormat( loaded, SDL_PIXELFORMAT_RGB888, 0 ) ) );
+		SDL_FreeSurface( loaded );
+	}
+
+	//Workers for the threaded scales, this thread being the first
+	JobSystem jobs;
+	startJobSystem( jobs, threads );
+
+	ScalePath best = bestScalePath();
+	int cpus = jobWorkerCount( jobs );
+	BenchReport report;
+	report.suite = "scale_bench";
+
+	printf( "%d reps per point, best kernels: %s, %d threads\n", reps, scalePathName( best ), cpus );
+	printf( "%-12s %6s %12s %12s %10s %12s %10s\n", "source", "factor", "size", "method", "ms", "MPix/s", "vs blit" );
+	const int factors[] = { 2, 3, 6 };
+	for( size_t s = 0; s < sources.size(); ++s )
+	{
+		SDL_Surface* source = sources[ s ].second;
+		if( source == NULL )
+		{
+			continue;
+		}
+
+		for( int f = 0; f < 3; ++f )
+		{
+			int factor = factors[ f ];
+			SDL_Surface* destination = SDL_CreateRGBSurfaceWithFormat( 0, source->w * factor, source->h * factor, 32, SDL_PIXELFORMAT_RGB888 );
+			if( destination == NULL )
+			{
+				printf( "Unable to create %dx destination! SDL Error: %s\n", factor, SDL_GetError() );
+				continue;
+			}
+			char size[ 32 ];
+			SDL_snprintf( size, sizeof( size ), "%dx%d", destination->w, destination->h );
+
+			//The software renderer draws straight into the destination surface
+			SDL_Renderer* renderer = SDL_CreateSoftwareRenderer( destination );
+			SDL_Texture* texture = NULL;
+			if( renderer != NULL )
+			{
+				SDL_RenderSetLogicalSize( renderer, source->w, source->h );
+				SDL_RenderSetIntegerScale( renderer, SDL_TRUE );
+				texture = SDL_CreateTexture( renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, source->w, source->h );
+			}
+
+			double blitRate = 0.0;
+			for( int m = 0; m < METHOD_TOTAL; ++m )
+			{
+				ScaleMethod method = (ScaleMethod)m;
+				if( ( method == METHOD_AVX2 && best != SCALE_PATH_AVX2 ) || ( method == METHOD_SSE2 && best == SCALE_PATH_SCALAR ) ||
+					( method == METHOD_RENDERER_SW && texture == NULL ) )
+				{
+					continue;
+				}
+
+				//The first frame is an untimed warmup
+				std::vector<double> samples;
+				bool ran = true;
+				for( int rep = -1; rep < reps && ran; ++rep )
+				{
+					double start = benchNowMs();
+					ran = scaleFrame( method, source, destination, factor, jobs, renderer, texture );
+					if( rep >= 0 )
+					{
+						samples.push_back( benchNowMs() - start );
+					}
+				}
+				if( !ran )
+				{
+					printf( "%-12s %6d %12s %12s failed: %s\n", sources[ s ].first.c_str(), factor, size, METHOD_NAMES[ m ], SDL_GetError() );
+					continue;
+				}
+
+				BenchStats stats = summarizeSamples( samples );
+				double rate = stats.median > 0.0 ? (double)destination->w * destination->h / stats.median / 1000.0 : 0.0;
+				if( method == METHOD_BLIT_SCALED )
+				{
+					blitRate = rate;
+				}
+				double speedup = blitRate > 0.0 ? rate / blitRate : 0.0;
+				printf( "%-12s %5dx %12s %12s %10.3f %12.1f %9.2fx\n", sources[ s ].first.c_str(), factor, size, METHOD_NAMES[ m ], stats.median, rate, speedup );
+
+				BenchResult result;
+				result.name = "integer_scale";
+				result.params.push_back( std::make_pair( "source", sources[ s ].first ) );
+				result.params.push_back( std::make_pair( "factor", std::to_string( factor ) ) );
+				result.params.push_back( std::make_pair( "method", METHOD_NAMES[ m ] ) );
+				result.params.push_back( std::make_pair( "threads", std::to_string( method == METHOD_THREADED ? cpus : 1 ) ) );
+				result.metrics.push_back( std::make_pair( "mpix_per_s", rate ) );
+				result.metrics.push_back( std::make_pair( "speedup_vs_blit_scaled", speedup ) );
+				addStatsMetrics( result, stats );
+				report.results.push_back( result );
+			}
+
+			SDL_DestroyTexture( texture );
+			SDL_DestroyRenderer( renderer );
+			SDL_FreeSurface( destination );
+		}
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	for( size_t s = 0; s < sources.size(); ++s )
+	{
+		SDL_FreeSurface( sources[ s ].second );
+	}
+	stopJobSystem( jobs );
+	SDL_Quit();
+
+	return 0;
+}
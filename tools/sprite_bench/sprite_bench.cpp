@@ -0,0 +1,429 @@
+/*Sprite throughput benchmark on 07's texture path.
+
+	sprite_bench [--counts 1000,10000,100000,1000000] [--frames 10] [--driver name] [--json out.json]
+
+Draws N instances of 07's texture.png per frame with varying positions, sizes, flips and color mods, five ways:
+	copy      SDL_SetTextureColorMod + SDL_RenderCopy per sprite (no flips, RenderCopy can't)
+	copyex    SDL_SetTextureColorMod + SDL_RenderCopyEx per sprite
+	geometry  all sprites as one SDL_RenderGeometry call, vertex colors for the color mod, swapped UVs for flips,
+	          vertex and index buffers allocated once and reused every frame
+	copyex-mip    copyex from the mip level matching each sprite's size (common/mipmap.h)
+	geometry-mip  geometry with sprites grouped by mip level, one SDL_RenderGeometry call per level used
+and reports sprites/ms. The sprites are 8 to 64 pixels and the texture 640x480, so every draw is heavily minified.
+By default it renders with SDL's software renderer into a 640x480 surface so no window or GPU is needed, --driver names
+another backend to run on a hidden window instead; a name SDL doesn't have is an error rather than its default backend.
+*/
+
+//Using SDL, SDL_image, standard IO, strings and the benchmark report
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "../../common/bench_report.h"
+#include "../../common/lazy_image_init.h"
+#include "../../common/renderer_probe.h"
+#include "../../common/mipmap.h"
+
+//Screen dimension constants
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+
+//The texture from 07
+const char* TEXTURE_PATH = "../../07_texture_loading_and_rendering/texture.png";
+
+//One sprite instance
+struct Sprite
+{
+	float x, y;
+	float vx, vy;
+	int w, h;
+	SDL_RendererFlip flip;
+	SDL_Color color;
+};
+
+//Ways of drawing the sprites
+enum SpriteMode
+{
+	SPRITE_MODE_COPY,
+	SPRITE_MODE_COPY_EX,
+	SPRITE_MODE_GEOMETRY,
+	SPRITE_MODE_COPY_EX_MIP,
+	SPRITE_MODE_GEOMETRY_MIP,
+	SPRITE_MODE_TOTAL
+};
+const char* SPRITE_MODE_NAMES[ SPRITE_MODE_TOTAL ] = { "copy", "copyex", "geometry", "copyex-mip", "geometry-mip" };
+
+//Reused submission buffers for the geometry path
+std::vector<SDL_Vertex> gVertices;
+std::vector<int> gIndices;
+
+//The texture's mip chain and the geometry-mip path's per level vertex buffers
+MipTexture gMip;
+std::vector< std::vector<SDL_Vertex> > gLevelVertices;
+
+//Makes a reproducible set of sprites
+std::vector<Sprite> makeSprites( int count )
+{
+	std::vector<Sprite> sprites( count );
+	Uint32 seed = 12345;
+	for( int i = 0; i < count; ++i )
+	{
+		//Small LCG so every run draws the same scene
+		seed = seed * 1664525u + 1013904223u;
+		Sprite& sprite = sprites[ i ];
+		sprite.w = 8 + ( seed >> 8 ) % 57;
+		sprite.h = 8 + ( seed >> 16 ) % 57;
+		sprite.x = (float)( ( seed >> 4 ) % ( SCREEN_WIDTH - sprite.w ) );
+		seed = seed * 1664525u + 1013904223u;
+		sprite.y = (float)( ( seed >> 4 ) % ( SCREEN_HEIGHT - sprite.h ) );
+		sprite.vx = (float)( (int)( ( seed >> 12 ) % 7 ) - 3 );
+		sprite.vy = (float)( (int)( ( seed >> 20 ) % 7 ) - 3 );
+		sprite.flip = (SDL_RendererFlip)( ( seed >> 28 ) % 4 );
+		sprite.color.r = 0x80 + ( ( seed >> 3 ) & 0x7F );
+		sprite.color.g = 0x80 + ( ( seed >> 10 ) & 0x7F );
+		sprite.color.b = 0x80 + ( ( seed >> 17 ) & 0x7F );
+		sprite.color.a = 0xFF;
+	}
+
+	return sprites;
+}
+
+//Moves sprites, bouncing off the screen edges
+void updateSprites( std::vector<Sprite>& sprites )
+{
+	for( size_t i = 0; i < sprites.size(); ++i )
+	{
+		Sprite& sprite = sprites[ i ];
+		sprite.x += sprite.vx;
+		sprite.y += sprite.vy;
+		if( sprite.x < 0 || sprite.x > SCREEN_WIDTH - sprite.w )
+		{
+			sprite.vx = -sprite.vx;
+			sprite.x += 2 * sprite.vx;
+		}
+		if( sprite.y < 0 || sprite.y > SCREEN_HEIGHT - sprite.h )
+		{
+			sprite.vy = -sprite.vy;
+			sprite.y += 2 * sprite.vy;
+		}
+	}
+}
+
+//Writes one sprite's quad
+void writeSpriteQuad( const Sprite& sprite, SDL_Vertex* vertex )
+{
+	float u0 = ( sprite.flip & SDL_FLIP_HORIZONTAL ) ? 1.0f : 0.0f;
+	float u1 = 1.0f - u0;
+	float v0 = ( sprite.flip & SDL_FLIP_VERTICAL ) ? 1.0f : 0.0f;
+	float v1 = 1.0f - v0;
+	float x1 = sprite.x + sprite.w;
+	float y1 = sprite.y + sprite.h;
+
+	vertex[ 0 ].position = { sprite.x, sprite.y };
+	vertex[ 0 ].tex_coord = { u0, v0 };
+	vertex[ 1 ].position = { x1, sprite.y };
+	vertex[ 1 ].tex_coord = { u1, v0 };
+	vertex[ 2 ].position = { x1, y1 };
+	vertex[ 2 ].tex_coord = { u1, v1 };
+	vertex[ 3 ].position = { sprite.x, y1 };
+	vertex[ 3 ].tex_coord = { u0, v1 };
+	vertex[ 0 ].color = vertex[ 1 ].color = vertex[ 2 ].color = vertex[ 3 ].color = sprite.color;
+}
+
+//Makes sure the shared index buffer covers count quads
+void ensureIndices( size_t count )
+{
+	//Indices never change, only build them when the sprite count grows
+	if( gIndices.size() < count * 6 )
+	{
+		size_t first = gIndices.size() / 6;
+		gIndices.resize( count * 6 );
+		for( size_t i = first; i < count; ++i )
+		{
+			int v = i * 4;
+			int* index = &gIndices[ i * 6 ];
+			index[ 0 ] = v;
+			index[ 1 ] = v + 1;
+			index[ 2 ] = v + 2;
+			index[ 3 ] = v + 2;
+			index[ 4 ] = v + 3;
+			index[ 5 ] = v;
+		}
+	}
+}
+
+//Draws every sprite with one SDL_RenderGeometry call
+void renderSpritesGeometry( SDL_Renderer* renderer, SDL_Texture* texture, const std::vector<Sprite>& sprites )
+{
+	size_t count = sprites.size();
+	ensureIndices( count );
+	if( gVertices.size() < count * 4 )
+	{
+		gVertices.resize( count * 4 );
+	}
+
+	for( size_t i = 0; i < count; ++i )
+	{
+		writeSpriteQuad( sprites[ i ], &gVertices[ i * 4 ] );
+	}
+
+	SDL_RenderGeometry( renderer, texture, gVertices.data(), count * 4, gIndices.data(), count * 6 );
+}
+
+//Draws the sprites grouped by mip level, one SDL_RenderGeometry call per level (UVs are normalized so every level uses the same ones)
+void renderSpritesGeometryMip( SDL_Renderer* renderer, const std::vector<Sprite>& sprites )
+{
+	gLevelVertices.resize( gMip.levels.size() );
+	for( size_t level = 0; level < gLevelVertices.size(); ++level )
+	{
+		gLevelVertices[ level ].clear();
+	}
+
+	for( size_t i = 0; i < sprites.size(); ++i )
+	{
+		const Sprite& sprite = sprites[ i ];
+		std::vector<SDL_Vertex>& vertices = gLevelVertices[ selectMipLevel( gMip, (float)gMip.width, (float)gMip.height, (float)sprite.w, (float)sprite.h ) ];
+		vertices.resize( vertices.size() + 4 );
+		writeSpriteQuad( sprite, &vertices[ vertices.size() - 4 ] );
+	}
+
+	ensureIndices( sprites.size() );
+	for( size_t level = 0; level < gLevelVertices.size(); ++level )
+	{
+		int quads = gLevelVertices[ level ].size() / 4;
+		if( quads > 0 )
+		{
+			SDL_RenderGeometry( renderer, gMip.levels[ level ], gLevelVertices[ level ].data(), quads * 4, gIndices.data(), quads * 6 );
+		}
+	}
+}
+
+//Draws one frame of sprites
+void renderSprites( SDL_Renderer* renderer, SDL_Texture* texture, const std::vector<Sprite>& sprites, SpriteMode mode )
+{
+	SDL_SetRenderDrawColor( renderer, 0xFF, 0xFF, 0xFF, 0xFF );
+	SDL_RenderClear( renderer );
+
+	if( mode == SPRITE_MODE_GEOMETRY )
+	{
+		renderSpritesGeometry( renderer, texture, sprites );
+	}
+	else if( mode == SPRITE_MODE_GEOMETRY_MIP )
+	{
+		renderSpritesGeometryMip( renderer, sprites );
+	}
+	else if( mode == SPRITE_MODE_COPY_EX_MIP )
+	{
+		for( size_t i = 0; i < sprites.size(); ++i )
+		{
+			//Color mod only on the level this sprite samples
+			const Sprite& sprite = sprites[ i ];
+			SDL_Rect dst = { (int)sprite.x, (int)sprite.y, sprite.w, sprite.h };
+			int level = selectMipLevel( gMip, (float)gMip.width, (float)gMip.height, (float)sprite.w, (float)sprite.h );
+			SDL_SetTextureColorMod( gMip.levels[ level ], sprite.color.r, sprite.color.g, sprite.color.b );
+			renderCopyMip( renderer, gMip, NULL, &dst, sprite.flip );
+		}
+	}
+	else
+	{
+		for( size_t i = 0; i < sprites.size(); ++i )
+		{
+			const Sprite& sprite = sprites[ i ];
+			SDL_Rect dst = { (int)sprite.x, (int)sprite.y, sprite.w, sprite.h };
+			SDL_SetTextureColorMod( texture, sprite.color.r, sprite.color.g, sprite.color.b );
+			if( mode == SPRITE_MODE_COPY )
+			{
+				SDL_RenderCopy( renderer, texture, NULL, &dst );
+			}
+			else
+			{
+				SDL_RenderCopyEx( renderer, texture, NULL, &dst, 0.0, NULL, sprite.flip );
+			}
+		}
+	}
+
+	SDL_RenderPresent( renderer );
+}
+
+int main( int argc, char* args[] )
+{
+	std::vector<int> counts = { 1000, 10000, 100000, 1000000 };
+	int frames = 10;
+	std::string driver;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--counts" && i + 1 < argc )
+		{
+			counts.clear();
+			std::string list = args[ ++i ];
+			for( size_t start = 0; start < list.size(); )
+			{
+				size_t comma = list.find( ',', start );
+				if( comma == std::string::npos )
+				{
+					comma = list.size();
+				}
+				int count = atoi( list.substr( start, comma - start ).c_str() );
+				if( count > 0 )
+				{
+					counts.push_back( count );
+				}
+				start = comma + 1;
+			}
+		}
+		else if( arg == "--frames" && i + 1 < argc )
+		{
+			frames = atoi( args[ ++i ] );
+			frames = SDL_max( 1, frames );
+		}
+		else if( arg == "--driver" && i + 1 < argc )
+		{
+			driver = args[ ++i ];
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Usage: %s [--counts 1000,10000] [--frames N] [--driver name] [--json out.json]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+
+	//Run headless unless told otherwise
+	if( getenv( "SDL_VIDEODRIVER" ) == NULL )
+	{
+		SDL_SetHint( SDL_HINT_VIDEODRIVER, "offscreen" );
+	}
+	if( SDL_Init( SDL_INIT_VIDEO ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	//Software renderer into a plain surface, or the named backend on a hidden window
+	SDL_Surface* target = NULL;
+	SDL_Window* window = NULL;
+	SDL_Renderer* renderer = NULL;
+	if( driver.empty() || driver == "software" )
+	{
+		driver = "software";
+		target = SDL_CreateRGBSurfaceWithFormat( 0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888 );
+		renderer = target != NULL ? SDL_CreateSoftwareRenderer( target ) : NULL;
+	}
+	else
+	{
+		//An unknown name would get SDL's default backend with the results labeled as the one asked for
+		int index = findRenderDriver( driver );
+		if( index < 0 )
+		{
+			printf( "No %s render driver!\n", driver.c_str() );
+			SDL_Quit();
+			return 1;
+		}
+		window = SDL_CreateWindow( "Sprite bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN );
+		renderer = window != NULL ? SDL_CreateRenderer( window, index, 0 ) : NULL;
+	}
+	if( renderer == NULL )
+	{
+		printf( "Renderer could not be created! SDL Error: %s\n", SDL_GetError() );
+		SDL_Quit();
+		return 1;
+	}
+
+	//Load 07's texture
+	SDL_Texture* texture = NULL;
+	SDL_Surface* loadedSurface = ensureImageInit( IMG_INIT_PNG ) ? IMG_Load( TEXTURE_PATH ) : NULL;
+	if( loadedSurface == NULL )
+	{
+		printf( "Unable to load image %s! SDL_image Error: %s\n", TEXTURE_PATH, IMG_GetError() );
+	}
+	else
+	{
+		texture = SDL_CreateTextureFromSurface( renderer, loadedSurface );
+
+		//The mip chain is built from the same pixels, 32-bit so the box filter can run on it
+		double mipStart = benchNowMs();
+		SDL_Surface* mipSurface = SDL_ConvertSurfaceFormat( loadedSurface, SDL_PIXELFORMAT_ARGB8888, 0 );
+		if( mipSurface == NULL || !createMipTexture( renderer, mipSurface, gMip ) )
+		{
+			printf( "Unable to create mip chain! SDL Error: %s\n", SDL_GetError() );
+		}
+		else
+		{
+			printf( "Built %d mip levels in %.2f ms\n", (int)gMip.levels.size(), benchNowMs() - mipStart );
+		}
+		SDL_FreeSurface( mipSurface );
+		SDL_FreeSurface( loadedSurface );
+	}
+	if( texture == NULL || gMip.levels.empty() )
+	{
+		printf( "Unable to create texture! SDL Error: %s\n", SDL_GetError() );
+		SDL_DestroyRenderer( renderer );
+		SDL_Quit();
+		return 1;
+	}
+	SDL_SetTextureBlendMode( texture, SDL_BLENDMODE_BLEND );
+	setMipTextureBlendMode( gMip, SDL_BLENDMODE_BLEND );
+
+	BenchReport report;
+	report.suite = "sprite_bench";
+
+	printf( "%s renderer, %d frames per point\n", driver.c_str(), frames );
+	printf( "%10s %10s %12s %12s\n", "sprites", "mode", "median ms", "sprites/ms" );
+	for( size_t c = 0; c < counts.size(); ++c )
+	{
+		for( int m = 0; m < SPRITE_MODE_TOTAL; ++m )
+		{
+			SpriteMode mode = (SpriteMode)m;
+			std::vector<Sprite> sprites = makeSprites( counts[ c ] );
+
+			//One untimed frame to build buffers and warm caches
+			renderSprites( renderer, texture, sprites, mode );
+
+			std::vector<double> samples;
+			for( int frame = 0; frame < frames; ++frame )
+			{
+				double start = benchNowMs();
+				updateSprites( sprites );
+				renderSprites( renderer, texture, sprites, mode );
+				samples.push_back( benchNowMs() - start );
+			}
+
+			BenchStats stats = summarizeSamples( samples );
+			double spritesPerMs = stats.median > 0.0 ? counts[ c ] / stats.median : 0.0;
+			printf( "%10d %10s %12.3f %12.1f\n", counts[ c ], SPRITE_MODE_NAMES[ m ], stats.median, spritesPerMs );
+
+			BenchResult result;
+			result.name = "sprites";
+			result.params.push_back( std::make_pair( "renderer", driver ) );
+			result.params.push_back( std::make_pair( "mode", SPRITE_MODE_NAMES[ m ] ) );
+			result.params.push_back( std::make_pair( "sprites", std::to_string( counts[ c ] ) ) );
+			result.metrics.push_back( std::make_pair( "sprites_per_ms", spritesPerMs ) );
+			addStatsMetrics( result, stats );
+			report.results.push_back( result );
+		}
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	destroyMipTexture( gMip );
+	SDL_DestroyTexture( texture );
+	SDL_DestroyRenderer( renderer );
+	SDL_FreeSurface( target );
+	SDL_DestroyWindow( window );
+	IMG_Quit();
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*CPU frame upload benchmark.
+
+	stream_bench [--frames 200] [--window] [--json out.json]
+
+Draws a full frame on the CPU and gets it onto a renderer every way common/stream_framebuffer.h offers, at 640x480,
+1920x1080 and 3840x2160:
+	surface   draw into a surface, SDL_CreateTextureFromSurface, SDL_RenderCopy, SDL_DestroyTexture (what 07 and 08 do
+	          with --cpu-frame surface and --cpu-raster surface)
+	stream-1  draw into one streaming texture locked with SDL_LockTextureToSurface, then SDL_RenderCopy
+	stream-2  the same with two textures taking turns, the default
+	stream-3  three
+Each frame ends with SDL_RenderPresent. upload is everything but the drawing, the time a path adds on top of the
+rasterizer. By default the renderer is SDL's software renderer drawing into a surface, which needs no display;
+--window uses a hidden window and whatever renderer SDL picks for it, which is where GPU uploads and waits show up.
+*/
+
+//Using SDL, standard IO, strings and the streaming framebuffer
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../common/bench_report.h"
+#include "../../common/stream_framebuffer.h"
+
+//Ways of getting a frame onto the renderer
+enum UploadPath
+{
+	PATH_SURFACE,
+	PATH_STREAM_1,
+	PATH_STREAM_2,
+	PATH_STREAM_3,
+	PATH_TOTAL
+};
+const char* PATH_NAMES[ PATH_TOTAL ] = { "surface", "stream-1", "stream-2", "stream-3" };
+
+//A frame that changes every time, every pixel written like a rasterizer that clears would
+void drawFrame( SDL_Surface* target, int frame )
+{
+	for( int y = 0; y < target->h; ++y )
+	{
+		Uint32* row = (Uint32*)( (Uint8*)target->pixels + y * target->pitch );
+		Uint32 base = ( (Uint32)( ( y + frame ) & 0xFF ) << 8 ) | 0xFF000000;
+		for( int x = 0; x < target->w; ++x )
+		{
+			row[ x ] = base | ( (Uint32)( ( x + frame ) & 0xFF ) << 16 ) | (Uint32)( frame & 0xFF );
+		}
+	}
+}
+
+int main( int argc, char* args[] )
+{
+	int frames = 200;
+	bool useWindow = false;
+	const char* jsonPath = NULL;
+
+	//Read the command line
+	for( int i = 1; i < argc; ++i )
+	{
+		std::string arg = args[ i ];
+		if( arg == "--frames" && i + 1 < argc )
+		{
+			frames = atoi( args[ ++i ] );
+		}
+		else if( arg == "--window" )
+		{
+			useWindow = true;
+		}
+		else if( arg == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Usage: %s [--frames N] [--window] [--json out.json]\n", args[ 0 ] );
+			return 1;
+		}
+	}
+	frames = SDL_max( 1, frames );
+
+	if( SDL_Init( useWindow ? SDL_INIT_VIDEO : 0 ) < 0 )
+	{
+		printf( "SDL could not initialize! SDL Error: %s\n", SDL_GetError() );
+		return 1;
+	}
+
+	BenchReport report;
+	report.suite = "stream_bench";
+
+	printf( "%d frames per point, %s\n", frames, useWindow ? "window renderer" : "software renderer on a surface" );
+	printf( "%-10s %10s %10s %10s %10s %12s %10s\n", "size", "path", "frame ms", "draw ms", "upload ms", "copies/frame", "saved ms" );
+	const int sizes[ 3 ][ 2 ] = { { 640, 480 }, { 1920, 1080 }, { 3840, 2160 } };
+	for( int s = 0; s < 3; ++s )
+	{
+		int width = sizes[ s ][ 0 ];
+		int height = sizes[ s ][ 1 ];
+		char size[ 32 ];
+		SDL_snprintf( size, sizeof( size ), "%dx%d", width, height );
+
+		//The renderer draws into a surface the frame's size, or a hidden window
+		SDL_Window* window = NULL;
+		SDL_Surface* screen = NULL;
+		SDL_Renderer* renderer = NULL;
+		if( useWindow )
+		{
+			window = SDL_CreateWindow( "stream_bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, width, height, SDL_WINDOW_HIDDEN );
+			renderer = window != NULL ? SDL_CreateRenderer( window, -1, 0 ) : NULL;
+		}
+		else
+		{
+			screen = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, SDL_PIXELFORMAT_RGB888 );
+			renderer = screen != NULL ? SDL_CreateSoftwareRenderer( screen ) : NULL;
+		}
+		if( renderer == NULL )
+		{
+			printf( "Unable to create a %s renderer! SDL Error: %s\n", size, SDL_GetError() );
+			SDL_DestroyWindow( window );
+			SDL_FreeSurface( screen );
+			continue;
+		}
+		Uint32 format = preferredStreamFormat( renderer );
+
+		double surfaceUploadMs = 0.0;
+		for( int p = 0; p < PATH_TOTAL; ++p )
+		{
+			UploadPath path = (UploadPath)p;
+			SDL_Surface* surface = NULL;
+			StreamFramebuffer framebuffer = StreamFramebuffer();
+			CpuFrameStats surfaceStats = {};
+			bool ready = false;
+			if( path == PATH_SURFACE )
+			{
+				surface = SDL_CreateRGBSurfaceWithFormat( 0, width, height, 32, format );
+				ready = surface != NULL;
+			}
+			else
+			{
+				ready = createStreamFramebuffer( renderer, framebuffer, width, height, path - PATH_STREAM_1 + 1, format );
+			}
+			if( !ready )
+			{
+				printf( "%-10s %10s failed: %s\n", size, PATH_NAMES[ p ], SDL_GetError() );
+				continue;
+			}
+
+			//Frame 0 is an untimed warmup, its stats are dropped below
+			std::vector<double> samples;
+			for( int frame = -1; frame < frames; ++frame )
+			{
+				if( frame == 0 )
+				{
+					surfaceStats = CpuFrameStats();
+					framebuffer.stats = CpuFrameStats();
+				}
+
+				double start = benchNowMs();
+				if( path == PATH_SURFACE )
+				{
+					Uint64 drawStart = SDL_GetPerformanceCounter();
+					drawFrame( surface, frame );
+					surfaceStats.drawTicks += SDL_GetPerformanceCounter() - drawStart;
+					SDL_Texture* texture = uploadSurfaceFrame( renderer, surface, surfaceStats );
+					SDL_RenderCopy( renderer, texture, NULL, NULL );
+					SDL_DestroyTexture( texture );
+				}
+				else
+				{
+					SDL_Surface* target = lockStreamFramebuffer( framebuffer );
+					if( target != NULL )
+					{
+						Uint64 drawStart = SDL_GetPerformanceCounter();
+						drawFrame( target, frame );
+						framebuffer.stats.drawTicks += SDL_GetPerformanceCounter() - drawStart;
+						SDL_RenderCopy( renderer, unlockStreamFramebuffer( framebuffer ), NULL, NULL );
+					}
+				}
+				SDL_RenderPresent( renderer );
+				if( frame >= 0 )
+				{
+					samples.push_back( benchNowMs() - start );
+				}
+			}
+
+			CpuFrameStats& stats = path == PATH_SURFACE ? surfaceStats : framebuffer.stats;
+			BenchStats frameStats = summarizeSamples( samples );
+			double toMs = 1000.0 / SDL_GetPerformanceFrequency();
+			double drawMs = stats.frames > 0 ? stats.drawTicks * toMs / stats.frames : 0.0;
+
+			//Upload is the whole frame minus the drawing, so it includes the copy, the texture churn and any waiting
+			double uploadMs = frameStats.mean - drawMs;
+			if( path == PATH_SURFACE )
+			{
+				surfaceUploadMs = uploadMs;
+			}
+			double copies = stats.frames > 0 ? (double)stats.copies / stats.frames : 0.0;
+			double savedMs = surfaceUploadMs - uploadMs;
+			printf( "%-10s %10s %10.3f %10.3f %10.3f %12.2f %10.3f\n", size, PATH_NAMES[ p ], frameStats.median, drawMs, uploadMs, copies, savedMs );
+
+			BenchResult result;
+			result.name = "cpu_frame_upload";
+			result.params.push_back( std::make_pair( "size", size ) );
+			result.params.push_back( std::make_pair( "path", PATH_NAMES[ p ] ) );
+			result.params.push_back( std::make_pair( "renderer", useWindow ? "window" : "software" ) );
+			result.metrics.push_back( std::make_pair( "draw_ms", drawMs ) );
+			result.metrics.push_back( std::make_pair( "upload_ms", uploadMs ) );
+			result.metrics.push_back( std::make_pair( "copies_per_frame", copies ) );
+			result.metrics.push_back( std::make_pair( "saved_ms_vs_surface", savedMs ) );
+			addStatsMetrics( result, frameStats );
+			report.results.push_back( result );
+
+			destroyStreamFramebuffer( framebuffer );
+			SDL_FreeSurface( surface );
+		}
+
+		SDL_DestroyRenderer( renderer );
+		SDL_DestroyWindow( window );
+		SDL_FreeSurface( screen );
+	}
+
+	if( jsonPath != NULL )
+	{
+		writeBenchReport( report, jsonPath );
+	}
+
+	SDL_Quit();
+
+	return 0;
+}
@@ -0,0 +1,306 @@
+/*Telemetry reader: follows a lesson's shared memory telemetry ring from another process.
+
+	telemetry_reader NAME [--interval 1000] [--window 600] [--duration 0] [--json out.json] [--csv out.csv]
+
+NAME is what the lesson was given with --telemetry. The ring is mapped read only and polled every --interval ms; the writer
+never waits for the reader, so this only ever reads. Each poll copies the records published since the last one, retrying
+a slot the writer is in the middle of (torn) and counting the ones it overwrote before they were read (lost), and prints
+one line of rolling stats over the last --window frames: frame rate, mean, median, 99th percentile and worst frame time,
+mean and 99th percentile blit and present time, events per frame, resident memory, and how old the newest record is.
+--csv appends every record read, --json rewrites a report with the window's stats and series after every poll (through a
+temporary file, so whatever reads it never sees half of one) and once more at exit. Stops after --duration seconds (0 for
+never), on Ctrl+C, or when the writer has exited and everything it wrote has been read.
+Exits with 1 if the ring can't be opened, 0 otherwise.
+*/
+
+//Using SDL, standard IO, strings, the telemetry ring and the benchmark report writer
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include "../../common/telemetry_ring.h"
+#include "../../common/bench_report.h"
+
+//Set by Ctrl+C
+volatile sig_atomic_t gStop = 0;
+
+void stopReading( int signal )
+{
+	gStop = 1;
+}
+
+//Tries to copy a slot again this many times while the writer is in it
+const int TORN_RETRIES = 4;
+
+//Rolling window and what reading it has run into
+struct ReaderState
+{
+	std::deque<TelemetryRecord> window;
+	size_t windowSize;
+	Uint64 next;
+	Uint64 read;
+	Uint64 lost;
+	Uint64 torn;
+	Uint64 peakRssBytes;
+};
+
+//Copies everything published since the last poll into the window, returns how many records were read
+int pollRing( const TelemetryRing& ring, ReaderState& state, FILE* csv )
+{
+	Uint64 written = telemetryWritten( ring );
+	Uint64 capacity = ring.header->capacity;
+
+	//Fell more than a ring behind, what was in between is gone
+	if( written - state.next > capacity )
+	{
+		state.lost += written - capacity - state.next;
+		state.next = written - capacity;
+	}
+
+	int count = 0;
+	for( ; state.next < written; ++state.next )
+	{
+		TelemetryRecord record;
+		TelemetryReadResult result = readTelemetry( ring, state.next, record );
+		for( int retry = 0; retry < TORN_RETRIES && result == TELEMETRY_READ_TORN; ++retry )
+		{
+			++state.torn;
+			result = readTelemetry( ring, state.next, record );
+		}
+		if( result != TELEMETRY_READ_OK )
+		{
+			++state.lost;
+			continue;
+		}
+
+		state.window.push_back( record );
+		if( state.window.size() > state.windowSize )
+		{
+			state.window.pop_front();
+		}
+		state.peakRssBytes = SDL_max( state.peakRssBytes, record.rssBytes );
+		++state.read;
+		++count;
+
+		if( csv != NULL )
+		{
+			fprintf( csv, "%llu,%llu,%.4f,%.4f,%.4f,%u,%llu\n", (unsigned long long)record.frame, (unsigned long long)record.timeNs,
+				record.frameMs, record.blitMs, record.presentMs, record.events, (unsigned long long)record.rssBytes );
+		}
+	}
+	return count;
+}
+
+//The window's stats as a report result, series included
+BenchResult windowResult( const TelemetryRing& ring, const ReaderState& state )
+{
+	std::vector<double> frameMs, blitMs, presentMs, events, rssMb;
+	for( size_t i = 0; i < state.window.size(); ++i )
+	{
+		const TelemetryRecord& record = state.window[ i ];
+
+		//The first record has no frame before it to time against
+		if( record.frame > 0 )
+		{
+			frameMs.push_back( record.frameMs );
+		}
+		blitMs.push_back( record.blitMs );
+		presentMs.push_back( record.presentMs );
+		events.push_back( record.events );
+		rssMb.push_back( record.rssBytes / ( 1024.0 * 1024.0 ) );
+	}
+
+	BenchResult result;
+	result.name = "telemetry";
+	result.params.push_back( std::make_pair( "ring", ring.name ) );
+	result.params.push_back( std::make_pair( "writer_pid", std::to_string( (unsigned long long)ring.header->pid ) ) );
+	result.params.push_back( std::make_pair( "window", std::to_string( state.windowSize ) ) );
+
+	BenchStats frame = summarizeSamples( frameMs );
+	BenchStats blit = summarizeSamples( blitMs );
+	BenchStats present = summarizeSamples( presentMs );
+	BenchStats event = summarizeSamples( events );
+	addStatsMetrics( result, frame );
+	result.metrics.push_back( std::make_pair( "fps", frame.mean > 0.0 ? 1000.0 / frame.mean : NAN ) );
+	result.metrics.push_back( std::make_pair( "blit_mean_ms", blit.mean ) );
+	result.metrics.push_back( std::make_pair( "blit_p99_ms", blit.p99 ) );
+	result.metrics.push_back( std::make_pair( "present_mean_ms", present.mean ) );
+	result.metrics.push_back( std::make_pair( "present_p99_ms", present.p99 ) );
+	result.metrics.push_back( std::make_pair( "events_per_frame", event.mean ) );
+	result.metrics.push_back( std::make_pair( "rss_mb", rssMb.empty() ? NAN : rssMb.back() ) );
+	result.metrics.push_back( std::make_pair( "rss_peak_mb", state.peakRssBytes / ( 1024.0 * 1024.0 ) ) );
+	result.metrics.push_back( std::make_pair( "age_ms", state.window.empty() ? NAN : ( telemetryNowNs() - state.window.back().timeNs ) / 1000000.0 ) );
+	result.metrics.push_back( std::make_pair( "records_read", (double)state.read ) );
+	result.metrics.push_back( std::make_pair( "records_lost", (double)state.lost ) );
+	result.metrics.push_back( std::make_pair( "torn_reads", (double)state.torn ) );
+
+	result.series.push_back( std::make_pair( "frame_ms", frameMs ) );
+	result.series.push_back( std::make_pair( "blit_ms", blitMs ) );
+	result.series.push_back( std::make_pair( "present_ms", presentMs ) );
+	result.series.push_back( std::make_pair( "events", events ) );
+	result.series.push_back( std::make_pair( "rss_mb", rssMb ) );
+	return result;
+}
+
+double metric( const BenchResult& result, const char* name )
+{
+	for( size_t i = 0; i < result.metrics.size(); ++i )
+	{
+		if( result.metrics[ i ].first == name )
+		{
+			return result.metrics[ i ].second;
+		}
+	}
+	return NAN;
+}
+
+void printWindow( const BenchResult& result, const ReaderState& state )
+{
+	printf( "frame %llu: %.1f fps, frame %.2f mean %.2f median %.2f p99 %.2f max ms, blit %.3f/%.3f ms, present %.3f/%.3f ms, "
+		"%.2f events, %.1f MB, %.0f ms old, %llu lost, %llu torn\n", (unsigned long long)( state.next > 0 ? state.next - 1 : 0 ),
+		metric( result, "fps" ), metric( result, "mean_ms" ), metric( result, "median_ms" ), metric( result, "p99_ms" ), metric( result, "max_ms" ),
+		metric( result, "blit_mean_ms" ), metric( result, "blit_p99_ms" ), metric( result, "present_mean_ms" ), metric( result, "present_p99_ms" ),
+		metric( result, "events_per_frame" ), metric( result, "rss_mb" ), metric( result, "age_ms" ), (unsigned long long)state.lost,
+		(unsigned long long)state.torn );
+	fflush( stdout );
+}
+
+//Writes the report next to path and renames it over path
+bool exportWindow( const BenchResult& result, const std::string& path )
+{
+	BenchReport report;
+	report.suite = "telemetry_reader";
+	report.results.push_back( result );
+
+	std::string temporary = path + ".tmp";
+	if( !writeBenchReport( report, temporary.c_str() ) )
+	{
+		return false;
+	}
+	if( rename( temporary.c_str(), path.c_str() ) != 0 )
+	{
+		printf( "Unable to replace %s!\n", path.c_str() );
+		return false;
+	}
+	return true;
+}
+
+int main( int argc, char* args[] )
+{
+	if( argc < 2 || args[ 1 ][ 0 ] == '-' )
+	{
+		printf( "Usage: telemetry_reader NAME [--interval 1000] [--window 600] [--duration 0] [--json out.json] [--csv out.csv]\n" );
+		return 1;
+	}
+
+	std::string name = args[ 1 ];
+	int intervalMs = 1000;
+	int windowSize = 600;
+	double duration = 0.0;
+	std::string jsonPath;
+	std::string csvPath;
+	for( int i = 2; i < argc; ++i )
+	{
+		if( std::string( args[ i ] ) == "--interval" && i + 1 < argc )
+		{
+			intervalMs = atoi( args[ ++i ] );
+			intervalMs = SDL_max( 1, intervalMs );
+		}
+		else if( std::string( args[ i ] ) == "--window" && i + 1 < argc )
+		{
+			windowSize = atoi( args[ ++i ] );
+			windowSize = SDL_max( 1, windowSize );
+		}
+		else if( std::string( args[ i ] ) == "--duration" && i + 1 < argc )
+		{
+			duration = atof( args[ ++i ] );
+		}
+		else if( std::string( args[ i ] ) == "--json" && i + 1 < argc )
+		{
+			jsonPath = args[ ++i ];
+		}
+		else if( std::string( args[ i ] ) == "--csv" && i + 1 < argc )
+		{
+			csvPath = args[ ++i ];
+		}
+		else
+		{
+			printf( "Unknown option %s\n", args[ i ] );
+			return 1;
+		}
+	}
+
+	TelemetryRing ring;
+	if( !openTelemetryReader( ring, name ) )
+	{
+		return 1;
+	}
+	printf( "Reading %s from pid %llu, %u frame ring\n", ring.name.c_str(), (unsigned long long)ring.header->pid, ring.header->capacity );
+
+	FILE* csv = NULL;
+	if( !csvPath.empty() )
+	{
+		csv = fopen( csvPath.c_str(), "w" );
+		if( csv == NULL )
+		{
+			printf( "Unable to write %s!\n", csvPath.c_str() );
+			closeTelemetryRing( ring );
+			return 1;
+		}
+		fprintf( csv, "frame,time_ns,frame_ms,blit_ms,present_ms,events,rss_bytes\n" );
+	}
+
+	//Start with what is already there, up to a window
+	ReaderState state = ReaderState();
+	state.windowSize = windowSize;
+	Uint64 written = telemetryWritten( ring );
+	state.next = written - SDL_min( written, (Uint64)SDL_min( (Uint32)windowSize, ring.header->capacity ) );
+
+	signal( SIGINT, stopReading );
+	signal( SIGTERM, stopReading );
+	double start = benchNowMs();
+	while( !gStop )
+	{
+		//Checked before reading, so records written right before the writer exits are still read
+		bool alive = telemetryWriterAlive( ring );
+		int count = pollRing( ring, state, csv );
+
+		BenchResult result = windowResult( ring, state );
+		printWindow( result, state );
+		if( !jsonPath.empty() )
+		{
+			exportWindow( result, jsonPath );
+		}
+
+		if( !alive && count == 0 )
+		{
+			printf( "Writer %llu has exited\n", (unsigned long long)ring.header->pid );
+			break;
+		}
+		if( duration > 0.0 && benchNowMs() - start >= duration * 1000.0 )
+		{
+			break;
+		}
+		SDL_Delay( intervalMs );
+	}
+
+	//Last of it, in case the loop stopped between polls
+	pollRing( ring, state, csv );
+	BenchResult result = windowResult( ring, state );
+	printf( "Read %llu records, %llu lost, %llu torn reads retried\n", (unsigned long long)state.read, (unsigned long long)state.lost,
+		(unsigned long long)state.torn );
+	if( !jsonPath.empty() )
+	{
+		exportWindow( result, jsonPath );
+	}
+
+	if( csv != NULL )
+	{
+		fclose( csv );
+	}
+	closeTelemetryRing( ring );
+	return 0;
+}